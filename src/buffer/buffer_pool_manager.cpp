@@ -1,28 +1,48 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <tuple>
+
 #include "buffer/buffer_pool_manager.h"
 #include "glog/logging.h"
 #include "page/bitmap_page.h"
 
-BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager) {
-  pages_ = new Page[pool_size_];
-  //启用LRU替换策略
-  replacer_ = new LRUReplacer(pool_size_);
-  //启用Clock替换策略
-//  replacer_ = new ClockReplacer(pool_size_);
-  for (size_t i = 0; i < pool_size_; i++) {
-    free_list_.emplace_back(i);
+BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager,
+                                     ReplacerType replacer_type, bool enable_cleaner)
+    : pool_size_(0),
+      disk_manager_(disk_manager),
+      log_manager_(log_manager),
+      num_shards_(std::max<size_t>(1, std::min<size_t>(MAX_BUFFER_POOL_SHARDS, pool_size / BUFFER_POOL_SHARD_FRAMES))),
+      shards_(num_shards_) {
+  for (auto &shard : shards_) {
+    shard.replacer_ = Replacer::Create(replacer_type, pool_size / num_shards_ + 1, &replacer_clock_);
+  }
+  AddFrames(pool_size);
+  clean_buffer_ = new char[BUFFER_POOL_CLEAN_BATCH * PAGE_SIZE];
+  if (enable_cleaner) {
+    cleaner_thread_ = std::thread(&BufferPoolManager::RunCleaner, this);
   }
 }
 
 BufferPoolManager::~BufferPoolManager() {
-  for (auto page : page_table_) {
-    FlushPage(page.first);
+  {
+    std::scoped_lock<std::mutex> lock(cleaner_latch_);
+    stop_ = true;
+  }
+  cleaner_cv_.notify_all();
+  if (cleaner_thread_.joinable()) {
+    cleaner_thread_.join();
+  }
+  // 等预读都完成，回调里要用到shard
+  disk_manager_->WaitIO();
+  FlushAllPages();
+  delete[] clean_buffer_;
+  for (auto &shard : shards_) {
+    delete shard.replacer_;
   }
-  delete[] pages_;
-  delete replacer_;
 }
 
-Page *BufferPoolManager::FetchPage(page_id_t page_id) {
+Page *BufferPoolManager::FetchPage(page_id_t page_id, bool scan) {
   // 1.     Search the page table for the requested page (P).
   // 1.1    If P exists, pin it and return it immediately.
   // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
@@ -37,45 +57,51 @@ Page *BufferPoolManager::FetchPage(page_id_t page_id) {
   //        replacer，此时FetchPage把这个Page直接拿来用了，那么这个修改过的脏数据就丢失了
   // 3.     Delete R from the page table and insert P.
   // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
-  if (page_table_.find(page_id) != page_table_.end()) {
-    replacer_->Pin(page_table_[page_id]);
-    pages_[page_table_[page_id]].pin_count_++;
-//    cout << "+";
-    return pages_ + page_table_[page_id];
-  } else {
-    frame_id_t free_page_index;
-    if (free_list_.size() > 0) {
-      // 简单起见，直接从末尾拿一个吧
-      free_page_index = free_list_.back();
-      free_list_.pop_back();
-    } else if (replacer_->Size() > 0) {
-      frame_id_t *free_frame_receiver = new frame_id_t;
-      replacer_->Victim(free_frame_receiver);
-      free_page_index = *free_frame_receiver;
-      delete free_frame_receiver;
-    } else {
-      return nullptr;
+  Shard &shard = GetShard(page_id);
+  std::unique_lock<std::mutex> lock(shard.latch_);
+  frame_id_t free_page_index;
+  while (true) {
+    auto it = WaitForRead(shard, lock, page_id);
+    if (it != shard.page_table_.end()) {
+      shard.hits_++;
+      Page *page = GetFrame(it->second);
+      // 扫描之外又访问到了预读的页，说明它不只是被扫描一次，之后按普通页对待
+      if (!scan) {
+        page->cold_ = false;
+      }
+      if (page->pin_count_++ == 0) {
+        shard.replacer_->Pin(it->second);
+      }
+      return page;
     }
-    // TODO: 1.dirty的判定，什么时候dirty? => 在UnpinPage时，由调用者传入是否dirty，因为可能有多个调用者，所以应该用一个或关系
-    //       2.既然有dirty，那么这个page在buffer中的写又在哪里实现? =>
-    //       返回的是Page*，而Page类中GetData可以获取data的指针，从指针修改写入即可
-    if (pages_[free_page_index].is_dirty_) {
-      disk_manager_->WritePage(pages_[free_page_index].page_id_, pages_[free_page_index].data_);
+    if ((free_page_index = GetFreeFrame(shard)) != INVALID_FRAME_ID) {
+      break;
     }
-    // 更新page_table_，更新pages_中的那一页page
-    page_table_.erase(pages_[free_page_index].page_id_);
-    // Page对象里设置了不允许复制，也即重载了运算符=
-    //    pages_[free_page_index] = Page();
-    pages_[free_page_index].ResetMemory();
-    pages_[free_page_index].is_dirty_ = false;
-    pages_[free_page_index].page_id_ = page_id;
-    page_table_[page_id] = free_page_index;
-    disk_manager_->ReadPage(page_id, pages_[free_page_index].data_);
-    replacer_->Pin(free_page_index);
-    pages_[free_page_index].pin_count_++;
-//    cout << "+";
-    return pages_ + free_page_index;
+    // 这个shard的帧都被pin住了，向别的shard借一个；借的时候放开了latch，这一页可能已经被别人读进来了，要重新查
+    lock.unlock();
+    if (!BorrowFrame(shard)) {
+      return nullptr;
+    }
+    lock.lock();
+  }
+  shard.misses_++;
+  // TODO: 1.dirty的判定，什么时候dirty? => 在UnpinPage时，由调用者传入是否dirty，因为可能有多个调用者，所以应该用一个或关系
+  //       2.既然有dirty，那么这个page在buffer中的写又在哪里实现? =>
+  //       返回的是Page*，而Page类中GetData可以获取data的指针，从指针修改写入即可
+  Page *page = GetFrame(free_page_index);
+  page->page_id_ = page_id;
+  shard.page_table_.emplace(page_id, free_page_index);
+  // 后台正在写的页，等写完再读，否则读到的是旧的内容
+  WaitForWrite(page_id);
+  disk_manager_->ReadPage(page_id, page->data_);
+  if (log_manager_ != nullptr) {
+    memcpy(GetSnapshot(free_page_index), page->data_, PAGE_SIZE);
   }
+  page->pin_count_ = 1;
+  // 读进来也算一次访问
+  shard.replacer_->SetPage(free_page_index, page_id);
+  shard.replacer_->Pin(free_page_index);
+  return page;
 }
 
 Page *BufferPoolManager::NewPage(page_id_t &page_id) {
@@ -84,35 +110,508 @@ Page *BufferPoolManager::NewPage(page_id_t &page_id) {
   // 2.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
   // 3.   Update P's metadata, zero out memory and add P to the page table.
   // 4.   Set the page ID output parameter. Return a pointer to P.
+  // 新page属于哪个shard由page_id决定，所以要先从disk中分配page_id，shard满了再还回去
+  page_id_t new_page_id = AllocatePage();
+  Shard &shard = GetShard(new_page_id);
+  std::unique_lock<std::mutex> lock(shard.latch_);
+  frame_id_t free_page_index;
+  while ((free_page_index = GetFreeFrame(shard)) == INVALID_FRAME_ID) {
+    lock.unlock();
+    if (!BorrowFrame(shard)) {
+      DeallocatePage(new_page_id);
+      return nullptr;
+    }
+    lock.lock();
+  }
+  Page *page = GetFrame(free_page_index);
+  page->page_id_ = new_page_id;
+  shard.page_table_.emplace(new_page_id, free_page_index);
+  if (log_manager_ != nullptr) {
+    // 磁盘上这一页可能还留着被删除前的内容，redo时要先清零
+    LogRecord record(LogRecordType::kNewPage, new_page_id);
+    page->log_lsn_ = log_manager_->AppendLogRecord(&record);
+    page->rec_lsn_ = page->log_lsn_;
+    memset(GetSnapshot(free_page_index), 0, PAGE_SIZE);
+  }
+  page->pin_count_ = 1;
+  shard.replacer_->SetPage(free_page_index, new_page_id);
+  shard.replacer_->Pin(free_page_index);
+  page_id = new_page_id;
+  return page;
+}
+
+frame_id_t BufferPoolManager::GetFreeFrame(Shard &shard) {
   frame_id_t free_page_index;
-  if (free_list_.size() > 0) {
-    free_page_index = free_list_.back();
-    free_list_.pop_back();
-  } else if (replacer_->Size() > 0) {
-    frame_id_t *free_frame_receiver = new frame_id_t;
-    replacer_->Victim(free_frame_receiver);
-    free_page_index = *free_frame_receiver;
-    delete free_frame_receiver;
+  if (!shard.free_list_.empty()) {
+    // 简单起见，直接从末尾拿一个吧
+    free_page_index = shard.free_list_.back();
+    shard.free_list_.pop_back();
+  } else if (!shard.replacer_->Victim(&free_page_index)) {
+    return INVALID_FRAME_ID;
+  }
+  // 其他类可以调用并修改buffer pool中的page，被替换的page若是dirty的，需要先写回disk
+  // 后台的cleaner没来得及写，由前台写，并叫醒cleaner
+  Page *page = GetFrame(free_page_index);
+  if (page->is_dirty_) {
+    WriteBack(free_page_index);
+    foreground_writes_++;
+    RequestClean();
+  }
+  // 更新page_table_，Page对象里设置了不允许复制，只能手动重置
+  if (page->page_id_ != INVALID_PAGE_ID) {
+    shard.page_table_.erase(page->page_id_);
+  }
+  page->ResetMemory();
+  page->page_id_ = INVALID_PAGE_ID;
+  page->is_dirty_ = false;
+  page->pin_count_ = 0;
+  page->log_lsn_ = INVALID_LSN;
+  page->rec_lsn_ = INVALID_LSN;
+  page->cold_ = false;
+  return free_page_index;
+}
+
+bool BufferPoolManager::BorrowFrame(Shard &shard) {
+  size_t index = &shard - shards_.data();
+  frame_id_t frame_id = INVALID_FRAME_ID;
+  // 先找有空闲帧的shard，都没有才换出别的shard里的页
+  for (bool evict : {false, true}) {
+    for (size_t i = 1; i < num_shards_ && frame_id == INVALID_FRAME_ID; i++) {
+      Shard &donor = shards_[(index + i) % num_shards_];
+      std::scoped_lock<std::mutex> lock(donor.latch_);
+      if (!evict && donor.free_list_.empty()) {
+        continue;
+      }
+      frame_id = GetFreeFrame(donor);
+      if (frame_id != INVALID_FRAME_ID) {
+        donor.replacer_->Remove(frame_id);
+        SetFrameCount(donor, donor.frame_count_ - 1);
+      }
+    }
+  }
+  if (frame_id == INVALID_FRAME_ID) {
+    return false;
+  }
+  std::scoped_lock<std::mutex> lock(shard.latch_);
+  shard.free_list_.emplace_back(frame_id);
+  SetFrameCount(shard, shard.frame_count_ + 1);
+  return true;
+}
+
+std::unordered_map<page_id_t, frame_id_t>::iterator BufferPoolManager::WaitForRead(Shard &shard,
+                                                                                std::unique_lock<std::mutex> &lock,
+                                                                                page_id_t page_id) {
+  auto it = shard.page_table_.find(page_id);
+  while (it != shard.page_table_.end() && shard.reading_.count(it->second) > 0) {
+    shard.read_done_.wait(lock);
+    // 读失败时这一页会被移出page table
+    it = shard.page_table_.find(page_id);
+  }
+  return it;
+}
+
+size_t BufferPoolManager::PrefetchPages(const std::vector<page_id_t> &page_ids, bool cold) {
+  std::vector<std::tuple<page_id_t, frame_id_t, char *>> reads;
+  for (auto page_id : page_ids) {
+    Shard &shard = GetShard(page_id);
+    std::scoped_lock<std::mutex> lock(shard.latch_);
+    if (shard.page_table_.count(page_id) > 0) {
+      continue;
+    }
+    frame_id_t frame_id = GetFreeFrame(shard);
+    if (frame_id == INVALID_FRAME_ID) {
+      continue;
+    }
+    WaitForWrite(page_id);
+    // 读完之前不放进replacer，不会被换出去
+    Page *page = GetFrame(frame_id);
+    page->page_id_ = page_id;
+    page->cold_ = cold;
+    shard.page_table_.emplace(page_id, frame_id);
+    shard.replacer_->SetPage(frame_id, page_id);
+    shard.reading_.insert(frame_id);
+    reads.emplace_back(page_id, frame_id, page->data_);
+  }
+  // 提交时不能拿着shard的latch：队列满了要等别的请求完成，而完成回调要拿latch
+  for (auto &read : reads) {
+    page_id_t page_id = std::get<0>(read);
+    frame_id_t frame_id = std::get<1>(read);
+    disk_manager_->ReadPageAsync(page_id, std::get<2>(read),
+                                 [this, page_id, frame_id](bool ok) { FinishPrefetch(page_id, frame_id, ok); });
+  }
+  disk_manager_->SubmitIO();
+  return reads.size();
+}
+
+void BufferPoolManager::FinishPrefetch(page_id_t page_id, frame_id_t frame_id, bool ok) {
+  Shard &shard = GetShard(page_id);
+  std::scoped_lock<std::mutex> lock(shard.latch_);
+  shard.reading_.erase(frame_id);
+  Page *page = GetFrame(frame_id);
+  if (ok) {
+    if (log_manager_ != nullptr) {
+      memcpy(GetSnapshot(frame_id), page->data_, PAGE_SIZE);
+    }
+    if (page->cold_) {
+      shard.replacer_->UnpinCold(frame_id);
+    } else {
+      shard.replacer_->Unpin(frame_id);
+    }
   } else {
-    return nullptr;
-  }
-  if (pages_[free_page_index].is_dirty_) {
-    disk_manager_->WritePage(pages_[free_page_index].page_id_, pages_[free_page_index].data_);
-  }
-  // 更新page_table_，更新pages_中的那一页page
-  page_table_.erase(pages_[free_page_index].page_id_);
-  // 从disk中分配一个新的page_id，传进引用
-  page_id = AllocatePage();
-  // Page对象里设置了不允许复制，也即重载了运算符=
-  //    pages_[free_page_index] = Page();
-  pages_[free_page_index].ResetMemory();
-  pages_[free_page_index].is_dirty_ = false;
-  pages_[free_page_index].page_id_ = page_id;
-  page_table_[page_id] = free_page_index;
-  replacer_->Pin(free_page_index);
-  pages_[free_page_index].pin_count_ = 1;
-//  cout << "+";
-  return pages_ + free_page_index;
+    shard.page_table_.erase(page_id);
+    page->ResetMemory();
+    page->page_id_ = INVALID_PAGE_ID;
+    shard.free_list_.emplace_back(frame_id);
+  }
+  shard.read_done_.notify_all();
+}
+
+void BufferPoolManager::LogPageDelta(frame_id_t frame_id) {
+  Page *page = GetFrame(frame_id);
+  char *snapshot = GetSnapshot(frame_id);
+  LogRecord record(LogRecordType::kPageDelta, page->page_id_);
+  bool changed = false;
+  // 按8字节比较，找出与快照不同的区间；两段之间只隔8个相同字节时合并成一段，减少段头的开销
+  constexpr uint32_t WORD = sizeof(uint64_t);
+  uint32_t i = 0;
+  while (i < PAGE_SIZE) {
+    if (memcmp(page->data_ + i, snapshot + i, WORD) == 0) {
+      i += WORD;
+      continue;
+    }
+    uint32_t start = i;
+    uint32_t end = i + WORD;
+    while (end < PAGE_SIZE) {
+      if (memcmp(page->data_ + end, snapshot + end, WORD) != 0) {
+        end += WORD;
+      } else if (end + WORD < PAGE_SIZE && memcmp(page->data_ + end + WORD, snapshot + end + WORD, WORD) != 0) {
+        end += 2 * WORD;
+      } else {
+        break;
+      }
+    }
+    record.AppendDeltaRun(start, page->data_ + start, end - start);
+    memcpy(snapshot + start, page->data_ + start, end - start);
+    changed = true;
+    i = end;
+  }
+  if (changed) {
+    page->log_lsn_ = log_manager_->AppendLogRecord(&record);
+    if (page->rec_lsn_ == INVALID_LSN) {
+      page->rec_lsn_ = page->log_lsn_;
+    }
+  }
+}
+
+void BufferPoolManager::WriteBack(frame_id_t frame_id) {
+  Page *page = GetFrame(frame_id);
+  // cleaner写的是之前的副本，要等它写完，否则它可能覆盖掉这次写的内容
+  WaitForWrite(page->page_id_);
+  if (log_manager_ != nullptr) {
+    // write-ahead: 先把这一页还没记日志的修改记下来，并等日志落盘
+    LogPageDelta(frame_id);
+    log_manager_->Flush(page->log_lsn_);
+  }
+  disk_manager_->WritePage(page->page_id_, page->data_);
+  page->is_dirty_ = false;
+  page->rec_lsn_ = INVALID_LSN;
+}
+
+void BufferPoolManager::GetDirtyPageTable(std::vector<std::pair<page_id_t, lsn_t>> &dirty_pages) {
+  for (auto &shard : shards_) {
+    std::scoped_lock<std::mutex> lock(shard.latch_);
+    for (auto &entry : shard.page_table_) {
+      Page *page = GetFrame(entry.second);
+      if (page->rec_lsn_ != INVALID_LSN) {
+        dirty_pages.emplace_back(entry.first, page->rec_lsn_);
+      }
+    }
+  }
+  // cleaner正在写的页可能已经被换出了，写完之前仍然算脏页
+  std::scoped_lock<std::mutex> lock(write_latch_);
+  for (auto &entry : writing_) {
+    if (entry.second != INVALID_LSN &&
+        std::none_of(dirty_pages.begin(), dirty_pages.end(), [&](auto &page) { return page.first == entry.first; })) {
+      dirty_pages.emplace_back(entry.first, entry.second);
+    }
+  }
+}
+
+size_t BufferPoolManager::CleanPages() {
+  std::scoped_lock<std::mutex> flush_lock(flush_latch_);
+  // 1. 统计可以换出的帧，找出其中没有在写的脏页
+  std::vector<std::pair<page_id_t, frame_id_t>> dirty;
+  size_t evictable = 0;
+  for (auto &shard : shards_) {
+    std::scoped_lock<std::mutex> lock(shard.latch_);
+    evictable += shard.free_list_.size();
+    for (auto &entry : shard.page_table_) {
+      Page *page = GetFrame(entry.second);
+      if (page->pin_count_ > 0 || shard.reading_.count(entry.second) > 0) {
+        continue;
+      }
+      evictable++;
+      if (page->is_dirty_) {
+        dirty.emplace_back(entry.first, entry.second);
+      }
+    }
+  }
+  size_t target = static_cast<size_t>(evictable * BUFFER_POOL_CLEAN_RATIO);
+  size_t clean = evictable - dirty.size();
+  if (clean >= target) {
+    return 0;
+  }
+  size_t count = std::min<size_t>({target - clean, dirty.size(), BUFFER_POOL_CLEAN_BATCH});
+  // 按页号顺序写，从上一轮停下的地方接着往后扫
+  std::sort(dirty.begin(), dirty.end());
+  auto start = std::lower_bound(dirty.begin(), dirty.end(), std::make_pair(clean_cursor_, INVALID_FRAME_ID));
+  std::rotate(dirty.begin(), start, dirty.end());
+  dirty.resize(count);
+  clean_cursor_ = std::max_element(dirty.begin(), dirty.end())->first + 1;
+  std::vector<std::vector<std::pair<page_id_t, frame_id_t>>> dirty_by_shard(num_shards_);
+  for (auto &entry : dirty) {
+    dirty_by_shard[static_cast<uint32_t>(entry.first) % num_shards_].push_back(entry);
+  }
+
+  // 2. 在shard latch下复制页的内容，页没被pin就不会有人在改它。
+  //    每个shard只进一次：拿着shard latch的前台线程可能在等这个shard里刚复制的页写完，cleaner不能回头再等这个latch
+  std::vector<std::pair<page_id_t, frame_id_t>> writes;
+  std::vector<std::pair<page_id_t, const char *>> copies;
+  lsn_t flush_lsn = INVALID_LSN;
+  for (size_t i = 0; i < num_shards_; i++) {
+    if (dirty_by_shard[i].empty()) {
+      continue;
+    }
+    std::scoped_lock<std::mutex> lock(shards_[i].latch_);
+    for (auto &entry : dirty_by_shard[i]) {
+      Page *page = GetFrame(entry.second);
+      if (page->page_id_ != entry.first || page->pin_count_ > 0 || !page->is_dirty_) {
+        continue;
+      }
+      if (log_manager_ != nullptr) {
+        LogPageDelta(entry.second);
+        flush_lsn = std::max(flush_lsn, page->log_lsn_);
+      }
+      char *copy = clean_buffer_ + writes.size() * PAGE_SIZE;
+      memcpy(copy, page->data_, PAGE_SIZE);
+      copies.emplace_back(entry.first, copy);
+      {
+        std::scoped_lock<std::mutex> write_lock(write_latch_);
+        writing_.emplace(entry.first, page->rec_lsn_);
+      }
+      // 之后再被修改的话会重新变脏，recLSN要等写完才能清掉
+      page->is_dirty_ = false;
+      writes.push_back(entry);
+    }
+  }
+  if (writes.empty()) {
+    return 0;
+  }
+
+  // 3. write-ahead: 日志先落盘，再不持有任何latch地写页
+  if (log_manager_ != nullptr) {
+    log_manager_->Flush(flush_lsn);
+  }
+  disk_manager_->WritePages(copies);
+  background_writes_ += writes.size();
+
+  // 4. 写完了，没有再变脏的页可以清掉recLSN
+  {
+    std::scoped_lock<std::mutex> write_lock(write_latch_);
+    for (auto &entry : writes) {
+      writing_.erase(entry.first);
+    }
+  }
+  write_done_.notify_all();
+  for (auto &entry : writes) {
+    Shard &shard = GetShard(entry.first);
+    std::scoped_lock<std::mutex> lock(shard.latch_);
+    Page *page = GetFrame(entry.second);
+    if (page->page_id_ == entry.first && !page->is_dirty_) {
+      page->rec_lsn_ = INVALID_LSN;
+    }
+  }
+  return writes.size();
+}
+
+void BufferPoolManager::WaitForWrite(page_id_t page_id) {
+  std::unique_lock<std::mutex> lock(write_latch_);
+  write_done_.wait(lock, [&] { return writing_.count(page_id) == 0; });
+}
+
+void BufferPoolManager::RequestClean() {
+  {
+    std::scoped_lock<std::mutex> lock(cleaner_latch_);
+    clean_requested_ = true;
+  }
+  cleaner_cv_.notify_one();
+}
+
+void BufferPoolManager::RunCleaner() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(cleaner_latch_);
+      cleaner_cv_.wait_for(lock, std::chrono::milliseconds(BUFFER_POOL_CLEANER_INTERVAL_MS),
+                           [this] { return stop_ || clean_requested_; });
+      if (stop_) {
+        return;
+      }
+      clean_requested_ = false;
+    }
+    // 一轮写满了说明还有很多脏页，接着写
+    while (CleanPages() == BUFFER_POOL_CLEAN_BATCH) {
+    }
+  }
+}
+
+uint64_t BufferPoolManager::GetHitCount() {
+  uint64_t hits = 0;
+  for (auto &shard : shards_) {
+    std::scoped_lock<std::mutex> lock(shard.latch_);
+    hits += shard.hits_;
+  }
+  return hits;
+}
+
+uint64_t BufferPoolManager::GetMissCount() {
+  uint64_t misses = 0;
+  for (auto &shard : shards_) {
+    std::scoped_lock<std::mutex> lock(shard.latch_);
+    misses += shard.misses_;
+  }
+  return misses;
+}
+
+void BufferPoolManager::AddFrames(size_t count) {
+  while (count > 0) {
+    if (chunks_.empty() || chunks_.back().size_ == chunks_.back().capacity_) {
+      Chunk chunk;
+      chunk.capacity_ = std::min<size_t>(count, BUFFER_POOL_CHUNK_FRAMES);
+      chunk.size_ = 0;
+      chunk.pages_.reset(new Page[chunk.capacity_]);
+      if (log_manager_ != nullptr) {
+        chunk.snapshots_.reset(new char[chunk.capacity_ * PAGE_SIZE]);
+      }
+      chunks_.push_back(std::move(chunk));
+    }
+    Chunk &chunk = chunks_.back();
+    size_t base = (chunks_.size() - 1) * BUFFER_POOL_CHUNK_FRAMES;
+    size_t added = std::min(count, chunk.capacity_ - chunk.size_);
+    for (size_t i = chunk.size_; i < chunk.size_ + added; i++) {
+      AdoptFrame(base + i);
+    }
+    chunk.size_ += added;
+    pool_size_ += added;
+    count -= added;
+  }
+}
+
+void BufferPoolManager::AdoptFrame(frame_id_t frame_id) {
+  Shard &shard = *std::min_element(shards_.begin(), shards_.end(), [](const Shard &a, const Shard &b) {
+    return a.frame_count_ < b.frame_count_;
+  });
+  shard.free_list_.emplace_back(frame_id);
+  SetFrameCount(shard, shard.frame_count_ + 1);
+}
+
+void BufferPoolManager::RetireFrames(std::vector<frame_id_t> &targets, std::vector<frame_id_t> &retired) {
+  std::unordered_set<frame_id_t> wanted(targets.begin(), targets.end());
+  for (auto &shard : shards_) {
+    std::scoped_lock<std::mutex> lock(shard.latch_);
+    // 空闲的帧直接拿走
+    shard.free_list_.remove_if([&](frame_id_t frame_id) {
+      if (wanted.erase(frame_id) == 0) {
+        return false;
+      }
+      shard.replacer_->Remove(frame_id);
+      SetFrameCount(shard, shard.frame_count_ - 1);
+      retired.push_back(frame_id);
+      return true;
+    });
+    // 没被pin的帧换出其中的页；被pin的和正在预读的等下一轮
+    for (auto it = shard.page_table_.begin(); it != shard.page_table_.end();) {
+      frame_id_t frame_id = it->second;
+      Page *page = GetFrame(frame_id);
+      if (wanted.count(frame_id) == 0 || page->pin_count_ > 0 || shard.reading_.count(frame_id) > 0) {
+        ++it;
+        continue;
+      }
+      if (page->is_dirty_) {
+        WriteBack(frame_id);
+        foreground_writes_++;
+      }
+      shard.replacer_->Remove(frame_id);
+      page->ResetMemory();
+      page->page_id_ = INVALID_PAGE_ID;
+      page->is_dirty_ = false;
+      page->log_lsn_ = INVALID_LSN;
+      page->rec_lsn_ = INVALID_LSN;
+      page->cold_ = false;
+      it = shard.page_table_.erase(it);
+      SetFrameCount(shard, shard.frame_count_ - 1);
+      wanted.erase(frame_id);
+      retired.push_back(frame_id);
+    }
+  }
+  targets.erase(std::remove_if(targets.begin(), targets.end(),
+                               [&](frame_id_t frame_id) { return wanted.count(frame_id) == 0; }),
+                targets.end());
+}
+
+bool BufferPoolManager::Resize(size_t pool_size, uint32_t timeout_ms) {
+  std::scoped_lock<std::mutex> resize_lock(resize_latch_);
+  size_t old_size = pool_size_;
+  if (pool_size < num_shards_) {
+    return false;
+  }
+  // 页号到shard的映射不变，只是每个shard的帧变多或变少：新的帧给帧最少的shard，缩小时哪个shard的帧都可能被拿走
+  if (pool_size < old_size) {
+    // 1. 把帧号最大的那些帧一个个腾出来，被pin住的要等它们被unpin
+    std::vector<frame_id_t> targets;
+    for (size_t c = chunks_.size(); c-- > 0 && targets.size() < old_size - pool_size;) {
+      for (size_t i = chunks_[c].size_; i-- > 0 && targets.size() < old_size - pool_size;) {
+        targets.push_back(c * BUFFER_POOL_CHUNK_FRAMES + i);
+      }
+    }
+    std::vector<frame_id_t> retired;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (RetireFrames(targets, retired), !targets.empty()) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        // 没能及时腾出来，已经拿走的帧放回去，保持原来的大小
+        std::vector<std::unique_lock<std::mutex>> locks;
+        locks.reserve(num_shards_);
+        for (auto &shard : shards_) {
+          locks.emplace_back(shard.latch_);
+        }
+        for (auto frame_id : retired) {
+          AdoptFrame(frame_id);
+        }
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  // 2. 拿着所有latch增减块，cleaner这一轮写完的页还要回到帧里看一眼，所以也要等它
+  std::scoped_lock<std::mutex> flush_lock(flush_latch_);
+  std::vector<std::unique_lock<std::mutex>> locks;
+  locks.reserve(num_shards_);
+  for (auto &shard : shards_) {
+    locks.emplace_back(shard.latch_);
+  }
+  if (pool_size > old_size) {
+    AddFrames(pool_size - old_size);
+  }
+  for (size_t removed = old_size - std::min(pool_size, old_size); removed > 0;) {
+    Chunk &chunk = chunks_.back();
+    size_t count = std::min(removed, chunk.size_);
+    chunk.size_ -= count;
+    pool_size_ -= count;
+    removed -= count;
+    if (chunk.size_ == 0) {
+      chunks_.pop_back();
+    }
+  }
+  return true;
 }
 
 bool BufferPoolManager::DeletePage(page_id_t page_id) {
@@ -121,53 +620,104 @@ bool BufferPoolManager::DeletePage(page_id_t page_id) {
   // 1.   If P does not exist, return true.
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-  if (page_table_.find(page_id) == page_table_.end()) {
+  Shard &shard = GetShard(page_id);
+  std::unique_lock<std::mutex> lock(shard.latch_);
+  auto it = WaitForRead(shard, lock, page_id);
+  if (it == shard.page_table_.end()) {
     // 如果不在内存里，直接从硬盘中删除
     DeallocatePage(page_id);
     return true;
-  } else if (pages_[page_table_[page_id]].pin_count_ > 0) {
+  }
+  frame_id_t frame_id = it->second;
+  Page *page = GetFrame(frame_id);
+  if (page->pin_count_ > 0) {
     // 如果在内存中而被pin，则不能删除
     return false;
-  } else {
-    // 如果在内存中而没有被pin，则删除，并从replacer移除
-    replacer_->Pin(page_table_[page_id]);
-    DeallocatePage(page_id);
-    pages_[page_table_[page_id]].ResetMemory();
-    pages_[page_table_[page_id]].is_dirty_ = false;
-    free_list_.emplace_back(page_table_[page_id]);
-    page_table_.erase(page_id);
-    return true;
   }
+  // 如果在内存中而没有被pin，则删除，并从replacer移除
+  shard.replacer_->Pin(frame_id);
+  DeallocatePage(page_id);
+  page->ResetMemory();
+  page->page_id_ = INVALID_PAGE_ID;
+  page->is_dirty_ = false;
+  page->rec_lsn_ = INVALID_LSN;
+  page->cold_ = false;
+  shard.free_list_.emplace_back(frame_id);
+  shard.page_table_.erase(it);
+  return true;
 }
 
 bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
-  if (page_table_.find(page_id) == page_table_.end()) return false;
-  pages_[page_table_[page_id]].pin_count_--;
-//  cout << "-";
-  pages_[page_table_[page_id]].is_dirty_ = pages_[page_table_[page_id]].is_dirty_ || is_dirty;
-  if (pages_[page_table_[page_id]].pin_count_ == 0) {
-    replacer_->Unpin(page_table_[page_id]);
+  Shard &shard = GetShard(page_id);
+  std::scoped_lock<std::mutex> lock(shard.latch_);
+  auto it = shard.page_table_.find(page_id);
+  if (it == shard.page_table_.end()) return false;
+  Page *page = GetFrame(it->second);
+  if (is_dirty && log_manager_ != nullptr) {
+    LogPageDelta(it->second);
+  }
+  page->is_dirty_ = page->is_dirty_ || is_dirty;
+  // 被修改过的页不再是只被扫描过的冷页
+  page->cold_ = page->cold_ && !is_dirty;
+  if (--page->pin_count_ == 0) {
+    if (page->cold_) {
+      shard.replacer_->UnpinCold(it->second);
+    } else {
+      shard.replacer_->Unpin(it->second);
+    }
   }
   return true;
 }
 
 bool BufferPoolManager::FlushPage(page_id_t page_id) {
-  if (page_table_.find(page_id) == page_table_.end()) return false;
-  disk_manager_->WritePage(page_id, pages_[page_table_[page_id]].data_);
-  pages_[page_table_[page_id]].is_dirty_ = false;
+  Shard &shard = GetShard(page_id);
+  std::unique_lock<std::mutex> lock(shard.latch_);
+  auto it = WaitForRead(shard, lock, page_id);
+  if (it == shard.page_table_.end()) return false;
+  WriteBack(it->second);
   return true;
 }
 
 bool BufferPoolManager::FlushAllPages() {
-  for (size_t i = 0; i < pool_size_; ++i) {
-    if (pages_[i].page_id_ != INVALID_PAGE_ID) {
-      if (FlushPage(pages_[i].page_id_)) {
-        // cout << "success" << endl;
-      } else {
-        // cout << "failed" << endl;
+  // 和cleaner的一轮互斥，下面拿着shard latch时不会有页正在被cleaner写，也就不用WaitForWrite
+  std::scoped_lock<std::mutex> flush_lock(flush_latch_);
+  // 页号相邻的页分在不同的shard里，要拿着所有shard的latch一起排序才能合并成大块的写
+  std::vector<std::unique_lock<std::mutex>> locks;
+  locks.reserve(num_shards_);
+  for (auto &shard : shards_) {
+    locks.emplace_back(shard.latch_);
+  }
+  std::vector<std::pair<page_id_t, const char *>> pages;
+  std::vector<frame_id_t> frames;
+  for (auto &shard : shards_) {
+    for (auto &entry : shard.page_table_) {
+      // 正在预读的页还没有内容，也不可能是脏的
+      if (shard.reading_.count(entry.second) > 0) {
+        continue;
+      }
+      Page *page = GetFrame(entry.second);
+      if (log_manager_ != nullptr) {
+        // 先记下所有页的修改，只等一次日志落盘
+        LogPageDelta(entry.second);
+      }
+      if (page->is_dirty_ || page->rec_lsn_ != INVALID_LSN) {
+        pages.emplace_back(entry.first, page->data_);
+        frames.push_back(entry.second);
       }
     }
   }
+  if (pages.empty()) {
+    return true;
+  }
+  if (log_manager_ != nullptr) {
+    log_manager_->FlushAll();
+  }
+  disk_manager_->WritePages(pages);
+  disk_manager_->SyncData();
+  for (auto frame_id : frames) {
+    GetFrame(frame_id)->is_dirty_ = false;
+    GetFrame(frame_id)->rec_lsn_ = INVALID_LSN;
+  }
   return true;
 }
 
@@ -183,10 +733,17 @@ bool BufferPoolManager::IsPageFree(page_id_t page_id) { return disk_manager_->Is
 // Only used for debug
 bool BufferPoolManager::CheckAllUnpinned() {
   bool res = true;
-  for (size_t i = 0; i < pool_size_; i++) {
-    if (pages_[i].pin_count_ != 0) {
-      res = false;
-      LOG(ERROR) << "page " << pages_[i].page_id_ << " pin count:" << pages_[i].pin_count_ << endl;
+  std::vector<std::unique_lock<std::mutex>> locks;
+  for (auto &shard : shards_) {
+    locks.emplace_back(shard.latch_);
+  }
+  for (auto &chunk : chunks_) {
+    for (size_t i = 0; i < chunk.size_; i++) {
+      Page &page = chunk.pages_[i];
+      if (page.pin_count_ != 0) {
+        res = false;
+        LOG(ERROR) << "page " << page.page_id_ << " pin count:" << page.pin_count_ << endl;
+      }
     }
   }
   return res;
@@ -33,17 +33,11 @@ bool ClockReplacer::Victim(frame_id_t *frame_id) {
 
 void ClockReplacer::Pin(frame_id_t frame_id) {
 //  cout<<"Pin Called"<< " frame_id: " << frame_id <<endl;
-  //如果已经有了hand
-  if(Size()&&Find(frame_id)!=(size_t)-1){
-    //查看删除的是否是当前hand指向的
-    if(nodes.at(hand).frame_id == frame_id) {
-      nodes.at(hand).isNull = true;
-      //如果还有其他非空的话就更改hand
-      if(Size()) HandInc();
-    }
-    //非当前hand指向，直接设置IsNULL
-    nodes.at(Find(frame_id)).isNull = true;
-  }
+  size_t index = Find(frame_id);
+  if (index == (size_t)-1) return;
+  nodes.at(index).isNull = true;
+  //删除的是当前hand指向的，如果还有其他非空的话就更改hand
+  if (index == hand && Size()) HandInc();
 //  Test(3);
 }
 
@@ -60,19 +54,29 @@ void ClockReplacer::Unpin(frame_id_t frame_id) {
     //将Unpin的Node跟hand前的Node置换
     SwapNodes(index,FindUsedBeforeHand());
   } else {
-    //不在缓冲区，找一个空位插入
+    //不在缓冲区，找一个空位插入；没有空位就扩容，丢掉的帧再也不会被替换
     temp = FindNull();
-    if(temp != (size_t)-1){
-      nodes.at(temp).isNull = false;
-      nodes.at(temp).frame_id = frame_id;
-      nodes.at(temp).node_status = true;
+    if (temp == (size_t)-1) {
+      temp = num_page;
+      SetCapacity(num_page + 1);
     }
+    nodes.at(temp).isNull = false;
+    nodes.at(temp).frame_id = frame_id;
+    nodes.at(temp).node_status = true;
     //如果是插入的第一个元素
     if(Size() == 1) hand = temp;
   }
 //  Test(4);
 }
 
+void ClockReplacer::SetCapacity(size_t num_pages) {
+  // 只扩不缩，空节点放在末尾不影响hand的顺序
+  if (num_pages > num_page) {
+    num_page = num_pages;
+    nodes.resize(num_page);
+  }
+}
+
 size_t ClockReplacer::Size() {
   //count所有isNull==false的点的数量
   int count = 0;
@@ -81,12 +85,10 @@ size_t ClockReplacer::Size() {
   return count;
 }
 
-//查找nodes里面的对应frame_id的下标，若无，则返回-1
+//查找nodes里面的对应frame_id的非空节点的下标，若无，则返回-1
 size_t ClockReplacer::Find(frame_id_t frame_id) {
-  if(Size() != 0){
-    for(size_t i = 0; i < Size(); i++){
-      if(nodes.at(i).frame_id == frame_id) return i;
-    }
+  for (size_t i = 0; i < num_page; i++) {
+    if (!nodes.at(i).isNull && nodes.at(i).frame_id == frame_id) return i;
   }
   return -1;
 }
@@ -112,8 +114,9 @@ void ClockReplacer::SwapNodes(size_t v_1, size_t v_2) {
   nodes.at(v_2).frame_id = temp.frame_id;
 }
 
-//起到hand++的效果
+//起到hand++的效果，没有非空节点时hand不动
 void ClockReplacer::HandInc() {
+  if (Size() == 0) return;
   do{
     hand = (hand + 1) % num_page;
   }while(nodes.at(hand).isNull);
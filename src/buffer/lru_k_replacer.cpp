@@ -0,0 +1,110 @@
+#include "buffer/lru_k_replacer.h"
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k, std::atomic<uint64_t> *clock)
+    : clock_(clock != nullptr ? clock : &own_clock_), k_(k) {
+  frames_.reserve(num_pages);
+}
+
+LRUKReplacer::~LRUKReplacer() = default;
+
+bool LRUKReplacer::Victim(frame_id_t *frame_id) {
+  // 访问不到k次的帧的k-距离是无穷大，先从它们里面挑
+  std::set<Key> &frames = cold_frames_.empty() ? hot_frames_ : cold_frames_;
+  if (frames.empty()) {
+    return false;
+  }
+  *frame_id = frames.begin()->second;
+  frames.erase(frames.begin());
+  frames_.erase(*frame_id);
+  return true;
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  FrameInfo &info = frames_[frame_id];
+  if (info.evictable_) {
+    Erase(frame_id, info);
+    info.evictable_ = false;
+  }
+  info.cold_ = false;
+  RecordAccess(info);
+}
+
+void LRUKReplacer::Unpin(frame_id_t frame_id) {
+  auto it = frames_.find(frame_id);
+  if (it == frames_.end() || it->second.evictable_) {
+    // 没有被Pin过或者再次Unpin，都当作一次访问
+    FrameInfo &info = frames_[frame_id];
+    if (info.evictable_) {
+      Erase(frame_id, info);
+    }
+    info.cold_ = false;
+    RecordAccess(info);
+    info.evictable_ = true;
+    Insert(frame_id, info);
+    return;
+  }
+  it->second.evictable_ = true;
+  Insert(frame_id, it->second);
+}
+
+void LRUKReplacer::UnpinCold(frame_id_t frame_id) {
+  FrameInfo &info = frames_[frame_id];
+  if (info.evictable_) {
+    Erase(frame_id, info);
+  }
+  info.cold_ = true;
+  info.evictable_ = true;
+  Insert(frame_id, info);
+}
+
+void LRUKReplacer::SetPage(frame_id_t frame_id, page_id_t page_id) {
+  // 帧里换了一页，之前的访问历史作废
+  Remove(frame_id);
+}
+
+void LRUKReplacer::Remove(frame_id_t frame_id) {
+  auto it = frames_.find(frame_id);
+  if (it == frames_.end()) {
+    return;
+  }
+  if (it->second.evictable_) {
+    Erase(frame_id, it->second);
+  }
+  frames_.erase(it);
+}
+
+size_t LRUKReplacer::Size() { return cold_frames_.size() + hot_frames_.size(); }
+
+void LRUKReplacer::RecordAccess(FrameInfo &info) {
+  uint64_t now = ++*clock_;
+  if (!info.history_.empty() && now - info.last_access_ <= LRUK_CORRELATED_PERIOD) {
+    info.last_access_ = now;
+    return;
+  }
+  if (info.history_.size() == k_) {
+    info.history_.erase(info.history_.begin());
+  }
+  info.history_.push_back(now);
+  info.last_access_ = now;
+}
+
+void LRUKReplacer::Insert(frame_id_t frame_id, const FrameInfo &info) {
+  if (info.cold_) {
+    // 扫描预读的冷页排在最前面
+    cold_frames_.emplace(0, frame_id);
+  } else if (info.history_.size() < k_) {
+    cold_frames_.emplace(info.last_access_, frame_id);
+  } else {
+    hot_frames_.emplace(info.history_.front(), frame_id);
+  }
+}
+
+void LRUKReplacer::Erase(frame_id_t frame_id, const FrameInfo &info) {
+  if (info.cold_) {
+    cold_frames_.erase(Key(0, frame_id));
+  } else if (info.history_.size() < k_) {
+    cold_frames_.erase(Key(info.last_access_, frame_id));
+  } else {
+    hot_frames_.erase(Key(info.history_.front(), frame_id));
+  }
+}
@@ -36,6 +36,15 @@ void LRUReplacer::Unpin(frame_id_t frame_id) {
   map[frame_id] = deque.begin();
 }
 
+// 冷的页放在最近最少使用的一端，下一个就替换它，扫描读进来的页不会把常用的页挤出去
+void LRUReplacer::UnpinCold(frame_id_t frame_id) {
+  if (map.find(frame_id) != map.end()) {
+    deque.erase(map[frame_id]);
+  }
+  deque.emplace_back(frame_id);
+  map[frame_id] = std::prev(deque.end());
+}
+
 size_t LRUReplacer::Size() {
   return deque.size();
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "buffer/replacer.h"
+
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "buffer/two_q_replacer.h"
+
+Replacer *Replacer::Create(ReplacerType type, size_t num_pages, std::atomic<uint64_t> *clock) {
+  switch (type) {
+    case ReplacerType::kClock:
+      return new ClockReplacer(num_pages);
+    case ReplacerType::kLRUK:
+      return new LRUKReplacer(num_pages, LRUK_K, clock);
+    case ReplacerType::k2Q:
+      return new TwoQReplacer(num_pages);
+    case ReplacerType::kLRU:
+    default:
+      return new LRUReplacer(num_pages);
+  }
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+
+#include "buffer/two_q_replacer.h"
+
+TwoQReplacer::TwoQReplacer(size_t num_pages)
+    : kin_(std::max<size_t>(1, num_pages / 4)), kout_(std::max<size_t>(1, num_pages / 2)) {
+  frames_.reserve(num_pages);
+}
+
+TwoQReplacer::~TwoQReplacer() = default;
+
+bool TwoQReplacer::Victim(frame_id_t *frame_id) {
+  // A1in超出了Kin，或者Am里没有可以换出的，从A1in换出
+  std::set<Key> *frames;
+  if (!a1in_.empty() && (a1in_count_ > kin_ || am_.empty())) {
+    frames = &a1in_;
+  } else if (!am_.empty()) {
+    frames = &am_;
+  } else {
+    return false;
+  }
+  *frame_id = frames->begin()->second;
+  frames->erase(frames->begin());
+  auto it = frames_.find(*frame_id);
+  if (it->second.queue_ == Queue::kA1in) {
+    a1in_count_--;
+    AddGhost(it->second.page_id_);
+  }
+  frames_.erase(it);
+  return true;
+}
+
+void TwoQReplacer::Pin(frame_id_t frame_id) {
+  FrameInfo &info = GetFrame(frame_id);
+  if (info.evictable_) {
+    Erase(frame_id, info);
+    info.evictable_ = false;
+  }
+  // A1in里的页不因为重复访问而提升
+  if (info.queue_ == Queue::kAm) {
+    info.key_ = ++clock_;
+  }
+}
+
+void TwoQReplacer::Unpin(frame_id_t frame_id) {
+  FrameInfo &info = GetFrame(frame_id);
+  if (info.evictable_) {
+    // 再次Unpin当作一次访问
+    Erase(frame_id, info);
+    if (info.queue_ == Queue::kAm) {
+      info.key_ = ++clock_;
+    }
+  }
+  if (info.queue_ == Queue::kA1in && info.key_ == 0) {
+    // 冷页被正常使用过了，回到A1in的队尾
+    info.key_ = ++clock_;
+  }
+  info.evictable_ = true;
+  Insert(frame_id, info);
+}
+
+void TwoQReplacer::UnpinCold(frame_id_t frame_id) {
+  FrameInfo &info = GetFrame(frame_id);
+  if (info.evictable_) {
+    Erase(frame_id, info);
+  }
+  if (info.queue_ == Queue::kAm) {
+    info.queue_ = Queue::kA1in;
+    a1in_count_++;
+  }
+  info.key_ = 0;
+  info.evictable_ = true;
+  Insert(frame_id, info);
+}
+
+void TwoQReplacer::SetPage(frame_id_t frame_id, page_id_t page_id) {
+  Remove(frame_id);
+  FrameInfo &info = frames_[frame_id];
+  info.page_id_ = page_id;
+  info.key_ = ++clock_;
+  auto ghost = a1out_map_.find(page_id);
+  if (ghost != a1out_map_.end()) {
+    info.queue_ = Queue::kAm;
+    a1out_.erase(ghost->second);
+    a1out_map_.erase(ghost);
+  } else {
+    info.queue_ = Queue::kA1in;
+    a1in_count_++;
+  }
+}
+
+void TwoQReplacer::Remove(frame_id_t frame_id) {
+  auto it = frames_.find(frame_id);
+  if (it == frames_.end()) {
+    return;
+  }
+  if (it->second.evictable_) {
+    Erase(frame_id, it->second);
+  }
+  if (it->second.queue_ == Queue::kA1in) {
+    a1in_count_--;
+  }
+  frames_.erase(it);
+}
+
+void TwoQReplacer::SetCapacity(size_t num_pages) {
+  kin_ = std::max<size_t>(1, num_pages / 4);
+  kout_ = std::max<size_t>(1, num_pages / 2);
+  while (a1out_.size() > kout_) {
+    a1out_map_.erase(a1out_.back());
+    a1out_.pop_back();
+  }
+}
+
+size_t TwoQReplacer::Size() { return a1in_.size() + am_.size(); }
+
+TwoQReplacer::FrameInfo &TwoQReplacer::GetFrame(frame_id_t frame_id) {
+  auto it = frames_.find(frame_id);
+  if (it != frames_.end()) {
+    return it->second;
+  }
+  FrameInfo &info = frames_[frame_id];
+  info.key_ = ++clock_;
+  a1in_count_++;
+  return info;
+}
+
+void TwoQReplacer::Erase(frame_id_t frame_id, const FrameInfo &info) {
+  (info.queue_ == Queue::kA1in ? a1in_ : am_).erase(Key(info.key_, frame_id));
+}
+
+void TwoQReplacer::Insert(frame_id_t frame_id, const FrameInfo &info) {
+  (info.queue_ == Queue::kA1in ? a1in_ : am_).emplace(info.key_, frame_id);
+}
+
+void TwoQReplacer::AddGhost(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID || a1out_map_.count(page_id) > 0) {
+    return;
+  }
+  a1out_.push_front(page_id);
+  a1out_map_[page_id] = a1out_.begin();
+  if (a1out_.size() > kout_) {
+    a1out_map_.erase(a1out_.back());
+    a1out_.pop_back();
+  }
+}
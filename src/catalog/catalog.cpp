@@ -1,18 +1,30 @@
 #include "catalog/catalog.h"
+
+#include <algorithm>
+#include <cstring>
+
 using namespace std;
 /*
  * 序列化catalog的meta_data,看似不需要像record里面那样返回偏移值
  * 序列化顺序:
  * 1.magic_number
- * 2.table_meta_pages_.size()
- * 3.index_meta_pages_.size()
- * 4.table_meta_pages_,每次写入两个byte,分别为table_id_t, page_id_t
- * 5.index_meta_pages_,每次写入两个byte,分别为index_id_t, page_id_t
+ * 2.FORMAT_VERSION, page_size_, buffer_pool_size_
+ * 3.table_meta_pages_.size()
+ * 4.index_meta_pages_.size()
+ * 5.table_meta_pages_,每次写入两个byte,分别为table_id_t, page_id_t
+ * 6.index_meta_pages_,每次写入两个byte,分别为index_id_t, page_id_t
+ * 7.statistics_pages_.size(), statistics_pages_,每次写入两个byte,分别为table_id_t, page_id_t（版本2开始有）
  */
 void CatalogMeta::SerializeTo(char *buf) const {
   // write magic_number
   MACH_WRITE_UINT32(buf, CATALOG_METADATA_MAGIC_NUM);
   buf += 4;
+  MACH_WRITE_UINT32(buf, FORMAT_VERSION);
+  buf += 4;
+  MACH_WRITE_UINT32(buf, page_size_);
+  buf += 4;
+  MACH_WRITE_UINT32(buf, buffer_pool_size_);
+  buf += 4;
   // write table_meta_pages_.size()
   MACH_WRITE_INT32(buf, table_meta_pages_.size());
   buf += 4;
@@ -37,6 +49,15 @@ void CatalogMeta::SerializeTo(char *buf) const {
     buf += 4;
     index_meta_pages_it++;
   }
+  // write statistics_pages_
+  MACH_WRITE_INT32(buf, statistics_pages_.size());
+  buf += 4;
+  for (auto &statistics_page : statistics_pages_) {
+    MACH_WRITE_UINT32(buf, statistics_page.first);
+    buf += 4;
+    MACH_WRITE_INT32(buf, statistics_page.second);
+    buf += 4;
+  }
 }
 
 CatalogMeta *CatalogMeta::DeserializeFrom(char *buf, MemHeap *heap) {
@@ -44,11 +65,13 @@ CatalogMeta *CatalogMeta::DeserializeFrom(char *buf, MemHeap *heap) {
   auto *De = new (heap->Allocate(sizeof(CatalogMeta))) CatalogMeta();
   // DeserializeForm
   // check magic number
-  if (MACH_READ_UINT32(buf) != CATALOG_METADATA_MAGIC_NUM) {
+  uint32_t version;
+  if (!DeserializeHeader(buf, &version, &De->page_size_, &De->buffer_pool_size_) || version < MIN_FORMAT_VERSION ||
+      version > FORMAT_VERSION) {
     cout << "ERROR: NOT CATALOGMETA MAGIC_NUMBER!" << endl;
     return nullptr;
   }
-  buf += 4;
+  buf += 16;
   // read size
   int32_t table_meta_pages_size = MACH_READ_INT32(buf);
   buf += 4;
@@ -73,16 +96,48 @@ CatalogMeta *CatalogMeta::DeserializeFrom(char *buf, MemHeap *heap) {
     buf += 4;
     De->index_meta_pages_[index_id_t] = page_id_t;
   }
+  // 版本1没有统计信息
+  if (version >= 2) {
+    int32_t statistics_pages_size = MACH_READ_INT32(buf);
+    buf += 4;
+    for (int i = 0; i < statistics_pages_size; i++) {
+      table_id_t = MACH_READ_UINT32(buf);
+      buf += 4;
+      page_id_t = MACH_READ_INT32(buf);
+      buf += 4;
+      De->statistics_pages_[table_id_t] = page_id_t;
+    }
+  }
 
   return De;
 }
 
+bool CatalogMeta::DeserializeHeader(const char *buf, uint32_t *version, uint32_t *page_size,
+                                    uint32_t *buffer_pool_size) {
+  uint32_t magic_num = MACH_READ_UINT32(buf);
+  if (magic_num == UNVERSIONED_MAGIC_NUM) {
+    // 旧格式只有4KB的页，也没有记录缓冲池大小
+    *version = 0;
+    *page_size = 4096;
+    *buffer_pool_size = 0;
+    return true;
+  }
+  if (magic_num != CATALOG_METADATA_MAGIC_NUM) {
+    return false;
+  }
+  *version = MACH_READ_UINT32(buf + 4);
+  *page_size = MACH_READ_UINT32(buf + 8);
+  *buffer_pool_size = MACH_READ_UINT32(buf + 12);
+  return true;
+}
+
 /* 返回序列化的大小
  * 有可能有问题，比如说在序列化之后，index_meta_pages_和table_meta_pages_又发生了变化
  */
 uint32_t CatalogMeta::GetSerializedSize() const {
-  // magic_number(4)+table_meta_size(4)+index_meta_size(4)+8*each_element_in_map
-  return 12 + 8 * (table_meta_pages_.size() + index_meta_pages_.size());
+  // magic_number(4)+version(4)+page_size(4)+buffer_pool_size(4)+table_meta_size(4)+index_meta_size(4)
+  // +statistics_pages_size(4)+8*each_element_in_map
+  return 28 + 8 * (table_meta_pages_.size() + index_meta_pages_.size() + statistics_pages_.size());
 }
 
 CatalogMeta::CatalogMeta() {}
@@ -116,6 +171,10 @@ CatalogManager::CatalogManager(BufferPoolManager *buffer_pool_manager, LockManag
     for (auto index_meta_page_it : catalog_meta_->index_meta_pages_) {
       ASSERT(LoadIndex(index_meta_page_it.first, index_meta_page_it.second) == DB_SUCCESS, "LoadIndex Failed");
     }
+    for (auto statistics_page_it : catalog_meta_->statistics_pages_) {
+      ASSERT(LoadStatistics(statistics_page_it.first, statistics_page_it.second) == DB_SUCCESS,
+             "LoadStatistics Failed");
+    }
     buffer_pool_manager_->UnpinPage(CATALOG_META_PAGE_ID, false);
   }
   // 将改动刷盘
@@ -125,6 +184,10 @@ CatalogManager::CatalogManager(BufferPoolManager *buffer_pool_manager, LockManag
 CatalogManager::~CatalogManager() {
   // 我不是很清楚什么时候需要Flush,以防万一，现在这里Flush一下
   FlushCatalogMetaPage();
+  // TableInfo分配在heap_里，delete heap_只会释放内存，要先析构
+  for (auto &table : tables_) {
+    table.second->~TableInfo();
+  }
   delete heap_;
 }
 
@@ -139,7 +202,9 @@ dberr_t CatalogManager::CreateTable(const string &table_name, TableSchema *schem
   TableHeap *table_heap = TableHeap::Create(buffer_pool_manager_, schema, nullptr, log_manager_, lock_manager_,
                                             table_info->GetMemHeap());
   // 这里直接拿了table_heap的FirstPageId,但是这个table_heap
-  TableMetadata *meta_data = TableMetadata::Create(table_id, table_name, table_heap->GetFirstPageId(), schema, table_info->GetMemHeap());
+  TableMetadata *meta_data = TableMetadata::Create(table_id, table_name, table_heap->GetFirstPageId(),
+                                                   table_heap->GetFreeSpaceMapPageId(), schema,
+                                                   table_info->GetMemHeap());
   table_info->Init(meta_data, table_heap);
   // step3: 更新CatalogManager和CatalogMetaData
   table_names_[table_name] = table_id;
@@ -195,7 +260,7 @@ dberr_t CatalogManager::CreateIndex(const std::string &table_name, const string
   }
   // 新建IndexMetaData并init index_info
   IndexMetadata *meta_data = IndexMetadata::Create(index_id, index_name, table_id, key_map, index_info->GetMemHeap());
-  index_info->Init(meta_data, table_info, buffer_pool_manager_);
+  index_info->Init(meta_data, table_info, buffer_pool_manager_, log_manager_);
   // step3: 更新CatalogMetaData和CatalogManager
   // 更新index_names_
   if (index_names_.find(table_name) == index_names_.end()) {
@@ -246,6 +311,14 @@ dberr_t CatalogManager::GetIndex(const std::string &table_name, const std::strin
   return DB_SUCCESS;
 }
 
+// 根据index_id获取IndexInfo，recovery撤销索引操作时使用
+dberr_t CatalogManager::GetIndex(const index_id_t index_id, IndexInfo *&index_info) const {
+  auto index_info_it = indexes_.find(index_id);
+  if (index_info_it == indexes_.end()) return DB_INDEX_NOT_FOUND;
+  index_info = index_info_it->second;
+  return DB_SUCCESS;
+}
+
 // 根据table_name，将对应所有的index的IndexInfo放到参数里面
 // WARNING: 如果该table没有index,将返回原indexes以及DB_SUCCESS
 dberr_t CatalogManager::GetTableIndexes(const std::string &table_name, std::vector<IndexInfo *> &indexes) const {
@@ -283,6 +356,12 @@ dberr_t CatalogManager::DropTable(const string &table_name) {
   // step3:删除各个map中对应的table
   tables_.erase(tables_.find(table_id));
   table_names_.erase(table_names_.find(table_name));
+  statistics_.erase(table_id);
+  auto statistics_page_it = catalog_meta_->statistics_pages_.find(table_id);
+  if (statistics_page_it != catalog_meta_->statistics_pages_.end()) {
+    DeleteStatistics(statistics_page_it->second);
+    catalog_meta_->statistics_pages_.erase(statistics_page_it);
+  }
   catalog_meta_->table_meta_pages_.erase(catalog_meta_->table_meta_pages_.find(table_id));
   // 回收各个map中该table的index
   if (index_names_.find(table_name) != index_names_.end()) {
@@ -340,6 +419,42 @@ dberr_t CatalogManager::DropIndex(const string &table_name, const string &index_
   return DB_SUCCESS;
 }
 
+// 扫描整张表重新统计，之前的统计信息直接替换掉
+dberr_t CatalogManager::AnalyzeTable(const string &table_name) {
+  TableInfo *table_info;
+  if (GetTable(table_name, table_info) != DB_SUCCESS) return DB_TABLE_NOT_EXIST;
+  table_id_t table_id = table_info->GetTableId();
+  TableStatistics statistics = TableStatistics::Collect(table_info);
+  // 新的统计信息写好之后再换掉catalog meta里的记录，最后回收旧的页
+  page_id_t page_id = FlushStatistics(statistics);
+  if (page_id == INVALID_PAGE_ID) return DB_FAILED;
+  auto &statistics_pages = catalog_meta_->statistics_pages_;
+  page_id_t old_page_id = statistics_pages.count(table_id) == 0 ? INVALID_PAGE_ID : statistics_pages[table_id];
+  statistics_pages[table_id] = page_id;
+  FlushCatalogMetaPage();
+  DeleteStatistics(old_page_id);
+  statistics_.erase(table_id);
+  statistics_.emplace(table_id, std::move(statistics));
+  return DB_SUCCESS;
+}
+
+dberr_t CatalogManager::GetTableStatistics(const string &table_name, const TableStatistics *&statistics) const {
+  auto table_id_it = table_names_.find(table_name);
+  if (table_id_it == table_names_.end()) return DB_TABLE_NOT_EXIST;
+  auto statistics_it = statistics_.find(table_id_it->second);
+  statistics = statistics_it == statistics_.end() ? nullptr : &statistics_it->second;
+  return DB_SUCCESS;
+}
+
+uint32_t CatalogManager::GetBufferPoolSize() const {
+  return catalog_meta_->buffer_pool_size_;
+}
+
+dberr_t CatalogManager::SetBufferPoolSize(uint32_t buffer_pool_size) {
+  catalog_meta_->buffer_pool_size_ = buffer_pool_size;
+  return FlushCatalogMetaPage();
+}
+
 // 将CatalogMeta里面的数据写到page中
 dberr_t CatalogManager::FlushCatalogMetaPage() const {
   // 直接序列化CatalogMetaData到数据页中
@@ -371,7 +486,8 @@ dberr_t CatalogManager::LoadTable(const table_id_t table_id, const page_id_t pag
   table_names_[meta_data->GetTableName()] = table_id;
   // step4: init table_info插入tables_
   // 新建table_heap
-  TableHeap *table_heap = TableHeap::Create(buffer_pool_manager_, meta_data->GetFirstPageId(), meta_data->GetSchema(),
+  TableHeap *table_heap = TableHeap::Create(buffer_pool_manager_, meta_data->GetFirstPageId(),
+                                            meta_data->GetFreeSpaceMapPageId(), meta_data->GetSchema(),
                                             log_manager_, lock_manager_, table_info->GetMemHeap());
   table_info->Init(meta_data, table_heap);
   tables_[table_id] = table_info;
@@ -379,6 +495,57 @@ dberr_t CatalogManager::LoadTable(const table_id_t table_id, const page_id_t pag
   return DB_SUCCESS;
 }
 
+page_id_t CatalogManager::FlushStatistics(const TableStatistics &statistics) {
+  std::vector<char> buf(statistics.GetSerializedSize());
+  statistics.SerializeTo(buf.data());
+  // 每页开头4个字节是下一页的page_id，从最后一页往前写，写每一页时就知道下一页在哪里
+  const uint32_t page_data_size = PAGE_SIZE - 4;
+  uint32_t page_count = (buf.size() + page_data_size - 1) / page_data_size;
+  page_id_t next_page_id = INVALID_PAGE_ID;
+  for (uint32_t i = page_count; i > 0; i--) {
+    page_id_t page_id;
+    auto page = buffer_pool_manager_->NewPage(page_id);
+    if (page == nullptr) {
+      DeleteStatistics(next_page_id);
+      return INVALID_PAGE_ID;
+    }
+    uint32_t offset = (i - 1) * page_data_size;
+    MACH_WRITE_INT32(page->GetData(), next_page_id);
+    memcpy(page->GetData() + 4, buf.data() + offset, std::min<size_t>(page_data_size, buf.size() - offset));
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    buffer_pool_manager_->FlushPage(page_id);
+    next_page_id = page_id;
+  }
+  return next_page_id;
+}
+
+dberr_t CatalogManager::LoadStatistics(const table_id_t table_id, const page_id_t page_id) {
+  std::vector<char> buf;
+  for (page_id_t next_page_id = page_id; next_page_id != INVALID_PAGE_ID;) {
+    auto page = buffer_pool_manager_->FetchPage(next_page_id);
+    if (page == nullptr) return DB_FAILED;
+    buf.insert(buf.end(), page->GetData() + 4, page->GetData() + PAGE_SIZE);
+    page_id_t current_page_id = next_page_id;
+    next_page_id = MACH_READ_INT32(page->GetData());
+    buffer_pool_manager_->UnpinPage(current_page_id, false);
+  }
+  TableStatistics statistics;
+  if (TableStatistics::DeserializeFrom(buf.data(), &statistics) == 0) return DB_FAILED;
+  statistics_.emplace(table_id, std::move(statistics));
+  return DB_SUCCESS;
+}
+
+void CatalogManager::DeleteStatistics(page_id_t page_id) {
+  while (page_id != INVALID_PAGE_ID) {
+    auto page = buffer_pool_manager_->FetchPage(page_id);
+    if (page == nullptr) return;
+    page_id_t next_page_id = MACH_READ_INT32(page->GetData());
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    buffer_pool_manager_->DeletePage(page_id);
+    page_id = next_page_id;
+  }
+}
+
 // 读取page_id存的table_meta_data,并更新CatalogManager
 dberr_t CatalogManager::LoadIndex(const index_id_t index_id, const page_id_t page_id) {
   // step1: 拿到存meta_data的页
@@ -413,7 +580,7 @@ dberr_t CatalogManager::LoadIndex(const index_id_t index_id, const page_id_t pag
     }
   }
   // step4: init index_info并插入indexes_
-  index_info->Init(meta_data, tables_[table_id], buffer_pool_manager_);
+  index_info->Init(meta_data, tables_[table_id], buffer_pool_manager_, log_manager_);
   indexes_[index_id] = index_info;
   buffer_pool_manager_->UnpinPage(page_id, false);
   return DB_SUCCESS;
@@ -77,7 +77,7 @@ uint32_t IndexMetadata::DeserializeFrom(char *buf, IndexMetadata *&index_meta, M
   buf += 4;
   ofs += 4;
   // 一个字符一个字符地读取
-  char *name = new char[len];
+  char *name = new char[len + 1];
   ofs += len;
   for (uint32_t i = 0; i < len; i++) {
     name[i] = MACH_READ_FROM(char, buf);
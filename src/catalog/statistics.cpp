@@ -0,0 +1,237 @@
+#include "catalog/statistics.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+
+#include "storage/table_iterator.h"
+
+TableStatistics TableStatistics::Collect(TableInfo *table_info) {
+  TableStatistics statistics;
+  Schema *schema = table_info->GetSchema();
+  uint32_t column_count = schema->GetColumnCount();
+  statistics.columns_.resize(column_count);
+  std::vector<std::vector<double>> values(column_count);
+  // char的前8个字节不能区分所有值，distinct单独用字符串统计
+  std::vector<std::unordered_set<std::string>> distinct_chars(column_count);
+  for (uint32_t i = 0; i < column_count; i++) {
+    statistics.columns_[i].type_ = schema->GetColumn(i)->GetType();
+  }
+  TableHeap *table_heap = table_info->GetTableHeap();
+  statistics.page_count_ = table_heap->GetPageCount();
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); ++iter) {
+    statistics.row_count_++;
+    for (uint32_t i = 0; i < column_count; i++) {
+      Field *field = iter->GetField(i);
+      if (field->IsNull()) {
+        statistics.columns_[i].null_count_++;
+        continue;
+      }
+      values[i].push_back(ToDouble(statistics.columns_[i].type_, *field));
+      if (statistics.columns_[i].type_ == TypeId::kTypeChar) {
+        distinct_chars[i].emplace(field->GetChars(), field->GetLength());
+      }
+    }
+  }
+  for (uint32_t i = 0; i < column_count; i++) {
+    auto &column = statistics.columns_[i];
+    auto &column_values = values[i];
+    if (column_values.empty()) {
+      continue;
+    }
+    std::sort(column_values.begin(), column_values.end());
+    if (column.type_ == TypeId::kTypeChar) {
+      column.distinct_count_ = distinct_chars[i].size();
+    } else {
+      column.distinct_count_ = 1;
+      for (size_t j = 1; j < column_values.size(); j++) {
+        column.distinct_count_ += column_values[j] != column_values[j - 1];
+      }
+    }
+    uint64_t n = column_values.size();
+    uint64_t buckets = std::min<uint64_t>(HISTOGRAM_BUCKETS, n);
+    for (uint64_t b = 0; b < buckets; b++) {
+      column.bounds_.push_back(column_values[b * n / buckets]);
+    }
+    column.bounds_.push_back(column_values[n - 1]);
+  }
+  return statistics;
+}
+
+double TableStatistics::EstimateSelectivity(uint32_t column_index, const std::string &op, const char *literal) const {
+  if (row_count_ == 0) {
+    return 0;
+  }
+  auto &column = columns_[column_index];
+  double null_fraction = static_cast<double>(column.null_count_) / row_count_;
+  double non_null_fraction = 1 - null_fraction;
+  if (op == "is") {
+    return null_fraction;
+  }
+  if (op == "not") {
+    return non_null_fraction;
+  }
+  if (literal == nullptr || column.bounds_.empty()) {
+    return 0;
+  }
+  double value = ToDouble(column.type_, literal);
+  double equal = FractionEqual(column, value);
+  double less = FractionLessThan(column, value);
+  double fraction = 0;
+  if (op == "=") {
+    fraction = equal;
+  } else if (op == "<>") {
+    fraction = 1 - equal;
+  } else if (op == "<") {
+    fraction = less;
+  } else if (op == "<=") {
+    fraction = less + equal;
+  } else if (op == ">") {
+    fraction = 1 - less - equal;
+  } else if (op == ">=") {
+    fraction = 1 - less;
+  }
+  return std::min(1.0, std::max(0.0, fraction)) * non_null_fraction;
+}
+
+double TableStatistics::FractionLessThan(const ColumnStatistics &column, double value) {
+  auto &bounds = column.bounds_;
+  size_t buckets = bounds.size() - 1;
+  if (buckets == 0) {
+    return value > bounds[0] ? 1 : 0;
+  }
+  if (value <= bounds[0]) {
+    return 0;
+  }
+  if (value > bounds[buckets]) {
+    return 1;
+  }
+  // 第一个上界不小于value的桶，之前的桶都小于value，这个桶内按均匀分布插值
+  size_t b = std::lower_bound(bounds.begin() + 1, bounds.end(), value) - bounds.begin() - 1;
+  double low = bounds[b];
+  double high = bounds[b + 1];
+  double partial = high > low ? (value - low) / (high - low) : 0;
+  return (b + partial) / buckets;
+}
+
+double TableStatistics::FractionEqual(const ColumnStatistics &column, double value) {
+  auto &bounds = column.bounds_;
+  size_t buckets = bounds.size() - 1;
+  if (value < bounds.front() || value > bounds.back()) {
+    return 0;
+  }
+  // 被这个值占满的桶
+  size_t full_buckets = 0;
+  for (size_t b = 0; b < buckets; b++) {
+    if (bounds[b] == value && bounds[b + 1] == value) {
+      full_buckets++;
+    }
+  }
+  if (full_buckets > 0) {
+    return static_cast<double>(full_buckets) / buckets;
+  }
+  return 1.0 / column.distinct_count_;
+}
+
+double TableStatistics::ToDouble(TypeId type, const Field &field) {
+  switch (type) {
+    case TypeId::kTypeInt:
+      return field.GetInt();
+    case TypeId::kTypeFloat:
+      return field.GetFloat();
+    default:
+      return CharsToDouble(field.GetChars(), field.GetLength());
+  }
+}
+
+double TableStatistics::ToDouble(TypeId type, const char *literal) {
+  switch (type) {
+    case TypeId::kTypeInt:
+      return atoi(literal);
+    case TypeId::kTypeFloat:
+      return (float)atof(literal);
+    default:
+      return CharsToDouble(literal, strlen(literal));
+  }
+}
+
+double TableStatistics::CharsToDouble(const char *chars, uint32_t len) {
+  // 前8个字节按大端序拼成整数，保持字符串的字典序
+  uint64_t prefix = 0;
+  for (uint32_t i = 0; i < 8; i++) {
+    prefix = (prefix << 8) | (i < len ? static_cast<unsigned char>(chars[i]) : 0);
+  }
+  return static_cast<double>(prefix);
+}
+
+/*
+ * 序列化顺序:
+ * 1.magic_number, row_count_(8), page_count_, columns_.size()
+ * 2.每一列: type_, distinct_count_(8), null_count_(8), bounds_.size(), bounds_(每个8)
+ */
+uint32_t TableStatistics::SerializeTo(char *buf) const {
+  char *begin = buf;
+  MACH_WRITE_UINT32(buf, STATISTICS_MAGIC_NUM);
+  buf += 4;
+  MACH_WRITE_TO(uint64_t, buf, row_count_);
+  buf += 8;
+  MACH_WRITE_UINT32(buf, page_count_);
+  buf += 4;
+  MACH_WRITE_UINT32(buf, columns_.size());
+  buf += 4;
+  for (auto &column : columns_) {
+    MACH_WRITE_UINT32(buf, column.type_);
+    buf += 4;
+    MACH_WRITE_TO(uint64_t, buf, column.distinct_count_);
+    buf += 8;
+    MACH_WRITE_TO(uint64_t, buf, column.null_count_);
+    buf += 8;
+    MACH_WRITE_UINT32(buf, column.bounds_.size());
+    buf += 4;
+    for (double bound : column.bounds_) {
+      MACH_WRITE_TO(double, buf, bound);
+      buf += 8;
+    }
+  }
+  return buf - begin;
+}
+
+uint32_t TableStatistics::GetSerializedSize() const {
+  // magic_number(4)+row_count_(8)+page_count_(4)+columns_.size()(4)
+  // +每一列type_(4)+distinct_count_(8)+null_count_(8)+bounds_.size()(4)+8*bounds_.size()
+  uint32_t size = 20;
+  for (auto &column : columns_) {
+    size += 24 + 8 * column.bounds_.size();
+  }
+  return size;
+}
+
+uint32_t TableStatistics::DeserializeFrom(const char *buf, TableStatistics *statistics) {
+  const char *begin = buf;
+  if (MACH_READ_UINT32(buf) != STATISTICS_MAGIC_NUM) {
+    return 0;
+  }
+  buf += 4;
+  statistics->row_count_ = MACH_READ_FROM(uint64_t, buf);
+  buf += 8;
+  statistics->page_count_ = MACH_READ_UINT32(buf);
+  buf += 4;
+  statistics->columns_.resize(MACH_READ_UINT32(buf));
+  buf += 4;
+  for (auto &column : statistics->columns_) {
+    column.type_ = static_cast<TypeId>(MACH_READ_UINT32(buf));
+    buf += 4;
+    column.distinct_count_ = MACH_READ_FROM(uint64_t, buf);
+    buf += 8;
+    column.null_count_ = MACH_READ_FROM(uint64_t, buf);
+    buf += 8;
+    column.bounds_.resize(MACH_READ_UINT32(buf));
+    buf += 4;
+    for (double &bound : column.bounds_) {
+      bound = MACH_READ_FROM(double, buf);
+      buf += 8;
+    }
+  }
+  return buf - begin;
+}
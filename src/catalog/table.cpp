@@ -32,6 +32,10 @@ uint32_t TableMetadata::SerializeTo(char *buf) const {
   MACH_WRITE_INT32(buf, root_page_id_);
   buf += 4;
   ofs += 4;
+  // 写入free_space_map_page_id_
+  MACH_WRITE_INT32(buf, free_space_map_page_id_);
+  buf += 4;
+  ofs += 4;
   // 写入schema
   schema_->SerializeTo(buf);
   buf += schema_->GetSerializedSize();
@@ -41,7 +45,8 @@ uint32_t TableMetadata::SerializeTo(char *buf) const {
 
 uint32_t TableMetadata::GetSerializedSize() const {
   // magic_number(4)+table_id_t(4)+table_name_(MACH_STR_SERIALIZED_SIZE(table_name_))+root_page_id_(4)
-  return 12 + MACH_STR_SERIALIZED_SIZE(table_name_) + schema_->GetSerializedSize();
+  // +free_space_map_page_id_(4)
+  return 16 + MACH_STR_SERIALIZED_SIZE(table_name_) + schema_->GetSerializedSize();
 }
 
 /**
@@ -67,7 +72,7 @@ uint32_t TableMetadata::DeserializeFrom(char *buf, TableMetadata *&table_meta, M
   buf += 4;
   ofs += 4;
   // 一个字符一个字符地读取
-  char *name = new char[len];
+  char *name = new char[len + 1];
   ofs += len;
   for (uint32_t i = 0; i < len; i++) {
     name[i] = MACH_READ_FROM(char, buf);
@@ -79,13 +84,18 @@ uint32_t TableMetadata::DeserializeFrom(char *buf, TableMetadata *&table_meta, M
   int32_t root_page_id_ = MACH_READ_INT32(buf);
   buf += 4;
   ofs += 4;
+  // 读取free_space_map_page_id_
+  int32_t free_space_map_page_id_ = MACH_READ_INT32(buf);
+  buf += 4;
+  ofs += 4;
   // 读取schema
   Schema *schema_;
   Schema::DeserializeFrom(buf,schema_,heap);
   buf += schema_->GetSerializedSize();
   ofs += schema_->GetSerializedSize();
   // 调用create函数,将反序列化得到的数据填到heap
-  table_meta = TableMetadata::Create(table_id_, table_name_, root_page_id_, (TableSchema *)schema_, heap);
+  table_meta = TableMetadata::Create(table_id_, table_name_, root_page_id_, free_space_map_page_id_,
+                                     (TableSchema *)schema_, heap);
   return ofs;
 }
 
@@ -95,11 +105,16 @@ uint32_t TableMetadata::DeserializeFrom(char *buf, TableMetadata *&table_meta, M
  * @param heap Memory heap passed by TableInfo
  */
 TableMetadata *TableMetadata::Create(table_id_t table_id, std::string table_name, page_id_t root_page_id,
-                                     TableSchema *schema, MemHeap *heap) {
+                                     page_id_t free_space_map_page_id, TableSchema *schema, MemHeap *heap) {
   // allocate space for table metadata
   void *buf = heap->Allocate(sizeof(TableMetadata));
-  return new (buf) TableMetadata(table_id, table_name, root_page_id, schema);
+  return new (buf) TableMetadata(table_id, table_name, root_page_id, free_space_map_page_id, schema);
 }
 
-TableMetadata::TableMetadata(table_id_t table_id, std::string table_name, page_id_t root_page_id, TableSchema *schema)
-    : table_id_(table_id), table_name_(table_name), root_page_id_(root_page_id), schema_(schema) {}
+TableMetadata::TableMetadata(table_id_t table_id, std::string table_name, page_id_t root_page_id,
+                             page_id_t free_space_map_page_id, TableSchema *schema)
+    : table_id_(table_id),
+      table_name_(table_name),
+      root_page_id_(root_page_id),
+      free_space_map_page_id_(free_space_map_page_id),
+      schema_(schema) {}
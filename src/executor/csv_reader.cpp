@@ -0,0 +1,80 @@
+#include "executor/csv_reader.h"
+
+CsvReader::CsvReader(const std::string &file_name, size_t buffer_size)
+    : file_(fopen(file_name.c_str(), "rb")), buffer_(new char[buffer_size]), buffer_size_(buffer_size) {}
+
+CsvReader::~CsvReader() {
+  if (file_ != nullptr) {
+    fclose(file_);
+  }
+}
+
+bool CsvReader::Fill() {
+  if (file_ == nullptr) {
+    return false;
+  }
+  size_ = fread(buffer_.get(), 1, buffer_size_, file_);
+  pos_ = 0;
+  return size_ > 0;
+}
+
+bool CsvReader::NextRecord(std::vector<std::string> *fields, std::vector<bool> *quoted) {
+  fields->clear();
+  quoted->clear();
+  int c = Get();
+  // 跳过空行
+  while (c == '\n' || c == '\r') {
+    if (c == '\n') {
+      line_++;
+    }
+    c = Get();
+  }
+  if (c == EOF) {
+    return false;
+  }
+  record_line_ = line_;
+  std::string field;
+  bool in_quotes = false;
+  bool field_quoted = false;
+  while (true) {
+    if (in_quotes) {
+      if (c == EOF) {
+        // 引号没有闭合，读到哪算哪
+        fields->emplace_back(std::move(field));
+        quoted->push_back(true);
+        break;
+      }
+      if (c == '"') {
+        if (Peek() == '"') {
+          Get();
+          field.push_back('"');
+        } else {
+          in_quotes = false;
+        }
+      } else {
+        if (c == '\n') {
+          line_++;
+        }
+        field.push_back(static_cast<char>(c));
+      }
+    } else if (c == '"' && field.empty() && !field_quoted) {
+      in_quotes = field_quoted = true;
+    } else if (c == ',') {
+      fields->emplace_back(std::move(field));
+      quoted->push_back(field_quoted);
+      field.clear();
+      field_quoted = false;
+    } else if (c == '\n' || c == EOF) {
+      if (c == '\n') {
+        line_++;
+      }
+      fields->emplace_back(std::move(field));
+      quoted->push_back(field_quoted);
+      break;
+    } else if (c != '\r' || Peek() != '\n') {
+      field.push_back(static_cast<char>(c));
+    }
+    c = Get();
+  }
+  return true;
+}
@@ -1,23 +1,38 @@
 #include "executor/execute_engine.h"
 #include <algorithm>
+#include <cerrno>
+#include <climits>
 #include <cstring>
+#include <fstream>
 #include <iomanip>
+#include <stdexcept>
+#include <strings.h>
+#include <unordered_set>
 #include "glog/logging.h"
 #include "utils/get_files.h"
 
 //#define ENABLE_EXECUTE_DEBUG
 
-bool IsSatisfiedRow(Row *row, SyntaxNode *condition, uint32_t column_index, TypeId column_type);
 string GetFieldString(Field *field, TypeId type);
-vector<RowId> GetSatisfiedRowIds(vector<vector<SyntaxNode *>> conditions, TableInfo *table_info,
-                                 vector<IndexInfo *> indexes);
 string path = "./db/";
-struct package {
-  uint32_t idx;
-  TypeId column_type;
-  char *set_value;
-};
-ExecuteEngine::ExecuteEngine() {
+
+/**
+ * Parse the frame count of a buffer pool, it must be an integer no less than MIN_BUFFER_POOL_SIZE
+ */
+static bool ParseBufferPoolSize(const char *str, uint32_t *buffer_pool_size) {
+  char *end;
+  errno = 0;
+  unsigned long val = strtoul(str, &end, 10);
+  if (*str == '-' || *end != '\0' || errno == ERANGE || val < MIN_BUFFER_POOL_SIZE || val > INT32_MAX) {
+    cout << "ERROR: buffer_pool_size must be an integer between " << MIN_BUFFER_POOL_SIZE << " and " << INT32_MAX
+         << endl;
+    return false;
+  }
+  *buffer_pool_size = static_cast<uint32_t>(val);
+  return true;
+}
+
+ExecuteEngine::ExecuteEngine(uint32_t buffer_pool_size) : buffer_pool_size_(buffer_pool_size) {
   cout << " __  __ _       _  _____  ____  _" << endl;
   cout << "|  \\/  (_)     (_)/ ____|/ __ \\| |" << endl;
   cout << "| \\  / |_ _ __  _| (___ | |  | | |" << endl;
@@ -35,7 +50,13 @@ ExecuteEngine::ExecuteEngine() {
   } else {
     for (auto db_file : db_files) {
       cout << "loading " << db_file << "... ";
-      dbs_.emplace(db_file.substr(0, db_file.size() - 3), new DBStorageEngine(path + db_file, false));
+      try {
+        dbs_.emplace(db_file.substr(0, db_file.size() - 3),
+                     new DBStorageEngine(path + db_file, false, buffer_pool_size_));
+      } catch (const std::runtime_error &e) {
+        cout << "failed: " << e.what() << endl;
+        continue;
+      }
       cout << "success!" << endl;
     }
   }
@@ -82,6 +103,12 @@ dberr_t ExecuteEngine::Execute(pSyntaxNode ast, ExecuteContext *context) {
       return ExecuteTrxCommit(ast, context);
     case kNodeTrxRollback:
       return ExecuteTrxRollback(ast, context);
+    case kNodeAnalyze:
+      return ExecuteAnalyze(ast, context);
+    case kNodeLoadData:
+      return ExecuteLoadData(ast, context);
+    case kNodeSet:
+      return ExecuteSet(ast, context);
     case kNodeExecFile:
       return ExecuteExecfile(ast, context);
     case kNodeQuit:
@@ -101,7 +128,17 @@ dberr_t ExecuteEngine::ExecuteCreateDatabase(pSyntaxNode ast, ExecuteContext *co
     cout << "ERROR: Database already exist" << endl;
     return DB_FAILED;
   } else {
-    dbs_.emplace(ast->child_->val_, new DBStorageEngine(path + ast->child_->val_ + ".db"));
+    // create database db buffer_pool_size = n，大小记在db文件里，以后打开时也用它
+    uint32_t buffer_pool_size = buffer_pool_size_;
+    pSyntaxNode size_node = ast->child_->next_;
+    if (size_node != nullptr && !ParseBufferPoolSize(size_node->val_, &buffer_pool_size)) {
+      return DB_FAILED;
+    }
+    auto db = new DBStorageEngine(path + db_name + ".db", true, buffer_pool_size);
+    if (size_node != nullptr) {
+      db->catalog_mgr_->SetBufferPoolSize(buffer_pool_size);
+    }
+    dbs_.emplace(db_name, db);
     cout << "Create " << ast->child_->val_ << " OK" << endl;
     context->related_row_num_ += 1;
     return DB_SUCCESS;
@@ -116,11 +153,16 @@ dberr_t ExecuteEngine::ExecuteDropDatabase(pSyntaxNode ast, ExecuteContext *cont
   if (dbs_.find(db_name) == dbs_.end()) {
     cout << "No such database called " << db_name << endl;
     return DB_FAILED;
+  } else if (txn_ != nullptr && db_name == current_db_) {
+    cout << "ERROR: Commit or rollback the current transaction first" << endl;
+    return DB_FAILED;
   } else {
-    string path_to_db_file = path + db_name + ".db";
-    remove(path_to_db_file.c_str());
     delete dbs_.find(db_name)->second;
     dbs_.erase(db_name);
+    string path_to_db_file = path + db_name + ".db";
+    string path_to_log_file = path + db_name + ".log";
+    remove(path_to_db_file.c_str());
+    remove(path_to_log_file.c_str());
     cout << "Drop " << db_name << " OK" << endl;
     context->related_row_num_ += 1;
     return DB_SUCCESS;
@@ -164,6 +206,9 @@ dberr_t ExecuteEngine::ExecuteUseDatabase(pSyntaxNode ast, ExecuteContext *conte
   if (dbs_.find(db_name) == dbs_.end()) {
     cout << "No such database called " << db_name << endl;
     return DB_FAILED;
+  } else if (txn_ != nullptr) {
+    cout << "ERROR: Commit or rollback the current transaction first" << endl;
+    return DB_FAILED;
   } else {
     current_db_ = db_name;
     cout << "Use " << db_name << " OK" << endl;
@@ -308,7 +353,8 @@ dberr_t ExecuteEngine::ExecuteCreateTable(pSyntaxNode ast, ExecuteContext *conte
     }
   }
 
-  dbs_[current_db_]->bpm_->FlushAllPages();
+  // DDL不在事务中，等它的page日志落盘即可，不需要写回所有page
+  dbs_[current_db_]->log_mgr_->FlushAll();
   context->related_row_num_ += 1;
   return DB_SUCCESS;
 }
@@ -448,26 +494,41 @@ dberr_t ExecuteEngine::ExecuteCreateIndex(pSyntaxNode ast, ExecuteContext *conte
     }
   }
   IndexInfo *tmp_index_info;
-  dbs_[current_db_]->catalog_mgr_->CreateIndex(table_name, index_name, index_keys, nullptr, tmp_index_info);
+  if (dbs_[current_db_]->catalog_mgr_->CreateIndex(table_name, index_name, index_keys, nullptr, tmp_index_info) !=
+      DB_SUCCESS) {
+    cout << "ERROR: Index already exist" << endl;
+    return DB_FAILED;
+  }
   TableInfo *tmp_table_info;
   dbs_[current_db_]->catalog_mgr_->GetTable(table_name, tmp_table_info);
   uint32_t *column_index = new uint32_t[index_keys.size()];
   for (unsigned long i = 0; i < index_keys.size(); ++i) {
     tmp_table_info->GetSchema()->GetColumnIndex(index_keys[i], column_index[i]);
   }
-  auto table_iter = tmp_table_info->GetTableHeap()->Begin(nullptr);
-  for (; table_iter != tmp_table_info->GetTableHeap()->End(); ++table_iter) {
-    // 遍历整个表，对每一行都取出响应Index keys插入索引
-    vector<Field> fields;
-    for (unsigned long i = 0; i < index_keys.size(); ++i) {
-      fields.emplace_back(*(table_iter->GetField(column_index[i])));
-    }
-    Row tmp_row(fields);
-    tmp_index_info->GetIndex()->InsertEntry(tmp_row, table_iter->GetRowId(), nullptr);
-  }
+  // 遍历整个表，把每一行的Index keys一次性交给索引，排好序后自底向上建树
+  auto table_heap = tmp_table_info->GetTableHeap();
+  auto table_iter = table_heap->Begin(nullptr);
+  dberr_t build_result = tmp_index_info->GetIndex()->BulkLoad(
+      [&](vector<Field> *key_fields, RowId *row_id) {
+        if (table_iter == table_heap->End()) {
+          return false;
+        }
+        for (unsigned long i = 0; i < index_keys.size(); ++i) {
+          key_fields->emplace_back(*(table_iter->GetField(column_index[i])));
+        }
+        *row_id = table_iter->GetRowId();
+        ++table_iter;
+        return true;
+      },
+      INDEX_FILL_FACTOR, nullptr);
   delete[] column_index;
+  if (build_result != DB_SUCCESS) {
+    cout << "ERROR: Failed to build index " << index_name << endl;
+    return DB_FAILED;
+  }
   cout << "Create bptree index " << index_name << " OK" << endl;
-  dbs_[current_db_]->bpm_->FlushAllPages();
+  // DDL不在事务中，等它的page日志落盘即可，不需要写回所有page
+  dbs_[current_db_]->log_mgr_->FlushAll();
   context->related_row_num_ += 1;
   return DB_SUCCESS;
 }
@@ -533,13 +594,32 @@ dberr_t ExecuteEngine::ExecuteSelect(pSyntaxNode ast, ExecuteContext *context) {
   }
   ast = ast->next_;
   string table_name = ast->val_;
+  pSyntaxNode conditions_node = nullptr;
+  pSyntaxNode limit_node = nullptr;
+  for (auto node = ast->next_; node != nullptr; node = node->next_) {
+    if (node->type_ == kNodeConditions) {
+      conditions_node = node;
+    } else if (node->type_ == kNodeLimit) {
+      limit_node = node;
+    }
+  }
+  unsigned long limit = 0;
+  if (limit_node != nullptr) {
+    const char *str = limit_node->child_->val_;
+    char *end;
+    errno = 0;
+    limit = strtoul(str, &end, 10);
+    if (*str == '-' || *end != '\0' || errno == ERANGE) {
+      cout << "ERROR: limit must be a non-negative integer" << endl;
+      return DB_FAILED;
+    }
+  }
   vector<vector<pSyntaxNode>> conditions;
   vector<pSyntaxNode> now_condition;
   // 如果有查询条件
-  if (ast->next_) {
-    ast = ast->next_->child_;
+  if (conditions_node != nullptr) {
+    ast = conditions_node->child_;
     while (ast->type_ == kNodeConnector) {
-      // TODO: 忘了加条件里的列名是否合法，非法会段错误，没空加就算了
       now_condition.emplace_back(ast->child_->next_);
       string connector = ast->val_;
       if (connector == "or") {
@@ -580,42 +660,22 @@ dberr_t ExecuteEngine::ExecuteSelect(pSyntaxNode ast, ExecuteContext *context) {
   }
   vector<IndexInfo *> indexes;
   dbs_[current_db_]->catalog_mgr_->GetTableIndexes(table_name, indexes);
-  cout << "We have " << indexes.size() << " indexes" << endl;
-  auto result = GetSatisfiedRowIds(conditions, table_info, indexes);
-  if (result.size() == 0) {
-    cout << "empty set" << endl;
-    return DB_SUCCESS;
-  } else {
-    context->related_row_num_ = result.size();
-    // 打印result
-    vector<Row> result_rows;
-    // 需要知道要取一个row中哪些field的值，（投影操作），所以需要先得到这些field的index，也就是column_indexes
-    for (unsigned long i = 0; i < result.size(); i++) {
-      auto tmp_row = Row(result[i]);
-      table_info->GetTableHeap()->GetTuple(&tmp_row, nullptr);
-      result_rows.emplace_back(tmp_row);
-    }
-    for (auto column : columns) {
-      uint32_t column_index;
-      table_info->GetSchema()->GetColumnIndex(column, column_index);
-      column_types.emplace_back(table_info->GetSchema()->GetColumn(column_index)->GetType());
-      column_indexes.emplace_back(column_index);
-    }
-    unsigned long *print_length = new unsigned long[columns.size()];
-    for (unsigned long i = 0; i < columns.size(); ++i) {
-      print_length[i] = columns[i].size();
-    }
-    // 先统计一下每一列的长度
-    for (auto result_row : result_rows) {
-      for (unsigned long i = 0; i < column_indexes.size(); i++) {
-        // 如果长度长于print_length[i]，那么更新print_length
-        unsigned long tmp_length = GetFieldString(result_row.GetField(column_indexes[i]), column_types[i]).size();
-        if (tmp_length > print_length[i]) {
-          print_length[i] = tmp_length;
-        }
-      }
-    }
-    // 打印列名行
+  // 读到的行加共享锁，不会读到其他事务还没提交的修改
+  Transaction *txn = StatementBegin();
+  auto scan = BuildScanExecutor(conditions, table_info, indexes, txn);
+  if (scan == nullptr) {
+    return StatementEnd(txn, DB_FAILED);
+  }
+  std::unique_ptr<AbstractExecutor> executor = std::make_unique<ProjectionExecutor>(std::move(scan), column_indexes);
+  // limit放在最上面，取够了行就不会再往下拉
+  if (limit_node != nullptr) {
+    executor = std::make_unique<LimitExecutor>(std::move(executor), limit);
+  }
+  executor->Init();
+  // 结果按批流式输出，列宽由列名和第一批结果决定，后面更长的值会把这一列撑开
+  vector<Row> batch;
+  vector<unsigned long> print_length;
+  auto print_separator = [&]() {
     for (unsigned long i = 0; i < columns.size(); ++i) {
       if (i == 0) {
         cout << "+-" << setw(print_length[i]) << setfill('-') << "-"
@@ -626,50 +686,65 @@ dberr_t ExecuteEngine::ExecuteSelect(pSyntaxNode ast, ExecuteContext *context) {
       }
     }
     cout << endl;
-    for (unsigned long i = 0; i < columns.size(); ++i) {
-      if (i == 0) {
-        cout << "| " << setw(print_length[i]) << setfill(' ') << left << columns[i] << " |";
-      } else {
-        cout << " " << setw(print_length[i]) << setfill(' ') << left << columns[i] << " |";
+  };
+  while (executor->Next(&batch)) {
+    if (context->related_row_num_ == 0) {
+      // 先统计一下每一列的长度
+      for (unsigned long i = 0; i < columns.size(); ++i) {
+        print_length.emplace_back(columns[i].size());
       }
-    }
-    cout << endl;
-    for (unsigned long i = 0; i < columns.size(); ++i) {
-      if (i == 0) {
-        cout << "+-" << setw(print_length[i]) << setfill('-') << "-"
-             << "-+";
-      } else {
-        cout << "-" << setw(print_length[i]) << setfill('-') << "-"
-             << "-+";
+      for (auto &result_row : batch) {
+        for (unsigned long i = 0; i < column_indexes.size(); i++) {
+          // 如果长度长于print_length[i]，那么更新print_length
+          unsigned long tmp_length = GetFieldString(result_row.GetField(i), column_types[i]).size();
+          if (tmp_length > print_length[i]) {
+            print_length[i] = tmp_length;
+          }
+        }
       }
+      // 打印列名行
+      print_separator();
+      for (unsigned long i = 0; i < columns.size(); ++i) {
+        if (i == 0) {
+          cout << "| " << setw(print_length[i]) << setfill(' ') << left << columns[i] << " |";
+        } else {
+          cout << " " << setw(print_length[i]) << setfill(' ') << left << columns[i] << " |";
+        }
+      }
+      cout << endl;
+      print_separator();
     }
-    cout << endl;
+    context->related_row_num_ += batch.size();
     // 打印数据
-    for (auto result_row : result_rows) {
+    for (auto &result_row : batch) {
       for (unsigned long i = 0; i < columns.size(); ++i) {
         if (i == 0) {
           cout << "| " << setw(print_length[i]) << setfill(' ') << left
-               << GetFieldString(result_row.GetField(column_indexes[i]), column_types[i]) << " |";
+               << GetFieldString(result_row.GetField(i), column_types[i]) << " |";
         } else {
           cout << " " << setw(print_length[i]) << setfill(' ') << left
-               << GetFieldString(result_row.GetField(column_indexes[i]), column_types[i]) << " |";
+               << GetFieldString(result_row.GetField(i), column_types[i]) << " |";
         }
       }
       cout << endl;
     }
-    for (unsigned long i = 0; i < columns.size(); ++i) {
-      if (i == 0) {
-        cout << "+-" << setw(print_length[i]) << setfill('-') << "-"
-             << "-+";
-      } else {
-        cout << "-" << setw(print_length[i]) << setfill('-') << "-"
-             << "-+";
-      }
+  }
+  // 中途读不出页或者事务被选为死锁的牺牲者时停下来，已经输出的行保留
+  if (executor->GetStatus() != DB_SUCCESS) {
+    if (context->related_row_num_ != 0) {
+      print_separator();
     }
-    cout << endl;
-    delete[] print_length;
+    if (txn->GetState() != TxnState::kAborted) {
+      cout << "ERROR: Failed to read the table or its index" << endl;
+    }
+    return StatementEnd(txn, executor->GetStatus());
   }
-  return DB_SUCCESS;
+  if (context->related_row_num_ == 0) {
+    cout << "empty set" << endl;
+  } else {
+    print_separator();
+  }
+  return StatementEnd(txn, DB_SUCCESS);
 }
 
 dberr_t ExecuteEngine::ExecuteInsert(pSyntaxNode ast, ExecuteContext *context) {
@@ -716,6 +791,11 @@ dberr_t ExecuteEngine::ExecuteInsert(pSyntaxNode ast, ExecuteContext *context) {
     }
     // char
     else {
+      // 索引键的大小按column定义的长度分配，超长的字符串直接拒绝
+      if (strlen(val_node->val_) > (*itr)->GetLength()) {
+        cout << "ERROR: Value too long for column " << (*itr)->GetName() << endl;
+        return DB_FAILED;
+      }
       fields.emplace_back(Field(kTypeChar, val_node->val_, strlen(val_node->val_), true));
     }
     val_node = val_node->next_;
@@ -727,19 +807,7 @@ dberr_t ExecuteEngine::ExecuteInsert(pSyntaxNode ast, ExecuteContext *context) {
   bool is_satisfied_indexes = true;
   string error_index_name;
   for (auto index : indexes) {
-    auto index_columns = index->GetIndexKeySchema()->GetColumns();
-    vector<uint32_t> column_indexes;  // 索引列的index标号
-    for (auto index_column : index_columns) {
-      uint32_t tmp;
-      if (table_info->GetSchema()->GetColumnIndex(index_column->GetName(), tmp) == DB_SUCCESS) {
-        column_indexes.emplace_back(tmp);
-      }
-    }
-    vector<Field> index_key_fields;
-    for (auto column_index : column_indexes) {
-      index_key_fields.emplace_back(fields[column_index]);
-    }
-    Row index_check_row(index_key_fields);
+    Row index_check_row(row, index->GetKeyMapping());
     vector<RowId> tmp_result;
     if (index->GetIndex()->ScanKey(index_check_row, tmp_result, nullptr, "") == DB_SUCCESS) {
       // 在b+树中找到了同样的节点，说明这个新行不满足唯一性
@@ -752,28 +820,19 @@ dberr_t ExecuteEngine::ExecuteInsert(pSyntaxNode ast, ExecuteContext *context) {
     cout << "ERROR: Same key has exist in index " << error_index_name << endl;
     return DB_FAILED;
   }
+  // 不在BEGIN开启的事务中时，每条语句是一个事务，提交时只需要等日志落盘，不再把所有page写回
+  Transaction *txn = StatementBegin();
   // 这里插入后，里面已经给这个row加上了rowid
-  table_info->GetTableHeap()->InsertTuple(row, nullptr);
+  if (!table_info->GetTableHeap()->InsertTuple(row, txn)) {
+    return StatementEnd(txn, DB_FAILED);
+  }
   // 更新全部该表中的索引
   for (auto index : indexes) {
-    auto index_columns = index->GetIndexKeySchema()->GetColumns();
-    vector<uint32_t> column_indexes;  // 索引列的index标号
-    for (auto index_column : index_columns) {
-      uint32_t tmp;
-      if (table_info->GetSchema()->GetColumnIndex(index_column->GetName(), tmp) == DB_SUCCESS) {
-        column_indexes.emplace_back(tmp);
-      }
-    }
-    vector<Field> index_key_fields;
-    for (auto column_index : column_indexes) {
-      index_key_fields.emplace_back(fields[column_index]);
-    }
-    Row index_row(index_key_fields);
-    index->GetIndex()->InsertEntry(index_row, row.GetRowId(), nullptr);
+    Row index_row(row, index->GetKeyMapping());
+    index->GetIndex()->InsertEntry(index_row, row.GetRowId(), txn);
   }
-  dbs_[current_db_]->bpm_->FlushAllPages();
   context->related_row_num_ += 1;
-  return DB_SUCCESS;
+  return StatementEnd(txn, DB_SUCCESS);
 }
 
 dberr_t ExecuteEngine::ExecuteDelete(pSyntaxNode ast, ExecuteContext *context) {
@@ -791,8 +850,6 @@ dberr_t ExecuteEngine::ExecuteDelete(pSyntaxNode ast, ExecuteContext *context) {
     cout << "ERROR: Table not exist" << endl;
     return DB_FAILED;
   }
-  TableHeap *table_heap = table_info->GetTableHeap();
-
   if (ast->next_) {
     ast = ast->next_->child_;
     while (ast->type_ == kNodeConnector) {
@@ -815,39 +872,18 @@ dberr_t ExecuteEngine::ExecuteDelete(pSyntaxNode ast, ExecuteContext *context) {
     cout << "ERROR: Indexes exist, but query index info failed" << endl;
     return DB_FAILED;
   }
-  cout << "We have " << indexes.size() << " indexes" << endl;
-  auto results = GetSatisfiedRowIds(conditions, table_info, indexes);
-  context->related_row_num_ += results.size();
-  for (uint32_t i = 0; i < results.size(); i++) {
-    Row old_row(results[i]);
-    table_heap->GetTuple(&old_row, nullptr);
-    vector<Field> fields;
-    // 获取需要被删除的row的所有field
-    for (uint32_t idx = 0; idx < table_info->GetSchema()->GetColumnCount(); idx++) {
-      fields.emplace_back(*old_row.GetField(idx));
-    }
-    table_heap->ApplyDelete(results[i], nullptr);
-    if (indexes.size() != 0) {
-      for (auto index : indexes) {
-        auto index_columns = index->GetIndexKeySchema()->GetColumns();
-        vector<uint32_t> column_indexes;  // 索引列的index标号
-        for (auto index_column : index_columns) {
-          uint32_t tmp;
-          if (table_info->GetSchema()->GetColumnIndex(index_column->GetName(), tmp) == DB_SUCCESS) {
-            column_indexes.emplace_back(tmp);
-          }
-        }
-        vector<Field> index_key_fields;
-        for (auto column_index : column_indexes) {
-          index_key_fields.emplace_back(fields[column_index]);
-        }
-        Row index_row(index_key_fields);
-        index->GetIndex()->RemoveEntry(index_row, old_row.GetRowId(), nullptr);
-      }
-    }
-    dbs_[current_db_]->bpm_->FlushAllPages();
+  Transaction *txn = StatementBegin();
+  auto scan = BuildScanExecutor(conditions, table_info, indexes, txn);
+  if (scan == nullptr) {
+    return StatementEnd(txn, DB_FAILED);
   }
-  return DB_SUCCESS;
+  DeleteExecutor executor(std::move(scan), table_info, indexes, txn);
+  executor.Init();
+  vector<Row> batch;
+  while (executor.Next(&batch)) {
+    context->related_row_num_ += batch.size();
+  }
+  return StatementEnd(txn, executor.GetStatus());
 }
 
 dberr_t ExecuteEngine::ExecuteUpdate(pSyntaxNode ast, ExecuteContext *context) {
@@ -862,7 +898,6 @@ dberr_t ExecuteEngine::ExecuteUpdate(pSyntaxNode ast, ExecuteContext *context) {
     cout << "ERROR: Table not exist" << endl;
     return DB_FAILED;
   }
-  TableHeap *table_heap = table_info->GetTableHeap();
   vector<vector<pSyntaxNode>> conditions;
   vector<pSyntaxNode> now_condition;
   pSyntaxNode values = ast->next_;
@@ -893,133 +928,331 @@ dberr_t ExecuteEngine::ExecuteUpdate(pSyntaxNode ast, ExecuteContext *context) {
   // 获取符合条件的rows
   vector<IndexInfo *> indexes;
   dbs_[current_db_]->catalog_mgr_->GetTableIndexes(table_name, indexes);
-  cout << "We have " << indexes.size() << " indexes" << endl;
-  auto results = GetSatisfiedRowIds(conditions, table_info, indexes);
-  //
-  vector<int> value_index;
-  vector<TypeId> column_type;
-  vector<string> set_value;
-  map<uint32_t, package> need_update;
-  // 遍历比较值
+  // 遍历需要更新的字段，得到列号和新值
+  vector<uint32_t> update_columns;
+  vector<Field> update_values;
   for (auto itr : need_set) {
-    // 遍历column
-    for (uint32_t i = 0; i < table_info->GetSchema()->GetColumnCount(); i++) {
-      Column now_column = table_info->GetSchema()->GetColumn(i);
-      // 如果当前column和当前节点的字段名称相同，则将它的信息放入容器
-      if (now_column.GetName() == itr->child_->val_) {
-        struct package tmp;
-        tmp.idx = i;
-        tmp.column_type = now_column.GetType();
-        tmp.set_value = itr->child_->next_->val_;
-        need_update[i] = tmp;
-      }
-    }
-  }
-  // 开始update
-  context->related_row_num_ += results.size();
-  Schema *now_schema = table_info->GetSchema();
-  for (auto itr : results) {
-    vector<Field> new_fields;
-    Row now_row(itr);
-    table_heap->GetTuple(&now_row, nullptr);
-    for (uint32_t idx = 0; idx < now_schema->GetColumnCount(); idx++) {
-      if (need_update.find(idx) != need_update.end()) {
-        // 这里是需要更新的
-        if (need_update[idx].column_type == kTypeInt) {
-          Field tmp(kTypeInt, atoi(need_update[idx].set_value));
-          new_fields.emplace_back(tmp);
-        } else if (need_update[idx].column_type == kTypeFloat) {
-          Field tmp(kTypeFloat, (float)atof(need_update[idx].set_value));
-          new_fields.emplace_back(tmp);
-        } else {
-          Field tmp(kTypeChar, need_update[idx].set_value, strlen(need_update[idx].set_value), false);
-          new_fields.emplace_back(tmp);
-        }
-      } else {
-        // 这里直接复制就好
-        Field tmp(*now_row.GetField(idx));
-        new_fields.emplace_back(tmp);
-      }
+    uint32_t column_index;
+    if (table_info->GetSchema()->GetColumnIndex(itr->child_->val_, column_index) != DB_SUCCESS) {
+      cout << "ERROR: Column not exist" << endl;
+      return DB_FAILED;
     }
-    // 判断即将更新的row会不会破坏index
-    if (indexes.size() != 0) {
-      bool is_satisfied_indexes = true;
-      string error_index_name;
-      for (auto index : indexes) {
-        auto index_columns = index->GetIndexKeySchema()->GetColumns();
-        vector<uint32_t> column_indexes;  // 索引列的index标号
-        for (auto index_column : index_columns) {
-          uint32_t tmp;
-          if (table_info->GetSchema()->GetColumnIndex(index_column->GetName(), tmp) == DB_SUCCESS) {
-            column_indexes.emplace_back(tmp);
-          }
-        }
-        vector<Field> index_key_fields;
-        for (auto column_index : column_indexes) {
-          index_key_fields.emplace_back(new_fields[column_index]);
-        }
-        Row index_check_row(index_key_fields);
-        vector<RowId> tmp_result;
-        if (index->GetIndex()->ScanKey(index_check_row, tmp_result, nullptr, "") == DB_SUCCESS) {
-          // 在b+树中找到了同样的节点，说明这个新行不满足唯一性
-          is_satisfied_indexes = false;
-          error_index_name = index->GetIndexName();
-          break;
-        }
-      }
-      if (!is_satisfied_indexes) {
-        cout << "ERROR: Same key has exist in index " << error_index_name << endl;
+    const Column *column = table_info->GetSchema()->GetColumn(column_index);
+    char *set_value = itr->child_->next_->val_;
+    if (column->GetType() == kTypeInt) {
+      update_values.emplace_back(kTypeInt, atoi(set_value));
+    } else if (column->GetType() == kTypeFloat) {
+      update_values.emplace_back(kTypeFloat, (float)atof(set_value));
+    } else {
+      if (strlen(set_value) > column->GetLength()) {
+        cout << "ERROR: Value too long for column " << column->GetName() << endl;
         return DB_FAILED;
       }
+      update_values.emplace_back(kTypeChar, set_value, strlen(set_value), true);
     }
-    // 利用fields构建新的Row并update,注意保持rowid不变
-    Row new_row(new_fields);
-    new_row.SetRowId(itr);
-    table_heap->UpdateTuple(new_row, itr, nullptr);
-    // 更新index，先romoveEntry再insertEntry
-    if (indexes.size() != 0) {
-      for (auto index : indexes) {
-        auto index_columns = index->GetIndexKeySchema()->GetColumns();
-        vector<uint32_t> column_indexes;  // 索引列的index标号
-        for (auto index_column : index_columns) {
-          uint32_t tmp;
-          if (table_info->GetSchema()->GetColumnIndex(index_column->GetName(), tmp) == DB_SUCCESS) {
-            column_indexes.emplace_back(tmp);
-          }
-        }
-        vector<Field> index_key_fields;
-        for (auto column_index : column_indexes) {
-          index_key_fields.emplace_back(new_fields[column_index]);
-        }
-        Row index_row(index_key_fields);
-        index->GetIndex()->RemoveEntry(index_row, new_row.GetRowId(), nullptr);
-        index->GetIndex()->InsertEntry(index_row, new_row.GetRowId(), nullptr);
-      }
-    }
-    dbs_[current_db_]->bpm_->FlushAllPages();
+    update_columns.emplace_back(column_index);
   }
-  return DB_SUCCESS;
+  // 开始update
+  Transaction *txn = StatementBegin();
+  auto scan = BuildScanExecutor(conditions, table_info, indexes, txn);
+  if (scan == nullptr) {
+    return StatementEnd(txn, DB_FAILED);
+  }
+  UpdateExecutor executor(std::move(scan), table_info, indexes, std::move(update_columns), std::move(update_values),
+                          txn);
+  executor.Init();
+  vector<Row> batch;
+  while (executor.Next(&batch)) {
+    context->related_row_num_ += batch.size();
+  }
+  // 失败时单条语句的事务回滚之前已经更新的行
+  return StatementEnd(txn, executor.GetStatus());
 }
 
 dberr_t ExecuteEngine::ExecuteTrxBegin(pSyntaxNode ast, ExecuteContext *context) {
 #ifdef ENABLE_EXECUTE_DEBUG
   LOG(INFO) << "ExecuteTrxBegin" << std::endl;
 #endif
-  return DB_FAILED;
+  if (dbs_.find(current_db_) == dbs_.end()) {
+    cout << "ERROR: No database selected" << endl;
+    return DB_FAILED;
+  }
+  if (txn_ != nullptr) {
+    cout << "ERROR: Already in a transaction" << endl;
+    return DB_FAILED;
+  }
+  txn_ = dbs_[current_db_]->txn_mgr_->Begin();
+  return DB_SUCCESS;
 }
 
 dberr_t ExecuteEngine::ExecuteTrxCommit(pSyntaxNode ast, ExecuteContext *context) {
 #ifdef ENABLE_EXECUTE_DEBUG
   LOG(INFO) << "ExecuteTrxCommit" << std::endl;
 #endif
-  return DB_FAILED;
+  if (txn_ == nullptr) {
+    cout << "ERROR: Not in a transaction" << endl;
+    return DB_FAILED;
+  }
+  dbs_[current_db_]->txn_mgr_->Commit(txn_);
+  txn_ = nullptr;
+  return DB_SUCCESS;
 }
 
 dberr_t ExecuteEngine::ExecuteTrxRollback(pSyntaxNode ast, ExecuteContext *context) {
 #ifdef ENABLE_EXECUTE_DEBUG
   LOG(INFO) << "ExecuteTrxRollback" << std::endl;
 #endif
-  return DB_FAILED;
+  if (txn_ == nullptr) {
+    cout << "ERROR: Not in a transaction" << endl;
+    return DB_FAILED;
+  }
+  dbs_[current_db_]->txn_mgr_->Abort(txn_);
+  txn_ = nullptr;
+  return DB_SUCCESS;
+}
+
+dberr_t ExecuteEngine::ExecuteAnalyze(pSyntaxNode ast, ExecuteContext *context) {
+#ifdef ENABLE_EXECUTE_DEBUG
+  LOG(INFO) << "ExecuteAnalyze" << std::endl;
+#endif
+  if (dbs_.find(current_db_) == dbs_.end()) {
+    cout << "ERROR: No current database" << endl;
+    return DB_FAILED;
+  }
+  string table_name = ast->child_->val_;
+  auto catalog = dbs_[current_db_]->catalog_mgr_;
+  dberr_t result = catalog->AnalyzeTable(table_name);
+  if (result == DB_TABLE_NOT_EXIST) {
+    cout << "ERROR: Table not exist" << endl;
+    return DB_TABLE_NOT_EXIST;
+  }
+  if (result != DB_SUCCESS) {
+    cout << "ERROR: No free page to save the statistics of " << table_name << endl;
+    return result;
+  }
+  const TableStatistics *statistics = nullptr;
+  catalog->GetTableStatistics(table_name, statistics);
+  context->related_row_num_ = statistics->GetRowCount();
+  cout << "Analyze " << table_name << " OK, " << statistics->GetRowCount() << " rows" << endl;
+  return DB_SUCCESS;
+}
+
+// 把csv的一条记录按列的类型转成Field，不带引号的空字段是null，格式不对时返回false并给出原因
+static bool ParseCsvRecord(const vector<Column *> &columns, const vector<string> &values, const vector<bool> &quoted,
+                           vector<Field> *fields, string *error) {
+  if (values.size() != columns.size()) {
+    *error = "expect " + std::to_string(columns.size()) + " fields but got " + std::to_string(values.size());
+    return false;
+  }
+  for (size_t i = 0; i < columns.size(); i++) {
+    auto column = columns[i];
+    const string &value = values[i];
+    if (value.empty() && !quoted[i]) {
+      if (!column->IsNullable()) {
+        *error = "column " + column->GetName() + " can not be null";
+        return false;
+      }
+      fields->emplace_back(column->GetType());
+      continue;
+    }
+    char *end = nullptr;
+    errno = 0;
+    if (column->GetType() == kTypeInt) {
+      long val = strtol(value.c_str(), &end, 10);
+      if (*end != '\0' || errno == ERANGE || val < INT32_MIN || val > INT32_MAX) {
+        *error = "invalid int " + value + " for column " + column->GetName();
+        return false;
+      }
+      fields->emplace_back(kTypeInt, static_cast<int32_t>(val));
+    } else if (column->GetType() == kTypeFloat) {
+      float val = strtof(value.c_str(), &end);
+      if (*end != '\0' || errno == ERANGE) {
+        *error = "invalid float " + value + " for column " + column->GetName();
+        return false;
+      }
+      fields->emplace_back(kTypeFloat, val);
+    } else {
+      if (value.size() > column->GetLength()) {
+        *error = "value too long for column " + column->GetName();
+        return false;
+      }
+      fields->emplace_back(kTypeChar, const_cast<char *>(value.c_str()), value.size(), true);
+    }
+  }
+  return true;
+}
+
+// LOAD DATA和DDL一样不在事务中执行：行直接追加到新的page里，索引在最后用排好序的新键一次性合并，只刷一次日志
+dberr_t ExecuteEngine::ExecuteLoadData(pSyntaxNode ast, ExecuteContext *context) {
+#ifdef ENABLE_EXECUTE_DEBUG
+  LOG(INFO) << "ExecuteLoadData" << std::endl;
+#endif
+  static constexpr uint32_t MAX_WARNINGS = 10;
+  if (dbs_.find(current_db_) == dbs_.end()) {
+    cout << "ERROR: No current database" << endl;
+    return DB_FAILED;
+  }
+  if (txn_ != nullptr) {
+    cout << "ERROR: Can not load data inside a transaction" << endl;
+    return DB_FAILED;
+  }
+  string file_name = ast->child_->val_;
+  string table_name = ast->child_->next_->val_;
+  auto catalog = dbs_[current_db_]->catalog_mgr_;
+  TableInfo *table_info;
+  if (catalog->GetTable(table_name, table_info) != DB_SUCCESS) {
+    cout << "ERROR: Table not exist" << endl;
+    return DB_TABLE_NOT_EXIST;
+  }
+  vector<IndexInfo *> indexes;
+  if (catalog->GetTableIndexes(table_name, indexes) != DB_SUCCESS) {
+    cout << "ERROR: Indexes exist, but query index info failed" << endl;
+    return DB_FAILED;
+  }
+  CsvReader reader(file_name);
+  if (!reader.IsOpen()) {
+    cout << "ERROR: Can not open file " << file_name << endl;
+    return DB_FAILED;
+  }
+  auto columns = table_info->GetSchema()->GetColumns();
+  auto table_heap = table_info->GetTableHeap();
+  vector<string> values;
+  vector<bool> quoted;
+  string error;
+  uint32_t parsed = 0;
+  uint32_t skipped = 0;
+  uint32_t appended = 0;
+  RowId first_rid = table_heap->AppendTuples(
+      [&](vector<Field> *fields) {
+        while (reader.NextRecord(&values, &quoted)) {
+          if (ParseCsvRecord(columns, values, quoted, fields, &error)) {
+            parsed++;
+            return true;
+          }
+          fields->clear();
+          if (skipped++ < MAX_WARNINGS) {
+            cout << "WARNING: Line " << reader.GetLineNumber() << " skipped, " << error << endl;
+          }
+        }
+        return false;
+      },
+      [&](const Row &) { appended++; });
+  // 一行太大放不进page
+  skipped += parsed - appended;
+  // 每个索引扫一遍新插入的行，和已有的键或文件中前面的行重复的行记下来，最后从所有索引和表中删掉
+  std::unordered_set<RowId> rejected;
+  for (auto index : indexes) {
+    if (first_rid == INVALID_ROWID) {
+      break;
+    }
+    auto &key_map = index->GetKeyMapping();
+    TableIterator table_iter(table_heap, first_rid);
+    vector<RowId> duplicates;
+    dberr_t build_result = index->GetIndex()->BulkLoad(
+        [&](vector<Field> *key_fields, RowId *row_id) {
+          while (table_iter != table_heap->End() && rejected.count(table_iter->GetRowId()) > 0) {
+            ++table_iter;
+          }
+          if (table_iter == table_heap->End()) {
+            return false;
+          }
+          for (auto column_index : key_map) {
+            key_fields->emplace_back(*(table_iter->GetField(column_index)));
+          }
+          *row_id = table_iter->GetRowId();
+          ++table_iter;
+          return true;
+        },
+        INDEX_FILL_FACTOR, &duplicates);
+    if (build_result != DB_SUCCESS) {
+      cout << "ERROR: Failed to update index " << index->GetIndexName() << endl;
+      return DB_FAILED;
+    }
+    rejected.insert(duplicates.begin(), duplicates.end());
+  }
+  for (auto &rid : rejected) {
+    Row row(rid);
+    if (!table_heap->GetTuple(&row, nullptr)) {
+      continue;
+    }
+    for (auto index : indexes) {
+      vector<Field> key_fields;
+      for (auto column_index : index->GetKeyMapping()) {
+        key_fields.emplace_back(*(row.GetField(column_index)));
+      }
+      Row key(key_fields);
+      vector<RowId> result;
+      // 只删这一行自己的索引项，同一个键可能属于先插入的另一行
+      if (index->GetIndex()->ScanKey(key, result, nullptr, "=") == DB_SUCCESS && result[0] == rid) {
+        index->GetIndex()->RemoveEntry(key, rid, nullptr);
+      }
+    }
+    table_heap->ApplyDelete(rid, nullptr);
+  }
+  skipped += rejected.size();
+  dbs_[current_db_]->log_mgr_->FlushAll();
+  uint32_t loaded = appended - rejected.size();
+  cout << "Load " << loaded << " rows into " << table_name;
+  if (skipped > 0) {
+    cout << ", " << skipped << " rows skipped";
+  }
+  cout << endl;
+  context->related_row_num_ += loaded;
+  return DB_SUCCESS;
+}
+
+Transaction *ExecuteEngine::StatementBegin() {
+  return txn_ != nullptr ? txn_ : dbs_[current_db_]->txn_mgr_->Begin();
+}
+
+dberr_t ExecuteEngine::StatementEnd(Transaction *txn, dberr_t result) {
+  auto txn_mgr = dbs_[current_db_]->txn_mgr_;
+  if (txn->GetState() == TxnState::kAborted) {
+    cout << "ERROR: Transaction aborted because of deadlock, all its changes are rolled back" << endl;
+    txn_mgr->Abort(txn);
+    if (txn == txn_) {
+      txn_ = nullptr;
+    }
+    return DB_FAILED;
+  }
+  if (txn == txn_) {
+    return result;
+  }
+  if (result == DB_SUCCESS) {
+    txn_mgr->Commit(txn);
+  } else {
+    txn_mgr->Abort(txn);
+  }
+  return result;
+}
+
+dberr_t ExecuteEngine::ExecuteSet(pSyntaxNode ast, ExecuteContext *context) {
+#ifdef ENABLE_EXECUTE_DEBUG
+  LOG(INFO) << "ExecuteSet" << std::endl;
+#endif
+  string name = ast->child_->val_;
+  if (strcasecmp(name.c_str(), "buffer_pool_size") != 0) {
+    cout << "ERROR: Unknown variable " << name << endl;
+    return DB_FAILED;
+  }
+  if (dbs_.find(current_db_) == dbs_.end()) {
+    cout << "ERROR: No current database" << endl;
+    return DB_FAILED;
+  }
+  uint32_t buffer_pool_size;
+  if (!ParseBufferPoolSize(ast->child_->next_->val_, &buffer_pool_size)) {
+    return DB_FAILED;
+  }
+  // 在线调整当前数据库的缓冲池，缩小时要等被pin住的帧；新的大小记在db文件里，下次打开时也用它
+  auto db = dbs_[current_db_];
+  if (!db->bpm_->Resize(buffer_pool_size)) {
+    cout << "ERROR: Buffer pool pages stay pinned, buffer_pool_size of " << current_db_ << " is still "
+         << db->bpm_->GetPoolSize() << endl;
+    return DB_FAILED;
+  }
+  db->catalog_mgr_->SetBufferPoolSize(buffer_pool_size);
+  cout << "buffer_pool_size of " << current_db_ << " is " << buffer_pool_size << endl;
+  return DB_SUCCESS;
 }
 
 // 可以是任意非二进制文件
@@ -1114,131 +1347,11 @@ dberr_t ExecuteEngine::ExecuteQuit(pSyntaxNode ast, ExecuteContext *context) {
   return DB_SUCCESS;
 }
 
-// 判断Row对象是否满足condition，condition中涉及到的column在row中为第column_index个
-bool IsSatisfiedRow(Row *row, SyntaxNode *condition, uint32_t column_index, TypeId column_type) {
-  bool is_satisfied = true;
-  string condition_operator = condition->val_;
-  if (condition_operator == "=") {
-    if (column_type == TypeId::kTypeInt) {
-      auto tmp_field = Field(column_type, stoi(condition->child_->next_->val_));
-      if (row->GetField(column_index)->CompareEquals(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    } else if (column_type == TypeId::kTypeChar) {
-      string tmp_str = condition->child_->next_->val_;
-      auto tmp_field = Field(column_type, condition->child_->next_->val_, tmp_str.size(), true);
-      if (row->GetField(column_index)->CompareEquals(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    } else if (column_type == TypeId::kTypeFloat) {
-      auto tmp_field = Field(column_type, (float)atof(condition->child_->next_->val_));
-      if (row->GetField(column_index)->CompareEquals(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    }
-  } else if (condition_operator == "<") {
-    if (column_type == TypeId::kTypeInt) {
-      auto tmp_field = Field(column_type, stoi(condition->child_->next_->val_));
-      if (row->GetField(column_index)->CompareLessThan(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    } else if (column_type == TypeId::kTypeChar) {
-      string tmp_str = condition->child_->next_->val_;
-      auto tmp_field = Field(column_type, condition->child_->next_->val_, tmp_str.size(), true);
-      if (row->GetField(column_index)->CompareLessThan(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    } else if (column_type == TypeId::kTypeFloat) {
-      auto tmp_field = Field(column_type, (float)atof(condition->child_->next_->val_));
-      if (row->GetField(column_index)->CompareLessThan(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    }
-  } else if (condition_operator == "<=") {
-    if (column_type == TypeId::kTypeInt) {
-      auto tmp_field = Field(column_type, stoi(condition->child_->next_->val_));
-      if (row->GetField(column_index)->CompareLessThanEquals(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    } else if (column_type == TypeId::kTypeChar) {
-      string tmp_str = condition->child_->next_->val_;
-      auto tmp_field = Field(column_type, condition->child_->next_->val_, tmp_str.size(), true);
-      if (row->GetField(column_index)->CompareLessThanEquals(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    } else if (column_type == TypeId::kTypeFloat) {
-      auto tmp_field = Field(column_type, (float)atof(condition->child_->next_->val_));
-      if (row->GetField(column_index)->CompareLessThanEquals(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    }
-  } else if (condition_operator == ">") {
-    if (column_type == TypeId::kTypeInt) {
-      auto tmp_field = Field(column_type, stoi(condition->child_->next_->val_));
-      if (row->GetField(column_index)->CompareGreaterThan(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    } else if (column_type == TypeId::kTypeChar) {
-      string tmp_str = condition->child_->next_->val_;
-      auto tmp_field = Field(column_type, condition->child_->next_->val_, tmp_str.size(), true);
-      if (row->GetField(column_index)->CompareGreaterThan(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    } else if (column_type == TypeId::kTypeFloat) {
-      auto tmp_field = Field(column_type, (float)atof(condition->child_->next_->val_));
-      if (row->GetField(column_index)->CompareGreaterThan(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    }
-  } else if (condition_operator == ">=") {
-    if (column_type == TypeId::kTypeInt) {
-      auto tmp_field = Field(column_type, stoi(condition->child_->next_->val_));
-      if (row->GetField(column_index)->CompareGreaterThanEquals(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    } else if (column_type == TypeId::kTypeChar) {
-      string tmp_str = condition->child_->next_->val_;
-      auto tmp_field = Field(column_type, condition->child_->next_->val_, tmp_str.size(), true);
-      if (row->GetField(column_index)->CompareGreaterThanEquals(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    } else if (column_type == TypeId::kTypeFloat) {
-      auto tmp_field = Field(column_type, (float)atof(condition->child_->next_->val_));
-      if (row->GetField(column_index)->CompareGreaterThanEquals(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    }
-  } else if (condition_operator == "<>") {
-    if (column_type == TypeId::kTypeInt) {
-      auto tmp_field = Field(column_type, stoi(condition->child_->next_->val_));
-      if (row->GetField(column_index)->CompareNotEquals(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    } else if (column_type == TypeId::kTypeChar) {
-      string tmp_str = condition->child_->next_->val_;
-      auto tmp_field = Field(column_type, condition->child_->next_->val_, tmp_str.size(), true);
-      if (row->GetField(column_index)->CompareNotEquals(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    } else if (column_type == TypeId::kTypeFloat) {
-      auto tmp_field = Field(column_type, (float)atof(condition->child_->next_->val_));
-      if (row->GetField(column_index)->CompareNotEquals(tmp_field) == CmpBool::kFalse) {
-        is_satisfied = false;
-      }
-    }
-  } else if (condition_operator == "is") {
-    if (!row->GetField(column_index)->IsNull()) {
-      is_satisfied = false;
-    }
-  } else if (condition_operator == "not") {
-    if (row->GetField(column_index)->IsNull()) {
-      is_satisfied = false;
-    }
-  }
-  return is_satisfied;
-}
-
 string GetFieldString(Field *field, TypeId type) {
+  // LOAD DATA可以插入null
+  if (field->IsNull()) {
+    return "null";
+  }
   if (type == TypeId::kTypeInt) {
     return to_string(field->GetInt());
   } else if (type == TypeId::kTypeFloat) {
@@ -1251,183 +1364,51 @@ string GetFieldString(Field *field, TypeId type) {
   }
 }
 
-vector<RowId> GetSatisfiedRowIds(vector<vector<SyntaxNode *>> conditions, TableInfo *table_info,
-                                 vector<IndexInfo *> indexes) {
-  vector<RowId> result;
-  if (conditions.size() == 0) {
-    auto table_iter = table_info->GetTableHeap()->Begin(nullptr);
-    while (table_iter != table_info->GetTableHeap()->End()) {
-      result.emplace_back((*table_iter).GetRowId());
-      ++table_iter;
-    }
-  } else {
-    // 是否使用索引
-    bool use_index = true;
-    IndexInfo *chosed_index = nullptr;
-    // 是否使用复合索引
-    bool use_multi_index = true;
-    bool is_all_equal = true;
-    // 如果有or，那么不用索引，全表扫描
-    if (conditions.size() > 1) {
-      use_index = false;
-    } else {
-      // 此时只有一个全为and连接的条件集合，位于conditions[0]
-      for (auto condition : conditions[0]) {
-        string condition_operator = condition->val_;
-        if (condition_operator != "=") {
-          is_all_equal = false;
-        }
-        if (condition_operator == "<>" || condition_operator == "is" || condition_operator == "not") {
-          use_index = false;
-          break;
-        }
-      }
-      // 简单起见，这里只做（所有索引字段条件为等于）的复合索引查询或简单单列索引的索引查询）
-      // 先判断有没有必要做复合索引查询
-      if (is_all_equal && conditions[0].size() > 1) {
-        // 如果可以做复合索引查询，那么找找有没有完全匹配的复合索引
-        for (auto index : indexes) {
-          auto tmp_columns = index->GetIndexKeySchema()->GetColumns();
-          bool all_same = true;
-          if (tmp_columns.size() != conditions[0].size()) {
-            all_same = false;
-          } else {
-            for (auto condition : conditions[0]) {
-              bool single_same = false;
-              for (auto tmp_column : tmp_columns) {
-                if (tmp_column->GetName() == condition->child_->val_) {
-                  single_same = true;
-                  break;
-                }
-              }
-              if (!single_same) {
-                all_same = false;
-                break;
-              }
-            }
-          }
-          if (all_same) {
-            chosed_index = index;
-            break;
-          }
-        }
-        if (chosed_index == nullptr) {
-          use_multi_index = false;
-        }
-      } else {
-        use_multi_index = false;
+std::unique_ptr<AbstractExecutor> ExecuteEngine::BuildScanExecutor(const vector<vector<SyntaxNode *>> &conditions,
+                                                                   TableInfo *table_info,
+                                                                   const vector<IndexInfo *> &indexes,
+                                                                   Transaction *txn) {
+  // 先把条件绑定到表的列上，常量只解析一次
+  vector<vector<ScanCondition>> scan_conditions;
+  Predicate predicate;
+  Schema *schema = table_info->GetSchema();
+  for (auto &divided_conditions : conditions) {
+    predicate.AddClause();
+    scan_conditions.emplace_back();
+    for (auto condition : divided_conditions) {
+      uint32_t column_index;
+      if (schema->GetColumnIndex(condition->child_->val_, column_index) != DB_SUCCESS) {
+        cout << "ERROR: Column not exist" << endl;
+        return nullptr;
       }
-      if (!use_multi_index) {
-        // 寻找单个索引
-        for (auto index : indexes) {
-          auto tmp_columns = index->GetIndexKeySchema()->GetColumns();
-          if (tmp_columns.size() > 1) {
-            continue;
-          } else {
-            for (auto condition : conditions[0]) {
-              // 找到第一个符合的就行，不过多计算优化
-              if (condition->child_->val_ == tmp_columns[0]->GetName()) {
-                chosed_index = index;
-                break;
-              }
-            }
-          }
-        }
+      auto column_type = schema->GetColumn(column_index)->GetType();
+      if (!predicate.AddComparison(column_index, column_type, condition->val_, condition->child_->next_->val_)) {
+        cout << "ERROR: Unsupported operator " << condition->val_ << endl;
+        return nullptr;
       }
+      scan_conditions.back().push_back(ScanCondition{column_index, condition->val_, condition->child_->next_->val_});
     }
-    if (use_index && chosed_index != nullptr) {
-      cout << "Use index " << chosed_index->GetIndexName() << endl;
-      // 单个condition
-      // 用索引进行查找
-      // int key_length = chosed_index->GetKeyLength();
-      // 先构建一个索引查找的Row对象
-      vector<Field> fields;
-      for (auto column : chosed_index->GetIndexKeySchema()->GetColumns()) {
-        for (auto condition : conditions[0]) {
-          if (condition->child_->val_ == column->GetName()) {
-            if (column->GetType() == TypeId::kTypeInt) {
-              fields.emplace_back(Field(column->GetType(), stoi(condition->child_->next_->val_)));
-            } else if (column->GetType() == TypeId::kTypeChar) {
-              string tmp_str = condition->child_->next_->val_;
-              fields.emplace_back(Field(column->GetType(), condition->child_->next_->val_, tmp_str.size(), true));
-            } else if (column->GetType() == TypeId::kTypeFloat) {
-              fields.emplace_back(Field(column->GetType(), (float)atof(condition->child_->next_->val_)));
-            }
-            break;
-          }
-        }
-      }
-      Row row(fields);
-      if (use_multi_index) {
-        if (chosed_index->GetIndex()->ScanKey(row, result, nullptr, "=") == DB_KEY_NOT_FOUND) {
-          return result;
-        }
-      } else {
-        // 用单个列的索引
-        for (auto condition : conditions[0]) {
-          if (condition->child_->val_ == chosed_index->GetIndexKeySchema()->GetColumn(0)->GetName()) {
-            if (chosed_index->GetIndex()->ScanKey(row, result, nullptr, condition->val_) == DB_KEY_NOT_FOUND) {
-              return result;
-            } else {
-              // 因为单个列的索引查找我是允许有复合条件的，所以还把result过滤一遍
-              for (auto item = result.begin(); item != result.end();) {
-                Row tmp_row(*item);
-                table_info->GetTableHeap()->GetTuple(&tmp_row, nullptr);
-                // 这里是遍历conditions[0]的第二层，外面那层是为了找到索引列，里面这层是对索引列条件选出来的结果做其他条件的筛选
-                bool is_item_satisfied = true;
-                for (auto tmp_condition : conditions[0]) {
-                  uint32_t column_index;
-                  table_info->GetSchema()->GetColumnIndex(tmp_condition->child_->val_, column_index);
-                  auto column_type = table_info->GetSchema()->GetColumn(column_index)->GetType();
-                  if (!IsSatisfiedRow(&tmp_row, tmp_condition, column_index, column_type)) {
-                    is_item_satisfied = false;
-                    break;
-                  }
-                }
-                if (!is_item_satisfied) {
-                  result.erase(item);
-                } else {
-                  item++;
-                }
-              }
-            }
-            break;
-          }
-        }
-      }
-    } else {
-      cout << "Scan through the whole table" << endl;
-      // 可能有多个condition（指or相连的）
-      // 全表扫描，符合的加进result
-      auto tmp_table_iter = table_info->GetTableHeap()->Begin(nullptr);
-      while (tmp_table_iter != table_info->GetTableHeap()->End()) {
-        bool is_satisfied = false;
-        // 遍历条件
-        for (auto divided_conditions : conditions) {
-          bool is_single_satisfied = true;
-          // 这是一坨and连接的条件，只要有一个挂了就整个挂
-          for (auto condition : divided_conditions) {
-            // 获取这个condition对应的column序号，才能在field里取值
-            uint32_t column_index;
-            table_info->GetSchema()->GetColumnIndex(condition->child_->val_, column_index);
-            auto column_type = table_info->GetSchema()->GetColumn(column_index)->GetType();
-            if (!IsSatisfiedRow(tmp_table_iter.operator->(), condition, column_index, column_type)) {
-              is_single_satisfied = false;
-              break;
-            }
-          }
-          if (is_single_satisfied) {
-            // 在一堆or中，只要有一个满足即可
-            is_satisfied = true;
-            break;
-          }
-        }
-        if (is_satisfied) {
-          result.emplace_back((*tmp_table_iter).GetRowId());
-        }
-        ++tmp_table_iter;
-      }
+  }
+  cout << "We have " << indexes.size() << " indexes" << endl;
+  // 根据统计信息估计代价，选择全表扫描、单个索引、多个索引的交集或并集
+  const TableStatistics *statistics = nullptr;
+  dbs_[current_db_]->catalog_mgr_->GetTableStatistics(table_info->GetTableName(), statistics);
+  Optimizer optimizer(table_info, indexes, statistics);
+  AccessPath path = optimizer.ChooseAccessPath(scan_conditions);
+  if (path.lookups_.empty()) {
+    cout << "Scan through the whole table" << endl;
+    // 没有条件时predicate为空，扫描所有行
+    return std::make_unique<SeqScanExecutor>(table_info, std::move(predicate), txn);
+  }
+  // 例如 Use index idx_a and idx_b or idx_c
+  cout << "Use index ";
+  for (size_t i = 0; i < path.lookups_.size(); i++) {
+    for (size_t j = 0; j < path.lookups_[i].size(); j++) {
+      cout << (i == 0 && j == 0 ? "" : j == 0 ? " or " : " and ") << path.lookups_[i][j].index_->GetIndexName();
     }
   }
-  return result;
-}
\ No newline at end of file
+  cout << endl;
+  // 索引只处理了一部分条件，所有条件都再用filter检查一遍
+  auto scan = std::make_unique<IndexScanExecutor>(table_info, std::move(path.lookups_), txn);
+  return std::make_unique<FilterExecutor>(std::move(scan), std::move(predicate));
+}
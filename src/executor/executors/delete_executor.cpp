@@ -0,0 +1,41 @@
+#include "executor/executors/delete_executor.h"
+
+#include "storage/table_heap.h"
+
+void DeleteExecutor::Init() { child_->Init(); }
+
+bool DeleteExecutor::Next(std::vector<Row> *batch) {
+  batch->clear();
+  batch->reserve(EXECUTOR_BATCH_SIZE);
+  TableHeap *table_heap = table_info_->GetTableHeap();
+  while (batch->empty()) {
+    if (!child_->Next(&child_batch_)) {
+      status_ = child_->GetStatus();
+      return false;
+    }
+    for (auto &row : child_batch_) {
+      // 先用共享锁读出旧值，MarkDelete时升级为排它锁
+      batch->emplace_back(row.GetRowId());
+      Row &old_row = batch->back();
+      if (!table_heap->GetTuple(&old_row, txn_)) {
+        batch->pop_back();
+        if (txn_ != nullptr && txn_->GetState() == TxnState::kAborted) {
+          status_ = DB_FAILED;
+          return false;
+        }
+        // 已经被其他事务删除
+        continue;
+      }
+      // 提交时才真正删除
+      if (!table_heap->MarkDelete(old_row.GetRowId(), txn_)) {
+        batch->pop_back();
+        status_ = DB_FAILED;
+        return false;
+      }
+      for (auto index : indexes_) {
+        index->GetIndex()->RemoveEntry(MakeIndexKey(old_row, index), old_row.GetRowId(), txn_);
+      }
+    }
+  }
+  return true;
+}
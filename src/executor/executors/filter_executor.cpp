@@ -0,0 +1,21 @@
+#include "executor/executors/filter_executor.h"
+
+void FilterExecutor::Init() { child_->Init(); }
+
+bool FilterExecutor::Next(std::vector<Row> *batch) {
+  batch->clear();
+  batch->reserve(EXECUTOR_BATCH_SIZE);
+  // 孩子的一批row可能一个都不满足，继续拉下一批，直到有输出或者孩子没有row了
+  while (batch->empty()) {
+    if (!child_->Next(&child_batch_)) {
+      status_ = child_->GetStatus();
+      return false;
+    }
+    for (auto &row : child_batch_) {
+      if (predicate_(row)) {
+        batch->emplace_back(row);
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,78 @@
+#include "executor/executors/index_scan_executor.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "storage/table_heap.h"
+
+void IndexScanExecutor::Init() {
+  rids_.clear();
+  cursor_ = 0;
+  status_ = DB_SUCCESS;
+  if (lookups_.size() == 1 && lookups_[0].size() == 1) {
+    if (!Lookup(lookups_[0][0], &rids_)) {
+      rids_.clear();
+      status_ = DB_FAILED;
+    }
+    return;
+  }
+  auto less = [](const RowId &a, const RowId &b) { return a.Get() < b.Get(); };
+  for (auto &clause : lookups_) {
+    // 一个clause内的lookup取交集
+    std::vector<RowId> clause_rids;
+    for (size_t i = 0; i < clause.size(); i++) {
+      std::vector<RowId> rids;
+      if (!Lookup(clause[i], &rids)) {
+        rids_.clear();
+        status_ = DB_FAILED;
+        return;
+      }
+      std::sort(rids.begin(), rids.end(), less);
+      if (i == 0) {
+        clause_rids.swap(rids);
+      } else {
+        std::vector<RowId> intersection;
+        std::set_intersection(clause_rids.begin(), clause_rids.end(), rids.begin(), rids.end(),
+                              std::back_inserter(intersection), less);
+        clause_rids.swap(intersection);
+      }
+    }
+    rids_.insert(rids_.end(), clause_rids.begin(), clause_rids.end());
+  }
+  // clause之间取并集
+  std::sort(rids_.begin(), rids_.end(), less);
+  rids_.erase(std::unique(rids_.begin(), rids_.end()), rids_.end());
+}
+
+bool IndexScanExecutor::Lookup(const IndexLookup &lookup, std::vector<RowId> *rids) {
+  std::vector<Field> key_fields(lookup.key_);
+  Row key(key_fields);
+  if (lookup.upper_op_.empty()) {
+    // 等值查找没找到不是错误
+    return lookup.index_->GetIndex()->ScanKey(key, *rids, nullptr, lookup.op_) != DB_FAILED;
+  }
+  std::vector<Field> upper_fields(lookup.upper_key_);
+  Row upper(upper_fields);
+  return lookup.index_->GetIndex()->ScanRange(&key, lookup.op_ == ">=", &upper, lookup.upper_op_ == "<=", *rids,
+                                              nullptr) == DB_SUCCESS;
+}
+
+bool IndexScanExecutor::Next(std::vector<Row> *batch) {
+  batch->clear();
+  batch->reserve(EXECUTOR_BATCH_SIZE);
+  // 上一批row已经清空，它们的field一起释放
+  heap_.Reset();
+  while (batch->size() < EXECUTOR_BATCH_SIZE && cursor_ < rids_.size()) {
+    batch->emplace_back(rids_[cursor_++], &heap_);
+    // 索引中的row可能已经被标记删除
+    if (!table_info_->GetTableHeap()->GetTuple(&batch->back(), txn_)) {
+      batch->pop_back();
+      if (txn_ != nullptr && txn_->GetState() == TxnState::kAborted) {
+        status_ = DB_FAILED;
+        cursor_ = rids_.size();
+        break;
+      }
+    }
+  }
+  return !batch->empty();
+}
@@ -0,0 +1,23 @@
+#include "executor/executors/limit_executor.h"
+
+void LimitExecutor::Init() {
+  child_->Init();
+  produced_ = 0;
+}
+
+bool LimitExecutor::Next(std::vector<Row> *batch) {
+  batch->clear();
+  if (produced_ >= limit_) {
+    return false;
+  }
+  if (!child_->Next(batch)) {
+    status_ = child_->GetStatus();
+    return false;
+  }
+  // Row不能赋值，只能从末尾删掉多出来的部分
+  while (produced_ + batch->size() > limit_) {
+    batch->pop_back();
+  }
+  produced_ += batch->size();
+  return true;
+}
@@ -0,0 +1,22 @@
+#include "executor/executors/projection_executor.h"
+
+void ProjectionExecutor::Init() { child_->Init(); }
+
+bool ProjectionExecutor::Next(std::vector<Row> *batch) {
+  batch->clear();
+  if (!child_->Next(&child_batch_)) {
+    status_ = child_->GetStatus();
+    return false;
+  }
+  batch->reserve(child_batch_.size());
+  std::vector<Field> fields;
+  for (auto &row : child_batch_) {
+    fields.clear();
+    for (auto column_index : column_indexes_) {
+      fields.emplace_back(*row.GetField(column_index));
+    }
+    batch->emplace_back(fields);
+    batch->back().SetRowId(row.GetRowId());
+  }
+  return true;
+}
@@ -0,0 +1,60 @@
+#include "executor/executors/seq_scan_executor.h"
+
+#include "storage/table_heap.h"
+
+void SeqScanExecutor::Init() {
+  page_id_ = table_info_->GetTableHeap()->GetFirstPageId();
+  slot_num_ = 0;
+  read_ahead_ = ScanReadAhead(table_info_->GetTableHeap());
+  status_ = DB_SUCCESS;
+}
+
+bool SeqScanExecutor::Next(std::vector<Row> *batch) {
+  batch->clear();
+  batch->reserve(EXECUTOR_BATCH_SIZE);
+  heap_.Reset();
+  auto table_heap = table_info_->GetTableHeap();
+  auto visitor = [this, batch, table_heap](const RowView &view) {
+    bool emit = predicate_.Empty() || predicate_.Evaluate(view);
+    // 别的事务改了这一行还没提交，放开页之后再等它的锁
+    if (!table_heap->TryLockRow(view.GetRowId(), txn_, emit)) {
+      wait_rid_ = view.GetRowId();
+      return false;
+    }
+    if (emit) {
+      batch->emplace_back(view.GetRowId(), &heap_);
+      view.Materialize(&batch->back());
+    }
+    return batch->size() < EXECUTOR_BATCH_SIZE;
+  };
+  while (batch->size() < EXECUTOR_BATCH_SIZE && page_id_ != INVALID_PAGE_ID) {
+    page_id_t next_page_id;
+    if (!table_heap->ScanPage(page_id_, &slot_num_, &next_page_id, &view_, visitor)) {
+      // buffer pool里没有空闲的帧读这一页，扫描到此为止，这一批已经读出的行照常返回
+      status_ = DB_FAILED;
+      page_id_ = INVALID_PAGE_ID;
+      break;
+    }
+    if (wait_rid_.GetPageId() != INVALID_PAGE_ID) {
+      // 拿到锁之后从这一行重新看，它可能已经被改了或者删了
+      bool locked = table_heap->LockRow(wait_rid_, txn_);
+      slot_num_ = wait_rid_.GetSlotNum();
+      wait_rid_ = INVALID_ROWID;
+      if (!locked) {
+        // 事务被选为死锁的牺牲者
+        status_ = DB_FAILED;
+        page_id_ = INVALID_PAGE_ID;
+        break;
+      }
+      continue;
+    }
+    if (next_page_id != page_id_) {
+      page_id_ = next_page_id;
+      slot_num_ = 0;
+      if (page_id_ != INVALID_PAGE_ID) {
+        read_ahead_.OnPage(page_id_);
+      }
+    }
+  }
+  return !batch->empty();
+}
@@ -0,0 +1,94 @@
+#include "executor/executors/update_executor.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "storage/table_heap.h"
+
+void UpdateExecutor::Init() {
+  moved_rids_.clear();
+  child_->Init();
+}
+
+bool UpdateExecutor::Next(std::vector<Row> *batch) {
+  batch->clear();
+  batch->reserve(EXECUTOR_BATCH_SIZE);
+  while (batch->empty()) {
+    if (!child_->Next(&child_batch_)) {
+      status_ = child_->GetStatus();
+      return false;
+    }
+    for (auto &row : child_batch_) {
+      if (!UpdateRow(row.GetRowId(), batch) && status_ != DB_SUCCESS) {
+        batch->clear();
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool UpdateExecutor::UpdateRow(const RowId &rid, std::vector<Row> *batch) {
+  if (moved_rids_.count(rid.Get()) > 0) {
+    return false;
+  }
+  TableHeap *table_heap = table_info_->GetTableHeap();
+  Row old_row(rid);
+  if (!table_heap->GetTuple(&old_row, txn_)) {
+    if (txn_ != nullptr && txn_->GetState() == TxnState::kAborted) {
+      status_ = DB_FAILED;
+    }
+    // 已经被其他事务删除
+    return false;
+  }
+  std::vector<Field> new_fields;
+  for (uint32_t idx = 0; idx < old_row.GetFieldCount(); idx++) {
+    auto it = std::find(update_columns_.begin(), update_columns_.end(), idx);
+    if (it != update_columns_.end()) {
+      new_fields.emplace_back(update_values_[it - update_columns_.begin()]);
+    } else {
+      new_fields.emplace_back(*old_row.GetField(idx));
+    }
+  }
+  Row new_row(new_fields);
+  new_row.SetRowId(rid);
+  // 只有key变了的索引需要维护，新的key不能和其他row的key重复
+  std::vector<IndexInfo *> changed_indexes;
+  for (auto index : indexes_) {
+    Row old_key = MakeIndexKey(old_row, index);
+    Row new_key = MakeIndexKey(new_row, index);
+    bool changed = false;
+    for (uint32_t i = 0; i < new_key.GetFieldCount(); i++) {
+      if (old_key.GetField(i)->CompareEquals(*new_key.GetField(i)) != CmpBool::kTrue) {
+        changed = true;
+        break;
+      }
+    }
+    if (!changed) {
+      continue;
+    }
+    std::vector<RowId> exist;
+    if (index->GetIndex()->ScanKey(new_key, exist, nullptr, "=") == DB_SUCCESS) {
+      std::cout << "ERROR: Same key has exist in index " << index->GetIndexName() << std::endl;
+      status_ = DB_FAILED;
+      return false;
+    }
+    changed_indexes.push_back(index);
+  }
+  if (!table_heap->UpdateOrMoveTuple(new_row, rid, txn_)) {
+    status_ = DB_FAILED;
+    return false;
+  }
+  // row被移到了别的page，所有索引都要指向新的rid
+  if (!(new_row.GetRowId() == rid)) {
+    moved_rids_.insert(new_row.GetRowId().Get());
+    changed_indexes = indexes_;
+  }
+  // 先删除旧key再插入新key
+  for (auto index : changed_indexes) {
+    index->GetIndex()->RemoveEntry(MakeIndexKey(old_row, index), rid, txn_);
+    index->GetIndex()->InsertEntry(MakeIndexKey(new_row, index), new_row.GetRowId(), txn_);
+  }
+  batch->emplace_back(new_row);
+  return true;
+}
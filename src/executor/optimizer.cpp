@@ -0,0 +1,201 @@
+#include "executor/optimizer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+AccessPath Optimizer::ChooseAccessPath(const std::vector<std::vector<ScanCondition>> &conditions) const {
+  double row_count = GetRowCount();
+  AccessPath seq_scan;
+  seq_scan.rows_ = row_count;
+  seq_scan.cost_ = row_count * SEQ_ROW_COST;
+  if (conditions.empty()) {
+    return seq_scan;
+  }
+  // 每个or分支都要能用上索引，才能用索引的并集
+  AccessPath index_scan;
+  for (auto &clause : conditions) {
+    std::vector<IndexLookup> lookups;
+    double rows;
+    double cost;
+    if (!ChooseClauseLookups(clause, &lookups, &rows, &cost)) {
+      return seq_scan;
+    }
+    index_scan.lookups_.emplace_back(std::move(lookups));
+    index_scan.rows_ += rows;
+    index_scan.cost_ += cost;
+  }
+  index_scan.rows_ = std::min(index_scan.rows_, row_count);
+  if (index_scan.cost_ < seq_scan.cost_) {
+    return index_scan;
+  }
+  return seq_scan;
+}
+
+double Optimizer::Selectivity(const ScanCondition &condition) const {
+  if (statistics_ != nullptr) {
+    return statistics_->EstimateSelectivity(condition.column_index_, condition.op_, condition.literal_);
+  }
+  const std::string &op = condition.op_;
+  if (op == "is") {
+    return DEFAULT_EQUAL_SELECTIVITY;
+  }
+  if (op == "not") {
+    return 1 - DEFAULT_EQUAL_SELECTIVITY;
+  }
+  if (condition.literal_ == nullptr) {
+    return 0;
+  }
+  if (op == "=") {
+    return DEFAULT_EQUAL_SELECTIVITY;
+  }
+  if (op == "<>") {
+    return 1 - DEFAULT_EQUAL_SELECTIVITY;
+  }
+  return DEFAULT_RANGE_SELECTIVITY;
+}
+
+double Optimizer::RangeSelectivity(const ScanCondition &lower, const ScanCondition &upper) const {
+  if (statistics_ == nullptr) {
+    return DEFAULT_BOUNDED_RANGE_SELECTIVITY;
+  }
+  if (statistics_->GetRowCount() == 0) {
+    return 0;
+  }
+  // 在非空的行中，x > l 和 x < u 的并集是全部，所以交集 = 两者之和 - 非空的比例
+  double non_null = 1 - static_cast<double>(statistics_->GetNullCount(lower.column_index_)) / statistics_->GetRowCount();
+  return std::max(0.0, Selectivity(lower) + Selectivity(upper) - non_null);
+}
+
+bool Optimizer::ChooseClauseLookups(const std::vector<ScanCondition> &clause, std::vector<IndexLookup> *lookups,
+                                    double *rows, double *cost) const {
+  auto candidates = FindCandidates(clause);
+  if (candidates.empty()) {
+    return false;
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate &a, const Candidate &b) { return a.selectivity_ < b.selectivity_; });
+  // 按选择率从小到大依次加入交集，假设条件之间相互独立
+  double row_count = GetRowCount();
+  double lookup_cost = 0;
+  double selectivity = 1;
+  size_t best_count = 0;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    lookup_cost += INDEX_LOOKUP_COST + candidates[i].selectivity_ * row_count * INDEX_ROW_COST;
+    selectivity *= candidates[i].selectivity_;
+    double total_cost = lookup_cost + selectivity * row_count * FETCH_ROW_COST;
+    if (best_count == 0 || total_cost < *cost) {
+      best_count = i + 1;
+      *cost = total_cost;
+      *rows = selectivity * row_count;
+    }
+  }
+  for (size_t i = 0; i < best_count; i++) {
+    lookups->emplace_back(MakeLookup(candidates[i]));
+  }
+  return true;
+}
+
+std::vector<Optimizer::Candidate> Optimizer::FindCandidates(const std::vector<ScanCondition> &clause) const {
+  std::vector<Candidate> candidates;
+  // 索引都是唯一的，所有列都等值时最多一行
+  double unique_selectivity = 1 / GetRowCount();
+  for (auto index : indexes_) {
+    auto &key_map = index->GetKeyMapping();
+    if (key_map.size() == 1) {
+      // 单列索引可以做等值和范围查找，同一列有多个条件时用最有选择性的等值、最紧的上界和下界
+      const ScanCondition *best[3] = {nullptr, nullptr, nullptr};  // =, 下界, 上界
+      double best_selectivity[3] = {1, 1, 1};
+      for (auto &condition : clause) {
+        const std::string &op = condition.op_;
+        if (condition.column_index_ != key_map[0] || condition.literal_ == nullptr) {
+          continue;
+        }
+        int kind;
+        double selectivity = Selectivity(condition);
+        if (op == "=") {
+          kind = 0;
+          selectivity = std::min(selectivity, unique_selectivity);
+        } else if (op == ">" || op == ">=") {
+          kind = 1;
+        } else if (op == "<" || op == "<=") {
+          kind = 2;
+        } else {
+          continue;
+        }
+        if (best[kind] == nullptr || selectivity < best_selectivity[kind]) {
+          best[kind] = &condition;
+          best_selectivity[kind] = selectivity;
+        }
+      }
+      // 同时有上下界时只查一次索引：从下界开始，到上界为止
+      Candidate range{index, {}, 1};
+      if (best[1] != nullptr && best[2] != nullptr) {
+        range = Candidate{index, {best[1]}, RangeSelectivity(*best[1], *best[2]), best[2]};
+      } else if (best[1] != nullptr || best[2] != nullptr) {
+        int kind = best[1] != nullptr ? 1 : 2;
+        range = Candidate{index, {best[kind]}, best_selectivity[kind]};
+      }
+      if (best[0] != nullptr && (range.conditions_.empty() || best_selectivity[0] <= range.selectivity_)) {
+        candidates.push_back(Candidate{index, {best[0]}, best_selectivity[0]});
+      } else if (!range.conditions_.empty()) {
+        candidates.push_back(std::move(range));
+      }
+    } else {
+      // 复合索引只做所有列都等值的查找
+      std::vector<const ScanCondition *> key_conditions;
+      for (auto column_index : key_map) {
+        for (auto &condition : clause) {
+          if (condition.column_index_ == column_index && condition.op_ == "=" && condition.literal_ != nullptr) {
+            key_conditions.push_back(&condition);
+            break;
+          }
+        }
+      }
+      if (key_conditions.size() == key_map.size()) {
+        candidates.push_back(Candidate{index, std::move(key_conditions), unique_selectivity});
+      }
+    }
+  }
+  return candidates;
+}
+
+IndexLookup Optimizer::MakeLookup(const Candidate &candidate) const {
+  IndexLookup lookup{candidate.index_, {}, candidate.conditions_[0]->op_};
+  for (auto condition : candidate.conditions_) {
+    AppendKey(*condition, &lookup.key_);
+  }
+  if (candidate.upper_ != nullptr) {
+    AppendKey(*candidate.upper_, &lookup.upper_key_);
+    lookup.upper_op_ = candidate.upper_->op_;
+  }
+  return lookup;
+}
+
+void Optimizer::AppendKey(const ScanCondition &condition, std::vector<Field> *key) const {
+  char *literal = const_cast<char *>(condition.literal_);
+  switch (table_info_->GetSchema()->GetColumn(condition.column_index_)->GetType()) {
+    case TypeId::kTypeInt:
+      key->emplace_back(TypeId::kTypeInt, atoi(literal));
+      break;
+    case TypeId::kTypeFloat:
+      key->emplace_back(TypeId::kTypeFloat, (float)atof(literal));
+      break;
+    default:
+      key->emplace_back(TypeId::kTypeChar, literal, strlen(literal), true);
+      break;
+  }
+}
+
+double Optimizer::GetRowCount() const {
+  if (statistics_ == nullptr) {
+    return DEFAULT_ROW_COUNT;
+  }
+  double row_count = std::max<double>(1, statistics_->GetRowCount());
+  // 统计信息是ANALYZE时的快照，之后insert或load data让表变大了，按页数等比例放大行数
+  uint32_t page_count = table_info_->GetTableHeap()->GetPageCount();
+  if (statistics_->GetPageCount() > 0 && page_count > statistics_->GetPageCount()) {
+    row_count *= static_cast<double>(page_count) / statistics_->GetPageCount();
+  }
+  return row_count;
+}
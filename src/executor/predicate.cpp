@@ -0,0 +1,129 @@
+#include "executor/predicate.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+#include "common/macros.h"
+
+void Predicate::AddClause() { clauses_.emplace_back(); }
+
+bool Predicate::AddComparison(uint32_t column_index, TypeId type, const std::string &op, const char *literal) {
+  ASSERT(!clauses_.empty(), "AddClause first.");
+  Comparison comparison;
+  comparison.column_index_ = column_index;
+  if (op == "=") {
+    comparison.compare_ = ForType<std::equal_to<>>(type);
+  } else if (op == "<>") {
+    comparison.compare_ = ForType<std::not_equal_to<>>(type);
+  } else if (op == "<") {
+    comparison.compare_ = ForType<std::less<>>(type);
+  } else if (op == "<=") {
+    comparison.compare_ = ForType<std::less_equal<>>(type);
+  } else if (op == ">") {
+    comparison.compare_ = ForType<std::greater<>>(type);
+  } else if (op == ">=") {
+    comparison.compare_ = ForType<std::greater_equal<>>(type);
+  } else if (op == "is") {
+    comparison.compare_ = IsNull;
+  } else if (op == "not") {
+    comparison.compare_ = IsNotNull;
+  } else {
+    return false;
+  }
+  if (op != "is" && op != "not") {
+    if (literal == nullptr) {
+      // 和null比较的结果是unknown，哪一行都不满足
+      comparison.compare_ = Never;
+    } else if (type == TypeId::kTypeInt) {
+      comparison.int_ = atoi(literal);
+    } else if (type == TypeId::kTypeFloat) {
+      comparison.float_ = (float)atof(literal);
+    } else {
+      comparison.chars_ = literal;
+    }
+  }
+  clauses_.back().emplace_back(std::move(comparison));
+  return true;
+}
+
+bool Predicate::Evaluate(const Row &row) const {
+  // 一堆or中只要有一个满足即可，and连接的条件只要有一个不满足就整个不满足
+  for (auto &clause : clauses_) {
+    bool satisfied = true;
+    for (auto &comparison : clause) {
+      if (!comparison.compare_(*row.GetField(comparison.column_index_), comparison)) {
+        satisfied = false;
+        break;
+      }
+    }
+    if (satisfied) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Predicate::Evaluate(const RowView &row) const {
+  // 和上面一样，只是field是指向页内数据的临时Field，不分配内存
+  for (auto &clause : clauses_) {
+    bool satisfied = true;
+    for (auto &comparison : clause) {
+      if (!comparison.compare_(row.GetField(comparison.column_index_), comparison)) {
+        satisfied = false;
+        break;
+      }
+    }
+    if (satisfied) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename Op>
+bool Predicate::CompareInt(const Field &field, const Comparison &comparison) {
+  return !field.IsNull() && Op()(field.GetInt(), comparison.int_);
+}
+
+template <typename Op>
+bool Predicate::CompareFloat(const Field &field, const Comparison &comparison) {
+  return !field.IsNull() && Op()(field.GetFloat(), comparison.float_);
+}
+
+template <typename Op>
+bool Predicate::CompareChar(const Field &field, const Comparison &comparison) {
+  if (field.IsNull()) {
+    return false;
+  }
+  // 和TypeChar的比较一致：先比公共前缀，相同时短的小
+  uint32_t len = field.GetLength();
+  uint32_t constant_len = comparison.chars_.size();
+  int ret = memcmp(field.GetChars(), comparison.chars_.data(), std::min(len, constant_len));
+  if (ret == 0 && len != constant_len) {
+    ret = len < constant_len ? -1 : 1;
+  }
+  return Op()(ret, 0);
+}
+
+bool Predicate::IsNull(const Field &field, const Comparison &) { return field.IsNull(); }
+
+bool Predicate::IsNotNull(const Field &field, const Comparison &) { return !field.IsNull(); }
+
+bool Predicate::Never(const Field &, const Comparison &) { return false; }
+
+template <typename Op>
+Predicate::CompareFunc Predicate::ForType(TypeId type) {
+  switch (type) {
+    case TypeId::kTypeInt:
+      return CompareInt<Op>;
+    case TypeId::kTypeFloat:
+      return CompareFloat<Op>;
+    case TypeId::kTypeChar:
+      return CompareChar<Op>;
+    default:
+      ASSERT(false, "Unsupported type.");
+      return nullptr;
+  }
+}
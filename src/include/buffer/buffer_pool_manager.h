@@ -1,25 +1,45 @@
 #ifndef MINISQL_BUFFER_POOL_MANAGER_H
 #define MINISQL_BUFFER_POOL_MANAGER_H
 
+#include <atomic>
+#include <condition_variable>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
-#include "buffer/lru_replacer.h"
-#include "buffer/clock_replacer.h"
+#include "buffer/replacer.h"
 #include "page/page.h"
 #include "page/disk_file_meta_page.h"
 #include "storage/disk_manager.h"
+#include "transaction/log_manager.h"
 
 using namespace std;
 
 class BufferPoolManager {
 public:
-  explicit BufferPoolManager(size_t pool_size, DiskManager *disk_manager);
+  /**
+   * @param log_manager if not nullptr, every change of a page is logged (see LogPageDelta) and a dirty page is
+   *                    written back only after the log is durable up to the page's last log record
+   * @param replacer_type replacement policy of the pool
+   * @param enable_cleaner start the background page cleaner thread, see CleanPages
+   */
+  explicit BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                             ReplacerType replacer_type = ReplacerType::kLRU, bool enable_cleaner = false);
 
+  /**
+   * Stop the page cleaner and write back all dirty pages
+   */
   ~BufferPoolManager();
 
-  Page *FetchPage(page_id_t page_id);
+  /**
+   * @param scan the page is fetched by a sequential scan. A page read ahead for a scan stays cold however often the
+   *             scan itself fetches it, any other fetch of it is a real reuse and makes it an ordinary page
+   */
+  Page *FetchPage(page_id_t page_id, bool scan = false);
 
   bool UnpinPage(page_id_t page_id, bool is_dirty);
 
@@ -33,8 +53,75 @@ public:
 
   bool CheckAllUnpinned();
 
+  /**
+   * Write back all dirty pages: they are sorted by physical page id, runs of adjacent pages are written with one
+   * pwritev (see DiskManager::WritePages) and the db file is synced once at the end
+   */
   bool FlushAllPages();
 
+  /**
+   * Start reading pages that are going to be fetched soon without waiting for them, the reads are handed to the
+   * disk as one asynchronous batch. Pages already in the pool, or whose shard has no free frame, are skipped.
+   * FetchPage of a page that is still being read waits for the read.
+   * @param cold the pages are read ahead for a sequential scan: they are victimized before the other pages
+   *             until they are modified, so that a large scan does not push the hot pages out
+   * @return number of pages being read
+   */
+  size_t PrefetchPages(const std::vector<page_id_t> &page_ids, bool cold = false);
+
+  /**
+   * Collect (page_id, recLSN) of every frame holding logged changes that are not written back yet,
+   * used by fuzzy checkpoints. Only meaningful when logging is on.
+   */
+  void GetDirtyPageTable(std::vector<std::pair<page_id_t, lsn_t>> &dirty_pages);
+
+  /**
+   * @return number of FetchPage calls that found the page in the pool (including pages being prefetched)
+   */
+  uint64_t GetHitCount();
+
+  /**
+   * @return number of FetchPage calls that had to read the page from disk
+   */
+  uint64_t GetMissCount();
+
+  /**
+   * Write back dirty unpinned pages in page id order until BUFFER_POOL_CLEAN_RATIO of the evictable (free or
+   * unpinned) frames are clean, at most BUFFER_POOL_CLEAN_BATCH pages. Run by the page cleaner thread.
+   *
+   * 页在shard latch下复制出来，写盘时不持有latch；正在写的页记在writing_中，写完之前
+   * 这些页不会被前台写回或者重新从磁盘读入，也仍然出现在dirty page table里。
+   * @return number of pages written
+   */
+  size_t CleanPages();
+
+  /**
+   * Resize the pool online. Growing adds the new frames to the free lists of the shards owning the fewest frames.
+   * Shrinking takes the frames with the
+   * highest ids out of the pool: free ones at once, unpinned ones after evicting (and writing back) their pages,
+   * pinned ones once they are unpinned. Frames are allocated in chunks of BUFFER_POOL_CHUNK_FRAMES, a chunk is
+   * freed when none of its frames is left.
+   * @param timeout_ms how long to wait for pinned frames when shrinking
+   * @return false if the pool could not shrink in time (it keeps its old size), or pool_size is smaller than
+   *         the number of shards
+   */
+  bool Resize(size_t pool_size, uint32_t timeout_ms = BUFFER_POOL_RESIZE_TIMEOUT_MS);
+
+  /**
+   * @return number of frames in the pool
+   */
+  inline size_t GetPoolSize() const { return pool_size_; }
+
+  /**
+   * @return number of dirty victims written back by FetchPage, NewPage or PrefetchPages
+   */
+  inline uint64_t GetForegroundWriteCount() const { return foreground_writes_; }
+
+  /**
+   * @return number of pages written back by CleanPages
+   */
+  inline uint64_t GetBackgroundWriteCount() const { return background_writes_; }
+
 private:
   /**
    * Allocate new page (operations like create index/table) For now just keep an increasing counter
@@ -46,15 +133,146 @@ private:
    */
   void DeallocatePage(page_id_t page_id);
 
+  /**
+   * buffer pool按page_id分成若干个shard，每个shard独占一部分frame，并拥有自己的latch、page table、replacer和
+   * free list，访问不同shard的Fetch/Unpin互不阻塞。一个shard的帧都被pin住时会从别的shard借帧（见BorrowFrame），
+   * 借来的帧从此属于这个shard
+   */
+  struct Shard {
+    std::mutex latch_;                                      // to protect the members below
+    std::unordered_map<page_id_t, frame_id_t> page_table_;  // page_id_t -> index of the frame in Page *pages_
+    Replacer *replacer_{nullptr};                           // to find an unpinned frame of this shard for replacement
+    std::list<frame_id_t> free_list_;                       // free frames owned by this shard
+    std::unordered_set<frame_id_t> reading_;                // frames being prefetched, not in the replacer yet
+    std::condition_variable read_done_;                     // notified when a prefetch completes
+    size_t frame_count_{0};                                 // frames owned by this shard, see SetFrameCount
+    uint64_t hits_{0};                                      // FetchPage statistics
+    uint64_t misses_{0};
+  };
+
+  inline Shard &GetShard(page_id_t page_id) { return shards_[static_cast<uint32_t>(page_id) % num_shards_]; }
+
+  /**
+   * A frame joins or leaves the shard, its replacer is sized for the frames the shard owns. Caller holds shard.latch_.
+   */
+  inline void SetFrameCount(Shard &shard, size_t frame_count) {
+    shard.frame_count_ = frame_count;
+    shard.replacer_->SetCapacity(frame_count);
+  }
+
+  /**
+   * 帧按块分配，frame_id / BUFFER_POOL_CHUNK_FRAMES是块号。块一旦分配就不会移动，已经交出去的Page *一直有效。
+   * 新块按需要的帧数分配，可以比BUFFER_POOL_CHUNK_FRAMES小，所以帧号中间可能有空缺；只有最后一块可以有没用上的帧。
+   * chunks_只在拿着所有shard latch时修改，访问帧时至少拿着一个shard latch
+   */
+  struct Chunk {
+    std::unique_ptr<Page[]> pages_;
+    std::unique_ptr<char[]> snapshots_;                     // nullptr if logging is off
+    size_t capacity_;                                       // frames allocated
+    size_t size_;                                           // frames in the pool, the first size_ of the chunk
+  };
+
+  inline Page *GetFrame(frame_id_t frame_id) {
+    uint32_t id = static_cast<uint32_t>(frame_id);
+    return chunks_[id / BUFFER_POOL_CHUNK_FRAMES].pages_.get() + id % BUFFER_POOL_CHUNK_FRAMES;
+  }
+
+  inline char *GetSnapshot(frame_id_t frame_id) {
+    uint32_t id = static_cast<uint32_t>(frame_id);
+    return chunks_[id / BUFFER_POOL_CHUNK_FRAMES].snapshots_.get() +
+           static_cast<size_t>(id % BUFFER_POOL_CHUNK_FRAMES) * PAGE_SIZE;
+  }
+
+  /**
+   * Add frames to the pool, filling up the last chunk first. Caller holds all shard latches.
+   */
+  void AddFrames(size_t count);
+
+  /**
+   * Give a frame that belongs to no shard to the shard owning the fewest frames, so that the frames of a grow spread
+   * over all shards whatever their ids. Caller holds all shard latches.
+   */
+  void AdoptFrame(frame_id_t frame_id);
+
+  /**
+   * Take as many frames of the targets out of the pool as possible: free frames and unpinned frames whose
+   * page is evicted. The frames taken are removed from targets and appended to retired.
+   */
+  void RetireFrames(std::vector<frame_id_t> &targets, std::vector<frame_id_t> &retired);
+
+  /**
+   * Find a frame for a new page from the free list first, then from the replacer.
+   * The victim page (if any) is written back and removed from the page table. Caller must hold shard.latch_.
+   * @return INVALID_FRAME_ID if all frames of the shard are pinned
+   */
+  frame_id_t GetFreeFrame(Shard &shard);
+
+  /**
+   * All frames of the shard are pinned: move a frame of another shard to its free list, a free one if any shard has
+   * one, otherwise a victim of another shard (written back if dirty). Only one shard latch is held at a time, so the
+   * caller must not hold any and has to look up its page again afterwards.
+   * @return false if all frames of the pool are pinned
+   */
+  bool BorrowFrame(Shard &shard);
+
+  /**
+   * Wait until the frame of page_id (if any) is not being prefetched. Caller holds lock on shard.latch_.
+   * @return the page table entry of page_id, the end of the page table if the page is not in the pool
+   */
+  std::unordered_map<page_id_t, frame_id_t>::iterator WaitForRead(Shard &shard, std::unique_lock<std::mutex> &lock,
+                                                                  page_id_t page_id);
+
+  /**
+   * Completion of a prefetch, the frame becomes replaceable (or free again if the read failed)
+   */
+  void FinishPrefetch(page_id_t page_id, frame_id_t frame_id, bool ok);
+
+  /**
+   * Wait until the page cleaner is not writing page_id. Caller may hold the latch of a shard.
+   */
+  void WaitForWrite(page_id_t page_id);
+
+  /**
+   * Wake up the page cleaner before its next round, e.g. after a foreground write
+   */
+  void RequestClean();
+
+  void RunCleaner();
+
+  /**
+   * Compare the frame with its snapshot (content as of the last log record) and log the changed byte runs
+   * as a kPageDelta record. Caller must hold the latch of the frame's shard.
+   */
+  void LogPageDelta(frame_id_t frame_id);
+
+  /**
+   * Write the frame back to disk, respecting the write-ahead rule. Caller must hold the latch of the frame's shard.
+   */
+  void WriteBack(frame_id_t frame_id);
+
 
 private:
-  size_t pool_size_;                                        // number of pages in buffer pool
-  Page *pages_;                                             // array of pages, all empty at beginning.
+  std::atomic<size_t> pool_size_;                           // number of pages in buffer pool
   DiskManager *disk_manager_;                               // pointer to the disk manager.
-  std::unordered_map<page_id_t, frame_id_t> page_table_;    // to keep track of pages, page_id_t is the type of logical page id, frame_id_t is the type of page index in Page *pages_
-  Replacer *replacer_;                                      // to find an unpinned page for replacement
-  std::list<frame_id_t> free_list_;                         // to find a free page for replacement, init with all frame_id (totally the whole pool size)
-  recursive_mutex latch_;                                   // to protect shared data structure
+  LogManager *log_manager_;                                 // pointer to the log manager, nullptr if logging is off
+  size_t num_shards_;                                       // number of shards, see Shard
+  std::atomic<uint64_t> replacer_clock_{0};                 // logical clock shared by the replacers of the shards
+  std::vector<Shard> shards_;                               // shards of the page table
+  std::vector<Chunk> chunks_;                               // frames (and their snapshots) of the pool, see Chunk
+  std::mutex resize_latch_;                                 // one Resize at a time
+  std::atomic<uint64_t> foreground_writes_{0};
+  std::atomic<uint64_t> background_writes_{0};
+  std::mutex flush_latch_;                                  // one round of the cleaner or FlushAllPages at a time
+  std::mutex write_latch_;                                  // to protect writing_, taken after a shard latch
+  std::condition_variable write_done_;                      // notified when the cleaner finishes a round of writes
+  std::unordered_map<page_id_t, lsn_t> writing_;            // pages being written by the cleaner -> their recLSN
+  char *clean_buffer_{nullptr};                             // copies of the pages being written by the cleaner
+  page_id_t clean_cursor_{0};                               // the cleaner goes on from this page id in the next round
+  std::mutex cleaner_latch_;                                // to protect the two flags below
+  bool stop_{false};
+  bool clean_requested_{false};
+  std::condition_variable cleaner_cv_;
+  std::thread cleaner_thread_;
 };
 
 #endif  // MINISQL_BUFFER_POOL_MANAGER_H
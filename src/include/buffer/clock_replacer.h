@@ -41,6 +41,8 @@ class ClockReplacer : public Replacer {
 
   void Unpin(frame_id_t frame_id) override;
 
+  void SetCapacity(size_t num_pages) override;
+
   size_t Size() override;
   size_t num_page;
 
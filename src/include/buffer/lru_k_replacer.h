@@ -0,0 +1,79 @@
+#ifndef MINISQL_LRU_K_REPLACER_H
+#define MINISQL_LRU_K_REPLACER_H
+
+#include <atomic>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+/**
+ * LRUKReplacer implements the LRU-K replacement policy: the victim is the frame whose K-th most recent access
+ * is the oldest. Frames accessed fewer than K times have an infinite backward K-distance and are victimized first,
+ * the least recently used of them first, so pages that a scan touches once do not push out the pages that are used
+ * again and again, e.g. the upper levels of an index.
+ *
+ * 访问指Pin（包括页刚被读进来时），按逻辑时钟计时。一个buffer pool的所有shard共用一个时钟，这样看到的是整个buffer pool
+ * 的访问顺序，不同的buffer pool（数据库）互不影响。
+ * 同一帧两次访问之间的其他访问不超过LRUK_CORRELATED_PERIOD次时（比如扫描一行一行地fetch同一页）算作相关访问，
+ * 只更新最近访问时间，不算新的一次。换出后不保留历史。
+ */
+class LRUKReplacer : public Replacer {
+public:
+  /**
+   * @param num_pages the maximum number of pages the LRUKReplacer will be required to store
+   * @param clock logical clock shared with the other replacers of the buffer pool, nullptr to use a clock of its own
+   */
+  explicit LRUKReplacer(size_t num_pages, size_t k = LRUK_K, std::atomic<uint64_t> *clock = nullptr);
+
+  ~LRUKReplacer() override;
+
+  bool Victim(frame_id_t *frame_id) override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  void UnpinCold(frame_id_t frame_id) override;
+
+  void SetPage(frame_id_t frame_id, page_id_t page_id) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  size_t Size() override;
+
+private:
+  using Key = std::pair<uint64_t, frame_id_t>;
+
+  struct FrameInfo {
+    std::vector<uint64_t> history_;  // times of the last (at most) k distinct accesses, oldest first
+    uint64_t last_access_{0};
+    bool evictable_{false};
+    bool cold_{false};               // unpinned by UnpinCold and not accessed since
+  };
+
+  /**
+   * Record an access of the frame now
+   */
+  void RecordAccess(FrameInfo &info);
+
+  /**
+   * Add an evictable frame to cold_frames_ or hot_frames_, the key is computed from info
+   */
+  void Insert(frame_id_t frame_id, const FrameInfo &info);
+
+  void Erase(frame_id_t frame_id, const FrameInfo &info);
+
+  std::atomic<uint64_t> own_clock_{0};
+  std::atomic<uint64_t> *clock_;
+
+  size_t k_;
+  std::unordered_map<frame_id_t, FrameInfo> frames_;
+  std::set<Key> cold_frames_;  // evictable frames accessed fewer than k times, least recently used first
+  std::set<Key> hot_frames_;   // evictable frames accessed k times, oldest k-th most recent access first
+};
+
+#endif  // MINISQL_LRU_K_REPLACER_H
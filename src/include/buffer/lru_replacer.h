@@ -34,6 +34,8 @@ public:
 
   void Unpin(frame_id_t frame_id) override;
 
+  void UnpinCold(frame_id_t frame_id) override;
+
   size_t Size() override;
 
 private:
@@ -1,9 +1,20 @@
 #ifndef MINISQL_REPLACER_H
 #define MINISQL_REPLACER_H
 
+#include <atomic>
 #include <cstdio>
 #include "common/config.h"
 
+/**
+ * Replacement policies the buffer pool can be created with
+ */
+enum class ReplacerType {
+  kLRU,    // least recently used
+  kClock,  // clock (second chance)
+  kLRUK,   // LRU-K, see LRUKReplacer
+  k2Q,     // 2Q, see TwoQReplacer
+};
+
 /**
  * Replacer is an abstract class that tracks page usage.
  */
@@ -13,6 +24,13 @@ public:
 
   virtual ~Replacer() = default;
 
+  /**
+   * Create a replacer of the given policy
+   * @param num_pages the maximum number of pages the replacer will be required to store
+   * @param clock logical clock shared by the replacers of one buffer pool, only used by LRU-K
+   */
+  static Replacer *Create(ReplacerType type, size_t num_pages, std::atomic<uint64_t> *clock = nullptr);
+
   /**
    * Remove the victim frame as defined by the replacement policy.
    * @param[out] frame_id id of frame that was removed, nullptr if no victim was found
@@ -32,6 +50,30 @@ public:
    */
   virtual void Unpin(frame_id_t frame_id) = 0;
 
+  /**
+   * Unpins a frame that is unlikely to be used again soon, e.g. a page read ahead for a sequential scan,
+   * so that it is victimized before the other frames. Policies without such a notion treat it as Unpin.
+   * @param frame_id the id of the frame to unpin
+   */
+  virtual void UnpinCold(frame_id_t frame_id) { Unpin(frame_id); }
+
+  /**
+   * Tells the replacer that the frame now holds page_id, called before the frame is pinned for a newly read page.
+   * Policies that keep history per page (LRU-K, 2Q) use it to forget the previous page of the frame.
+   */
+  virtual void SetPage(frame_id_t frame_id, page_id_t page_id) {}
+
+  /**
+   * Forget a frame that is taken out of the buffer pool (the pool shrinks), it is never seen again unless the
+   * frame id is reused by a later grow.
+   */
+  virtual void Remove(frame_id_t frame_id) { Pin(frame_id); }
+
+  /**
+   * The buffer pool was resized, the replacer may be required to store up to num_pages pages from now on
+   */
+  virtual void SetCapacity(size_t num_pages) {}
+
   /** @return the number of elements in the replacer that can be victimized */
   virtual size_t Size() = 0;
 };
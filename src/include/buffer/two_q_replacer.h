@@ -0,0 +1,85 @@
+#ifndef MINISQL_TWO_Q_REPLACER_H
+#define MINISQL_TWO_Q_REPLACER_H
+
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+/**
+ * TwoQReplacer implements the full version of the 2Q replacement policy.
+ *
+ * 第一次读进来的页进入FIFO队列A1in；A1in超过Kin（1/4的帧）时从它的队头换出，页号记在只有页号的ghost队列A1out里
+ * （最多Kout，即1/2的帧）；在A1out里的页再次被读进来说明它是热的，放进按LRU管理的Am。
+ * 页还在A1in里时的重复访问当作相关访问（比如扫描一行一行地fetch同一页），不会提升到Am，
+ * 所以一次大扫描只会在A1in里流过，不会把Am里的索引页挤出去。
+ */
+class TwoQReplacer : public Replacer {
+public:
+  /**
+   * @param num_pages the maximum number of pages the TwoQReplacer will be required to store
+   */
+  explicit TwoQReplacer(size_t num_pages);
+
+  ~TwoQReplacer() override;
+
+  bool Victim(frame_id_t *frame_id) override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  void UnpinCold(frame_id_t frame_id) override;
+
+  void SetPage(frame_id_t frame_id, page_id_t page_id) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  void SetCapacity(size_t num_pages) override;
+
+  size_t Size() override;
+
+private:
+  using Key = std::pair<uint64_t, frame_id_t>;
+
+  enum class Queue { kA1in, kAm };
+
+  struct FrameInfo {
+    page_id_t page_id_{INVALID_PAGE_ID};
+    Queue queue_{Queue::kA1in};
+    uint64_t key_{0};           // A1in: time the page entered the queue (0 if cold), Am: time of the last access
+    bool evictable_{false};
+  };
+
+  /**
+   * @return the info of the frame, a frame never seen before (no SetPage) is put into A1in
+   */
+  FrameInfo &GetFrame(frame_id_t frame_id);
+
+  /**
+   * Remove an evictable frame from a1in_ or am_
+   */
+  void Erase(frame_id_t frame_id, const FrameInfo &info);
+
+  void Insert(frame_id_t frame_id, const FrameInfo &info);
+
+  /**
+   * Remember the page of a frame evicted from A1in in A1out
+   */
+  void AddGhost(page_id_t page_id);
+
+  size_t kin_;
+  size_t kout_;
+  uint64_t clock_{0};
+  std::unordered_map<frame_id_t, FrameInfo> frames_;
+  size_t a1in_count_{0};                 // frames in A1in, pinned or not
+  std::set<Key> a1in_;                   // evictable frames in A1in, oldest first
+  std::set<Key> am_;                     // evictable frames in Am, least recently used first
+  std::list<page_id_t> a1out_;           // pages recently evicted from A1in, most recent first
+  std::unordered_map<page_id_t, std::list<page_id_t>::iterator> a1out_map_;
+};
+
+#endif  // MINISQL_TWO_Q_REPLACER_H
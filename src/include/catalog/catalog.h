@@ -7,6 +7,7 @@
 
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/indexes.h"
+#include "catalog/statistics.h"
 #include "catalog/table.h"
 #include "common/config.h"
 #include "common/dberr.h"
@@ -14,14 +15,30 @@
 #include "transaction/log_manager.h"
 #include "transaction/transaction.h"
 
+/**
+ * CatalogMeta records the meta pages of all tables and indexes, and the settings of the database:
+ * the format version and page size the db file was written with, and its buffer pool size.
+ */
 class CatalogMeta {
   friend class CatalogManager;
 
 public:
+  /** version of the db file format, a db file of another version can not be opened */
+  static constexpr uint32_t FORMAT_VERSION = 2;
+  /** oldest format version that can still be read, version 1 has no statistics */
+  static constexpr uint32_t MIN_FORMAT_VERSION = 1;
+
   void SerializeTo(char *buf) const;
 
   static CatalogMeta *DeserializeFrom(char *buf, MemHeap *heap);
 
+  /**
+   * Read the settings of the database from a serialized catalog meta without deserializing the rest,
+   * the version of a catalog meta written before the version was recorded is 0
+   * @return false if buf does not hold a catalog meta
+   */
+  static bool DeserializeHeader(const char *buf, uint32_t *version, uint32_t *page_size, uint32_t *buffer_pool_size);
+
   uint32_t GetSerializedSize() const;
 
   inline table_id_t GetNextTableId() const {
@@ -51,13 +68,24 @@ public:
     return &index_meta_pages_;
   }
 
+  /**
+   * Used only for testing
+   */
+  inline std::map<table_id_t, page_id_t> *GetStatisticsPages() {
+    return &statistics_pages_;
+  }
+
 private:
   explicit CatalogMeta();
 
 private:
-  static constexpr uint32_t CATALOG_METADATA_MAGIC_NUM = 89849;
+  static constexpr uint32_t CATALOG_METADATA_MAGIC_NUM = 89850;
+  static constexpr uint32_t UNVERSIONED_MAGIC_NUM = 89849;  // magic number before the format version was recorded
+  uint32_t page_size_{PAGE_SIZE};
+  uint32_t buffer_pool_size_{0};  // 0 if create database did not give one
   std::map<table_id_t, page_id_t> table_meta_pages_;
   std::map<index_id_t, page_id_t> index_meta_pages_;
+  std::map<table_id_t, page_id_t> statistics_pages_;  // first page of the statistics of analyzed tables
 };
 
 /**
@@ -83,12 +111,35 @@ public:
 
   dberr_t GetIndex(const std::string &table_name, const std::string &index_name, IndexInfo *&index_info) const;
 
+  dberr_t GetIndex(const index_id_t index_id, IndexInfo *&index_info) const;
+
   dberr_t GetTableIndexes(const std::string &table_name, std::vector<IndexInfo *> &indexes) const;
 
   dberr_t DropTable(const std::string &table_name);
 
   dberr_t DropIndex(const std::string &table_name, const std::string &index_name);
 
+  /**
+   * Scan the table and replace its statistics, used by ANALYZE. The statistics are saved in the db file.
+   * @return DB_FAILED if there is no free page to save them, the old statistics are kept
+   */
+  dberr_t AnalyzeTable(const std::string &table_name);
+
+  /**
+   * statistics is set to nullptr if the table has never been analyzed
+   */
+  dberr_t GetTableStatistics(const std::string &table_name, const TableStatistics *&statistics) const;
+
+  /**
+   * @return the buffer pool size recorded for the database, 0 if none
+   */
+  uint32_t GetBufferPoolSize() const;
+
+  /**
+   * Record the buffer pool size of the database, it is used whenever the database is opened
+   */
+  dberr_t SetBufferPoolSize(uint32_t buffer_pool_size);
+
 private:
   dberr_t FlushCatalogMetaPage() const;
 
@@ -96,6 +147,19 @@ private:
 
   dberr_t LoadIndex(const index_id_t index_id, const page_id_t page_id);
 
+  /**
+   * Write statistics to a chain of new pages, each page starts with the id of the next one
+   * @return the first page of the chain, INVALID_PAGE_ID if there are not enough free pages
+   */
+  page_id_t FlushStatistics(const TableStatistics &statistics);
+
+  dberr_t LoadStatistics(const table_id_t table_id, const page_id_t page_id);
+
+  /**
+   * Free the chain of pages starting at page_id written by FlushStatistics
+   */
+  void DeleteStatistics(page_id_t page_id);
+
   dberr_t GetTable(const table_id_t table_id, TableInfo *&table_info);
 
 private:
@@ -111,6 +175,8 @@ private:
   // map for indexes: table_name->index_name->indexes
   [[maybe_unused]] std::unordered_map<std::string, std::unordered_map<std::string, index_id_t>> index_names_;
   [[maybe_unused]] std::unordered_map<index_id_t, IndexInfo *> indexes_;
+  // statistics of analyzed tables, saved in the pages recorded in CatalogMeta::statistics_pages_
+  std::unordered_map<table_id_t, TableStatistics> statistics_;
   // memory heap
   MemHeap *heap_;
 };
@@ -65,7 +65,8 @@ class IndexInfo {
 
   ~IndexInfo() { delete heap_; }
 
-  void Init(IndexMetadata *meta_data, TableInfo *table_info, BufferPoolManager *buffer_pool_manager) {
+  void Init(IndexMetadata *meta_data, TableInfo *table_info, BufferPoolManager *buffer_pool_manager,
+            LogManager *log_manager = nullptr) {
     // Step1: init index metadata and table info
     meta_data_ = meta_data;
     table_info_ = table_info;
@@ -77,7 +78,7 @@ class IndexInfo {
     }
     key_schema_ = Schema::ShallowCopySchema(table_info_->GetSchema(), column_index, heap_);
     // Step3: call CreateIndex to create the index
-    index_ = CreateIndex(buffer_pool_manager);
+    index_ = CreateIndex(buffer_pool_manager, log_manager);
 
     // 我想了想，这块暂时不应该存在。如果是重新读取Index的话，那就会导致在原有的Index上重新InsertEntry
     // 或许有关这一块的处理得加载CatalogManager::CreateIndex那里
@@ -105,6 +106,11 @@ class IndexInfo {
 
   inline IndexSchema *GetIndexKeySchema() { return key_schema_; }
 
+  /**
+   * @return for each column of the key, its column index in the table schema
+   */
+  inline const std::vector<uint32_t> &GetKeyMapping() const { return meta_data_->GetKeyMapping(); }
+
   inline MemHeap *GetMemHeap() const { return heap_; }
 
   inline TableInfo *GetTableInfo() const { return table_info_; }
@@ -116,38 +122,34 @@ class IndexInfo {
       : meta_data_{nullptr}, index_{nullptr}, table_info_{nullptr}, key_schema_{nullptr}, heap_(new SimpleMemHeap()) {}
 
   // 直接根据key的Length新建index,index会自动从磁盘中读取对应index_id的数据
-  Index *CreateIndex(BufferPoolManager *buffer_pool_manager) {
-    uint32_t keyLength = 0;
-    for (auto column_it : key_schema_->GetColumns()) {
-      keyLength += column_it->GetLength();
-    }
-    // 这是一个Row中的header的长度，因为索引键是用Row存的，所以需要header
-    keyLength += 4 + (uint32_t)ceil((double)key_schema_->GetColumnCount() / 8);
+  Index *CreateIndex(BufferPoolManager *buffer_pool_manager, LogManager *log_manager) {
+    // 索引键使用可比较编码，按最长的情况（每一列 1(null flag) + column长度，char再加结束符）分配
+    uint32_t keyLength = GetEncodedKeySize(key_schema_);
     ASSERT(keyLength <= 128, "WARNING: GenericKey is not big enough. From indexes.h:CreateIndex");
     if (keyLength <= 4) {
       meta_data_->keyLength = 4;
       return new BPlusTreeIndex<GenericKey<4>, RowId, GenericComparator<4>>
-          (meta_data_->GetIndexId(), key_schema_,buffer_pool_manager);
+          (meta_data_->GetIndexId(), key_schema_, buffer_pool_manager, log_manager);
     } else if (keyLength <= 8) {
       meta_data_->keyLength = 8;
       return new BPlusTreeIndex<GenericKey<8>, RowId, GenericComparator<8>>
-          (meta_data_->GetIndexId(), key_schema_,buffer_pool_manager);
+          (meta_data_->GetIndexId(), key_schema_, buffer_pool_manager, log_manager);
     } else if (keyLength <= 16) {
       meta_data_->keyLength = 16;
       return new BPlusTreeIndex<GenericKey<16>, RowId, GenericComparator<16>>
-          (meta_data_->GetIndexId(), key_schema_,buffer_pool_manager);
+          (meta_data_->GetIndexId(), key_schema_, buffer_pool_manager, log_manager);
     } else if (keyLength <= 32) {
       meta_data_->keyLength = 32;
       return new BPlusTreeIndex<GenericKey<32>, RowId, GenericComparator<32>>
-          (meta_data_->GetIndexId(), key_schema_,buffer_pool_manager);
+          (meta_data_->GetIndexId(), key_schema_, buffer_pool_manager, log_manager);
     } else if (keyLength <= 64) {
       meta_data_->keyLength = 64;
       return new BPlusTreeIndex<GenericKey<64>, RowId, GenericComparator<64>>
-          (meta_data_->GetIndexId(), key_schema_,buffer_pool_manager);
+          (meta_data_->GetIndexId(), key_schema_, buffer_pool_manager, log_manager);
     } else {
       meta_data_->keyLength = 128;
       return new BPlusTreeIndex<GenericKey<128>, RowId, GenericComparator<128>>
-          (meta_data_->GetIndexId(), key_schema_,buffer_pool_manager);
+          (meta_data_->GetIndexId(), key_schema_, buffer_pool_manager, log_manager);
     }
   }
 
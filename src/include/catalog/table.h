@@ -17,8 +17,8 @@ public:
 
   static uint32_t DeserializeFrom(char *buf, TableMetadata *&table_meta, MemHeap *heap);
 
-  static TableMetadata *Create(table_id_t table_id, std::string table_name,
-                               page_id_t root_page_id, TableSchema *schema, MemHeap *heap);
+  static TableMetadata *Create(table_id_t table_id, std::string table_name, page_id_t root_page_id,
+                               page_id_t free_space_map_page_id, TableSchema *schema, MemHeap *heap);
 
   inline table_id_t GetTableId() const { return table_id_; }
 
@@ -26,19 +26,24 @@ public:
 
   inline page_id_t GetFirstPageId() const { return root_page_id_; }
 
+  inline page_id_t GetFreeSpaceMapPageId() const { return free_space_map_page_id_; }
+
   inline Schema *GetSchema() const { return schema_; }
 
 
 private:
   TableMetadata() = delete;
 
-  TableMetadata(table_id_t table_id, std::string table_name, page_id_t root_page_id, TableSchema *schema);
+  TableMetadata(table_id_t table_id, std::string table_name, page_id_t root_page_id,
+                page_id_t free_space_map_page_id, TableSchema *schema);
 
 private:
-  static constexpr uint32_t TABLE_METADATA_MAGIC_NUM = 344528;
+  // free_space_map_page_id_加入后格式变了，换一个magic number
+  static constexpr uint32_t TABLE_METADATA_MAGIC_NUM = 344529;
   table_id_t table_id_;
   std::string table_name_;
   page_id_t root_page_id_;
+  page_id_t free_space_map_page_id_;  // first page of the free space map of the table heap
   Schema *schema_;
 };
 
@@ -53,6 +58,10 @@ public:
   }
 
   ~TableInfo() {
+    // table heap是placement new在heap_里的，释放内存之前要先析构，否则它的空闲空间表等成员会泄漏
+    if (table_heap_ != nullptr) {
+      table_heap_->~TableHeap();
+    }
     delete heap_;
   }
 
@@ -77,8 +86,8 @@ private:
   explicit TableInfo() : heap_(new SimpleMemHeap()) {};
 
 private:
-  TableMetadata *table_meta_;
-  TableHeap *table_heap_;
+  TableMetadata *table_meta_{nullptr};
+  TableHeap *table_heap_{nullptr};
   MemHeap *heap_; /** store all objects allocated in table_meta and table heap */
 };
 
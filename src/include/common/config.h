@@ -13,8 +13,39 @@ static constexpr int META_PAGE_ID = 0;               // physical page id of the
 static constexpr int CATALOG_META_PAGE_ID = 0;       // logical page id of the catalog meta data
 static constexpr int INDEX_ROOTS_PAGE_ID = 1;        // logical page id of the index roots
 
-static constexpr int PAGE_SIZE = 4096;               // size of a data page in byte
+// 页大小在编译时决定（cmake -DMINISQL_PAGE_SIZE=16384），记录在db文件的catalog meta里，打开页大小不同的db文件会失败
+#ifndef MINISQL_PAGE_SIZE
+#define MINISQL_PAGE_SIZE 4096
+#endif
+static constexpr int PAGE_SIZE = MINISQL_PAGE_SIZE;  // size of a data page in byte
+static_assert(PAGE_SIZE >= 4096 && (PAGE_SIZE & (PAGE_SIZE - 1)) == 0, "page size must be a power of 2, at least 4KB");
 static constexpr int DEFAULT_BUFFER_POOL_SIZE = 1024;// default size of buffer pool
+static constexpr uint32_t MIN_BUFFER_POOL_SIZE = 16; // a b+ tree operation pins a few pages at once, so no fewer frames
+static constexpr int BUFFER_POOL_SHARD_FRAMES = 64;  // minimum number of frames per buffer pool shard
+static constexpr int MAX_BUFFER_POOL_SHARDS = 16;    // maximum number of buffer pool shards
+static constexpr uint32_t BUFFER_POOL_CHUNK_FRAMES = 1024; // frames are allocated this many at a time, a power of 2
+static constexpr uint32_t BUFFER_POOL_RESIZE_TIMEOUT_MS = 10000; // shrinking gives up if frames stay pinned this long
+static constexpr int LRUK_K = 2;                     // K of the LRU-K replacer
+static constexpr int LRUK_CORRELATED_PERIOD = 2;     // accesses of a frame at most this many ticks apart count as one
+static constexpr int LOG_BUFFER_SIZE = 32 * PAGE_SIZE; // size of each of the two in-memory log buffers
+static constexpr int LOG_FLUSH_TIMEOUT_MS = 50;      // the log flush thread wakes up at least this often
+static constexpr int CHECKPOINT_LOG_SIZE = 1024 * PAGE_SIZE; // take a checkpoint after this many bytes of log
+static constexpr int CHECKPOINT_INTERVAL_MS = 1000;  // the checkpointer checks the log size this often
+static constexpr int BUFFER_POOL_CLEANER_INTERVAL_MS = 10; // the page cleaner wakes up at least this often
+static constexpr double BUFFER_POOL_CLEAN_RATIO = 0.5; // fraction of the evictable frames the page cleaner keeps clean
+static constexpr uint32_t BUFFER_POOL_CLEAN_BATCH = 64; // max number of pages the page cleaner writes per round
+static constexpr uint32_t DISK_PREALLOCATE_PAGES = 1024; // pages the db file is extended by at a time with fallocate
+static constexpr uint32_t ASYNC_IO_QUEUE_DEPTH = 64; // max number of asynchronous page I/Os in flight
+static constexpr uint32_t ASYNC_IO_THREADS = 4;      // threads doing asynchronous I/O when io_uring is unavailable
+static constexpr uint32_t READ_AHEAD_PAGES = 32;    // pages a sequential table scan reads ahead of its cursor
+static constexpr uint32_t READ_AHEAD_TRIGGER = 2;    // pages a table scan crosses before it is treated as sequential
+static constexpr int DEADLOCK_DETECTION_INTERVAL_MS = 50; // the deadlock detector looks for cycles this often
+static constexpr uint32_t EXECUTOR_BATCH_SIZE = 256; // max number of rows an executor produces per Next call
+static constexpr double INDEX_FILL_FACTOR = 0.9;     // fraction of a b+ tree page filled by bulk load
+static constexpr size_t INDEX_SORT_MEMORY = 64 * 1024 * 1024; // bytes of index entries sorted in memory, the rest spills to disk
+static constexpr size_t ARENA_BLOCK_SIZE = 16 * 1024; // bytes of a block of ArenaMemHeap, e.g. the rows of a batch
+static constexpr size_t ROW_ARENA_BLOCK_SIZE = 256;   // bytes of a block of the ArenaMemHeap owned by a row
+static constexpr size_t LOAD_BUFFER_SIZE = 1024 * 1024; // bytes read from a data file at a time by LOAD DATA
 
 static constexpr uint32_t FIELD_NULL_LEN = UINT32_MAX;
 static constexpr uint32_t VARCHAR_MAX_LEN = PAGE_SIZE / 2;    // max length of varchar
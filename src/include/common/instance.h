@@ -2,18 +2,30 @@
 #define MINISQL_INSTANCE_H
 
 #include <memory>
+#include <stdexcept>
 #include <string>
 
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/catalog.h"
 #include "common/config.h"
 #include "common/dberr.h"
+#include "recovery/checkpoint_manager.h"
+#include "recovery/log_recovery.h"
 #include "storage/disk_manager.h"
+#include "transaction/log_manager.h"
+#include "transaction/txn_manager.h"
 
 class DBStorageEngine {
 public:
+  /**
+   * Open the database in db_name, a new one if init is true
+   * @param buffer_pool_size frames of the buffer pool, unless the db file records a size of its own
+   *        (create database ... buffer_pool_size = n)
+   * @throw std::runtime_error if the db file was written in another format version or with another page size
+   */
   explicit DBStorageEngine(std::string db_name, bool init = true,
-                           uint32_t buffer_pool_size = DEFAULT_BUFFER_POOL_SIZE)
+                           uint32_t buffer_pool_size = DEFAULT_BUFFER_POOL_SIZE,
+                           ReplacerType replacer_type = ReplacerType::kLRU)
           : db_file_name_(std::move(db_name)), init_(init) {
     // Init database file if needed
     if (init_) {
@@ -21,9 +33,19 @@ public:
     }
     // Initialize components
     disk_mgr_ = new DiskManager(db_file_name_);
-    bpm_ = new BufferPoolManager(buffer_pool_size, disk_mgr_);
-    catalog_mgr_ = new CatalogManager(bpm_, nullptr, nullptr, init);
-    // Allocate static page for db storage engine
+    LogRecovery recovery(disk_mgr_);
+    if (init_) {
+      disk_mgr_->TruncateLog();
+    } else {
+      // 上次没有正常关闭时，日志中还有没写回db文件的修改，先redo再加载catalog
+      recovery.Redo();
+      CheckFormat(&buffer_pool_size);
+    }
+    log_mgr_ = new LogManager(disk_mgr_, recovery.GetNextLSN());
+    bpm_ = new BufferPoolManager(buffer_pool_size, disk_mgr_, log_mgr_, replacer_type, true);
+    lock_mgr_ = new LockManager();
+    txn_mgr_ = new TransactionManager(log_mgr_, lock_mgr_, recovery.GetNextTxnId());
+    // Allocate static page for db storage engine (before the catalog manager touches them)
     if (init) {
       page_id_t id;
       ASSERT(bpm_->IsPageFree(CATALOG_META_PAGE_ID), "Catalog meta page not free.");
@@ -36,20 +58,70 @@ public:
       ASSERT(!bpm_->IsPageFree(CATALOG_META_PAGE_ID), "Invalid catalog meta page.");
       ASSERT(!bpm_->IsPageFree(INDEX_ROOTS_PAGE_ID), "Invalid header page.");
     }
+    catalog_mgr_ = new CatalogManager(bpm_, lock_mgr_, log_mgr_, init);
+    if (recovery.GetLoserCount() > 0) {
+      recovery.Undo(catalog_mgr_, bpm_, log_mgr_);
+    }
+    // undo完成之前不能做checkpoint，loser事务的日志还要用
+    checkpoint_mgr_ = new CheckpointManager(txn_mgr_, log_mgr_, bpm_, disk_mgr_, true);
+    if (recovery.GetLoserCount() > 0) {
+      checkpoint_mgr_->Checkpoint();
+    }
   }
 
   ~DBStorageEngine() {
+    delete checkpoint_mgr_;
     delete catalog_mgr_;
     delete bpm_;
+    delete log_mgr_;
+    // 所有page都已写回，正常关闭后不需要再保留日志
+    disk_mgr_->SyncData();
+    disk_mgr_->TruncateLog();
+    delete txn_mgr_;
+    delete lock_mgr_;
     delete disk_mgr_;
   }
 
 public:
   DiskManager *disk_mgr_;
+  LogManager *log_mgr_;
   BufferPoolManager *bpm_;
+  LockManager *lock_mgr_;
+  TransactionManager *txn_mgr_;
+  CheckpointManager *checkpoint_mgr_;
   CatalogManager *catalog_mgr_;
   std::string db_file_name_;
   bool init_;
+
+private:
+  /**
+   * Check the format version and page size recorded in the catalog meta of the db file, before the buffer pool
+   * is created, and take the buffer pool size recorded there if there is one
+   */
+  void CheckFormat(uint32_t *buffer_pool_size) {
+    char buf[PAGE_SIZE];
+    disk_mgr_->ReadPage(CATALOG_META_PAGE_ID, buf);
+    uint32_t version;
+    uint32_t page_size;
+    uint32_t recorded_buffer_pool_size;
+    std::string error;
+    if (!CatalogMeta::DeserializeHeader(buf, &version, &page_size, &recorded_buffer_pool_size)) {
+      // 页大小不同时catalog meta page的位置也不同，读到的不是catalog meta
+      error = " is not a database, or its page size is not " + std::to_string(PAGE_SIZE);
+    } else if (version < CatalogMeta::MIN_FORMAT_VERSION || version > CatalogMeta::FORMAT_VERSION) {
+      error = " is in format version " + std::to_string(version) + ", but this build reads versions " +
+              std::to_string(CatalogMeta::MIN_FORMAT_VERSION) + " to " + std::to_string(CatalogMeta::FORMAT_VERSION);
+    } else if (page_size != PAGE_SIZE) {
+      error = " has " + std::to_string(page_size) + " byte pages, but this build uses " + std::to_string(PAGE_SIZE);
+    }
+    if (!error.empty()) {
+      delete disk_mgr_;
+      throw std::runtime_error(db_file_name_ + error);
+    }
+    if (recorded_buffer_pool_size != 0) {
+      *buffer_pool_size = recorded_buffer_pool_size;
+    }
+  }
 };
 
 #endif //MINISQL_INSTANCE_H
@@ -2,6 +2,7 @@
 #define MINISQL_RID_H
 
 #include <cstdint>
+#include <functional>
 #include "common/config.h"
 
 /**
@@ -41,4 +42,11 @@ private:
 
 static const RowId INVALID_ROWID = RowId(INVALID_PAGE_ID, 0);
 
+namespace std {
+template <>
+struct hash<RowId> {
+  size_t operator()(const RowId &rid) const { return hash<int64_t>()(rid.Get()); }
+};
+}  // namespace std
+
 #endif //MINISQL_RID_H
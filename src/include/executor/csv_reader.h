@@ -0,0 +1,82 @@
+#ifndef MINISQL_CSV_READER_H
+#define MINISQL_CSV_READER_H
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+
+/**
+ * CsvReader reads the records of a csv file one by one, for LOAD DATA.
+ *
+ * 文件按buffer_size大块fread进来，逐字符切分，不会一次把整个文件读进内存。
+ * 格式按RFC 4180：字段用逗号分隔，记录以LF或CRLF结束，字段可以用双引号括起来，
+ * 括起来的字段里可以有逗号和换行，两个连续的双引号表示一个双引号。空行被跳过。
+ */
+class CsvReader {
+public:
+  explicit CsvReader(const std::string &file_name, size_t buffer_size = LOAD_BUFFER_SIZE);
+
+  ~CsvReader();
+
+  CsvReader(const CsvReader &) = delete;
+
+  CsvReader &operator=(const CsvReader &) = delete;
+
+  /**
+   * @return false if the file could not be opened
+   */
+  inline bool IsOpen() const { return file_ != nullptr; }
+
+  /**
+   * Read the next record
+   * @param[out] fields the fields of the record, without the quotes
+   * @param[out] quoted whether each field was quoted, so that an empty quoted field can be told from a missing one
+   * @return false at the end of the file
+   */
+  bool NextRecord(std::vector<std::string> *fields, std::vector<bool> *quoted);
+
+  /**
+   * @return the line the last record read starts at, counting from 1
+   */
+  inline uint32_t GetLineNumber() const { return record_line_; }
+
+private:
+  /**
+   * @return the next character, EOF at the end of the file
+   */
+  inline int Get() {
+    if (pos_ == size_ && !Fill()) {
+      return EOF;
+    }
+    return static_cast<unsigned char>(buffer_[pos_++]);
+  }
+
+  /**
+   * @return the next character without consuming it, EOF at the end of the file
+   */
+  inline int Peek() {
+    if (pos_ == size_ && !Fill()) {
+      return EOF;
+    }
+    return static_cast<unsigned char>(buffer_[pos_]);
+  }
+
+  /**
+   * Read the next block of the file into the buffer
+   * @return false if there is nothing left
+   */
+  bool Fill();
+
+  FILE *file_;
+  std::unique_ptr<char[]> buffer_;
+  size_t buffer_size_;
+  size_t size_{0};  // bytes in the buffer
+  size_t pos_{0};   // next byte to read in the buffer
+  uint32_t line_{1};
+  uint32_t record_line_{0};
+};
+
+#endif  // MINISQL_CSV_READER_H
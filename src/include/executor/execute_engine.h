@@ -1,10 +1,21 @@
 #ifndef MINISQL_EXECUTE_ENGINE_H
 #define MINISQL_EXECUTE_ENGINE_H
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include "common/dberr.h"
 #include "common/instance.h"
+#include "executor/csv_reader.h"
+#include "executor/executors/delete_executor.h"
+#include "executor/executors/filter_executor.h"
+#include "executor/executors/index_scan_executor.h"
+#include "executor/executors/limit_executor.h"
+#include "executor/executors/projection_executor.h"
+#include "executor/executors/seq_scan_executor.h"
+#include "executor/executors/update_executor.h"
+#include "executor/optimizer.h"
+#include "executor/predicate.h"
 #include "transaction/transaction.h"
 extern "C" {
 int yyparse(void);
@@ -29,9 +40,17 @@ struct ExecuteContext {
  */
 class ExecuteEngine {
 public:
-  ExecuteEngine();
+  /**
+   * Load all databases in the db directory
+   * @param buffer_pool_size frames of the buffer pool of a database that does not record a size of its own
+   */
+  explicit ExecuteEngine(uint32_t buffer_pool_size = DEFAULT_BUFFER_POOL_SIZE);
 
   ~ExecuteEngine() {
+    // 退出时还没有提交的事务回滚
+    if (txn_ != nullptr) {
+      dbs_[current_db_]->txn_mgr_->Abort(txn_);
+    }
     for (auto it : dbs_) {
       delete it.second;
     }
@@ -77,13 +96,44 @@ private:
 
   dberr_t ExecuteTrxRollback(pSyntaxNode ast, ExecuteContext *context);
 
+  dberr_t ExecuteAnalyze(pSyntaxNode ast, ExecuteContext *context);
+
+  dberr_t ExecuteLoadData(pSyntaxNode ast, ExecuteContext *context);
+
+  dberr_t ExecuteSet(pSyntaxNode ast, ExecuteContext *context);
+
   dberr_t ExecuteExecfile(pSyntaxNode ast, ExecuteContext *context);
 
   dberr_t ExecuteQuit(pSyntaxNode ast, ExecuteContext *context);
 
+  /**
+   * Transaction of a statement that reads or writes rows: the transaction started by BEGIN, or a new one for
+   * this statement only
+   */
+  Transaction *StatementBegin();
+
+  /**
+   * Commit (on success) or abort (on failure) the transaction of a single statement.
+   * A transaction chosen as a deadlock victim is aborted, even if it was started by BEGIN.
+   * @return result
+   */
+  dberr_t StatementEnd(Transaction *txn, dberr_t result);
+
+  /**
+   * Build the scan part of a plan: an index scan when one index matches the conditions, otherwise a
+   * sequential scan, with a filter on top that checks all conditions (OR of ANDs).
+   * The scan share locks the rows it returns in txn
+   * @return nullptr if a condition refers to a column that does not exist
+   */
+  std::unique_ptr<AbstractExecutor> BuildScanExecutor(const vector<vector<SyntaxNode *>> &conditions,
+                                                      TableInfo *table_info, const vector<IndexInfo *> &indexes,
+                                                      Transaction *txn);
+
 private:
   [[maybe_unused]] std::unordered_map<std::string, DBStorageEngine *> dbs_;  /** all opened databases */
   [[maybe_unused]] std::string current_db_;  /** current database */
+  Transaction *txn_{nullptr};  /** transaction started by BEGIN on the current database */
+  uint32_t buffer_pool_size_;  /** buffer pool size of databases that do not record their own */
 };
 
 #endif //MINISQL_EXECUTE_ENGINE_H
@@ -0,0 +1,46 @@
+#ifndef MINISQL_ABSTRACT_EXECUTOR_H
+#define MINISQL_ABSTRACT_EXECUTOR_H
+
+#include <vector>
+
+#include "catalog/indexes.h"
+#include "common/config.h"
+#include "common/dberr.h"
+#include "record/row.h"
+
+/**
+ * AbstractExecutor is the base class of all operators of the pull-based (volcano) executor.
+ *
+ * 执行计划是一棵executor树，上层executor调用孩子的Next拉取数据。每次Next产出一批（最多EXECUTOR_BATCH_SIZE行）row，
+ * 而不是一行，这样虚函数调用的开销分摊到一批row上；整个查询只需要在内存中保留一批row，第一批row算出来就可以输出。
+ */
+class AbstractExecutor {
+public:
+  virtual ~AbstractExecutor() = default;
+
+  /**
+   * Prepare the executor (and its children) to produce rows, must be called before the first Next
+   */
+  virtual void Init() = 0;
+
+  /**
+   * Produce the next batch of rows, batch is cleared first
+   * @return false if there are no more rows or an error happened (see GetStatus), batch is empty then
+   */
+  virtual bool Next(std::vector<Row> *batch) = 0;
+
+  /**
+   * @return DB_SUCCESS, or the error that stopped the executor, e.g. its transaction was aborted
+   */
+  inline dberr_t GetStatus() const { return status_; }
+
+protected:
+  /**
+   * @return key of row in index, row is a full row of the indexed table
+   */
+  static Row MakeIndexKey(const Row &row, IndexInfo *index) { return Row(row, index->GetKeyMapping()); }
+
+  dberr_t status_{DB_SUCCESS};
+};
+
+#endif  // MINISQL_ABSTRACT_EXECUTOR_H
@@ -0,0 +1,34 @@
+#ifndef MINISQL_DELETE_EXECUTOR_H
+#define MINISQL_DELETE_EXECUTOR_H
+
+#include <memory>
+#include <vector>
+
+#include "catalog/indexes.h"
+#include "catalog/table.h"
+#include "executor/executors/abstract_executor.h"
+
+/**
+ * DeleteExecutor deletes the rows produced by its child from the table and all its indexes,
+ * and produces the deleted rows.
+ * 删除之前用事务重新读一次row（加锁），已经被其他事务删除的row跳过；加锁失败说明事务被中止，停止执行并置status为DB_FAILED
+ */
+class DeleteExecutor : public AbstractExecutor {
+public:
+  DeleteExecutor(std::unique_ptr<AbstractExecutor> child, TableInfo *table_info, std::vector<IndexInfo *> indexes,
+                 Transaction *txn)
+      : child_(std::move(child)), table_info_(table_info), indexes_(std::move(indexes)), txn_(txn) {}
+
+  void Init() override;
+
+  bool Next(std::vector<Row> *batch) override;
+
+private:
+  std::unique_ptr<AbstractExecutor> child_;
+  TableInfo *table_info_;
+  std::vector<IndexInfo *> indexes_;
+  Transaction *txn_;
+  std::vector<Row> child_batch_;
+};
+
+#endif  // MINISQL_DELETE_EXECUTOR_H
@@ -0,0 +1,30 @@
+#ifndef MINISQL_FILTER_EXECUTOR_H
+#define MINISQL_FILTER_EXECUTOR_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "executor/executors/abstract_executor.h"
+
+/**
+ * FilterExecutor produces the rows of its child that satisfy the predicate
+ */
+class FilterExecutor : public AbstractExecutor {
+public:
+  using PredicateFunc = std::function<bool(const Row &)>;
+
+  FilterExecutor(std::unique_ptr<AbstractExecutor> child, PredicateFunc predicate)
+      : child_(std::move(child)), predicate_(std::move(predicate)) {}
+
+  void Init() override;
+
+  bool Next(std::vector<Row> *batch) override;
+
+private:
+  std::unique_ptr<AbstractExecutor> child_;
+  PredicateFunc predicate_;
+  std::vector<Row> child_batch_;
+};
+
+#endif  // MINISQL_FILTER_EXECUTOR_H
@@ -0,0 +1,60 @@
+#ifndef MINISQL_INDEX_SCAN_EXECUTOR_H
+#define MINISQL_INDEX_SCAN_EXECUTOR_H
+
+#include <string>
+#include <vector>
+
+#include "catalog/indexes.h"
+#include "catalog/table.h"
+#include "executor/executors/abstract_executor.h"
+
+/**
+ * IndexLookup finds the rows whose key in index_ satisfies "key op_ key_",
+ * op_ is one of "=", "<", "<=", ">", ">=" as in Index::ScanKey.
+ * A bounded range sets upper_op_ ("<" or "<=") and upper_key_ as well, op_ is then ">" or ">=",
+ * and is read by a single Index::ScanRange.
+ */
+struct IndexLookup {
+  IndexInfo *index_;
+  std::vector<Field> key_;
+  std::string op_;
+  std::vector<Field> upper_key_{};
+  std::string upper_op_{};
+};
+
+/**
+ * IndexScanExecutor produces the rows found by index lookups: the union over clauses of the intersection
+ * of the lookups in each clause.
+ * 索引只返回RowId，Init时把满足条件的RowId取出来，Next时再按批读出对应的row。
+ * 只有一个lookup时按索引顺序输出，否则按RowId排序去重后输出，读同一页的row挨在一起。
+ * In a transaction every row is share locked before it is read (TableHeap::GetTuple).
+ */
+class IndexScanExecutor : public AbstractExecutor {
+public:
+  IndexScanExecutor(TableInfo *table_info, IndexInfo *index_info, std::vector<Field> &search_key,
+                    std::string condition, Transaction *txn = nullptr)
+      : table_info_(table_info), lookups_{{IndexLookup{index_info, search_key, std::move(condition)}}}, txn_(txn) {}
+
+  IndexScanExecutor(TableInfo *table_info, std::vector<std::vector<IndexLookup>> lookups, Transaction *txn = nullptr)
+      : table_info_(table_info), lookups_(std::move(lookups)), txn_(txn) {}
+
+  void Init() override;
+
+  bool Next(std::vector<Row> *batch) override;
+
+private:
+  /**
+   * Append the RowIds found by lookup to rids
+   * @return false if the index could not be read
+   */
+  static bool Lookup(const IndexLookup &lookup, std::vector<RowId> *rids);
+
+  TableInfo *table_info_;
+  std::vector<std::vector<IndexLookup>> lookups_;
+  Transaction *txn_;
+  std::vector<RowId> rids_;
+  size_t cursor_{0};  // next rid in rids_ to read
+  ArenaMemHeap heap_;  // fields of the rows in the current batch
+};
+
+#endif  // MINISQL_INDEX_SCAN_EXECUTOR_H
@@ -0,0 +1,26 @@
+#ifndef MINISQL_LIMIT_EXECUTOR_H
+#define MINISQL_LIMIT_EXECUTOR_H
+
+#include <memory>
+#include <vector>
+
+#include "executor/executors/abstract_executor.h"
+
+/**
+ * LimitExecutor produces at most limit rows of its child, it stops pulling from the child once enough rows are produced
+ */
+class LimitExecutor : public AbstractExecutor {
+public:
+  LimitExecutor(std::unique_ptr<AbstractExecutor> child, size_t limit) : child_(std::move(child)), limit_(limit) {}
+
+  void Init() override;
+
+  bool Next(std::vector<Row> *batch) override;
+
+private:
+  std::unique_ptr<AbstractExecutor> child_;
+  size_t limit_;
+  size_t produced_{0};
+};
+
+#endif  // MINISQL_LIMIT_EXECUTOR_H
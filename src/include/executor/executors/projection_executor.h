@@ -0,0 +1,28 @@
+#ifndef MINISQL_PROJECTION_EXECUTOR_H
+#define MINISQL_PROJECTION_EXECUTOR_H
+
+#include <memory>
+#include <vector>
+
+#include "executor/executors/abstract_executor.h"
+
+/**
+ * ProjectionExecutor keeps the given columns (by index in the child's rows, in the given order) of each row.
+ * The row id of the row is kept.
+ */
+class ProjectionExecutor : public AbstractExecutor {
+public:
+  ProjectionExecutor(std::unique_ptr<AbstractExecutor> child, std::vector<uint32_t> column_indexes)
+      : child_(std::move(child)), column_indexes_(std::move(column_indexes)) {}
+
+  void Init() override;
+
+  bool Next(std::vector<Row> *batch) override;
+
+private:
+  std::unique_ptr<AbstractExecutor> child_;
+  std::vector<uint32_t> column_indexes_;
+  std::vector<Row> child_batch_;
+};
+
+#endif  // MINISQL_PROJECTION_EXECUTOR_H
@@ -0,0 +1,42 @@
+#ifndef MINISQL_SEQ_SCAN_EXECUTOR_H
+#define MINISQL_SEQ_SCAN_EXECUTOR_H
+
+#include <memory>
+#include <vector>
+
+#include "catalog/table.h"
+#include "executor/executors/abstract_executor.h"
+#include "executor/predicate.h"
+#include "record/row_view.h"
+#include "storage/table_iterator.h"
+
+/**
+ * SeqScanExecutor produces the rows of a table that satisfy the predicate (all rows if it is empty) in storage order.
+ * In a transaction every row returned is share locked, and the scan waits for rows that another transaction changed
+ * and has not committed yet (see TableHeap::TryLockRow), the same as reading rows with TableHeap::GetTuple.
+ *
+ * 谓词直接在页上的tuple字节上判断（RowView），只有满足条件的行才反序列化成Row，
+ * 所以不满足条件的行不会产生任何内存分配。一批row的field都分配在同一个arena上，下一次Next时一起释放
+ */
+class SeqScanExecutor : public AbstractExecutor {
+public:
+  explicit SeqScanExecutor(TableInfo *table_info, Predicate predicate = Predicate(), Transaction *txn = nullptr)
+      : table_info_(table_info), predicate_(std::move(predicate)), txn_(txn) {}
+
+  void Init() override;
+
+  bool Next(std::vector<Row> *batch) override;
+
+private:
+  TableInfo *table_info_;
+  Predicate predicate_;
+  Transaction *txn_;
+  page_id_t page_id_{INVALID_PAGE_ID};  // page to scan next, INVALID_PAGE_ID at the end of the table
+  uint32_t slot_num_{0};                // slot to scan next in page_id_
+  RowId wait_rid_{INVALID_ROWID};       // row the scan stopped at to wait for its lock
+  RowView view_;
+  ScanReadAhead read_ahead_;
+  ArenaMemHeap heap_;  // fields of the rows in the current batch
+};
+
+#endif  // MINISQL_SEQ_SCAN_EXECUTOR_H
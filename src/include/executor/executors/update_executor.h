@@ -0,0 +1,50 @@
+#ifndef MINISQL_UPDATE_EXECUTOR_H
+#define MINISQL_UPDATE_EXECUTOR_H
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "catalog/indexes.h"
+#include "catalog/table.h"
+#include "executor/executors/abstract_executor.h"
+
+/**
+ * UpdateExecutor sets column update_columns[i] to update_values[i] in every row produced by its child,
+ * maintains the indexes whose key changes, and produces the updated rows.
+ * A row that no longer fits in its page is moved to another page, then all indexes point to its new rid.
+ * 新的key在唯一索引中已经存在时，停止执行并置status为DB_FAILED，调用者负责回滚已经更新的row
+ */
+class UpdateExecutor : public AbstractExecutor {
+public:
+  UpdateExecutor(std::unique_ptr<AbstractExecutor> child, TableInfo *table_info, std::vector<IndexInfo *> indexes,
+                 std::vector<uint32_t> update_columns, std::vector<Field> update_values, Transaction *txn)
+      : child_(std::move(child)),
+        table_info_(table_info),
+        indexes_(std::move(indexes)),
+        update_columns_(std::move(update_columns)),
+        update_values_(std::move(update_values)),
+        txn_(txn) {}
+
+  void Init() override;
+
+  bool Next(std::vector<Row> *batch) override;
+
+private:
+  /**
+   * Update one row, the row is locked and read again first
+   * @return false if the row is gone (deleted by someone else) or an error happened (status_ is set)
+   */
+  bool UpdateRow(const RowId &rid, std::vector<Row> *batch);
+
+  std::unique_ptr<AbstractExecutor> child_;
+  TableInfo *table_info_;
+  std::vector<IndexInfo *> indexes_;
+  std::vector<uint32_t> update_columns_;
+  std::vector<Field> update_values_;
+  Transaction *txn_;
+  std::vector<Row> child_batch_;
+  std::unordered_set<int64_t> moved_rids_;  // new rids of moved rows, the scan below may reach them again
+};
+
+#endif  // MINISQL_UPDATE_EXECUTOR_H
@@ -0,0 +1,104 @@
+#ifndef MINISQL_OPTIMIZER_H
+#define MINISQL_OPTIMIZER_H
+
+#include <string>
+#include <vector>
+
+#include "catalog/indexes.h"
+#include "catalog/statistics.h"
+#include "catalog/table.h"
+#include "executor/executors/index_scan_executor.h"
+
+/**
+ * ScanCondition is a condition "column op literal" of a WHERE clause
+ */
+struct ScanCondition {
+  uint32_t column_index_;
+  std::string op_;
+  const char *literal_;  // nullptr for null
+};
+
+/**
+ * AccessPath is how the rows of a table are read: a sequential scan if lookups_ is empty, otherwise an index
+ * scan (union over clauses of the intersection of the lookups in each clause)
+ */
+struct AccessPath {
+  std::vector<std::vector<IndexLookup>> lookups_;
+  double rows_{0};  // estimated number of rows read from the table
+  double cost_{0};
+};
+
+/**
+ * Optimizer chooses the access path of a WHERE clause (OR of ANDs of ScanConditions) by cost: a sequential
+ * scan, one index, the intersection of several indexes for an AND, or the union of indexes for an OR.
+ *
+ * 选择率来自ANALYZE收集的统计信息，没有统计信息时用默认值。所有索引都是唯一的，所以索引的所有列都等值时最多一行。
+ * 代价以顺序读一行为单位：通过RowId读一行是随机读，比顺序读贵；每次索引查找有一次从根到叶子的开销，
+ * 取出的每个RowId也有一点开销（求交集并集时要排序）。
+ */
+class Optimizer {
+public:
+  static constexpr double SEQ_ROW_COST = 1.0;
+  static constexpr double FETCH_ROW_COST = 4.0;
+  static constexpr double INDEX_LOOKUP_COST = 10.0;
+  static constexpr double INDEX_ROW_COST = 0.2;
+  /** used without statistics */
+  static constexpr double DEFAULT_ROW_COUNT = 1000;
+  static constexpr double DEFAULT_EQUAL_SELECTIVITY = 0.005;
+  static constexpr double DEFAULT_RANGE_SELECTIVITY = 1.0 / 3;
+  static constexpr double DEFAULT_BOUNDED_RANGE_SELECTIVITY = 0.05;
+
+  /**
+   * @param statistics nullptr if the table has not been analyzed
+   */
+  Optimizer(TableInfo *table_info, std::vector<IndexInfo *> indexes, const TableStatistics *statistics)
+      : table_info_(table_info), indexes_(std::move(indexes)), statistics_(statistics) {}
+
+  AccessPath ChooseAccessPath(const std::vector<std::vector<ScanCondition>> &conditions) const;
+
+  /**
+   * Estimated fraction of rows that satisfy condition
+   */
+  double Selectivity(const ScanCondition &condition) const;
+
+  /**
+   * Estimated fraction of rows that satisfy both lower (">" or ">=") and upper ("<" or "<=") on the same column
+   */
+  double RangeSelectivity(const ScanCondition &lower, const ScanCondition &upper) const;
+
+private:
+  /**
+   * A lookup of one index that can be used for a clause
+   */
+  struct Candidate {
+    IndexInfo *index_;
+    std::vector<const ScanCondition *> conditions_;  // one condition for every key column
+    double selectivity_;
+    const ScanCondition *upper_{nullptr};  // upper bound of a bounded range, conditions_[0] is the lower bound
+  };
+
+  /**
+   * The cheapest index access for an AND clause: the most selective index, intersected with the next ones
+   * as long as that is cheaper
+   * @return false if no index can be used for the clause
+   */
+  bool ChooseClauseLookups(const std::vector<ScanCondition> &clause, std::vector<IndexLookup> *lookups,
+                           double *rows, double *cost) const;
+
+  std::vector<Candidate> FindCandidates(const std::vector<ScanCondition> &clause) const;
+
+  IndexLookup MakeLookup(const Candidate &candidate) const;
+
+  /**
+   * Append the literal of condition, converted to the type of its column, to key
+   */
+  void AppendKey(const ScanCondition &condition, std::vector<Field> *key) const;
+
+  double GetRowCount() const;
+
+  TableInfo *table_info_;
+  std::vector<IndexInfo *> indexes_;
+  const TableStatistics *statistics_;
+};
+
+#endif  // MINISQL_OPTIMIZER_H
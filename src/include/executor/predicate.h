@@ -0,0 +1,80 @@
+#ifndef MINISQL_PREDICATE_H
+#define MINISQL_PREDICATE_H
+
+#include <string>
+#include <vector>
+
+#include "record/row.h"
+#include "record/row_view.h"
+
+/**
+ * Predicate is a WHERE clause bound to the columns of a table: an OR of clauses, each clause an AND
+ * of comparisons "column op constant".
+ *
+ * 绑定时就把常量解析好，并按比较符和列类型选好比较函数（模板实例化），
+ * 所以每一行只需要取field、调用一次比较函数，不再比较比较符字符串，也不再stoi/atof和构造临时Field
+ */
+class Predicate {
+public:
+  /**
+   * Start a new clause, it is ORed with the previous ones
+   */
+  void AddClause();
+
+  /**
+   * AND "column op literal" to the last clause
+   * @param op one of "=", "<>", "<", "<=", ">", ">=", "is" (is null) and "not" (not null)
+   * @param literal the constant as written in the sql, ignored by "is" and "not"
+   * @return false if op is unknown
+   */
+  bool AddComparison(uint32_t column_index, TypeId type, const std::string &op, const char *literal);
+
+  /**
+   * @return whether the row satisfies the predicate, a comparison with a null field is not satisfied
+   */
+  bool Evaluate(const Row &row) const;
+
+  /**
+   * Evaluate the predicate on a row in place, the fields are read from the serialized bytes without copying
+   */
+  bool Evaluate(const RowView &row) const;
+
+  inline bool operator()(const Row &row) const { return Evaluate(row); }
+
+  inline bool Empty() const { return clauses_.empty(); }
+
+private:
+  struct Comparison;
+  using CompareFunc = bool (*)(const Field &field, const Comparison &comparison);
+
+  struct Comparison {
+    uint32_t column_index_;
+    CompareFunc compare_;
+    /** 解析好的常量，只有和列类型对应的那个有意义 */
+    int32_t int_{0};
+    float float_{0};
+    std::string chars_;
+  };
+
+  template <typename Op>
+  static bool CompareInt(const Field &field, const Comparison &comparison);
+
+  template <typename Op>
+  static bool CompareFloat(const Field &field, const Comparison &comparison);
+
+  template <typename Op>
+  static bool CompareChar(const Field &field, const Comparison &comparison);
+
+  static bool IsNull(const Field &field, const Comparison &comparison);
+
+  static bool IsNotNull(const Field &field, const Comparison &comparison);
+
+  static bool Never(const Field &field, const Comparison &comparison);
+
+  template <typename Op>
+  static CompareFunc ForType(TypeId type);
+
+  std::vector<std::vector<Comparison>> clauses_;
+};
+
+#endif  // MINISQL_PREDICATE_H
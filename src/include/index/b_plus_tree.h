@@ -1,10 +1,14 @@
 #ifndef MINISQL_B_PLUS_TREE_H
 #define MINISQL_B_PLUS_TREE_H
 
+#include <deque>
+#include <fstream>
+#include <functional>
 #include <queue>
 #include <string>
 #include <vector>
 
+#include "common/rwlatch.h"
 #include "page/b_plus_tree_internal_page.h"
 #include "page/b_plus_tree_leaf_page.h"
 #include "page/b_plus_tree_page.h"
@@ -22,6 +26,13 @@
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
+ *
+ * 并发控制使用latch crabbing：从根往下走时先给孩子加latch，再视情况释放祖先的latch，
+ * root_page_id_由root_latch_保护，可以看作根节点之上的一个虚拟节点。
+ * - 查找：一路加读latch，拿到孩子的latch后立即释放父亲。
+ * - 插入/删除先乐观地走一遍：内部节点加读latch，只给叶子加写latch，叶子不会分裂/合并时直接修改叶子；
+ *   否则释放所有latch，悲观地重来一遍：一路加写latch，孩子安全（插入不会分裂、删除不会合并/借节点）时释放所有祖先。
+ * 被合并掉的page在释放完所有latch之后才删除。Iterator在叶子之间移动时不加latch，和写操作并发的range scan不受保护。
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTree {
@@ -44,6 +55,25 @@ public:
   // return the value associated with a given key
   bool GetValue(const KeyType &key, std::vector<ValueType> &result, Transaction *transaction = nullptr);
 
+  /**
+   * Append the values of all keys between lower and upper to result, in key order.
+   * Descends once to the first leaf in the range and walks the leaf chain until upper is passed.
+   * @param lower nullptr if the range has no lower bound
+   * @param upper nullptr if the range has no upper bound
+   * @return false if a leaf could not be fetched into the buffer pool, result then holds the values found before it
+   */
+  bool ScanRange(const KeyType *lower, bool lower_inclusive, const KeyType *upper, bool upper_inclusive,
+                 std::vector<ValueType> &result, Transaction *transaction = nullptr);
+
+  /**
+   * Build an empty tree bottom-up from count entries sorted by key without duplicates.
+   * Pages of the same level get (almost) the same number of entries, about fill_factor of their max size.
+   * @param next called count times, writes the next entry in key order
+   * @return false if the tree is not empty
+   */
+  bool BulkLoad(size_t count, const std::function<void(KeyType *, ValueType *)> &next,
+                double fill_factor = INDEX_FILL_FACTOR);
+
   INDEXITERATOR_TYPE Begin();
 
   INDEXITERATOR_TYPE Begin(const KeyType &key);
@@ -51,6 +81,7 @@ public:
   INDEXITERATOR_TYPE End();
 
   // expose for test purpose
+  // the returned leaf page is pinned but not latched
   Page *FindLeafPage(const KeyType &key, bool leftMost = false);
 
   // used to check whether all pages are unpinned
@@ -71,25 +102,89 @@ public:
   }
 
 private:
+  enum class Operation { kRead, kInsert, kRemove };
+
+  /**
+   * Latches held by one operation on the tree
+   */
+  struct LatchContext {
+    LatchContext(Operation op, bool optimistic) : op_(op), optimistic_(optimistic) {}
+
+    Operation op_;
+    bool optimistic_;                        // only the leaf is write latched
+    bool root_latched_{false};               // root_latch_ is held
+    std::deque<Page *> pages_;               // latched and pinned pages, from top to bottom
+    std::vector<page_id_t> deleted_pages_;   // deleted after all latches are released
+  };
+
+  /**
+   * Descend from the root to the leaf page containing key, crabbing latches as described above.
+   * When the tree is empty, returns nullptr with root_latch_ still held.
+   * @return the leaf page, latched and pinned, it is the last page of ctx->pages_
+   */
+  Page *FindLeafPage(const KeyType &key, bool leftMost, LatchContext *ctx);
+
+  /**
+   * @return true if the operation on node will not split / merge it, so latches above it can be released
+   */
+  bool IsSafe(BPlusTreePage *node, Operation op) const;
+
+  bool IsWriteLatched(Page *page, LatchContext *ctx) const;
+
+  /**
+   * Release root_latch_ and all pages in ctx except the last one, none of them are modified
+   */
+  void ReleaseAncestors(LatchContext *ctx);
+
+  /**
+   * Release all latches and pins held in ctx, then delete the pages in ctx->deleted_pages_
+   */
+  void ReleaseLatches(LatchContext *ctx, bool is_dirty);
+
+  /**
+   * A level of the tree being bulk loaded, its pages are filled from left to right
+   */
+  struct BulkLevel {
+    // number of entries of the current page when it is full, sizes of all pages differ by at most one
+    int PageSize() const { return entry_count_ / page_count_ + (page_index_ < entry_count_ % page_count_ ? 1 : 0); }
+
+    size_t page_count_;
+    size_t entry_count_;               // children for internal pages
+    size_t page_index_{0};
+    int filled_{0};                    // entries in the current page
+    BPlusTreePage *page_{nullptr};     // the current page, pinned
+  };
+
+  /**
+   * @return the number of pages and entries of every level, from the leaves up to the root
+   */
+  std::vector<BulkLevel> PlanBulkLoad(size_t count, double fill_factor) const;
+
+  /**
+   * Start the next page of the level, key is the smallest key under it
+   */
+  void NewBulkPage(std::vector<BulkLevel> *levels, size_t level, const KeyType &key);
+
+  /**
+   * Add the child page to the current page of level, starting a new page if it is full
+   */
+  void AppendBulkChild(std::vector<BulkLevel> *levels, size_t level, const KeyType &key, BPlusTreePage *child);
+
   void StartNewTree(const KeyType &key, const ValueType &value);
 
-  bool InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
+  void InsertIntoLeaf(LeafPage *leaf, const KeyType &key, const ValueType &value, LatchContext *ctx);
 
-  void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
-                        Transaction *transaction = nullptr);
+  void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node, LatchContext *ctx);
 
   template<typename N>
   N *Split(N *node);
 
-  template <typename N>
-  void UpdateParentKey(N* node);
-
   template<typename N>
-  bool CoalesceOrRedistribute(N *node, Transaction *transaction = nullptr);
+  bool CoalesceOrRedistribute(N *node, LatchContext *ctx);
 
   template<typename N>
   bool Coalesce(N *neighbor_node, N *node, BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *parent,
-                int index, Transaction *transaction = nullptr);
+                int index, LatchContext *ctx);
 
   template<typename N>
   void Redistribute(N *neighbor_node, N *node, int index);
@@ -106,6 +201,7 @@ private:
   // member variable
   index_id_t index_id_;
   page_id_t root_page_id_;
+  ReaderWriterLatch root_latch_;  // protects root_page_id_
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
   int leaf_max_size_;
@@ -1,6 +1,8 @@
 #ifndef MINISQL_B_PLUS_TREE_INDEX_H
 #define MINISQL_B_PLUS_TREE_INDEX_H
 
+#include <cstdio>
+
 #include "index/b_plus_tree.h"
 #include "index/index.h"
 
@@ -9,7 +11,8 @@
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
 public:
-  BPlusTreeIndex(index_id_t index_id, IndexSchema *key_schema, BufferPoolManager *buffer_pool_manager);
+  BPlusTreeIndex(index_id_t index_id, IndexSchema *key_schema, BufferPoolManager *buffer_pool_manager,
+                 LogManager *log_manager = nullptr);
 
   dberr_t InsertEntry(const Row &key, RowId row_id, Transaction *txn) override;
 
@@ -17,8 +20,17 @@ public:
 
   dberr_t ScanKey(const Row &key, std::vector<RowId> &result, Transaction *txn, string condition) override;
 
+  dberr_t ScanRange(const Row *lower, bool lower_inclusive, const Row *upper, bool upper_inclusive,
+                    std::vector<RowId> &result, Transaction *txn) override;
+
+  dberr_t BulkLoad(const std::function<bool(std::vector<Field> *, RowId *)> &next, double fill_factor,
+                   std::vector<RowId> *duplicates) override;
+
   dberr_t Destroy() override;
 
+  // expose for test purpose
+  void SetSortMemory(size_t sort_memory) { sort_memory_ = sort_memory; }
+
   INDEXITERATOR_TYPE GetBeginIterator();
 
   INDEXITERATOR_TYPE GetBeginIterator(const KeyType &key);
@@ -26,10 +38,32 @@ public:
   INDEXITERATOR_TYPE GetEndIterator();
 
 protected:
+  /**
+   * An index entry being sorted by BulkLoad, runs that do not fit in memory are written to temporary files as is
+   */
+  struct BulkEntry {
+    KeyType key_;
+    ValueType value_;
+  };
+
+  /**
+   * Merge the sorted runs into out, keeping only the first entry (in the order of runs) of every key
+   * @return the number of entries written, or -1 if a temporary file can not be written
+   */
+  int64_t MergeRuns(const std::vector<FILE *> &runs, FILE *out, std::vector<RowId> *duplicates);
+
+  /**
+   * Add count sorted entries without duplicates to the tree, bottom-up if it is empty
+   */
+  void LoadSorted(size_t count, const std::function<void(KeyType *, ValueType *)> &next, double fill_factor,
+                  std::vector<RowId> *duplicates);
+
   // comparator for key
   KeyComparator comparator_;
   // container
   BPLUSTREE_TYPE container_;
+  // bytes of entries BulkLoad sorts in memory
+  size_t sort_memory_{INDEX_SORT_MEMORY};
 };
 
 #endif //MINISQL_B_PLUS_TREE_INDEX_H
@@ -6,22 +6,117 @@
 #include "record/row.h"
 #include "record/field.h"
 
+/**
+ * 索引键采用可直接memcmp比较的字节编码（按key schema的列顺序依次排列）:
+ * | null flag(1) | value | null flag(1) | value | ...
+ * null flag: 0x00表示null（没有value部分）, 0x01表示非null, 所以null排在所有非null值的前面
+ * int:   符号位取反后按big-endian写入4字节
+ * float: 非负数只翻转符号位，负数翻转全部位，然后按big-endian写入4字节
+ * char:  原始字节后跟一个'\0'结束符（字符串本身不含'\0'），短串自然排在其前缀相同的长串之前
+ * 剩余未使用的空间全部为0
+ */
+
+/**
+ * @return 按schema编码一个key最多需要的字节数
+ */
+inline uint32_t GetEncodedKeySize(Schema *schema) {
+  uint32_t size = 0;
+  for (auto column : schema->GetColumns()) {
+    size += 1 + column->GetLength() + (column->GetType() == TypeId::kTypeChar ? 1 : 0);
+  }
+  return size;
+}
+
 template<size_t KeySize>
 class GenericKey {
 public:
   inline void SerializeFromKey(const Row &key, Schema *schema) {
     // initialize to 0
-    uint32_t size = key.GetSerializedSize(schema);
     ASSERT(key.GetFieldCount() == schema->GetColumnCount(), "field nums not match.");
-    ASSERT(size <= KeySize, "Index key size exceed max key size.");
     memset(data, 0, KeySize);
-    key.SerializeTo(data, schema);
+    char *buf = data;
+    for (uint32_t i = 0; i < schema->GetColumnCount(); i++) {
+      const Column *column = schema->GetColumn(i);
+      Field *field = key.GetField(i);
+      if (field->IsNull()) {
+        ASSERT(buf + 1 <= data + KeySize, "Index key size exceed max key size.");
+        buf++;
+        continue;
+      }
+      uint32_t width = column->GetType() == TypeId::kTypeChar ? field->GetLength() + 1 : sizeof(uint32_t);
+      ASSERT(buf + 1 + width <= data + KeySize, "Index key size exceed max key size.");
+      *buf++ = 0x01;
+      switch (column->GetType()) {
+        case TypeId::kTypeInt:
+          EncodeUint32(buf, static_cast<uint32_t>(field->GetInt()) ^ 0x80000000u);
+          break;
+        case TypeId::kTypeFloat: {
+          uint32_t bits;
+          // -0.0和0.0视为相同的键
+          float value = field->GetFloat() == 0.0f ? 0.0f : field->GetFloat();
+          memcpy(&bits, &value, sizeof(bits));
+          bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+          EncodeUint32(buf, bits);
+          break;
+        }
+        case TypeId::kTypeChar:
+          // 结束符'\0'已经由memset写好
+          memcpy(buf, field->GetChars(), width - 1);
+          break;
+        default:
+          ASSERT(false, "Unsupported key type.");
+      }
+      buf += width;
+    }
   }
 
   inline void DeserializeToKey(Row &key, Schema *schema) const {
-    uint32_t ofs = key.DeserializeFrom(const_cast<char *>(data), schema);
-    ASSERT(ofs <= KeySize, "Index key size exceed max key size.");
-    return;
+    // 先还原成Row的序列化格式，再交给Row::DeserializeFrom
+    // 每一列至少占一个null flag字节，所以列数不超过KeySize，缓冲区大小在编译期就能确定
+    uint32_t column_count = schema->GetColumnCount();
+    ASSERT(column_count <= KeySize, "Index key has more columns than bytes.");
+    uint32_t bitmap_size = (column_count + 7) / 8;
+    char row_buf[KeySize + sizeof(uint32_t) * (KeySize + 1) + (KeySize + 7) / 8];
+    memset(row_buf, 0, sizeof(row_buf));
+    MACH_WRITE_UINT32(row_buf, column_count);
+    char *bitmap = row_buf + sizeof(uint32_t);
+    char *out = bitmap + bitmap_size;
+    const char *in = data;
+    for (uint32_t i = 0; i < column_count; i++) {
+      const Column *column = schema->GetColumn(i);
+      if (*in++ == 0) {
+        continue;
+      }
+      bitmap[i / 8] |= static_cast<char>(0x01 << (7 - i % 8));
+      switch (column->GetType()) {
+        case TypeId::kTypeInt: {
+          int32_t value = static_cast<int32_t>(DecodeUint32(in) ^ 0x80000000u);
+          MACH_WRITE_TO(int32_t, out, value);
+          out += sizeof(int32_t);
+          in += sizeof(int32_t);
+          break;
+        }
+        case TypeId::kTypeFloat: {
+          uint32_t bits = DecodeUint32(in);
+          bits = (bits & 0x80000000u) ? (bits & 0x7fffffffu) : ~bits;
+          memcpy(out, &bits, sizeof(bits));
+          out += sizeof(float);
+          in += sizeof(float);
+          break;
+        }
+        case TypeId::kTypeChar: {
+          uint32_t len = strnlen(in, data + KeySize - in);
+          MACH_WRITE_UINT32(out, len);
+          memcpy(out + sizeof(uint32_t), in, len);
+          out += sizeof(uint32_t) + len;
+          in += len + 1;
+          break;
+        }
+        default:
+          ASSERT(false, "Unsupported key type.");
+      }
+    }
+    key.DeserializeFrom(row_buf, schema);
   }
 
   // compare
@@ -44,6 +139,20 @@ public:
 
   // actual location of data, extends past the end.
   char data[KeySize];
+
+private:
+  static inline void EncodeUint32(char *buf, uint32_t value) {
+    buf[0] = static_cast<char>(value >> 24);
+    buf[1] = static_cast<char>(value >> 16);
+    buf[2] = static_cast<char>(value >> 8);
+    buf[3] = static_cast<char>(value);
+  }
+
+  static inline uint32_t DecodeUint32(const char *buf) {
+    auto ubuf = reinterpret_cast<const unsigned char *>(buf);
+    return (static_cast<uint32_t>(ubuf[0]) << 24) | (static_cast<uint32_t>(ubuf[1]) << 16) |
+           (static_cast<uint32_t>(ubuf[2]) << 8) | static_cast<uint32_t>(ubuf[3]);
+  }
 };
 
 /**
@@ -52,32 +161,10 @@ public:
 template<size_t KeySize>
 class GenericComparator {
 public:
+  // 键已经是字节序可比较的编码，直接memcmp即可，不需要反序列化
   inline int operator()(const GenericKey<KeySize> &lhs,
                         const GenericKey<KeySize> &rhs) const {
-    int column_count = key_schema_->GetColumnCount();
-    Row lhs_key(INVALID_ROWID);
-    Row rhs_key(INVALID_ROWID);
-    lhs.DeserializeToKey(lhs_key, key_schema_);
-    rhs.DeserializeToKey(rhs_key, key_schema_);
-    // beet：防止反序列化出空的row导致错误
-    if (lhs_key.GetFields().size() != rhs_key.GetFields().size()) {
-      return -1;
-    }
-    if (lhs_key.GetFields().size() == 0) {
-      return 0;
-    }
-    for (int i = 0; i < column_count; i++) {
-      Field *lhs_value = lhs_key.GetField(i);
-      Field *rhs_value = rhs_key.GetField(i);
-
-      if (lhs_value->CompareLessThan(*rhs_value) == CmpBool::kTrue)
-        return -1;
-
-      if (lhs_value->CompareGreaterThan(*rhs_value) == CmpBool::kTrue)
-        return 1;
-    }
-    // equals
-    return 0;
+    return memcmp(lhs.data, rhs.data, KeySize);
   }
 
   GenericComparator(const GenericComparator &other) {
@@ -1,16 +1,19 @@
 #ifndef MINISQL_INDEX_H
 #define MINISQL_INDEX_H
 
+#include <functional>
 #include <memory>
+#include <string>
 
 #include "common/dberr.h"
 #include "record/row.h"
+#include "transaction/log_manager.h"
 #include "transaction/transaction.h"
 
 class Index {
 public:
-  explicit Index(index_id_t index_id, IndexSchema *key_schema)
-          : index_id_(index_id), key_schema_(key_schema) {}
+  explicit Index(index_id_t index_id, IndexSchema *key_schema, LogManager *log_manager = nullptr)
+          : index_id_(index_id), key_schema_(key_schema), log_manager_(log_manager) {}
 
   virtual ~Index() {}
 
@@ -18,13 +21,53 @@ public:
 
   virtual dberr_t RemoveEntry(const Row &key, RowId row_id, Transaction *txn) = 0;
 
-  virtual dberr_t ScanKey(const Row &key, std::vector<RowId> &result, Transaction *txn, string condition) = 0;
+  virtual dberr_t ScanKey(const Row &key, std::vector<RowId> &result, Transaction *txn, std::string condition) = 0;
+
+  /**
+   * Append the row ids of all keys between lower and upper to result, in key order
+   * @param lower nullptr if the range has no lower bound
+   * @param upper nullptr if the range has no upper bound
+   */
+  virtual dberr_t ScanRange(const Row *lower, bool lower_inclusive, const Row *upper, bool upper_inclusive,
+                            std::vector<RowId> &result, Transaction *txn) = 0;
+
+  /**
+   * Add many (key, row id) pairs at once, in any order. An empty index is built from them bottom-up,
+   * otherwise they are inserted in key order. Pairs whose key is already in the index or comes earlier are dropped.
+   * Changes are not part of any transaction.
+   * @param next writes the key fields and the row id of the next pair, returns false when there are no more pairs
+   * @param fill_factor fraction of every index page to fill when the index is built from scratch
+   * @param duplicates if not nullptr, row ids of the dropped pairs are appended to it
+   */
+  virtual dberr_t BulkLoad(const std::function<bool(std::vector<Field> *, RowId *)> &next, double fill_factor,
+                           std::vector<RowId> *duplicates) = 0;
 
   virtual dberr_t Destroy() = 0;
 
+protected:
+  /**
+   * Remember an insert / delete of the key in the write set of txn so that it can be rolled back,
+   * and log it so that recovery can undo it if txn never finishes
+   */
+  void RecordIndexWrite(LogRecordType type, const Row &key, RowId row_id, Transaction *txn) {
+    if (txn == nullptr) {
+      return;
+    }
+    txn->GetIndexWriteSet().emplace_back(row_id, type == LogRecordType::kIndexInsert ? WType::kInsert : WType::kDelete,
+                                         key, this);
+    if (log_manager_ == nullptr) {
+      return;
+    }
+    std::string buf(key.GetSerializedSize(key_schema_), '\0');
+    key.SerializeTo(buf.data(), key_schema_);
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), type, index_id_, row_id, buf.data(), buf.size());
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+  }
+
 protected:
   index_id_t index_id_;
   IndexSchema *key_schema_;
+  LogManager *log_manager_;
 };
 
 #endif //MINISQL_INDEX_H
@@ -34,6 +34,8 @@ public:
 
   ValueType ValueAt(int index) const;
 
+  void SetValueAt(int index, const ValueType &value);
+
   ValueType Lookup(const KeyType &key, const KeyComparator &comparator) const;
 
   void PopulateNewRoot(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value);
@@ -46,6 +46,9 @@ public:
 
   int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
 
+  // first index i so that array_[i].first >= key, GetSize() if there is none
+  int LowerBound(const KeyType &key, const KeyComparator &comparator) const;
+
   const MappingType &GetItem(int index);
 
   // insert and delete methods
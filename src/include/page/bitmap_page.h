@@ -20,6 +20,12 @@ public:
    */
   bool AllocatePage(uint32_t &page_offset);
 
+  /**
+   * Allocate a specific page, used to redo an allocation
+   * @return true if the page was free
+   */
+  bool AllocatePageAt(uint32_t page_offset);
+
   /**
    * @return true if successfully de-allocate a page.
    */
@@ -44,13 +50,19 @@ private:
    */
   bool IsPageFreeLow(uint32_t byte_index, uint8_t bit_index) const;
 
+  /**
+   * Find the first free page from page_offset and make it next_free_page_ (MAX_CHARS * 8 if there is none).
+   * 按字节跳过全满的8个页
+   */
+  void FindNextFreePage(uint32_t page_offset);
+
   /** Note: need to update if modify page structure. */
   static constexpr size_t MAX_CHARS = PageSize - 2 * sizeof(uint32_t);
 
 private:
   /** The space occupied by all members of the class should be equal to the PageSize */
   [[maybe_unused]] uint32_t page_allocated_;
-  [[maybe_unused]] uint32_t next_free_page_;
+  [[maybe_unused]] uint32_t next_free_page_;       // 它前面的页都已经分配了
   [[maybe_unused]] unsigned char bytes[MAX_CHARS];
 };
 
@@ -5,10 +5,17 @@
 
 #include "page/bitmap_page.h"
 
-static constexpr page_id_t MAX_VALID_PAGE_ID = (PAGE_SIZE - 8) / 4 * BitmapPage<PAGE_SIZE>::GetMaxSupportedSize();
-
+/**
+ * Format (size in byte):
+ *  ------------------------------------------------------------------------------------
+ * | AllocatedPages (4) | Extents (4) | ExtentUsedPage_1 (4) | ... | ExtentUsedPage_n (4) |
+ *  ------------------------------------------------------------------------------------
+ * 整页都是extent表，页大小和缓冲池大小记在catalog meta里（见CatalogMeta）
+ */
 class DiskFileMetaPage {
 public:
+  static constexpr uint32_t MAX_EXTENT_NUMS = (PAGE_SIZE - 8) / 4;
+
   uint32_t GetExtentNums() {
     return num_extents_;
   }
@@ -30,4 +37,7 @@ public:
   uint32_t extent_used_page_[0];
 };
 
+static constexpr page_id_t MAX_VALID_PAGE_ID =
+    DiskFileMetaPage::MAX_EXTENT_NUMS * BitmapPage<PAGE_SIZE>::GetMaxSupportedSize();
+
 #endif //MINISQL_DISK_FILE_META_PAGE_H
@@ -0,0 +1,66 @@
+#ifndef MINISQL_FREE_SPACE_MAP_PAGE_H
+#define MINISQL_FREE_SPACE_MAP_PAGE_H
+
+#include <cstdint>
+
+#include "common/config.h"
+
+/**
+ * FreeSpaceMapPage records the free space of a run of table pages, the free space map of a table heap
+ * is a chain of these pages.
+ *
+ * Format (size in byte):
+ *  ---------------------------------------------------------------------------------------------------
+ * | Magic (4) | NextPageId (4) | Count (4) | PageId_1 (4) | ... | PageId_n (4) | Bucket_1 (1) | ... |
+ *  ---------------------------------------------------------------------------------------------------
+ * 页号和桶号分开存放，每个表页只占5个字节。magic不对时说明这一页还没写回过磁盘（比如崩溃了），当作空页处理
+ */
+class FreeSpaceMapPage {
+public:
+  static constexpr uint32_t MAX_ENTRY_COUNT = (PAGE_SIZE - 12) / (sizeof(page_id_t) + 1);
+
+  void Init() {
+    magic_num_ = FREE_SPACE_MAP_PAGE_MAGIC_NUM;
+    next_page_id_ = INVALID_PAGE_ID;
+    count_ = 0;
+  }
+
+  bool IsValid() const { return magic_num_ == FREE_SPACE_MAP_PAGE_MAGIC_NUM && count_ <= MAX_ENTRY_COUNT; }
+
+  page_id_t GetNextPageId() const { return next_page_id_; }
+
+  void SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+  uint32_t GetCount() const { return count_; }
+
+  bool IsFull() const { return count_ == MAX_ENTRY_COUNT; }
+
+  page_id_t GetPageId(uint32_t index) const { return page_ids_[index]; }
+
+  uint8_t GetBucket(uint32_t index) const { return GetBuckets()[index]; }
+
+  void SetBucket(uint32_t index, uint8_t bucket) { GetBuckets()[index] = bucket; }
+
+  /**
+   * @return the index of the new entry
+   */
+  uint32_t Append(page_id_t page_id, uint8_t bucket) {
+    page_ids_[count_] = page_id;
+    GetBuckets()[count_] = bucket;
+    return count_++;
+  }
+
+private:
+  static constexpr uint32_t FREE_SPACE_MAP_PAGE_MAGIC_NUM = 20220613;
+
+  uint8_t *GetBuckets() const {
+    return reinterpret_cast<uint8_t *>(const_cast<page_id_t *>(page_ids_) + MAX_ENTRY_COUNT);
+  }
+
+  uint32_t magic_num_;
+  page_id_t next_page_id_;
+  uint32_t count_;
+  page_id_t page_ids_[0];
+};
+
+#endif  // MINISQL_FREE_SPACE_MAP_PAGE_H
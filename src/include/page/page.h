@@ -76,6 +76,13 @@ private:
   int pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
   bool is_dirty_ = false;
+  // lsn of the last log record describing this frame, the frame can not be written back before the log is durable
+  // up to it. Kept outside data_ because not every page type reserves OFFSET_LSN
+  lsn_t log_lsn_ = INVALID_LSN;
+  // lsn of the first log record since the frame was last written back (recLSN), INVALID_LSN if the frame is clean
+  lsn_t rec_lsn_ = INVALID_LSN;
+  // read ahead for a sequential scan, goes to the cold end of the replacer until it is evicted or modified
+  bool cold_ = false;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
@@ -12,9 +12,12 @@
  *  ----------------------------------------------------------------------------
  *  | PageId (4)| LSN (4)| PrevPageId (4)| NextPageId (4)| FreeSpacePointer(4) |
  *  ----------------------------------------------------------------------------
- *  ----------------------------------------------------------------
- *  | TupleCount (4) | Tuple_1 offset (4) | Tuple_1 size (4) | ... |
- *  ----------------------------------------------------------------
+ *  ------------------------------------------------------------------------------------------------------
+ *  | TupleCount (4) | FreeSlot (4) | FragmentedSize (4) | Tuple_1 offset (4) | Tuple_1 size (4) | ... |
+ *  ------------------------------------------------------------------------------------------------------
+ *
+ *  空slot（size为0）的offset字段存下一个空slot的编号，FreeSlot是这条链的头，插入时直接取链头，不用扫描slot数组。
+ *  ApplyDelete只把tuple占的空间记进FragmentedSize，不立即搬动数据；空闲区不够但加上碎片够用时才调用Compact整理。
  **/
 
 #include <cstring>
@@ -22,6 +25,7 @@
 #include "common/rowid.h"
 #include "page/page.h"
 #include "record/row.h"
+#include "record/row_view.h"
 #include "transaction/lock_manager.h"
 #include "transaction/log_manager.h"
 #include "transaction/transaction.h"
@@ -44,7 +48,13 @@ public:
     memcpy(GetData() + OFFSET_NEXT_PAGE_ID, &next_page_id, sizeof(page_id_t));
   }
 
-  bool InsertTuple(Row &row, Schema *schema, Transaction *txn, LockManager *lock_manager, LogManager *log_manager);
+  /**
+   * Insert the row into this page, the caller must hold the page's write latch.
+   * @param wait_rid if the slot's row lock is held by another transaction, it is set to the slot's rid and false is
+   * returned. The caller should release the latch, wait for the lock and retry
+   */
+  bool InsertTuple(Row &row, Schema *schema, Transaction *txn, LockManager *lock_manager, LogManager *log_manager,
+                   RowId *wait_rid = nullptr);
 
   bool MarkDelete(const RowId &rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager);
 
@@ -55,12 +65,44 @@ public:
 
   void RollbackDelete(const RowId &rid, Transaction *txn, LogManager *log_manager);
 
+  /**
+   * Put a deleted tuple back into its (empty) slot, used to undo ApplyDelete
+   * @return false if the slot is in use or there is not enough space
+   */
+  bool RestoreTuple(const RowId &rid, const char *tuple, uint32_t tuple_size);
+
+  /**
+   * @return true if the slot holds exactly this tuple (deleted or not)
+   */
+  bool HasTuple(const RowId &rid, const char *tuple, uint32_t tuple_size);
+
   bool GetTuple(Row *row, Schema *schema, Transaction *txn, LockManager *lock_manager);
 
+  /**
+   * Point view at the tuple in slot_num without copying it, no lock is taken
+   * @return false if the slot is empty or the tuple is deleted
+   */
+  bool GetTupleView(uint32_t slot_num, Schema *schema, RowView *view);
+
+  /**
+   * @return number of slots in the page, including empty ones
+   */
+  uint32_t GetTupleCount() { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_TUPLE_COUNT); }
+
   bool GetFirstTupleRid(RowId *first_rid);
 
   bool GetNextTupleRid(const RowId &cur_rid, RowId *next_rid);
 
+  /**
+   * @return free bytes of the page, including the holes left by deleted tuples
+   */
+  uint32_t GetFreeSpaceRemaining() { return GetContiguousFreeSpace() + GetFragmentedSize(); }
+
+  /**
+   * Move all tuples to the end of the page so that the holes left by deleted tuples become one free space
+   */
+  void Compact();
+
 private:
   uint32_t GetFreeSpacePointer() { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_FREE_SPACE); }
 
@@ -68,11 +110,18 @@ private:
     memcpy(GetData() + OFFSET_FREE_SPACE, &free_space_pointer, sizeof(uint32_t));
   }
 
-  uint32_t GetTupleCount() { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_TUPLE_COUNT); }
 
   void SetTupleCount(uint32_t tuple_count) { memcpy(GetData() + OFFSET_TUPLE_COUNT, &tuple_count, sizeof(uint32_t)); }
 
-  uint32_t GetFreeSpaceRemaining() {
+  uint32_t GetFreeSlot() { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_FREE_SLOT); }
+
+  void SetFreeSlot(uint32_t slot_num) { memcpy(GetData() + OFFSET_FREE_SLOT, &slot_num, sizeof(uint32_t)); }
+
+  uint32_t GetFragmentedSize() { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_FRAGMENTED_SIZE); }
+
+  void SetFragmentedSize(uint32_t size) { memcpy(GetData() + OFFSET_FRAGMENTED_SIZE, &size, sizeof(uint32_t)); }
+
+  uint32_t GetContiguousFreeSpace() {
     return GetFreeSpacePointer() - SIZE_TABLE_PAGE_HEADER - SIZE_TUPLE * GetTupleCount();
   }
 
@@ -98,19 +147,38 @@ private:
 
   static uint32_t UnsetDeletedFlag(uint32_t tuple_size) { return static_cast<uint32_t>(tuple_size & (~DELETE_MASK)); }
 
+  /**
+   * Take slot_num out of the free slot chain, slot_num must be an empty slot
+   */
+  void RemoveFreeSlot(uint32_t slot_num);
+
+  /**
+   * Make sure there are at least size bytes of contiguous free space, compact the page if the holes are needed
+   * @return false if the page does not have enough free space at all
+   */
+  bool ReserveSpace(uint32_t size);
+
+  /**
+   * 在txn和log_manager都存在时为tuple操作追加一条逻辑日志，并更新txn的prev_lsn和page的lsn
+   */
+  void AppendTupleLog(LogRecord *log_record, Transaction *txn, LogManager *log_manager);
+
 private:
   static_assert(sizeof(page_id_t) == 4);
   static constexpr uint64_t DELETE_MASK = (1U << (8 * sizeof(uint32_t) - 1));
-  static constexpr size_t SIZE_TABLE_PAGE_HEADER = 24;
-  static constexpr size_t SIZE_TUPLE = 8;
+  static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+  static constexpr size_t SIZE_TABLE_PAGE_HEADER = 32;
   static constexpr size_t OFFSET_PREV_PAGE_ID = 8;
   static constexpr size_t OFFSET_NEXT_PAGE_ID = 12;
   static constexpr size_t OFFSET_FREE_SPACE = 16;
   static constexpr size_t OFFSET_TUPLE_COUNT = 20;
-  static constexpr size_t OFFSET_TUPLE_OFFSET = 24;
-  static constexpr size_t OFFSET_TUPLE_SIZE = 28;
+  static constexpr size_t OFFSET_FREE_SLOT = 24;
+  static constexpr size_t OFFSET_FRAGMENTED_SIZE = 28;
+  static constexpr size_t OFFSET_TUPLE_OFFSET = 32;
+  static constexpr size_t OFFSET_TUPLE_SIZE = 36;
 
 public:
+  static constexpr size_t SIZE_TUPLE = 8;  // size of a slot
   static constexpr size_t SIZE_MAX_ROW = PAGE_SIZE - SIZE_TABLE_PAGE_HEADER - SIZE_TUPLE;
 };
 
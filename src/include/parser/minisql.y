@@ -1,5 +1,6 @@
 %{
   #include <stdio.h>
+  #include <strings.h>
   #include "parser/parser.h"
 
   extern char *yytext;
@@ -7,6 +8,8 @@
   int yyerror(char* error);
 %}
 
+%define api.header.include {"parser/minisql_yacc.h"}
+
 %union {
 	pSyntaxNode syntax_node;
 }
@@ -24,10 +27,10 @@
 %type <syntax_node> column_definition_list column_definition column_type column_list
 %type <syntax_node> sql_create_index sql_drop_index sql_show_indexes
 %type <syntax_node> sql_trx_begin sql_trx_commit sql_trx_rollback
-%type <syntax_node> sql_select select_columns column_values column_value operator
+%type <syntax_node> sql_select select_columns select_limit column_values column_value operator
 %type <syntax_node> connector where_conditions where_condition
 %type <syntax_node> sql_insert sql_delete sql_update update_values update_value
-%type <syntax_node> sql_quit sql_exec_file
+%type <syntax_node> sql_quit sql_exec_file sql_analyze sql_load_data sql_set
 
 %%
 
@@ -58,6 +61,9 @@ sql:
   | sql_trx_rollback { $$ = $1; }
   | sql_quit { $$ = $1; }
   | sql_exec_file { $$ = $1; }
+  | sql_analyze { $$ = $1; }
+  | sql_load_data { $$ = $1; }
+  | sql_set { $$ = $1; }
   ;
 
 sql_create_database:
@@ -65,6 +71,16 @@ sql_create_database:
     $$ = CreateSyntaxNode(kNodeCreateDB, NULL);
     SyntaxNodeAddChildren($$, $3);
   }
+  | CREATE DATABASE IDENTIFIER IDENTIFIER EQ NUMBER {
+    // create database db buffer_pool_size = 65536，buffer_pool_size不作为关键字
+    if (strcasecmp($4->val_, "buffer_pool_size") != 0) {
+      yyerror("syntax error");
+      YYERROR;
+    }
+    $$ = CreateSyntaxNode(kNodeCreateDB, NULL);
+    SyntaxNodeAddChildren($$, $3);
+    SyntaxNodeAddChildren($$, $6);
+  }
   ;
 
 sql_drop_database:
@@ -209,6 +225,33 @@ sql_select:
     SyntaxNodeAddChildren(condition_node, $6);
     SyntaxNodeAddChildren($$, condition_node);
   }
+  | SELECT select_columns FROM IDENTIFIER select_limit {
+    $$ = CreateSyntaxNode(kNodeSelect, NULL);
+    SyntaxNodeAddChildren($$, $2);
+    SyntaxNodeAddChildren($$, $4);
+    SyntaxNodeAddChildren($$, $5);
+  }
+  | SELECT select_columns FROM IDENTIFIER WHERE where_conditions select_limit {
+    $$ = CreateSyntaxNode(kNodeSelect, NULL);
+    SyntaxNodeAddChildren($$, $2);
+    SyntaxNodeAddChildren($$, $4);
+    pSyntaxNode condition_node = CreateSyntaxNode(kNodeConditions, NULL);
+    SyntaxNodeAddChildren(condition_node, $6);
+    SyntaxNodeAddChildren($$, condition_node);
+    SyntaxNodeAddChildren($$, $7);
+  }
+  ;
+
+select_limit:
+  IDENTIFIER NUMBER {
+    // limit和analyze一样不作为关键字
+    if (strcasecmp($1->val_, "limit") != 0) {
+      yyerror("syntax error");
+      YYERROR;
+    }
+    $$ = CreateSyntaxNode(kNodeLimit, NULL);
+    SyntaxNodeAddChildren($$, $2);
+  }
   ;
 
 select_columns:
@@ -393,6 +436,40 @@ sql_exec_file:
   }
   ;
 
+sql_analyze:
+  IDENTIFIER IDENTIFIER {
+    // analyze不是关键字，避免重新生成词法分析器
+    if (strcasecmp($1->val_, "analyze") != 0) {
+      yyerror("syntax error");
+      YYERROR;
+    }
+    $$ = CreateSyntaxNode(kNodeAnalyze, NULL);
+    SyntaxNodeAddChildren($$, $2);
+  }
+  ;
+
+sql_load_data:
+  IDENTIFIER IDENTIFIER STRING INTO IDENTIFIER {
+    // load data "file.csv" into t，load和data同样不作为关键字
+    if (strcasecmp($1->val_, "load") != 0 || strcasecmp($2->val_, "data") != 0) {
+      yyerror("syntax error");
+      YYERROR;
+    }
+    $$ = CreateSyntaxNode(kNodeLoadData, NULL);
+    SyntaxNodeAddChildren($$, $3);
+    SyntaxNodeAddChildren($$, $5);
+  }
+  ;
+
+sql_set:
+  SET IDENTIFIER EQ NUMBER {
+    // set buffer_pool_size = 65536
+    $$ = CreateSyntaxNode(kNodeSet, NULL);
+    SyntaxNodeAddChildren($$, $2);
+    SyntaxNodeAddChildren($$, $4);
+  }
+  ;
+
 %%
 int yyerror(char* error) {
 	MinisqlParserSetError(error);
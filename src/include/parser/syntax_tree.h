@@ -43,7 +43,11 @@ typedef enum {
   kNodeIndexType, /** type of index */
   kNodeTrxBegin, /** begin transaction command */
   kNodeTrxCommit, /** commit transaction command */
-  kNodeTrxRollback /** rollback transaction command */
+  kNodeTrxRollback, /** rollback transaction command */
+  kNodeAnalyze, /** analyze table command */
+  kNodeLoadData, /** load data command */
+  kNodeSet, /** set variable command */
+  kNodeLimit /** limit of select */
 } SyntaxNodeType;
 
 /**
@@ -62,12 +62,13 @@ public:
   }
 
   // copy constructor
+  // char数据总是复制一份：原field可能指向row的arena或者页内的数据，拷贝出来的field要能比它们活得长
   explicit Field(const Field &other) {
     type_id_ = other.type_id_;
     len_ = other.len_;
     is_null_ = other.is_null_;
-    manage_data_ = other.manage_data_;
-    if (type_id_ == TypeId::kTypeChar && !is_null_ && manage_data_) {
+    manage_data_ = type_id_ == TypeId::kTypeChar && !is_null_;
+    if (manage_data_) {
       value_.chars_ = new char[len_+1];
       memcpy(value_.chars_, other.value_.chars_, len_);
       value_.chars_[len_] = '\0';
@@ -140,18 +141,22 @@ public:
     std::swap(first.manage_data_, second.manage_data_);
   }
 
-  inline int32_t GetInt() {
+  inline int32_t GetInt() const {
     return value_.integer_;
   }
 
-  inline float GetFloat() {
+  inline float GetFloat() const {
     return value_.float_;
   }
 
-  inline char* GetChars() {
+  inline char* GetChars() const {
     return value_.chars_;
   }
 
+  inline TypeId GetTypeId() const {
+    return type_id_;
+  }
+
 protected:
   union Val {
     int32_t integer_;
@@ -19,7 +19,8 @@
  * | Field Nums | Null bitmap |
  * -------------------------------------------
  *
- *
+ * field和char的数据都分配在heap_上：默认是row自己的ArenaMemHeap，一行只需要一两次malloc；
+ * 也可以传入外部的heap（比如executor每一批row共用一个arena），row析构时不释放，由heap的主人统一释放。
  */
 class Row {
  public:
@@ -27,11 +28,11 @@ class Row {
    * Row used for insert
    * Field integrity should check by upper level
    */
-  explicit Row(std::vector<Field> &fields) : heap_(new SimpleMemHeap) {
+  explicit Row(std::vector<Field> &fields, MemHeap *heap = nullptr) : heap_(heap != nullptr ? heap : &arena_) {
     // deep copy
+    fields_.reserve(fields.size());
     for (auto &field : fields) {
-      void *buf = heap_->Allocate(sizeof(Field));
-      fields_.push_back(new (buf) Field(field));
+      fields_.push_back(CopyField(field));
     }
   }
 
@@ -42,30 +43,33 @@ class Row {
 
   /**
    * Row used for deserialize and update
+   * @param heap where the fields are allocated, it must outlive the row, nullptr for the row's own arena
    */
-  Row(RowId rid) : rid_(rid), heap_(new SimpleMemHeap) {}
+  Row(RowId rid, MemHeap *heap = nullptr) : rid_(rid), heap_(heap != nullptr ? heap : &arena_) {}
 
   /**
-   * Row copy function
+   * Row copy function, the copy always uses its own arena
    */
-  Row(const Row &other) : heap_(new SimpleMemHeap) {
-    if (!fields_.empty()) {
-      for (auto &field : fields_) {
-        heap_->Free(field);
-      }
-      fields_.clear();
-    }
-    rid_ = other.rid_;
+  Row(const Row &other) : rid_(other.rid_), heap_(&arena_) {
+    fields_.reserve(other.fields_.size());
     for (auto &field : other.fields_) {
-      void *buf = heap_->Allocate(sizeof(Field));
-      fields_.push_back(new (buf) Field(*field));
+      fields_.push_back(CopyField(*field));
     }
   }
 
-  virtual ~Row() {
-    delete heap_;
+  /**
+   * Row made of some columns of another row, e.g. the key of an index
+   */
+  Row(const Row &other, const std::vector<uint32_t> &column_indexes, MemHeap *heap = nullptr)
+      : rid_(other.rid_), heap_(heap != nullptr ? heap : &arena_) {
+    fields_.reserve(column_indexes.size());
+    for (auto column_index : column_indexes) {
+      fields_.push_back(CopyField(*other.GetField(column_index)));
+    }
   }
 
+  virtual ~Row() = default;
+
   /**
    * Note: Make sure that bytes write to buf is equal to GetSerializedSize()
    */
@@ -97,9 +101,15 @@ class Row {
  private:
   Row &operator=(const Row &other) = delete;
 
+  /**
+   * Copy field into heap_, including its chars
+   */
+  Field *CopyField(const Field &field);
+
  private:
   RowId rid_{};
   std::vector<Field *> fields_; /** Make sure that all fields are created by mem heap */
+  ArenaMemHeap arena_{ROW_ARENA_BLOCK_SIZE};
   MemHeap *heap_{nullptr};
 };
 
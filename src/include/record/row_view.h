@@ -0,0 +1,63 @@
+#ifndef MINISQL_ROW_VIEW_H
+#define MINISQL_ROW_VIEW_H
+
+#include <cstdint>
+#include <vector>
+
+#include "common/rowid.h"
+#include "record/field.h"
+#include "record/row.h"
+#include "record/schema.h"
+
+/**
+ * RowView reads the fields of a serialized row (see Row) in place, e.g. a tuple on a pinned TablePage,
+ * without deserializing it into a Row.
+ *
+ * Reset只解析一次行头，算出每个field在行内的偏移，之后取field不再走一遍bitmap和前面的变长字段。
+ * 偏移表在多行之间复用，扫描时每行都不需要分配内存；view只在底层字节有效时（页被pin住并加了读锁）可用。
+ */
+class RowView {
+public:
+  RowView() = default;
+
+  /**
+   * Point the view at the row serialized at data
+   */
+  void Reset(const char *data, Schema *schema, RowId rid);
+
+  inline RowId GetRowId() const { return rid_; }
+
+  inline uint32_t GetFieldCount() const { return offsets_.size(); }
+
+  /**
+   * @return number of bytes of the serialized row
+   */
+  inline uint32_t GetSerializedSize() const { return size_; }
+
+  inline bool IsNull(uint32_t idx) const {
+    ASSERT(idx < offsets_.size(), "Failed to access field");
+    return offsets_[idx] == NULL_OFFSET;
+  }
+
+  /**
+   * @return a field that references the bytes of the row instead of copying them,
+   * note that GetChars of a char field is not null-terminated, use it together with GetLength
+   */
+  Field GetField(uint32_t idx) const;
+
+  /**
+   * Deserialize the row into row, which is the only step that copies the fields out of the page
+   */
+  void Materialize(Row *row) const;
+
+private:
+  static constexpr uint32_t NULL_OFFSET = UINT32_MAX;
+
+  const char *data_{nullptr};
+  Schema *schema_{nullptr};
+  RowId rid_{};
+  uint32_t size_{0};
+  std::vector<uint32_t> offsets_;  // offset of every field from data_, NULL_OFFSET if the field is null
+};
+
+#endif  // MINISQL_ROW_VIEW_H
@@ -0,0 +1,59 @@
+#ifndef MINISQL_CHECKPOINT_MANAGER_H
+#define MINISQL_CHECKPOINT_MANAGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "buffer/buffer_pool_manager.h"
+#include "storage/disk_manager.h"
+#include "transaction/log_manager.h"
+#include "transaction/txn_manager.h"
+
+/**
+ * CheckpointManager takes fuzzy checkpoints: it records the dirty page table of the buffer pool in the log
+ * without writing back any page or blocking running transactions, then drops the log records that recovery
+ * will never need again (older than every recLSN and every running transaction), so the log stays short
+ * and restart after a crash stays fast.
+ *
+ * 后台的checkpointer线程每隔CHECKPOINT_INTERVAL_MS毫秒看一次日志的长度，需要时做checkpoint，提交事务的线程不用等它。
+ */
+class CheckpointManager {
+public:
+  /**
+   * @param enable_checkpointer start the background checkpointer thread
+   */
+  CheckpointManager(TransactionManager *txn_manager, LogManager *log_manager,
+                    BufferPoolManager *buffer_pool_manager, DiskManager *disk_manager,
+                    bool enable_checkpointer = false);
+
+  /**
+   * Stop the checkpointer thread
+   */
+  ~CheckpointManager();
+
+  void Checkpoint();
+
+  /**
+   * Take a checkpoint if at least CHECKPOINT_LOG_SIZE bytes of log were appended since the last one
+   * @return true if a checkpoint is taken
+   */
+  bool CheckpointIfNeeded();
+
+private:
+  void RunCheckpointer();
+
+  TransactionManager *txn_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  DiskManager *disk_manager_;
+  std::mutex latch_;                                 // one checkpoint at a time
+  std::atomic<uint64_t> last_checkpoint_bytes_{0};  // appended bytes of the log manager at the last checkpoint
+  std::mutex stop_latch_;
+  bool stop_{false};
+  std::condition_variable stop_cv_;
+  std::thread checkpointer_thread_;
+};
+
+#endif  // MINISQL_CHECKPOINT_MANAGER_H
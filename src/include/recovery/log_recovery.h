@@ -0,0 +1,92 @@
+#ifndef MINISQL_LOG_RECOVERY_H
+#define MINISQL_LOG_RECOVERY_H
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/catalog.h"
+#include "storage/disk_manager.h"
+#include "transaction/log_manager.h"
+#include "transaction/log_rec.h"
+
+/**
+ * LogRecovery brings the database back to a consistent state after a crash, in the ARIES style:
+ *
+ * 1. Analysis: 读出日志中所有完整的记录，从最后一个checkpoint的dirty page table开始，
+ *    找出redo需要处理的page以及没有commit/abort的事务(loser)。
+ * 2. Redo: 按lsn顺序重放kNewPage/kPageDelta，checkpoint之前的记录只重放dirty page table中
+ *    recLSN之后的部分。delta记录的是字节的新值，重放是幂等的。重放后的page写回db文件并落盘。
+ * 3. Undo: catalog加载之后，按lsn倒序撤销loser的tuple和索引操作，再为它们写abort日志。
+ *    每个撤销操作都先检查page/索引的当前状态，所以撤销也是幂等的：如果在undo过程中再次崩溃，
+ *    下次启动时redo会重放已经完成的撤销，undo再跳过它们，不需要compensation log record。
+ */
+class LogRecovery {
+public:
+  explicit LogRecovery(DiskManager *disk_manager) : disk_manager_(disk_manager) {}
+
+  /**
+   * Analysis and redo, must run before any other component reads the db file
+   */
+  void Redo();
+
+  /**
+   * Undo the loser transactions found by Redo(), the changes go through the buffer pool (and are logged)
+   */
+  void Undo(CatalogManager *catalog_manager, BufferPoolManager *buffer_pool_manager, LogManager *log_manager);
+
+  /**
+   * @return lsn to continue the log with
+   */
+  inline lsn_t GetNextLSN() const { return next_lsn_; }
+
+  /**
+   * @return txn id to continue with, larger than any txn id in the log
+   */
+  inline txn_id_t GetNextTxnId() const { return next_txn_id_; }
+
+  /**
+   * @return number of log records read from the log
+   */
+  inline size_t GetLogRecordCount() const { return log_record_count_; }
+
+  /**
+   * @return number of page records applied by redo
+   */
+  inline size_t GetRedoCount() const { return redo_count_; }
+
+  /**
+   * @return number of transactions to undo
+   */
+  inline size_t GetLoserCount() const { return losers_.size(); }
+
+private:
+  /**
+   * Read all intact log records, stop at the first torn or corrupted record
+   */
+  void ReadLog();
+
+  void Analyze();
+
+  char *GetPage(page_id_t page_id);
+
+  void UndoRecord(const LogRecord &log_record, CatalogManager *catalog_manager,
+                  BufferPoolManager *buffer_pool_manager);
+
+private:
+  DiskManager *disk_manager_;
+  std::vector<LogRecord> log_records_;
+  size_t log_record_count_{0};
+  uint32_t log_size_{0};                                          // size of the intact part of the log
+  lsn_t next_lsn_{0};
+  txn_id_t next_txn_id_{0};
+  lsn_t checkpoint_begin_lsn_{INVALID_LSN};                       // records after it are always redone
+  std::unordered_map<page_id_t, lsn_t> dirty_pages_;              // page_id -> recLSN
+  std::unordered_set<txn_id_t> losers_;
+  size_t redo_count_{0};
+  std::unordered_map<page_id_t, std::unique_ptr<char[]>> pages_;  // pages touched by redo
+};
+
+#endif  // MINISQL_LOG_RECOVERY_H
@@ -0,0 +1,183 @@
+#ifndef MINISQL_ASYNC_IO_H
+#define MINISQL_ASYNC_IO_H
+
+#include <sys/types.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/config.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * AsyncIO reads and writes a file asynchronously: requests are queued by SubmitRead/SubmitWrite, handed to the
+ * kernel in a batch by Flush, and each one calls its callback when it completes.
+ *
+ * 有io_uring时用IoUringIO，一次io_uring_enter提交一批请求；内核不支持（或被禁用）时退回ThreadPoolIO，
+ * 由几个线程做pread/pwrite。同时在进行的请求最多queue_depth个，满了Submit会等。
+ * 回调在完成线程上执行，不能再提交新的请求。读到文件末尾之后的部分填0。
+ */
+class AsyncIO {
+public:
+  /**
+   * @param ok false if the I/O failed
+   */
+  using Callback = std::function<void(bool ok)>;
+
+  /**
+   * @return an io_uring backend if the kernel supports it, otherwise a thread pool backend
+   */
+  static std::unique_ptr<AsyncIO> Create(int fd, uint32_t queue_depth = ASYNC_IO_QUEUE_DEPTH);
+
+  virtual ~AsyncIO() = default;
+
+  /**
+   * Queue a read of len bytes at offset into buf, buf must stay valid until done is called
+   */
+  void SubmitRead(char *buf, size_t len, off_t offset, Callback done);
+
+  /**
+   * Queue a write of len bytes from buf at offset, buf must stay valid until done is called
+   */
+  void SubmitWrite(const char *buf, size_t len, off_t offset, Callback done);
+
+  /**
+   * Hand all queued requests to the kernel
+   */
+  virtual void Flush() = 0;
+
+  /**
+   * Flush and wait until every submitted request is complete
+   */
+  void Wait();
+
+  /**
+   * @return name of the backend, "io_uring" or "thread pool"
+   */
+  virtual const char *GetName() const = 0;
+
+protected:
+  struct Request {
+    bool write_;
+    char *buf_;
+    size_t len_;
+    off_t offset_;
+    Callback done_;
+  };
+
+  AsyncIO(int fd, uint32_t queue_depth) : fd_(fd), queue_depth_(queue_depth) {}
+
+  /**
+   * Queue the request, a slot is already reserved for it
+   */
+  virtual void Submit(Request *request) = 0;
+
+  /**
+   * Finish the request and free its slot
+   * @param result bytes transferred or -errno, a short transfer is completed synchronously
+   */
+  void Complete(Request *request, ssize_t result);
+
+  /**
+   * Do the whole request synchronously from byte done on
+   * @return bytes transferred or -errno
+   */
+  ssize_t Perform(Request *request, size_t done = 0);
+
+  int fd_;
+  uint32_t queue_depth_;
+
+private:
+  void Reserve();
+
+  std::mutex latch_;
+  std::condition_variable completed_;
+  uint32_t in_flight_{0};  // submitted but not completed
+};
+
+/**
+ * io_uring backend, the rings are set up with raw syscalls so that liburing is not needed.
+ * A completion thread waits for completions and runs the callbacks.
+ */
+class IoUringIO : public AsyncIO {
+public:
+  /**
+   * @return nullptr if io_uring is not available
+   */
+  static std::unique_ptr<IoUringIO> Create(int fd, uint32_t queue_depth = ASYNC_IO_QUEUE_DEPTH);
+
+  ~IoUringIO() override;
+
+  void Flush() override;
+
+  const char *GetName() const override { return "io_uring"; }
+
+private:
+  IoUringIO(int fd, uint32_t queue_depth) : AsyncIO(fd, queue_depth) {}
+
+  bool Setup();
+
+  void Submit(Request *request) override;
+
+  /**
+   * Put a sqe for request (nullptr: a nop that stops the completion thread) in the submission queue
+   */
+  void Push(Request *request);
+
+  void Reap();
+
+  std::mutex sq_latch_;  // protects the submission queue
+  uint32_t pending_{0};  // sqes not handed to the kernel yet
+  int ring_fd_{-1};
+  void *sq_ring_{nullptr};
+  void *cq_ring_{nullptr};
+  size_t sq_ring_size_{0};
+  size_t cq_ring_size_{0};
+  io_uring_sqe *sqes_{nullptr};
+  size_t sqes_size_{0};
+  unsigned *sq_tail_{nullptr};
+  unsigned *sq_mask_{nullptr};
+  unsigned *sq_array_{nullptr};
+  unsigned *cq_head_{nullptr};
+  unsigned *cq_tail_{nullptr};
+  unsigned *cq_mask_{nullptr};
+  io_uring_cqe *cqes_{nullptr};
+  std::thread reaper_;
+};
+
+/**
+ * Fallback backend, a few threads doing pread/pwrite
+ */
+class ThreadPoolIO : public AsyncIO {
+public:
+  ThreadPoolIO(int fd, uint32_t queue_depth = ASYNC_IO_QUEUE_DEPTH, uint32_t thread_count = ASYNC_IO_THREADS);
+
+  ~ThreadPoolIO() override;
+
+  /**
+   * Requests are picked up as soon as they are submitted, nothing to do
+   */
+  void Flush() override {}
+
+  const char *GetName() const override { return "thread pool"; }
+
+private:
+  void Submit(Request *request) override;
+
+  void Work();
+
+  std::mutex queue_latch_;
+  std::condition_variable queue_cv_;
+  std::deque<Request *> queue_;
+  bool stop_{false};
+  std::vector<std::thread> workers_;
+};
+
+#endif  // MINISQL_ASYNC_IO_H
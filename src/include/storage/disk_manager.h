@@ -2,14 +2,18 @@
 #define DISK_MGR_H
 
 #include <atomic>
-#include <fstream>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
+#include <sys/uio.h>
 #include "common/config.h"
 #include "common/macros.h"
 #include "page/bitmap_page.h"
 #include "page/disk_file_meta_page.h"
+#include "storage/async_io.h"
 
 /**
  * DiskManager takes care of the allocation and de allocation of pages within a database. It performs the reading and
@@ -18,9 +22,20 @@
  * Disk page storage format: (Free Page BitMap Size = PAGE_SIZE * 8, we note it as N)
  * | Meta Page | Free Page BitMap 1 | Page 1 | Page 2 | ....
  *      | Page N | Free Page BitMap 2 | Page N+1 | ... | Page 2N | ... |
+ *
+ * 页的读写直接在fd上pread/pwrite，不需要移动共享的文件指针，所以不加锁，多个线程的I/O可以同时进行；
+ * 只有分配和释放页时修改meta page和bitmap page需要互斥。
+ *
+ * meta page和bitmap page缓存在内存里，分配和释放页只改内存并记下哪些页脏了，SyncData和Close时才一起写回，
+ * 所以崩溃时最近的分配可能还没落盘：recovery按kNewPage日志重做分配（见AllocatePageAt），
+ * checkpoint在丢弃日志之前会SyncData；没写回的释放只会让页泄漏，不会被重复分配。
+ * 分配到文件末尾之后的页时用fallocate一次把文件扩展DISK_PREALLOCATE_PAGES页。
  */
 class DiskManager {
 public:
+  /**
+   * Open the db file, create it if it does not exist
+   */
   explicit DiskManager(const std::string &db_file);
 
   ~DiskManager() {
@@ -30,23 +45,70 @@ public:
   }
 
   /**
-   * Read page from specific page_id
+   * Read page from specific page_id, safe to call from many threads at once
    * Note: page_id = 0 is reserved for disk meta page
    */
   void ReadPage(page_id_t logical_page_id, char *page_data);
 
   /**
-   * Write data to specific page
+   * Write data to specific page, safe to call from many threads at once (for different pages)
    * Note: page_id = 0 is reserved for disk meta page
    */
   void WritePage(page_id_t logical_page_id, const char *page_data);
 
+  /**
+   * Write many pages at once: they are sorted by physical page id and every run of adjacent pages is written
+   * with one pwritev. Not synced, call SyncData to make them durable.
+   * @param pages (logical page id, page data) of the pages to write
+   */
+  void WritePages(const std::vector<std::pair<page_id_t, const char *>> &pages);
+
+  /**
+   * Queue an asynchronous read of a page, done is called on an I/O thread when page_data is filled in.
+   * Requests are handed to the kernel by SubmitIO (or when the queue is full).
+   */
+  void ReadPageAsync(page_id_t logical_page_id, char *page_data, const AsyncIO::Callback &done);
+
+  /**
+   * Queue an asynchronous write of a page, page_data must not change until done is called
+   */
+  void WritePageAsync(page_id_t logical_page_id, const char *page_data, const AsyncIO::Callback &done);
+
+  /**
+   * Hand the queued asynchronous requests to the kernel in one batch
+   */
+  inline void SubmitIO() {
+    if (async_io_ != nullptr) {
+      async_io_->Flush();
+    }
+  }
+
+  /**
+   * Wait until all asynchronous requests are complete, nothing to wait for after Close
+   */
+  inline void WaitIO() {
+    if (async_io_ != nullptr) {
+      async_io_->Wait();
+    }
+  }
+
+  /**
+   * @return name of the asynchronous I/O backend
+   */
+  inline const char *GetAsyncIOName() const { return async_io_->GetName(); }
+
   /**
    * Get next free page from disk
    * @return logical page id of allocated page
    */
   page_id_t AllocatePage();
 
+  /**
+   * Allocate a specific page, used by recovery to redo an allocation that was not written back before a crash
+   * @return false if the page is already allocated
+   */
+  bool AllocatePageAt(page_id_t logical_page_id);
+
   /**
    * Free this page and reset bit map
    */
@@ -57,6 +119,38 @@ public:
    */
   bool IsPageFree(page_id_t logical_page_id);
 
+  /**
+   * Append data to the end of the log file, returns after the data is durable (fdatasync)
+   */
+  void WriteLog(const char *log_data, uint32_t size);
+
+  /**
+   * Read the log file from offset
+   * @return number of bytes read, 0 if offset is at the end of the log
+   */
+  uint32_t ReadLog(char *log_data, uint32_t size, uint32_t offset);
+
+  /**
+   * Cut the log to size bytes, discard the whole log by default (once all logged changes are durable in the db file)
+   */
+  void TruncateLog(uint32_t size = 0);
+
+  /**
+   * Discard the first offset bytes of the log, the rest is copied to a new log file which atomically replaces
+   * the old one. Caller must make sure no WriteLog is in progress.
+   */
+  void DiscardLogPrefix(uint32_t offset);
+
+  /**
+   * @return size of the log file in bytes
+   */
+  inline uint32_t GetLogSize() const { return log_size_; }
+
+  /**
+   * Write back the meta page and the modified bitmap pages, and make all pages written so far durable in the db file
+   */
+  void SyncData();
+
   /**
    * Shut down the disk manager and close all the file resources.
    */
@@ -74,12 +168,7 @@ public:
 
 private:
   /**
-   * Helper function to get disk file size
-   */
-  int GetFileSize(const std::string &file_name);
-
-  /**
-   * Read physical page from disk
+   * Read physical page from disk, the part beyond the end of the file reads as zeros
    */
   void ReadPhysicalPage(page_id_t physical_page_id, char *page_data);
 
@@ -88,19 +177,55 @@ private:
    */
   void WritePhysicalPage(page_id_t physical_page_id, const char *page_data);
 
+  /**
+   * Write the buffers of iov to the physical pages starting from physical_page_id with pwritev, iov is consumed
+   */
+  void WritePhysicalPages(page_id_t physical_page_id, std::vector<iovec> &iov);
+
   /**
    * Map logical page id to physical page id
    */
   page_id_t MapPageId(page_id_t logical_page_id);
 
+  /**
+   * @return the cached bitmap page of an extent, read from disk on first use. Caller holds meta_latch_.
+   */
+  BitmapPage<PAGE_SIZE> *GetBitmap(uint32_t extent_id);
+
+  /**
+   * Write back the meta page and the bitmap pages modified since the last call. Caller holds meta_latch_.
+   */
+  void WriteAllocationPages();
+
+  /**
+   * Make sure the file covers the physical page, extending it with fallocate. Caller holds meta_latch_.
+   */
+  void Preallocate(page_id_t physical_page_id);
+
+  /**
+   * xxx.db -> xxx.log
+   */
+  static std::string GetLogFileName(const std::string &db_file);
+
 private:
-  // stream to write db file
-  std::fstream db_io_;
+  // db file, read and written with pread/pwrite
+  int db_fd_{-1};
+  // asynchronous I/O on db_fd_
+  std::unique_ptr<AsyncIO> async_io_;
   std::string file_name_;
-  // with multiple buffer pool instances, need to protect file access
-  std::recursive_mutex db_io_latch_;
+  // log file, appended and fdatasync-ed through the raw fd
+  std::string log_name_;
+  int log_fd_{-1};
+  uint32_t log_size_{0};
+  // protects meta_data_ and the bitmap pages while allocating and freeing pages
+  std::mutex meta_latch_;
   bool closed{false};
   char meta_data_[PAGE_SIZE];
+  bool meta_dirty_{false};
+  std::vector<std::unique_ptr<char[]>> bitmaps_;  // cached bitmap page of every extent, nullptr if not read yet
+  std::vector<bool> bitmap_dirty_;
+  uint32_t next_free_extent_{0};                  // every extent before it is full
+  page_id_t file_pages_{0};                       // number of physical pages the db file covers
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef MINISQL_FREE_SPACE_MAP_H
+#define MINISQL_FREE_SPACE_MAP_H
+
+#include <algorithm>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "page/free_space_map_page.h"
+
+/**
+ * FreeSpaceMap remembers how much free space every page of a table heap has, so that an insert can find a page
+ * with enough room without walking the page chain.
+ *
+ * 空闲空间按BUCKET_SIZE字节向下取整成一个桶号（0~255），持久化在一串FreeSpaceMapPage中，内存里缓存一份，
+ * 并按桶号给页分组，查找时从够用的最小桶往上找，最多看BUCKET_COUNT个桶。
+ * 记录的只是提示：崩溃恢复、回滚等绕过了它的修改会让它过时，插入失败时以页上的实际空闲空间为准更新。
+ */
+class FreeSpaceMap {
+public:
+  static constexpr uint32_t BUCKET_COUNT = 256;
+  static constexpr uint32_t BUCKET_SIZE = PAGE_SIZE / BUCKET_COUNT;
+
+  /**
+   * Create an empty free space map, its first page is allocated from buffer_pool_manager
+   */
+  explicit FreeSpaceMap(BufferPoolManager *buffer_pool_manager);
+
+  /**
+   * Load the free space map stored from first_page_id
+   */
+  FreeSpaceMap(BufferPoolManager *buffer_pool_manager, page_id_t first_page_id);
+
+  inline page_id_t GetFirstPageId() const { return fsm_pages_.front(); }
+
+  /**
+   * @return the number of table pages in the map
+   */
+  uint32_t GetPageCount();
+
+  /**
+   * @return the last table page added to the map, INVALID_PAGE_ID if the map is empty
+   */
+  page_id_t GetLastPageId();
+
+  /**
+   * @return true if table_page_id is in the map
+   */
+  bool Contains(page_id_t table_page_id);
+
+  /**
+   * Get up to count table pages that follow table_page_id in the page chain
+   */
+  void GetNextPages(page_id_t table_page_id, uint32_t count, std::vector<page_id_t> *page_ids);
+
+  /**
+   * Find a table page that has at least size bytes free
+   * @return INVALID_PAGE_ID if there is no such page
+   */
+  page_id_t FindPage(uint32_t size);
+
+  /**
+   * Record the free space of a table page, table pages not in the map yet are added at the end
+   */
+  void Update(page_id_t table_page_id, uint32_t free_space);
+
+  /**
+   * Delete all pages of the map
+   */
+  void Destroy();
+
+private:
+  static uint8_t ToBucket(uint32_t free_space) {
+    return static_cast<uint8_t>(std::min<uint32_t>(free_space / BUCKET_SIZE, BUCKET_COUNT - 1));
+  }
+
+  /**
+   * Write the bucket of the index-th table page back to its FreeSpaceMapPage
+   */
+  void WriteBucket(uint32_t index);
+
+  /**
+   * Add a table page to the end of the map, and to the last FreeSpaceMapPage (a new one if it is full)
+   */
+  void Append(page_id_t table_page_id, uint8_t bucket);
+
+  std::mutex latch_;
+  BufferPoolManager *buffer_pool_manager_;
+  std::vector<page_id_t> fsm_pages_;
+  std::vector<page_id_t> table_pages_;                    // in the order of the page chain
+  std::vector<uint8_t> buckets_;                          // buckets_[i] is the bucket of table_pages_[i]
+  std::unordered_map<page_id_t, uint32_t> positions_;     // table page id -> index in table_pages_
+  std::vector<std::set<uint32_t>> pages_by_bucket_;       // indexes of table pages in every bucket
+};
+
+#endif  // MINISQL_FREE_SPACE_MAP_H
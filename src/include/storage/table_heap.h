@@ -1,8 +1,11 @@
 #ifndef MINISQL_TABLE_HEAP_H
 #define MINISQL_TABLE_HEAP_H
 
+#include <functional>
+
 #include "buffer/buffer_pool_manager.h"
 #include "page/table_page.h"
+#include "storage/free_space_map.h"
 #include "storage/table_iterator.h"
 #include "transaction/log_manager.h"
 #include "transaction/lock_manager.h"
@@ -18,10 +21,12 @@ public:
     return new(buf) TableHeap(buffer_pool_manager, schema, txn, log_manager, lock_manager);
   }
 
-  static TableHeap *Create(BufferPoolManager *buffer_pool_manager, page_id_t first_page_id, Schema *schema,
-                           LogManager *log_manager, LockManager *lock_manager, MemHeap *heap) {
+  static TableHeap *Create(BufferPoolManager *buffer_pool_manager, page_id_t first_page_id,
+                           page_id_t free_space_map_page_id, Schema *schema, LogManager *log_manager,
+                           LockManager *lock_manager, MemHeap *heap) {
     void *buf = heap->Allocate(sizeof(TableHeap));
-    return new(buf) TableHeap(buffer_pool_manager, first_page_id, schema, log_manager, lock_manager);
+    return new(buf) TableHeap(buffer_pool_manager, first_page_id, free_space_map_page_id, schema, log_manager,
+                              lock_manager);
   }
 
   ~TableHeap() {
@@ -29,7 +34,8 @@ public:
   }
 
   /**
-   * Insert a tuple into the table. If the tuple is too large (>= page_size), return false.
+   * Insert a tuple into the table, into a page the free space map finds room in, or into a new page at the end.
+   * If the tuple is too large (>= page_size), return false.
    * @param[in/out] row Tuple Row to insert, the rid of the inserted tuple is wrapped in object row
    * @param[in] txn The transaction performing the insert
    * @return true iff the insert is successful
@@ -37,10 +43,23 @@ public:
   bool InsertTuple(Row &row, Transaction *txn);
 
   /**
-   * Mark the tuple as deleted. The actual delete will occur when ApplyDelete is called.
+   * Append rows to the end of the table for a bulk load, outside any transaction. Rows go into fresh pages that
+   * are filled one after another without consulting the free space map; the last page is reused only if it holds
+   * no tuples yet. Rows that are too large for a page are skipped.
+   * @param[in] next Fills in the fields of the next row, returns false when there are no more rows
+   * @param[in] inserted Called with every appended row, the rid of the row is set
+   * @return the rid of the first appended row, INVALID_ROWID if nothing is appended; the appended rows are
+   * exactly the rows from it to the end of the table
+   */
+  RowId AppendTuples(const std::function<bool(std::vector<Field> *)> &next,
+                     const std::function<void(const Row &)> &inserted);
+
+  /**
+   * Mark the tuple as deleted. The actual delete will occur when ApplyDelete is called,
+   * which the transaction manager does when txn commits.
    * @param[in] rid Resource id of the tuple of delete
    * @param[in] txn Transaction performing the delete
-   * @return true iff the delete is successful (i.e the tuple exists)
+   * @return true iff the delete is successful (i.e the tuple exists and txn gets the exclusive lock)
    */
   bool MarkDelete(const RowId &rid, Transaction *txn);
 
@@ -53,6 +72,16 @@ public:
    */
   bool UpdateTuple(const Row &row, const RowId &rid, Transaction *txn);
 
+  /**
+   * Update the tuple at rid. If the new tuple does not fit in its page any more, the old tuple is marked deleted
+   * and the new one is inserted where the free space map finds room.
+   * @param[in/out] row Tuple of new row, its rid is set to where the tuple ends up
+   * @param[in] rid Rid of the old tuple
+   * @param[in] txn Transaction performing the update
+   * @return true is update is successful.
+   */
+  bool UpdateOrMoveTuple(Row &row, const RowId &rid, Transaction *txn);
+
   /**
    * Called on Commit/Abort to actually delete a tuple or rollback an insert.
    * @param rid Rid of the tuple to delete
@@ -95,7 +124,100 @@ public:
    */
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
+  /**
+   * @return the id of the first page of the free space map of this table
+   */
+  inline page_id_t GetFreeSpaceMapPageId() const { return free_space_map_.GetFirstPageId(); }
+
+  /**
+   * @return the number of pages of this table
+   */
+  inline uint32_t GetPageCount() { return free_space_map_.GetPageCount(); }
+
+  /**
+   * Read ahead up to count pages that follow page_id in the page chain, for a sequential scan. The reads are
+   * asynchronous and the pages are kept at the cold end of the buffer pool.
+   * @param[out] last_page_id the last page of the window, unchanged if page_id is the last page
+   * @return number of pages in the window
+   */
+  uint32_t ReadAhead(page_id_t page_id, uint32_t count, page_id_t *last_page_id);
+
+  /**
+   * @return how many pages a sequential scan reads ahead, 0 if read-ahead is disabled
+   */
+  inline uint32_t GetReadAheadPages() const { return read_ahead_pages_; }
+
+  inline void SetReadAheadPages(uint32_t read_ahead_pages) { read_ahead_pages_ = read_ahead_pages; }
+
+  /**
+   * Visit the tuples of a table page in place from slot *slot_num on, each one as a RowView over the pinned and
+   * latched page, so that a scan can look at a row without deserializing it. No lock is taken, a visitor that runs
+   * in a transaction checks every row with TryLockRow.
+   * @param[out] next_page_id the next page of the chain once the page is finished, page_id itself if the visitor
+   *                          stopped
+   * @param visitor bool(const RowView &), returns false to stop, *slot_num is then the slot to resume from
+   * @return false if the page could not be fetched into the buffer pool
+   */
+  /**
+   * Lock a row visited by ScanPage. It is called while the page is latched, so it never waits: a row the scan
+   * returns is share locked, a row it skips is only checked for changes of another transaction that are not committed.
+   * @param emit the scan returns the row
+   * @return false if the row is exclusively locked by another transaction, the visitor then stops, the scan waits
+   *         with LockRow after the page is released and visits the row again
+   */
+  bool TryLockRow(const RowId &rid, Transaction *txn, bool emit);
+
+  /**
+   * Wait for a shared lock on a row that TryLockRow failed on, the page must not be latched
+   * @return false if the transaction is aborted
+   */
+  bool LockRow(const RowId &rid, Transaction *txn);
+
+  template <typename Visitor>
+  bool ScanPage(page_id_t page_id, uint32_t *slot_num, page_id_t *next_page_id, RowView *view, Visitor &&visitor) {
+    auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id, true));
+    if (page == nullptr) {
+      return false;
+    }
+    page->RLatch();
+    *next_page_id = page->GetNextPageId();
+    while (*slot_num < page->GetTupleCount()) {
+      uint32_t slot = (*slot_num)++;
+      if (page->GetTupleView(slot, schema_, view) && !visitor(*view)) {
+        *next_page_id = page_id;
+        break;
+      }
+    }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return true;
+  }
+
 private:
+  /**
+   * Update the tuple in its page
+   * @return the result of TablePage::UpdateTuple, 0 on success and 3 if there is not enough space in the page
+   */
+  int UpdateTupleInPlace(const Row &row, const RowId &rid, Transaction *txn);
+
+  /**
+   * Append a new page to the end of the table, unless another insert appended one with space_needed free bytes
+   * while this one was waiting for append_latch_
+   * @return the page to insert into, INVALID_PAGE_ID if no new page could be allocated
+   */
+  page_id_t FindOrAppendPage(uint32_t space_needed);
+
+  /**
+   * Add the pages at the end of the page chain that are missing from the free space map,
+   * e.g. when its pages were not written back before a crash
+   */
+  void SyncFreeSpaceMap();
+
+  /**
+   * Remember the write in the write set of txn, so that it can be undone if txn aborts
+   */
+  void AppendTableWrite(const RowId &rid, WType wtype, const Row &old_row, Transaction *txn);
+
   /**
    * create table heap and initialize first page
    */
@@ -104,30 +226,39 @@ private:
           buffer_pool_manager_(buffer_pool_manager),
           schema_(schema),
           log_manager_(log_manager),
-          lock_manager_(lock_manager) {
+          lock_manager_(lock_manager),
+          free_space_map_(buffer_pool_manager) {
     // first_page_id_=0;
     auto page = reinterpret_cast<TablePage *>(buffer_pool_manager->NewPage(first_page_id_));
     page->Init(first_page_id_,INVALID_PAGE_ID,log_manager,txn);
+    free_space_map_.Update(first_page_id_, page->GetFreeSpaceRemaining());
     buffer_pool_manager->UnpinPage(first_page_id_, true);
   };
 
   /**
    * load existing table heap by first_page_id
    */
-  explicit TableHeap(BufferPoolManager *buffer_pool_manager, page_id_t first_page_id, Schema *schema,
-                     LogManager *log_manager, LockManager *lock_manager)
+  explicit TableHeap(BufferPoolManager *buffer_pool_manager, page_id_t first_page_id,
+                     page_id_t free_space_map_page_id, Schema *schema, LogManager *log_manager,
+                     LockManager *lock_manager)
           : buffer_pool_manager_(buffer_pool_manager),
             first_page_id_(first_page_id),
             schema_(schema),
             log_manager_(log_manager),
-            lock_manager_(lock_manager) {}
+            lock_manager_(lock_manager),
+            free_space_map_(buffer_pool_manager, free_space_map_page_id) {
+    SyncFreeSpaceMap();
+  }
 
 private:
   BufferPoolManager *buffer_pool_manager_;
   page_id_t first_page_id_;
   Schema *schema_;
-  [[maybe_unused]] LogManager *log_manager_;
-  [[maybe_unused]] LockManager *lock_manager_;
+  LogManager *log_manager_;
+  LockManager *lock_manager_;
+  FreeSpaceMap free_space_map_;
+  std::mutex append_latch_;  // only one insert appends a new page at a time
+  uint32_t read_ahead_pages_{READ_AHEAD_PAGES};
 };
 
 #endif  // MINISQL_TABLE_HEAP_H
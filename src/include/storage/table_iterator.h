@@ -8,6 +8,26 @@
 
 class TableHeap;
 
+/**
+ * Read-ahead state of a sequential scan over a table heap
+ */
+class ScanReadAhead {
+public:
+  explicit ScanReadAhead(TableHeap *table_heap = nullptr) : table_heap_(table_heap) {}
+
+  /**
+   * Called when the scan moves to the next page. Once it has crossed READ_AHEAD_TRIGGER pages the scan is
+   * taken as sequential, and the pages ahead are read asynchronously whenever less than half a window is left.
+   */
+  void OnPage(page_id_t page_id);
+
+private:
+  TableHeap *table_heap_;
+  uint32_t pages_scanned_{0};                   // pages the scan has moved to
+  uint32_t read_ahead_left_{0};                 // pages read ahead that the scan has not reached yet
+  page_id_t read_ahead_end_{INVALID_PAGE_ID};   // last page read ahead
+};
+
 class TableIterator {
 
 public:
@@ -16,6 +36,8 @@ public:
 
   explicit TableIterator(const TableIterator &other);
 
+  TableIterator &operator=(const TableIterator &other);
+
   virtual ~TableIterator();
 
   bool operator==(const TableIterator &itr) const;
@@ -34,6 +56,7 @@ private:
   // add your own private member variables here
   TableHeap* table_heap_;
   Row* row_;
+  ScanReadAhead read_ahead_;
 };
 
 #endif //MINISQL_TABLE_ITERATOR_H
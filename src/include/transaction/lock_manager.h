@@ -1,13 +1,147 @@
 #ifndef MINISQL_LOCK_MANAGER_H
 #define MINISQL_LOCK_MANAGER_H
 
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rowid.h"
+#include "transaction/transaction.h"
+
 /**
  * LockManager handles transactions asking for locks on records.
  *
- * Implemented by student self.
+ * 每一行(RowId)有一个请求队列，按到达顺序授予锁：共享锁和它前面的共享锁相容，排它锁必须排在队首。
+ * 等待的事务阻塞在队列的条件变量上。锁一直持有到事务提交或回滚(strict 2PL)。
+ *
+ * 后台线程每隔DEADLOCK_DETECTION_INTERVAL_MS毫秒构造一次waits-for图，
+ * 如果有环，就把环中最年轻(txn id最大)的事务置为kAborted并唤醒它，它的加锁请求返回false。
  */
 class LockManager {
+public:
+  enum class LockMode { kShared, kExclusive };
+
+  /**
+   * @param enable_cycle_detection start the background deadlock detection thread
+   */
+  explicit LockManager(bool enable_cycle_detection = true);
+
+  /**
+   * Stop the deadlock detection thread
+   */
+  ~LockManager();
+
+  /**
+   * Acquire a shared lock on rid, blocking until it is granted.
+   * Returns true at once if the transaction already holds a shared or exclusive lock on rid.
+   * @return false if the transaction is aborted (it is not growing, or it is chosen as a deadlock victim)
+   */
+  bool LockShared(Transaction *txn, const RowId &rid);
+
+  /**
+   * Acquire an exclusive lock on rid, blocking until it is granted.
+   * A shared lock already held by the transaction is upgraded.
+   * @return false if the transaction is aborted
+   */
+  bool LockExclusive(Transaction *txn, const RowId &rid);
+
+  /**
+   * Acquire an exclusive lock on rid only if it can be granted at once, never waits.
+   * Used while holding a page latch, where waiting for a row lock could deadlock with the lock holder.
+   * @return false if the lock is held or requested by another transaction, or the transaction is aborted
+   */
+  bool TryLockExclusive(Transaction *txn, const RowId &rid);
+
+  /**
+   * Acquire a shared lock on rid only if it can be granted at once, never waits (see TryLockExclusive).
+   * Returns true at once if the transaction already holds a shared or exclusive lock on rid.
+   * @return false if an exclusive lock on rid is held or requested by another transaction, or the transaction
+   *         is aborted
+   */
+  bool TryLockShared(Transaction *txn, const RowId &rid);
+
+  /**
+   * Check without locking whether the row may hold changes that are not committed
+   * @return true if another transaction holds an exclusive lock on rid
+   */
+  bool IsExclusiveLockedByOther(Transaction *txn, const RowId &rid);
+
+  /**
+   * Upgrade a shared lock on rid to an exclusive lock. Only one transaction may wait for an upgrade on a row,
+   * a second one would deadlock with the first and is aborted at once.
+   * @return false if the transaction is aborted
+   */
+  bool LockUpgrade(Transaction *txn, const RowId &rid);
+
+  /**
+   * Release the lock held by the transaction on rid, a growing transaction enters the shrinking phase
+   */
+  bool Unlock(Transaction *txn, const RowId &rid);
+
+  /**
+   * Release all locks held by the transaction
+   */
+  void UnlockAll(Transaction *txn);
+
+  /**
+   * @return edges (waiting txn, holding txn) of the current waits-for graph, for tests
+   */
+  std::vector<std::pair<txn_id_t, txn_id_t>> GetEdgeList();
+
+  /**
+   * Abort the youngest transaction of every cycle in the waits-for graph
+   * @return number of aborted transactions
+   */
+  uint32_t DetectDeadlocks();
+
+private:
+  struct LockRequest {
+    LockRequest(txn_id_t txn_id, LockMode lock_mode) : txn_id_(txn_id), lock_mode_(lock_mode) {}
+
+    txn_id_t txn_id_;
+    LockMode lock_mode_;
+    bool granted_{false};
+  };
+
+  struct LockRequestQueue {
+    std::list<LockRequest> request_queue_;
+    std::condition_variable cv_;                // notified whenever the queue changes
+    txn_id_t upgrading_{INVALID_TXN_ID};        // transaction waiting to upgrade its shared lock
+  };
+
+  /**
+   * Wait until the request can be granted or the transaction is aborted, the request is removed if aborted
+   */
+  bool WaitForGrant(Transaction *txn, const RowId &rid, LockRequestQueue &queue,
+                    std::list<LockRequest>::iterator request, std::unique_lock<std::mutex> &lock);
+
+  static bool IsGrantable(const LockRequestQueue &queue, std::list<LockRequest>::const_iterator request);
+
+  /**
+   * Latch must be held
+   */
+  std::unordered_map<txn_id_t, std::vector<txn_id_t>> BuildWaitsForGraph();
+
+  /**
+   * Find a cycle with dfs, nodes and edges are visited in txn id order so the result is deterministic
+   * @return youngest transaction of the cycle, INVALID_TXN_ID if there is no cycle
+   */
+  static txn_id_t FindCycle(const std::unordered_map<txn_id_t, std::vector<txn_id_t>> &graph);
+
+  void RunCycleDetection();
 
+private:
+  std::mutex latch_;
+  std::unordered_map<RowId, LockRequestQueue> lock_table_;
+  std::unordered_map<txn_id_t, std::pair<Transaction *, RowId>> waiting_;  // blocked transactions and their rows
+  bool stop_{false};
+  std::condition_variable stop_cv_;
+  std::thread cycle_detection_thread_;
 };
 
 #endif //MINISQL_LOCK_MANAGER_H
@@ -1,15 +1,96 @@
 #ifndef MINISQL_LOG_MANAGER_H
 #define MINISQL_LOG_MANAGER_H
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "storage/disk_manager.h"
+#include "transaction/log_rec.h"
+
 /**
  * LogManager maintains a separate thread that is awakened whenever the
  * log buffer is full or whenever a timeout happens.
  * When the thread is awakened, the log buffer's content is written into the disk log file.
  *
- * Implemented by student self
+ * 日志使用两块缓冲区：AppendLogRecord只往log_buffer_里追加，flush线程把两块缓冲区交换后，
+ * 在不持有latch的情况下把flush_buffer_写入磁盘并fdatasync，所以写盘期间其他线程仍然可以追加日志。
+ * 提交的事务调用Flush(lsn)等待自己的commit日志落盘，同一次fdatasync会一起满足所有在此之前追加日志的事务(group commit)。
  */
 class LogManager {
+public:
+  /**
+   * @param next_lsn lsn of the first appended record, recovery continues the lsns of the existing log
+   */
+  explicit LogManager(DiskManager *disk_manager, lsn_t next_lsn = 0);
+
+  /**
+   * Stop the flush thread and flush everything still in the log buffer
+   */
+  ~LogManager();
+
+  /**
+   * Append a log record to the log buffer, the lsn of the record is assigned here
+   * @return lsn of the record
+   */
+  lsn_t AppendLogRecord(LogRecord *log_record);
+
+  /**
+   * Block until all log records with lsn <= lsn are durable
+   */
+  void Flush(lsn_t lsn);
+
+  /**
+   * Block until all appended log records are durable
+   */
+  void FlushAll();
+
+  inline lsn_t GetPersistentLSN() const { return persistent_lsn_; }
+
+  inline lsn_t GetNextLSN() {
+    std::scoped_lock<std::mutex> lock(latch_);
+    return next_lsn_;
+  }
+
+  /**
+   * @return total bytes appended by this log manager, used to decide when to take a checkpoint
+   */
+  inline uint64_t GetAppendedBytes() {
+    std::scoped_lock<std::mutex> lock(latch_);
+    return appended_bytes_;
+  }
+
+  /**
+   * Drop log records with lsn < lsn from the log file. Records are dropped in units of flushed batches,
+   * so a few older records may be kept. Only records that are no longer needed by recovery may be dropped.
+   */
+  void DiscardBefore(lsn_t lsn);
+
+private:
+  void FlushThread();
 
+private:
+  DiskManager *disk_manager_;
+  char *log_buffer_;                          // records are appended here
+  char *flush_buffer_;                        // being written to disk by the flush thread
+  uint32_t log_buffer_offset_{0};
+  lsn_t next_lsn_{0};                         // lsn of the next appended record
+  lsn_t first_buffered_lsn_{INVALID_LSN};     // lsn of the first record in log_buffer_
+  lsn_t last_buffered_lsn_{INVALID_LSN};      // lsn of the last record in log_buffer_
+  uint64_t appended_bytes_{0};
+  bool flushing_{false};                      // flush_buffer_ is being written
+  std::deque<std::pair<lsn_t, uint32_t>> batches_;  // (lsn of the first record, offset in the log file) of each batch
+  std::atomic<lsn_t> persistent_lsn_{INVALID_LSN};
+  lsn_t flush_request_lsn_{INVALID_LSN};      // largest lsn someone is waiting for
+  bool stop_{false};
+  std::mutex latch_;
+  std::condition_variable flush_cv_;          // wakes up the flush thread
+  std::condition_variable append_cv_;         // log buffer has room again
+  std::condition_variable persist_cv_;        // persistent_lsn_ advanced
+  std::thread flush_thread_;
 };
 
 #endif //MINISQL_LOG_MANAGER_H
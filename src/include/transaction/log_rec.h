@@ -0,0 +1,179 @@
+#ifndef MINISQL_LOG_REC_H
+#define MINISQL_LOG_REC_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rowid.h"
+
+enum class LogRecordType {
+  kInvalid = 0,
+  kBegin,
+  kCommit,
+  kAbort,
+  kInsert,          // 插入一个tuple
+  kMarkDelete,      // 标记删除一个tuple
+  kApplyDelete,     // 真正删除一个tuple
+  kRollbackDelete,  // 撤销标记删除
+  kUpdate,          // 原地更新一个tuple
+  kNewPage,         // 新分配的page，redo时整页清零
+  kPageDelta,       // page中若干段字节的新值（物理redo）
+  kIndexInsert,     // 向索引插入一个key
+  kIndexDelete,     // 从索引删除一个key
+  kCheckpoint,      // fuzzy checkpoint，记录当时的dirty page table
+};
+
+/**
+ * LogRecord is the unit written to the write-ahead log.
+ *
+ * Header format (size in bytes):
+ * --------------------------------------------------------------------------------
+ * | Size (4) | Checksum (4) | LSN (4) | TxnId (4) | PrevLSN (4) | LogRecordType (4) |
+ * --------------------------------------------------------------------------------
+ * Size is the size of the whole record including the header, Checksum covers everything after itself,
+ * which lets recovery detect a torn write at the tail of the log.
+ *
+ * Payload format:
+ * kBegin / kCommit / kAbort:   no payload
+ * kInsert / kMarkDelete / kApplyDelete / kRollbackDelete:
+ *   | RowId (8) | TupleSize (4) | Tuple (TupleSize) |
+ * kUpdate:
+ *   | RowId (8) | OldTupleSize (4) | OldTuple | NewTupleSize (4) | NewTuple |
+ * kIndexInsert / kIndexDelete:
+ *   | IndexId (4) | RowId (8) | KeySize (4) | Key (KeySize) |
+ * kNewPage:
+ *   | PageId (4) |
+ * kPageDelta:
+ *   | PageId (4) | Offset_1 (2) | Length_1 (2) | Data_1 | Offset_2 (2) | ... |
+ * kCheckpoint:
+ *   | BeginLSN (4) | DirtyPageCount (4) | PageId_1 (4) | RecLSN_1 (4) | ... |
+ *
+ * Tuple和索引操作的记录是逻辑日志，带有TxnId和PrevLSN，用于撤销未提交的事务；
+ * kNewPage和kPageDelta由BufferPoolManager在page被修改后生成，是与事务无关的物理redo日志。
+ * kCheckpoint中的BeginLSN是收集dirty page table之前的下一个lsn，之后的日志不受这张表的约束。
+ */
+class LogRecord {
+public:
+  static constexpr uint32_t HEADER_SIZE = 24;
+
+  LogRecord() = default;
+
+  /**
+   * Begin / commit / abort record
+   */
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType type)
+      : txn_id_(txn_id), prev_lsn_(prev_lsn), type_(type) {}
+
+  /**
+   * Insert / delete record
+   */
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType type, const RowId &rid, const char *tuple,
+            uint32_t tuple_size);
+
+  /**
+   * Update record
+   */
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, const RowId &rid, const char *old_tuple, uint32_t old_tuple_size,
+            const char *new_tuple, uint32_t new_tuple_size);
+
+  /**
+   * Index insert / delete record, key is the key row serialized with the key schema of the index
+   */
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType type, index_id_t index_id, const RowId &rid,
+            const char *key, uint32_t key_size);
+
+  /**
+   * New page / page delta record, runs of a page delta are added by AppendDeltaRun
+   */
+  LogRecord(LogRecordType type, page_id_t page_id);
+
+  /**
+   * Checkpoint record
+   */
+  LogRecord(lsn_t begin_lsn, const std::vector<std::pair<page_id_t, lsn_t>> &dirty_pages);
+
+  void AppendDeltaRun(uint16_t offset, const char *data, uint16_t length);
+
+  inline uint32_t GetSize() const { return HEADER_SIZE + payload_.size(); }
+
+  inline lsn_t GetLSN() const { return lsn_; }
+
+  inline void SetLSN(lsn_t lsn) { lsn_ = lsn; }
+
+  inline txn_id_t GetTxnId() const { return txn_id_; }
+
+  inline lsn_t GetPrevLSN() const { return prev_lsn_; }
+
+  inline LogRecordType GetType() const { return type_; }
+
+  /**
+   * Only for kInsert / kMarkDelete / kApplyDelete / kRollbackDelete / kUpdate / kIndexInsert / kIndexDelete
+   */
+  RowId GetRowId() const;
+
+  /**
+   * Tuple of insert / delete records, the old tuple of update records, or the key of index records
+   */
+  std::string GetTuple() const;
+
+  /**
+   * Only for kIndexInsert / kIndexDelete
+   */
+  index_id_t GetIndexId() const;
+
+  /**
+   * Only for kCheckpoint
+   */
+  lsn_t GetCheckpointBeginLSN() const;
+
+  /**
+   * Only for kCheckpoint
+   */
+  std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPageTable() const;
+
+  /**
+   * Only for kUpdate
+   */
+  std::string GetNewTuple() const;
+
+  /**
+   * Only for kNewPage / kPageDelta
+   */
+  page_id_t GetPageId() const;
+
+  /**
+   * Apply a kNewPage / kPageDelta record to the content of the page
+   */
+  void ApplyTo(char *page_data) const;
+
+  /**
+   * Note: make sure the buffer has GetSize() bytes
+   */
+  uint32_t SerializeTo(char *buf) const;
+
+  /**
+   * @return false if the buffer does not hold a complete and intact log record
+   */
+  static bool DeserializeFrom(const char *buf, uint32_t size, LogRecord *record);
+
+private:
+  static uint32_t Checksum(const char *buf, uint32_t size);
+
+  /**
+   * Offset of the RowId in the payload
+   */
+  inline uint32_t GetRowIdOffset() const {
+    return (type_ == LogRecordType::kIndexInsert || type_ == LogRecordType::kIndexDelete) ? sizeof(index_id_t) : 0;
+  }
+
+private:
+  lsn_t lsn_{INVALID_LSN};
+  txn_id_t txn_id_{INVALID_TXN_ID};
+  lsn_t prev_lsn_{INVALID_LSN};
+  LogRecordType type_{LogRecordType::kInvalid};
+  std::string payload_;
+};
+
+#endif  // MINISQL_LOG_REC_H
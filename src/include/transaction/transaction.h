@@ -1,13 +1,107 @@
 #ifndef MINISQL_TRANSACTION_H
 #define MINISQL_TRANSACTION_H
 
+#include <atomic>
+#include <deque>
+#include <unordered_set>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "common/rowid.h"
+#include "record/row.h"
+
+class TableHeap;
+class Index;
+
+/**
+ * 两阶段锁：加锁阶段(kGrowing)只能加锁，释放过锁之后(kShrinking)不能再加锁。
+ * 被死锁检测选为牺牲者的事务会被置为kAborted，它的加锁请求全部失败，调用者需要回滚它。
+ */
+enum class TxnState { kGrowing, kShrinking, kCommitted, kAborted };
+
+/**
+ * Type of a write in the write set
+ */
+enum class WType { kInsert = 0, kDelete, kUpdate };
+
+/**
+ * TableWriteRecord remembers a write to a table heap, so that it can be undone on abort.
+ * kDelete means the tuple is marked deleted, it is really deleted when the transaction commits.
+ */
+struct TableWriteRecord {
+  TableWriteRecord(RowId rid, WType wtype, const Row &old_row, TableHeap *table_heap)
+      : rid_(rid), wtype_(wtype), old_row_(old_row), table_heap_(table_heap) {}
+
+  RowId rid_;
+  WType wtype_;
+  Row old_row_;  // tuple before a kUpdate
+  TableHeap *table_heap_;
+};
+
+/**
+ * IndexWriteRecord remembers an insert (kInsert) or a delete (kDelete) of a key in an index
+ */
+struct IndexWriteRecord {
+  IndexWriteRecord(RowId rid, WType wtype, const Row &key, Index *index)
+      : rid_(rid), wtype_(wtype), key_(key), index_(index) {}
+
+  RowId rid_;
+  WType wtype_;
+  Row key_;
+  Index *index_;
+};
+
 /**
- * Transaction tracks information related to a transaction.
- *
- * Implemented by student self
+ * Transaction tracks information related to a transaction: its state, the row locks it holds
+ * and the writes it has done. Only the thread running the transaction touches the lock sets and write sets.
 */
 class Transaction {
+public:
+  explicit Transaction(txn_id_t txn_id = INVALID_TXN_ID) : txn_id_(txn_id) {}
+
+  DISALLOW_COPY(Transaction)
+
+  inline txn_id_t GetTransactionId() const { return txn_id_; }
+
+  inline TxnState GetState() const { return state_; }
+
+  inline void SetState(TxnState state) { state_ = state; }
+
+  /**
+   * @return lsn of the last log record written by this transaction
+   */
+  inline lsn_t GetPrevLSN() const { return prev_lsn_; }
+
+  inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
+
+  /**
+   * @return lsn of the begin record of this transaction
+   */
+  inline lsn_t GetBeginLSN() const { return begin_lsn_; }
+
+  inline void SetBeginLSN(lsn_t begin_lsn) { begin_lsn_ = begin_lsn; }
+
+  inline std::unordered_set<RowId> &GetSharedLockSet() { return shared_lock_set_; }
+
+  inline std::unordered_set<RowId> &GetExclusiveLockSet() { return exclusive_lock_set_; }
+
+  inline bool IsSharedLocked(const RowId &rid) const { return shared_lock_set_.count(rid) != 0; }
+
+  inline bool IsExclusiveLocked(const RowId &rid) const { return exclusive_lock_set_.count(rid) != 0; }
+
+  inline std::deque<TableWriteRecord> &GetTableWriteSet() { return table_write_set_; }
+
+  inline std::deque<IndexWriteRecord> &GetIndexWriteSet() { return index_write_set_; }
 
+private:
+  txn_id_t txn_id_;
+  std::atomic<TxnState> state_{TxnState::kGrowing};  // the deadlock detector aborts transactions from its own thread
+  lsn_t prev_lsn_{INVALID_LSN};
+  lsn_t begin_lsn_{INVALID_LSN};
+  std::unordered_set<RowId> shared_lock_set_;
+  std::unordered_set<RowId> exclusive_lock_set_;
+  std::deque<TableWriteRecord> table_write_set_;
+  std::deque<IndexWriteRecord> index_write_set_;
 };
 
 #endif  // MINISQL_TRANSACTION_H
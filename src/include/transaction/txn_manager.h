@@ -0,0 +1,56 @@
+#ifndef MINISQL_TXN_MANAGER_H
+#define MINISQL_TXN_MANAGER_H
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+#include "transaction/lock_manager.h"
+#include "transaction/log_manager.h"
+#include "transaction/transaction.h"
+
+/**
+ * TransactionManager creates transactions and drives them to commit or abort.
+ */
+class TransactionManager {
+public:
+  /**
+   * @param next_txn_id id of the first transaction, recovery continues the ids found in the existing log
+   */
+  explicit TransactionManager(LogManager *log_manager, LockManager *lock_manager = nullptr, txn_id_t next_txn_id = 0)
+      : log_manager_(log_manager), lock_manager_(lock_manager), next_txn_id_(next_txn_id) {}
+
+  ~TransactionManager();
+
+  /**
+   * Start a new transaction, the returned object is owned by the transaction manager
+   */
+  Transaction *Begin();
+
+  /**
+   * Apply the deletes of the transaction, write the commit record and wait until it is durable (group commit),
+   * then release the locks. The transaction object is released
+   */
+  void Commit(Transaction *txn);
+
+  /**
+   * Undo the writes of the transaction in reverse order, write the abort record and release the locks.
+   * The transaction object is released
+   */
+  void Abort(Transaction *txn);
+
+  /**
+   * @return smallest begin lsn of the running transactions, INVALID_LSN if there is none.
+   * Log records before it are not needed to undo any running transaction.
+   */
+  lsn_t GetOldestBeginLSN();
+
+private:
+  LogManager *log_manager_;
+  LockManager *lock_manager_;
+  std::atomic<txn_id_t> next_txn_id_{0};
+  std::mutex latch_;
+  std::unordered_map<txn_id_t, Transaction *> txn_map_;  // running transactions
+};
+
+#endif  // MINISQL_TXN_MANAGER_H
@@ -17,12 +17,14 @@ BPLUSTREE_TYPE::BPlusTree(index_id_t index_id, BufferPoolManager *buffer_pool_ma
   // 初始化为空
   root_page_id_ = INVALID_PAGE_ID;
   auto index_roots_page = buffer_pool_manager->FetchPage(INDEX_ROOTS_PAGE_ID);
+  index_roots_page->RLatch();
   auto index_roots = reinterpret_cast<IndexRootsPage*>(index_roots_page->GetData());
   page_id_t* root_page_id_receiver = new page_id_t();
   if (index_roots->GetRootId(index_id, root_page_id_receiver)) {
     root_page_id_ = *root_page_id_receiver;
   }
   delete root_page_id_receiver;
+  index_roots_page->RUnlatch();
   buffer_pool_manager->UnpinPage(INDEX_ROOTS_PAGE_ID, false);
 }
 
@@ -44,46 +46,237 @@ bool BPLUSTREE_TYPE::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID;
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> &result, Transaction *transaction) {
-  auto leaf_page = FindLeafPage(key);
-  if (leaf_page == nullptr) return false;
-  auto leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(leaf_page->GetData());
+  LatchContext ctx(Operation::kRead, true);
+  auto leaf_page = FindLeafPage(key, false, &ctx);
   bool res = false;
-  if (leaf != nullptr) {
+  if (leaf_page != nullptr) {
+    auto leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(leaf_page->GetData());
     ValueType value;
     if (leaf->Lookup(key, value, comparator_)) {
       result.push_back(value);
       res = true;
     }
   }
-  buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+  ReleaseLatches(&ctx, false);
   return res;
 }
 
+/*
+ * 只从根往下找一次起点所在的叶子，然后沿着叶子链表往右走，超过上界就停。
+ * 换到下一片叶子时先放掉当前叶子的latch再给下一片加latch（和iterator一样），
+ * 否则和从右往左latch兄弟的合并操作可能死锁。
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::ScanRange(const KeyType *lower, bool lower_inclusive, const KeyType *upper,
+                               bool upper_inclusive, std::vector<ValueType> &result, Transaction *transaction) {
+  LatchContext ctx(Operation::kRead, true);
+  KeyType leftmost{};
+  auto page = FindLeafPage(lower != nullptr ? *lower : leftmost, lower == nullptr, &ctx);
+  if (page == nullptr) {
+    ReleaseLatches(&ctx, false);
+    return true;
+  }
+  // 读操作在FindLeafPage里已经放掉了所有祖先，之后叶子的latch和pin由这里自己管理
+  ctx.pages_.clear();
+  auto leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+  int index = 0;
+  if (lower != nullptr) {
+    index = leaf->LowerBound(*lower, comparator_);
+    if (!lower_inclusive && index < leaf->GetSize() && comparator_(leaf->KeyAt(index), *lower) == 0) {
+      index++;
+    }
+  }
+  while (true) {
+    for (; index < leaf->GetSize(); index++) {
+      auto &item = leaf->GetItem(index);
+      if (upper != nullptr) {
+        int cmp = comparator_(item.first, *upper);
+        if (cmp > 0 || (cmp == 0 && !upper_inclusive)) {
+          page->RUnlatch();
+          buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+          return true;
+        }
+      }
+      result.push_back(item.second);
+    }
+    page_id_t next_page_id = leaf->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    if (next_page_id == INVALID_PAGE_ID) {
+      return true;
+    }
+    // 当前叶子已经放掉了，buffer pool满了拿不到下一片叶子时直接返回错误
+    page = buffer_pool_manager_->FetchPage(next_page_id);
+    if (page == nullptr) {
+      return false;
+    }
+    page->RLatch();
+    leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+    index = 0;
+  }
+}
+
 // ***************************************INSERTION********************************************
 
 /*
  * Insert constant key & value pair into b+ tree
  * if current tree is empty, start new tree, update root page id and insert
  * entry, otherwise insert into leaf page.
+ * 先乐观地只给叶子加写latch，叶子满了（会分裂）或者树是空的，再悲观地一路加写latch重来一次
  * @return: since we only support unique key, if user try to insert duplicate
  * keys return false, otherwise return true.
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) {
-  bool res = false;
-  if (IsEmpty()) {
-    StartNewTree(key, value);
-    res = true;
+  for (bool optimistic : {true, false}) {
+    LatchContext ctx(Operation::kInsert, optimistic);
+    auto page = FindLeafPage(key, false, &ctx);
+    if (page == nullptr) {
+      // 悲观模式下持有root_latch_的写latch，可以建新树
+      if (!optimistic) {
+        StartNewTree(key, value);
+      }
+      ReleaseLatches(&ctx, false);
+      if (optimistic) {
+        continue;
+      }
+      return true;
+    }
+    auto leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+    ValueType tmp = value;
+    if (leaf->Lookup(key, tmp, comparator_)) {
+      ReleaseLatches(&ctx, false);
+      return false;
+    }
+    if (optimistic && !IsSafe(leaf, Operation::kInsert)) {
+      ReleaseLatches(&ctx, false);
+      continue;
+    }
+    InsertIntoLeaf(leaf, key, value, &ctx);
+    ReleaseLatches(&ctx, true);
+    return true;
+  }
+  return false;
+}
+
+/*
+ * 自底向上建树：先算出每一层要多少页，再按key的顺序依次填满叶子，每开一个新页就把它挂到上一层当前的页上。
+ * 每层只有当前页被pin住，page都是新的，别人在root_page_id_设置好之前看不到，不需要加latch
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::BulkLoad(size_t count, const std::function<void(KeyType *, ValueType *)> &next,
+                              double fill_factor) {
+  root_latch_.WLock();
+  if (!IsEmpty()) {
+    root_latch_.WUnlock();
+    return false;
+  }
+  if (count == 0) {
+    root_latch_.WUnlock();
+    return true;
+  }
+  auto levels = PlanBulkLoad(count, fill_factor);
+  KeyType key;
+  ValueType value;
+  for (size_t i = 0; i < count; i++) {
+    next(&key, &value);
+    if (levels[0].page_ == nullptr || levels[0].filled_ == levels[0].PageSize()) {
+      NewBulkPage(&levels, 0, key);
+    }
+    // key是递增的，Insert总是追加在末尾
+    reinterpret_cast<LeafPage *>(levels[0].page_)->Insert(key, value, comparator_);
+    levels[0].filled_++;
+  }
+  for (auto &level : levels) {
+    ASSERT(level.page_index_ + 1 == level.page_count_ && level.filled_ == level.PageSize(), "Unexpected bulk load.");
+    buffer_pool_manager_->UnpinPage(level.page_->GetPageId(), true);
+  }
+  root_page_id_ = levels.back().page_->GetPageId();
+  UpdateRootPageId(true);
+  root_latch_.WUnlock();
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+std::vector<typename BPLUSTREE_TYPE::BulkLevel> BPLUSTREE_TYPE::PlanBulkLoad(size_t count, double fill_factor) const {
+  // 填充率低于一半的话页会比最小大小还小
+  fill_factor = std::min(1.0, std::max(0.5, fill_factor));
+  std::vector<BulkLevel> levels;
+  size_t entry_count = count;
+  int max_size = leaf_max_size_;
+  while (true) {
+    size_t target = std::max<size_t>(2, static_cast<size_t>(max_size * fill_factor));
+    size_t page_count = (entry_count + target - 1) / target;
+    // 平均分配后每页都不能少于最小大小（非根页）
+    size_t min_size = (max_size + 1) / 2;
+    while (page_count > 1 && entry_count / page_count < min_size) {
+      page_count--;
+    }
+    levels.push_back(BulkLevel{page_count, entry_count});
+    if (page_count == 1) {
+      return levels;
+    }
+    entry_count = page_count;
+    max_size = internal_max_size_;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::NewBulkPage(std::vector<BulkLevel> *levels, size_t level, const KeyType &key) {
+  page_id_t page_id;
+  auto page = buffer_pool_manager_->NewPage(page_id);
+  if (page == nullptr) {
+    throw Exception("out of memory");
+  }
+  BulkLevel &current = (*levels)[level];
+  BPlusTreePage *node;
+  if (level == 0) {
+    auto leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    leaf->Init(page_id, INVALID_PAGE_ID, leaf_max_size_);
+    if (current.page_ != nullptr) {
+      reinterpret_cast<LeafPage *>(current.page_)->SetNextPageId(page_id);
+    }
+    node = leaf;
   } else {
-    res = InsertIntoLeaf(key, value, transaction);
+    auto internal = reinterpret_cast<InternalPage *>(page->GetData());
+    internal->Init(page_id, INVALID_PAGE_ID, internal_max_size_);
+    node = internal;
+  }
+  if (current.page_ != nullptr) {
+    buffer_pool_manager_->UnpinPage(current.page_->GetPageId(), true);
+    current.page_index_++;
+  }
+  current.page_ = node;
+  current.filled_ = 0;
+  if (level + 1 < levels->size()) {
+    AppendBulkChild(levels, level + 1, key, node);
   }
-  return res;
 }
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::AppendBulkChild(std::vector<BulkLevel> *levels, size_t level, const KeyType &key,
+                                     BPlusTreePage *child) {
+  BulkLevel &current = (*levels)[level];
+  if (current.page_ == nullptr || current.filled_ == current.PageSize()) {
+    NewBulkPage(levels, level, key);
+  }
+  auto parent = reinterpret_cast<InternalPage *>(current.page_);
+  // 内部页Init之后size就是1，第一个孩子的key不使用
+  if (current.filled_ > 0) {
+    parent->SetKeyAt(current.filled_, key);
+    parent->IncreaseSize(1);
+  }
+  parent->SetValueAt(current.filled_, child->GetPageId());
+  child->SetParentPageId(parent->GetPageId());
+  current.filled_++;
+}
+
 /*
  * Insert constant key & value pair into an empty tree
  * User needs to first ask for new page from buffer pool manager(NOTICE: throw
  * an "out of memory" exception if returned value is nullptr), then update b+
  * tree's root page id and insert entry directly into leaf page.
+ * 调用者持有root_latch_的写latch
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
@@ -101,39 +294,26 @@ void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
 
 /*
  * Insert constant key & value pair into leaf page
- * User needs to first find the right leaf page as insertion target, then look
- * through leaf page to see whether insert key exist or not. If exist, return
- * immediately, otherwise insert entry. Remember to deal with split if necessary.
- * @return: since we only support unique key, if user try to insert duplicate
- * keys return false, otherwise return true.
+ * The leaf is write latched and does not contain key. Split it if necessary,
+ * in that case all the pages that may be changed by the split are latched in ctx.
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction) {
-  auto leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(FindLeafPage(key)->GetData());
-  if (leaf == nullptr) {
-    throw Exception("insert failed");
-  }
-  ValueType tmp = value;
-  if (leaf->Lookup(key, tmp, comparator_)) {
-    buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
-    return false;
-  }
+void BPLUSTREE_TYPE::InsertIntoLeaf(LeafPage *leaf, const KeyType &key, const ValueType &value, LatchContext *ctx) {
   if (leaf->GetSize() < leaf->GetMaxSize()) {
     leaf->Insert(key, value, comparator_);
+    return;
+  }
+  // 新的兄弟在父亲指向它之前别人看不到，父亲被我们持有写latch，所以不需要给它加latch
+  auto sibling = Split<B_PLUS_TREE_LEAF_PAGE_TYPE>(leaf);
+  if (comparator_(key, sibling->KeyAt(0)) < 0) {
+    leaf->Insert(key, value, comparator_);
   } else {
-    auto sibling = Split<B_PLUS_TREE_LEAF_PAGE_TYPE>(leaf);
-    if (comparator_(key, sibling->KeyAt(0)) < 0) {
-      leaf->Insert(key, value, comparator_);
-    } else {
-      sibling->Insert(key, value, comparator_);
-    }
-    sibling->SetNextPageId(leaf->GetNextPageId());
-    leaf->SetNextPageId(sibling->GetPageId());
-    InsertIntoParent(leaf, sibling->KeyAt(0), sibling, transaction);
-    buffer_pool_manager_->UnpinPage(sibling->GetPageId(), true);
+    sibling->Insert(key, value, comparator_);
   }
-  buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
-  return true;
+  sibling->SetNextPageId(leaf->GetNextPageId());
+  leaf->SetNextPageId(sibling->GetPageId());
+  InsertIntoParent(leaf, sibling->KeyAt(0), sibling, ctx);
+  buffer_pool_manager_->UnpinPage(sibling->GetPageId(), true);
 }
 
 /*
@@ -165,11 +345,13 @@ N *BPLUSTREE_TYPE::Split(N *node) {
  * User needs to first find the parent page of old_node, parent node must be
  * adjusted to take info of new_node into account. Remember to deal with split
  * recursively if necessary.
+ * old_node不安全，所以它的父亲（或者old_node是根时的root_latch_）一定还在ctx里被加着写latch
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
-                                      Transaction *transaction) {
+                                      LatchContext *ctx) {
   if (old_node->IsRootPage()) {
+    ASSERT(ctx->root_latched_, "Root latch must be held to change the root.");
     auto page = buffer_pool_manager_->NewPage(root_page_id_);
     if (page == nullptr) {
       throw Exception("out of memory");
@@ -209,7 +391,7 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
       }
 
       //      buffer_pool_manager_->UnpinPage(new_node->GetPageId(), true);
-      InsertIntoParent(parent_page, sibling_page->KeyAt(0), sibling_page);
+      InsertIntoParent(parent_page, sibling_page->KeyAt(0), sibling_page, ctx);
       buffer_pool_manager_->UnpinPage(sibling_page->GetPageId(), true);
     }
     buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
@@ -225,66 +407,48 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
  * If not, User needs to first find the right leaf page as deletion target, then
  * delete entry from leaf page. Remember to deal with redistribute or merge if
  * necessary.
+ * 和插入一样先乐观地只给叶子加写latch，删除后叶子会不足半满时再悲观地重来一次。
+ * 删除叶子的第一个key时不再更新祖先中的key：内部节点的key只需要是右边子树的下界，删掉最小的key后依然成立
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
-  if (IsEmpty()) return;
-  bool if_delete = false;
-  auto page = FindLeafPage(key);
-  auto leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page);
-  if (leaf != nullptr) {
-    int ori_size = leaf->GetSize();
-    // 如果ori_key_index不为ori_size，则有此记录
-    int ori_key_index = leaf->KeyIndex(key, comparator_);
-    if (ori_key_index != ori_size) {
-      leaf->RemoveAndDeleteRecord(key, comparator_);
-      // 更新父亲节点的索引
-      // 这里需要一个循环一路更新上去
-      if (!leaf->IsRootPage() && ori_key_index == 0) {
-        //        auto parent_page = buffer_pool_manager_->FetchPage(leaf->GetParentPageId());
-        //        auto parent = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t,
-        //        KeyComparator>*>(parent_page->GetData()); parent->SetKeyAt(parent->ValueIndex(leaf->GetPageId()),
-        //        leaf->KeyAt(0)); buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
-        UpdateParentKey(leaf);
-      }
-      if (leaf->GetSize() < leaf->GetMinSize()) {
-        if_delete = CoalesceOrRedistribute(leaf, transaction);
-      }
+  for (bool optimistic : {true, false}) {
+    LatchContext ctx(Operation::kRemove, optimistic);
+    auto page = FindLeafPage(key, false, &ctx);
+    if (page == nullptr) {
+      ReleaseLatches(&ctx, false);
+      return;
     }
+    auto leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+    // 如果KeyIndex不为size，则有此记录
+    if (leaf->KeyIndex(key, comparator_) == leaf->GetSize()) {
+      ReleaseLatches(&ctx, false);
+      return;
+    }
+    if (optimistic && !IsSafe(leaf, Operation::kRemove)) {
+      ReleaseLatches(&ctx, false);
+      continue;
+    }
+    leaf->RemoveAndDeleteRecord(key, comparator_);
+    if (leaf->GetSize() < leaf->GetMinSize() && CoalesceOrRedistribute(leaf, &ctx)) {
+      ctx.deleted_pages_.push_back(leaf->GetPageId());
+    }
+    ReleaseLatches(&ctx, true);
+    return;
   }
-  buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
-  if (if_delete) {
-    buffer_pool_manager_->DeletePage(page->GetPageId());
-  }
-}
-
-/*
- * 递归地更新父亲节点的key值
- */
-INDEX_TEMPLATE_ARGUMENTS
-template <typename N>
-void BPLUSTREE_TYPE::UpdateParentKey(N *node) {
-  if (node->IsRootPage()) return;
-  auto parent_page = buffer_pool_manager_->FetchPage(node->GetParentPageId());
-  auto parent = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(parent_page->GetData());
-  int update_index = parent->ValueIndex(node->GetPageId());
-  parent->SetKeyAt(update_index, node->KeyAt(0));
-  if (update_index == 0) {
-    UpdateParentKey(parent);
-  }
-  buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
 }
 
 /*
  * User needs to first find the sibling of input page. If sibling's size + input
  * page's size > page's max size, then redistribute. Otherwise, merge.
  * Using template N to represent either internal page or leaf page.
+ * node不安全，所以它的父亲一定还在ctx里被加着写latch，兄弟只能经过父亲访问，在这里加写latch
  * @return: true means target leaf page should be deleted, false means no
  * deletion happens
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
+bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, LatchContext *ctx) {
   if (node->IsRootPage()) {
     return AdjustRoot(node);
   }
@@ -305,7 +469,8 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
   if (sibling_page == nullptr) {
     throw Exception("out of memory");
   }
-  auto sibling = reinterpret_cast<N *>(sibling_page);
+  sibling_page->WLatch();
+  auto sibling = reinterpret_cast<N *>(sibling_page->GetData());
   bool if_delete = false;
   bool if_delete_parent = false;
   if (sibling->GetSize() + node->GetSize() > node->GetMaxSize()) {
@@ -318,25 +483,28 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
     //      Redistribute<N>(sibling, node, 1);
     //    }
     Redistribute<N>(sibling, node, node_index);
-    buffer_pool_manager_->UnpinPage(sibling->GetPageId(), true);
+    buffer_pool_manager_->UnpinPage(sibling_page_id, true);
+    sibling_page->WUnlatch();
   } else {
     // merge
     if (node_index == 0) {
       // 后面的兄弟合并进node，node不用删除
       if_delete = false;
-      if_delete_parent = Coalesce<N>(node, sibling, parent, 1, transaction);
+      if_delete_parent = Coalesce<N>(node, sibling, parent, 1, ctx);
       buffer_pool_manager_->UnpinPage(sibling_page_id, true);
-      buffer_pool_manager_->DeletePage(sibling_page_id);
+      sibling_page->WUnlatch();
+      ctx->deleted_pages_.push_back(sibling_page_id);
     } else {
       // node合并进前面的兄弟
       if_delete = true;
-      if_delete_parent = Coalesce<N>(sibling, node, parent, node_index, transaction);
-      buffer_pool_manager_->UnpinPage(sibling->GetPageId(), true);
+      if_delete_parent = Coalesce<N>(sibling, node, parent, node_index, ctx);
+      buffer_pool_manager_->UnpinPage(sibling_page_id, true);
+      sibling_page->WUnlatch();
     }
   }
   buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
   if (if_delete_parent) {
-    buffer_pool_manager_->DeletePage(parent->GetPageId());
+    ctx->deleted_pages_.push_back(parent->GetPageId());
   }
   return if_delete;
 }
@@ -356,14 +524,14 @@ INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
 bool BPLUSTREE_TYPE::Coalesce(N *neighbor_node, N *node,
                               BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *parent, int index,
-                              Transaction *transaction) {
+                              LatchContext *ctx) {
   // 从parent中获取node的第一个key（如果node是internal的话）
   node->MoveAllTo(neighbor_node, parent->KeyAt(index), buffer_pool_manager_);
   // 因为合并了，所以parent需要砍掉一个key
   parent->Remove(index);
   bool if_delete = false;
   if (parent->GetSize() < parent->GetMinSize()) {
-    if_delete = CoalesceOrRedistribute(parent, transaction);
+    if_delete = CoalesceOrRedistribute(parent, ctx);
   }
   return if_delete;
 }
@@ -490,9 +658,44 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::End() {
  */
 INDEX_TEMPLATE_ARGUMENTS
 Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
+  LatchContext ctx(Operation::kRead, true);
+  auto page = FindLeafPage(key, leftMost, &ctx);
+  if (page == nullptr) {
+    ReleaseLatches(&ctx, false);
+    return nullptr;
+  }
+  // 只留下pin
+  page->RUnlatch();
+  return page;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, LatchContext *ctx) {
+  // 只有悲观的写操作会修改root_page_id_
+  bool exclusive = ctx->op_ != Operation::kRead && !ctx->optimistic_;
+  if (exclusive) {
+    root_latch_.WLock();
+  } else {
+    root_latch_.RLock();
+  }
+  ctx->root_latched_ = true;
   if (root_page_id_ == INVALID_PAGE_ID) return nullptr;
   auto node = buffer_pool_manager_->FetchPage(root_page_id_);
-  while (!reinterpret_cast<BPlusTreePage *>(node->GetData())->IsLeafPage()) {
+  while (true) {
+    // page的类型在它被删除之前不会改变，而父亲（或root_latch_）的latch保证了它不会被删除，所以可以先看类型再加latch
+    if (IsWriteLatched(node, ctx)) {
+      node->WLatch();
+    } else {
+      node->RLatch();
+    }
+    ctx->pages_.push_back(node);
+    auto tree_node = reinterpret_cast<BPlusTreePage *>(node->GetData());
+    if (!exclusive || IsSafe(tree_node, ctx->op_)) {
+      ReleaseAncestors(ctx);
+    }
+    if (tree_node->IsLeafPage()) {
+      break;
+    }
     auto internal_node = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(node->GetData());
     page_id_t child_page_id;
     if (leftMost) {
@@ -500,13 +703,82 @@ Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
     } else {
       child_page_id = internal_node->Lookup(key, comparator_);
     }
-    buffer_pool_manager_->UnpinPage(internal_node->GetPageId(), false);
     node = buffer_pool_manager_->FetchPage(child_page_id);
   }
   // 退出循环后，这里已经是叶子节点
   return node;
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsSafe(BPlusTreePage *node, Operation op) const {
+  if (op == Operation::kInsert) {
+    return node->GetSize() < node->GetMaxSize();
+  }
+  if (op == Operation::kRemove) {
+    return node->GetSize() > node->GetMinSize();
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsWriteLatched(Page *page, LatchContext *ctx) const {
+  if (ctx->op_ == Operation::kRead) {
+    return false;
+  }
+  return !ctx->optimistic_ || reinterpret_cast<BPlusTreePage *>(page->GetData())->IsLeafPage();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleaseAncestors(LatchContext *ctx) {
+  if (ctx->root_latched_) {
+    if (ctx->op_ != Operation::kRead && !ctx->optimistic_) {
+      root_latch_.WUnlock();
+    } else {
+      root_latch_.RUnlock();
+    }
+    ctx->root_latched_ = false;
+  }
+  while (ctx->pages_.size() > 1) {
+    auto page = ctx->pages_.front();
+    ctx->pages_.pop_front();
+    bool write_latched = IsWriteLatched(page, ctx);
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    if (write_latched) {
+      page->WUnlatch();
+    } else {
+      page->RUnlatch();
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleaseLatches(LatchContext *ctx, bool is_dirty) {
+  if (ctx->root_latched_) {
+    if (ctx->op_ != Operation::kRead && !ctx->optimistic_) {
+      root_latch_.WUnlock();
+    } else {
+      root_latch_.RUnlock();
+    }
+    ctx->root_latched_ = false;
+  }
+  // 先unpin再释放latch，这样page delta的日志不会记下别人改了一半的内容
+  for (auto page : ctx->pages_) {
+    bool write_latched = IsWriteLatched(page, ctx);
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), is_dirty && write_latched);
+    if (write_latched) {
+      page->WUnlatch();
+    } else {
+      page->RUnlatch();
+    }
+  }
+  ctx->pages_.clear();
+  // 父亲已经不再指向这些page，释放latch之后不会再有人pin它们
+  for (auto page_id : ctx->deleted_pages_) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+  ctx->deleted_pages_.clear();
+}
+
 /*
  * Update/Insert root page id in header page(where page_id = 0, header_page is
  * defined under include/page/header_page.h)
@@ -521,6 +793,8 @@ void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
   if (index_roots_page == nullptr) {
     throw Exception("out of memory");
   }
+  // 所有索引共用这一页
+  index_roots_page->WLatch();
   auto index_roots = reinterpret_cast<IndexRootsPage *>(index_roots_page->GetData());
   if (insert_record) {
     index_roots->Insert(index_id_, root_page_id_);
@@ -528,6 +802,7 @@ void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
     index_roots->Update(index_id_, root_page_id_);
   }
   buffer_pool_manager_->UnpinPage(INDEX_ROOTS_PAGE_ID, true);
+  index_roots_page->WUnlatch();
 }
 
 /**
@@ -1,10 +1,14 @@
 #include "index/b_plus_tree_index.h"
+
+#include <algorithm>
+#include <queue>
+
 #include "index/generic_key.h"
 
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(index_id_t index_id, IndexSchema *key_schema,
-                                     BufferPoolManager *buffer_pool_manager)
-        : Index(index_id, key_schema),
+                                     BufferPoolManager *buffer_pool_manager, LogManager *log_manager)
+        : Index(index_id, key_schema, log_manager),
           comparator_(key_schema_),
           container_(index_id, buffer_pool_manager, comparator_) {
 
@@ -21,6 +25,7 @@ dberr_t BPLUSTREE_INDEX_TYPE::InsertEntry(const Row &key, RowId row_id, Transact
   if (!status) {
     return DB_FAILED;
   }
+  RecordIndexWrite(LogRecordType::kIndexInsert, key, row_id, txn);
   return DB_SUCCESS;
 }
 
@@ -28,7 +33,16 @@ INDEX_TEMPLATE_ARGUMENTS
 dberr_t BPLUSTREE_INDEX_TYPE::RemoveEntry(const Row &key, RowId row_id, Transaction *txn) {
   KeyType index_key;
   index_key.SerializeFromKey(key, key_schema_);
+  if (txn != nullptr) {
+    // key不存在时不能记录，否则回滚会插入一个从未存在过的key
+    std::vector<RowId> result;
+    if (!container_.GetValue(index_key, result, txn)) {
+      return DB_SUCCESS;
+    }
+    row_id = result[0];
+  }
   container_.Remove(index_key, txn);
+  RecordIndexWrite(LogRecordType::kIndexDelete, key, row_id, txn);
   return DB_SUCCESS;
 }
 
@@ -41,37 +55,176 @@ dberr_t BPLUSTREE_INDEX_TYPE::ScanKey(const Row &key, vector<RowId> &result, Tra
       return DB_SUCCESS;
     }
     return DB_KEY_NOT_FOUND;
-  } else if (condition == ">") {
-    auto iter = GetBeginIterator(index_key);
-    if (iter != GetEndIterator() && comparator_((*iter).first, index_key) == 0) {
-      ++iter;
+  }
+  bool ok = true;
+  if (condition == ">") {
+    ok = container_.ScanRange(&index_key, false, nullptr, false, result, txn);
+  } else if (condition == ">=") {
+    ok = container_.ScanRange(&index_key, true, nullptr, false, result, txn);
+  } else if (condition == "<") {
+    ok = container_.ScanRange(nullptr, false, &index_key, false, result, txn);
+  } else if (condition == "<=") {
+    ok = container_.ScanRange(nullptr, false, &index_key, true, result, txn);
+  }
+  return ok ? DB_SUCCESS : DB_FAILED;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+dberr_t BPLUSTREE_INDEX_TYPE::ScanRange(const Row *lower, bool lower_inclusive, const Row *upper,
+                                        bool upper_inclusive, vector<RowId> &result, Transaction *txn) {
+  KeyType lower_key;
+  KeyType upper_key;
+  if (lower != nullptr) {
+    lower_key.SerializeFromKey(*lower, key_schema_);
+  }
+  if (upper != nullptr) {
+    upper_key.SerializeFromKey(*upper, key_schema_);
+  }
+  if (!container_.ScanRange(lower != nullptr ? &lower_key : nullptr, lower_inclusive,
+                            upper != nullptr ? &upper_key : nullptr, upper_inclusive, result, txn)) {
+    return DB_FAILED;
+  }
+  return DB_SUCCESS;
+}
+
+/*
+ * 先把所有key排好序再自底向上建树（或按key的顺序插入非空的树）。内存里放不下时（超过sort_memory_），
+ * 每满一段就排好序写到临时文件，最后多路归并成一个去重后的文件，建树需要事先知道条目数
+ */
+INDEX_TEMPLATE_ARGUMENTS
+dberr_t BPLUSTREE_INDEX_TYPE::BulkLoad(const std::function<bool(std::vector<Field> *, RowId *)> &next,
+                                       double fill_factor, std::vector<RowId> *duplicates) {
+  // 稳定排序，相同的key先出现的在前面
+  auto less = [this](const BulkEntry &a, const BulkEntry &b) { return comparator_(a.key_, b.key_) < 0; };
+  const size_t run_size = std::max<size_t>(1, sort_memory_ / sizeof(BulkEntry));
+  std::vector<BulkEntry> entries;
+  std::vector<FILE *> runs;
+  auto close_runs = [&runs]() {
+    for (auto run : runs) {
+      fclose(run);
     }
-    while (iter != GetEndIterator()) {
-      result.emplace_back((*iter).second);
-      ++iter;
+  };
+  std::vector<Field> fields;
+  BulkEntry entry;
+  while (true) {
+    bool has_next = next(&fields, &entry.value_);
+    if (has_next) {
+      Row key(fields);
+      entry.key_.SerializeFromKey(key, key_schema_);
+      fields.clear();
+      entries.push_back(entry);
     }
-  } else if (condition == ">=") {
-    auto iter = GetBeginIterator(index_key);
-    while (iter != GetEndIterator()) {
-      result.emplace_back((*iter).second);
-      ++iter;
+    if (entries.size() == run_size || (!has_next && !runs.empty() && !entries.empty())) {
+      std::stable_sort(entries.begin(), entries.end(), less);
+      FILE *run = tmpfile();
+      if (run != nullptr) {
+        runs.push_back(run);
+      }
+      if (run == nullptr || fwrite(entries.data(), sizeof(BulkEntry), entries.size(), run) != entries.size()) {
+        close_runs();
+        return DB_FAILED;
+      }
+      entries.clear();
     }
-  } else if (condition == "<") {
-    auto iter = GetBeginIterator();
-    while (iter != GetEndIterator() && comparator_((*iter).first, index_key) < 0) {
-      result.emplace_back((*iter).second);
-      ++iter;
+    if (!has_next) {
+      break;
     }
-  } else if (condition == "<=") {
-    auto iter = GetBeginIterator();
-    while (iter != GetEndIterator() && comparator_((*iter).first, index_key) <= 0) {
-      result.emplace_back((*iter).second);
-      ++iter;
+  }
+  if (runs.empty()) {
+    std::stable_sort(entries.begin(), entries.end(), less);
+    size_t count = 0;
+    for (auto &sorted_entry : entries) {
+      if (count > 0 && comparator_(entries[count - 1].key_, sorted_entry.key_) == 0) {
+        if (duplicates != nullptr) {
+          duplicates->push_back(sorted_entry.value_);
+        }
+        continue;
+      }
+      entries[count++] = sorted_entry;
     }
+    size_t i = 0;
+    LoadSorted(count, [&](KeyType *key, ValueType *value) {
+      *key = entries[i].key_;
+      *value = entries[i].value_;
+      i++;
+    }, fill_factor, duplicates);
+    return DB_SUCCESS;
   }
+  FILE *merged = tmpfile();
+  int64_t count = merged != nullptr ? MergeRuns(runs, merged, duplicates) : -1;
+  close_runs();
+  if (count < 0) {
+    if (merged != nullptr) {
+      fclose(merged);
+    }
+    return DB_FAILED;
+  }
+  rewind(merged);
+  LoadSorted(count, [&](KeyType *key, ValueType *value) {
+    size_t __attribute__((unused)) read_count = fread(&entry, sizeof(BulkEntry), 1, merged);
+    ASSERT(read_count == 1, "Failed to read sorted index entries.");
+    *key = entry.key_;
+    *value = entry.value_;
+  }, fill_factor, duplicates);
+  fclose(merged);
   return DB_SUCCESS;
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::LoadSorted(size_t count, const std::function<void(KeyType *, ValueType *)> &next,
+                                      double fill_factor, std::vector<RowId> *duplicates) {
+  if (container_.BulkLoad(count, next, fill_factor)) {
+    return;
+  }
+  // 树不是空的，按key的顺序插入，相邻的key大多落在同一片叶子上
+  KeyType key;
+  ValueType value;
+  for (size_t i = 0; i < count; i++) {
+    next(&key, &value);
+    if (!container_.Insert(key, value) && duplicates != nullptr) {
+      duplicates->push_back(value);
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int64_t BPLUSTREE_INDEX_TYPE::MergeRuns(const std::vector<FILE *> &runs, FILE *out, std::vector<RowId> *duplicates) {
+  // 堆顶是key最小的条目，key相同时是编号小的段，也就是先出现的条目
+  using HeapItem = std::pair<BulkEntry, size_t>;
+  auto greater = [this](const HeapItem &a, const HeapItem &b) {
+    int cmp = comparator_(a.first.key_, b.first.key_);
+    return cmp != 0 ? cmp > 0 : a.second > b.second;
+  };
+  std::priority_queue<HeapItem, std::vector<HeapItem>, decltype(greater)> heap(greater);
+  HeapItem item;
+  for (size_t i = 0; i < runs.size(); i++) {
+    rewind(runs[i]);
+    item.second = i;
+    if (fread(&item.first, sizeof(BulkEntry), 1, runs[i]) == 1) {
+      heap.push(item);
+    }
+  }
+  int64_t count = 0;
+  KeyType last_key;
+  while (!heap.empty()) {
+    item = heap.top();
+    heap.pop();
+    if (count == 0 || comparator_(last_key, item.first.key_) != 0) {
+      if (fwrite(&item.first, sizeof(BulkEntry), 1, out) != 1) {
+        return -1;
+      }
+      last_key = item.first.key_;
+      count++;
+    } else if (duplicates != nullptr) {
+      duplicates->push_back(item.first.value_);
+    }
+    if (fread(&item.first, sizeof(BulkEntry), 1, runs[item.second]) == 1) {
+      heap.push(item);
+    }
+  }
+  return count;
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 dberr_t BPLUSTREE_INDEX_TYPE::Destroy() {
   container_.Destroy();
@@ -32,14 +32,37 @@ void InputCommand(char *input, const int len) {
   getchar();        // remove enter
 }
 
+/**
+ * minisql [--buffer_pool_size=N]
+ * buffer_pool_size是没有在create database时指定大小的数据库的缓冲池帧数
+ */
+uint32_t ParseArgs(int argc, char **argv) {
+  uint32_t buffer_pool_size = DEFAULT_BUFFER_POOL_SIZE;
+  const char *flag = "--buffer_pool_size=";
+  for (int i = 1; i < argc; i++) {
+    char *end;
+    if (strncmp(argv[i], flag, strlen(flag)) == 0) {
+      unsigned long val = strtoul(argv[i] + strlen(flag), &end, 10);
+      if (*end == '\0' && val >= MIN_BUFFER_POOL_SIZE && val <= INT32_MAX) {
+        buffer_pool_size = static_cast<uint32_t>(val);
+        continue;
+      }
+    }
+    fprintf(stderr, "usage: %s [--buffer_pool_size=N], N >= %u\n", argv[0], MIN_BUFFER_POOL_SIZE);
+    exit(1);
+  }
+  return buffer_pool_size;
+}
+
 int main(int argc, char **argv) {
   //TODO: 创建.db的副本避免crash
   InitGoogleLog(argv[0]);
+  uint32_t buffer_pool_size = ParseArgs(argc, argv);
   // command buffer
   const int buf_size = 1024;
   char cmd[buf_size];
   // execute engine
-  ExecuteEngine engine;
+  ExecuteEngine engine(buffer_pool_size);
   // for print syntax tree
   TreeFileManagers syntax_tree_file_mgr("syntax_tree_");
   [[maybe_unused]] uint32_t syntax_tree_id = 0;
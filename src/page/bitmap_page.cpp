@@ -1,4 +1,6 @@
 #include "page/bitmap_page.h"
+
+#include <algorithm>
 //#include <iostream>
 
 template <size_t PageSize>
@@ -6,29 +8,39 @@ bool BitmapPage<PageSize>::AllocatePage(uint32_t &page_offset) {
   // 根据.h中的注释，bitmap的语义是isUsed，即1表示已用，0表示为空
   // 这里只修改bitmap
   if (page_allocated_ < MAX_CHARS * 8) {
+    if (next_free_page_ >= MAX_CHARS * 8) {
+      // 旧版本写的bitmap不保证next_free_page_前面没有空页
+      FindNextFreePage(0);
+    }
     page_allocated_++;
     page_offset = next_free_page_;
     // 将添加的那一位置1
     bytes[page_offset / 8] = bytes[page_offset / 8] | (0x80 >> (page_offset % 8));
-    uint32_t index = 0;
-    // find next free page
-    // 获取这里需要从0开始查询？因为可能会有前面的page被释放掉了
-    // 先用0，后续如果防止碎片化的需求再改
-    while (!IsPageFreeLow(index / 8, index % 8) && index < MAX_CHARS * 8) {
-      index++;
-    }
-    next_free_page_ = index;
-    //    std::cout << next_free_page_ << std::endl;
+    // next_free_page_前面的页都已经分配了，释放时会把它往前移，所以只需要从这里往后找
+    FindNextFreePage(page_offset + 1);
     // 如果index达到了MAX_CHARS，并且在下次分配之前没有释放，那么下次分配就没有空闲page，allocate失败
     return true;
   }
   return false;
 }
 
+template <size_t PageSize>
+bool BitmapPage<PageSize>::AllocatePageAt(uint32_t page_offset) {
+  if (!IsPageFreeLow(page_offset / 8, page_offset % 8)) {
+    return false;
+  }
+  page_allocated_++;
+  bytes[page_offset / 8] = bytes[page_offset / 8] | (0x80 >> (page_offset % 8));
+  if (page_offset == next_free_page_) {
+    FindNextFreePage(page_offset + 1);
+  }
+  return true;
+}
+
 template <size_t PageSize>
 bool BitmapPage<PageSize>::DeAllocatePage(uint32_t page_offset) {
   if (!IsPageFreeLow(page_offset / 8, page_offset % 8)) {
-    if (page_allocated_ == MAX_CHARS * 8) {
+    if (page_allocated_ == MAX_CHARS * 8 || page_offset < next_free_page_) {
       next_free_page_ = page_offset;
     }
     // 将删掉的那一位置0
@@ -48,6 +60,15 @@ template <size_t PageSize>
 bool BitmapPage<PageSize>::IsPageFreeLow(uint32_t byte_index, uint8_t bit_index) const {
   return (bytes[byte_index] & (0x80 >> bit_index)) ? false : true;
 }
+template <size_t PageSize>
+void BitmapPage<PageSize>::FindNextFreePage(uint32_t page_offset) {
+  uint32_t index = page_offset;
+  while (index < MAX_CHARS * 8 && !IsPageFreeLow(index / 8, index % 8)) {
+    index = (index % 8 == 0 && bytes[index / 8] == 0xFF) ? index + 8 : index + 1;
+  }
+  next_free_page_ = std::min<uint32_t>(index, MAX_CHARS * 8);
+}
+
 template <size_t PageSize>
 uint32_t BitmapPage<PageSize>::GetNextFreePage(){
     return next_free_page_;
@@ -65,4 +86,12 @@ template class BitmapPage<1024>;
 
 template class BitmapPage<2048>;
 
-template class BitmapPage<4096>;
\ No newline at end of file
+template class BitmapPage<4096>;
+
+template class BitmapPage<8192>;
+
+template class BitmapPage<16384>;
+
+template class BitmapPage<32768>;
+
+template class BitmapPage<65536>;
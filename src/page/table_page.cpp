@@ -6,29 +6,36 @@ void TablePage::Init(page_id_t page_id, page_id_t prev_id, LogManager *log_mgr,
   SetNextPageId(INVALID_PAGE_ID);
   SetFreeSpacePointer(PAGE_SIZE);
   SetTupleCount(0);
+  SetFreeSlot(INVALID_SLOT);
+  SetFragmentedSize(0);
 }
 
 bool TablePage::InsertTuple(Row &row, Schema *schema, Transaction *txn,
-                            LockManager *lock_manager, LogManager *log_manager) {
+                            LockManager *lock_manager, LogManager *log_manager, RowId *wait_rid) {
   uint32_t serialized_size = row.GetSerializedSize(schema);
   ASSERT(serialized_size > 0, "Can not have empty row.");
-  uint32_t tuple_num = GetTupleCount();
-  tuple_num++;
-  if (GetFreeSpaceRemaining() < serialized_size + SIZE_TUPLE) {
+  // Reuse the head of the free slot chain, or append a new slot.
+  uint32_t i = GetFreeSlot();
+  uint32_t space_needed = serialized_size;
+  if (i == INVALID_SLOT) {
+    i = GetTupleCount();
+    space_needed += SIZE_TUPLE;
+  }
+  if (GetFreeSpaceRemaining() < space_needed) {
     return false;
   }
-  // Try to find a free slot to reuse.
-  uint32_t i;
-  for (i = 0; i < GetTupleCount(); i++) {
-    // If the slot is empty, i.e. its tuple has size 0,
-    if (GetTupleSize(i) == 0) {
-      // Then we break out of the loop at index i.
-      break;
+  // 新tuple在事务提交之前对其他事务不可见。slot可能刚被一个还没释放锁的事务删除，此时要等它结束，
+  // 但持有latch时不能等锁，交给调用者放掉latch再等
+  if (txn != nullptr && lock_manager != nullptr && !lock_manager->TryLockExclusive(txn, RowId(GetTablePageId(), i))) {
+    if (wait_rid != nullptr && txn->GetState() != TxnState::kAborted) {
+      *wait_rid = RowId(GetTablePageId(), i);
     }
-  }
-  if (i == GetTupleCount() && GetFreeSpaceRemaining() < serialized_size + SIZE_TUPLE) {
     return false;
   }
+  ReserveSpace(space_needed);
+  if (i < GetTupleCount()) {
+    SetFreeSlot(GetTupleOffsetAtSlot(i));
+  }
   // Otherwise we claim available free space..
   SetFreeSpacePointer(GetFreeSpacePointer() - serialized_size);
   uint32_t __attribute__((unused)) write_bytes = row.SerializeTo(GetData() + GetFreeSpacePointer(), schema);
@@ -42,6 +49,11 @@ bool TablePage::InsertTuple(Row &row, Schema *schema, Transaction *txn,
   if (i == GetTupleCount()) {
     SetTupleCount(GetTupleCount() + 1);
   }
+  if (txn != nullptr && log_manager != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::kInsert, row.GetRowId(),
+                         GetData() + GetFreeSpacePointer(), serialized_size);
+    AppendTupleLog(&log_record, txn, log_manager);
+  }
   return true;
 }
 
@@ -56,10 +68,19 @@ bool TablePage::MarkDelete(const RowId &rid, Transaction *txn, LockManager *lock
   if (IsDeleted(tuple_size)) {
     return false;
   }
+  // 调用者应当已经在latch page之前拿到了排它锁，这里不会阻塞
+  if (txn != nullptr && lock_manager != nullptr && !lock_manager->LockExclusive(txn, rid)) {
+    return false;
+  }
   // Mark the tuple as deleted.
   if (tuple_size > 0) {
     SetTupleSize(slot_num, SetDeletedFlag(tuple_size));
   }
+  if (txn != nullptr && log_manager != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::kMarkDelete, rid,
+                         GetData() + GetTupleOffsetAtSlot(slot_num), tuple_size);
+    AppendTupleLog(&log_record, txn, log_manager);
+  }
   return true;
 }
 
@@ -78,16 +99,27 @@ int TablePage::UpdateTuple(const Row &new_row, Row *old_row, Schema *schema,
   if (IsDeleted(tuple_size)) {
     return 2;
   }
+  if (txn != nullptr && lock_manager != nullptr && !lock_manager->LockExclusive(txn, old_row->GetRowId())) {
+    return 1;
+  }
   // If there is not enough space to update, we need to update via delete followed by an insert (not enough space).
   if (GetFreeSpaceRemaining() + tuple_size < serialized_size) {
     return 3;
   }
+  if (serialized_size > tuple_size) {
+    ReserveSpace(serialized_size - tuple_size);
+  }
   // Copy out the old value.
   uint32_t tuple_offset = GetTupleOffsetAtSlot(slot_num);
   uint32_t __attribute__((unused)) read_bytes = old_row->DeserializeFrom(GetData() + tuple_offset, schema);
   ASSERT(tuple_size == read_bytes, "Unexpected behavior in tuple deserialize.");
   uint32_t free_space_pointer = GetFreeSpacePointer();
   ASSERT(tuple_offset >= free_space_pointer, "Offset should appear after current free space position.");
+  // 旧tuple会被覆盖，先保存下来写日志
+  std::string old_tuple;
+  if (txn != nullptr && log_manager != nullptr) {
+    old_tuple.assign(GetData() + tuple_offset, tuple_size);
+  }
   memmove(GetData() + free_space_pointer + tuple_size - serialized_size, GetData() + free_space_pointer,
           tuple_offset - free_space_pointer);
   SetFreeSpacePointer(free_space_pointer + tuple_size - serialized_size);
@@ -101,6 +133,11 @@ int TablePage::UpdateTuple(const Row &new_row, Row *old_row, Schema *schema,
       SetTupleOffsetAtSlot(i, tuple_offset_i + tuple_size - new_row.GetSerializedSize(schema));
     }
   }
+  if (txn != nullptr && log_manager != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), old_row->GetRowId(), old_tuple.data(),
+                         old_tuple.size(), GetData() + tuple_offset + tuple_size - serialized_size, serialized_size);
+    AppendTupleLog(&log_record, txn, log_manager);
+  }
   return 0;
 }
 
@@ -117,20 +154,21 @@ void TablePage::ApplyDelete(const RowId &rid, Transaction *txn, LogManager *log_
 
   uint32_t free_space_pointer = GetFreeSpacePointer();
   ASSERT(tuple_offset >= free_space_pointer, "Free space appears before tuples.");
+  if (txn != nullptr && log_manager != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::kApplyDelete, rid,
+                         GetData() + tuple_offset, tuple_size);
+    AppendTupleLog(&log_record, txn, log_manager);
+  }
 
-  memmove(GetData() + free_space_pointer + tuple_size, GetData() + free_space_pointer,
-          tuple_offset - free_space_pointer);
-  SetFreeSpacePointer(free_space_pointer + tuple_size);
-  SetTupleSize(slot_num, 0);
-  SetTupleOffsetAtSlot(slot_num, 0);
-
-  // Update all tuple offsets.
-  for (uint32_t i = 0; i < GetTupleCount(); ++i) {
-    uint32_t tuple_offset_i = GetTupleOffsetAtSlot(i);
-    if (GetTupleSize(i) != 0 && tuple_offset_i < tuple_offset) {
-      SetTupleOffsetAtSlot(i, tuple_offset_i + tuple_size);
-    }
+  // 紧挨着空闲区的tuple直接并进空闲区，否则留下一个空洞，等空间不够时再整理
+  if (tuple_offset == free_space_pointer) {
+    SetFreeSpacePointer(free_space_pointer + tuple_size);
+  } else {
+    SetFragmentedSize(GetFragmentedSize() + tuple_size);
   }
+  SetTupleSize(slot_num, 0);
+  SetTupleOffsetAtSlot(slot_num, GetFreeSlot());
+  SetFreeSlot(slot_num);
 }
 
 void TablePage::RollbackDelete(const RowId &rid, Transaction *txn, LogManager *log_manager) {
@@ -142,6 +180,35 @@ void TablePage::RollbackDelete(const RowId &rid, Transaction *txn, LogManager *l
   if (IsDeleted(tuple_size)) {
     SetTupleSize(slot_num, UnsetDeletedFlag(tuple_size));
   }
+  if (txn != nullptr && log_manager != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::kRollbackDelete, rid,
+                         GetData() + GetTupleOffsetAtSlot(slot_num), UnsetDeletedFlag(tuple_size));
+    AppendTupleLog(&log_record, txn, log_manager);
+  }
+}
+
+bool TablePage::RestoreTuple(const RowId &rid, const char *tuple, uint32_t tuple_size) {
+  uint32_t slot_num = rid.GetSlotNum();
+  if (slot_num >= GetTupleCount() || GetTupleSize(slot_num) != 0) {
+    return false;
+  }
+  if (!ReserveSpace(tuple_size)) {
+    return false;
+  }
+  RemoveFreeSlot(slot_num);
+  SetFreeSpacePointer(GetFreeSpacePointer() - tuple_size);
+  memcpy(GetData() + GetFreeSpacePointer(), tuple, tuple_size);
+  SetTupleOffsetAtSlot(slot_num, GetFreeSpacePointer());
+  SetTupleSize(slot_num, tuple_size);
+  return true;
+}
+
+bool TablePage::HasTuple(const RowId &rid, const char *tuple, uint32_t tuple_size) {
+  uint32_t slot_num = rid.GetSlotNum();
+  if (slot_num >= GetTupleCount() || UnsetDeletedFlag(GetTupleSize(slot_num)) != tuple_size) {
+    return false;
+  }
+  return memcmp(GetData() + GetTupleOffsetAtSlot(slot_num), tuple, tuple_size) == 0;
 }
 
 bool TablePage::GetTuple(Row *row, Schema *schema, Transaction *txn, LockManager *lock_manager) {
@@ -158,6 +225,9 @@ bool TablePage::GetTuple(Row *row, Schema *schema, Transaction *txn, LockManager
   if (IsDeleted(tuple_size)) {
     return false;
   }
+  if (txn != nullptr && lock_manager != nullptr && !lock_manager->LockShared(txn, row->GetRowId())) {
+    return false;
+  }
   // At this point, we have at least a shared lock on the RID. Copy the tuple data into our result.
   uint32_t tuple_offset = GetTupleOffsetAtSlot(slot_num);
   uint32_t __attribute__((unused)) read_bytes = row->DeserializeFrom(GetData() + tuple_offset, schema);
@@ -165,6 +235,14 @@ bool TablePage::GetTuple(Row *row, Schema *schema, Transaction *txn, LockManager
   return true;
 }
 
+bool TablePage::GetTupleView(uint32_t slot_num, Schema *schema, RowView *view) {
+  if (slot_num >= GetTupleCount() || IsDeleted(GetTupleSize(slot_num))) {
+    return false;
+  }
+  view->Reset(GetData() + GetTupleOffsetAtSlot(slot_num), schema, RowId(GetTablePageId(), slot_num));
+  return true;
+}
+
 bool TablePage::GetFirstTupleRid(RowId *first_rid) {
   // Find and return the first valid tuple.
   for (uint32_t i = 0; i < GetTupleCount(); i++) {
@@ -190,3 +268,56 @@ bool TablePage::GetNextTupleRid(const RowId &cur_rid, RowId *next_rid) {
   next_rid->Set(INVALID_PAGE_ID, 0);
   return false;
 }
+
+void TablePage::Compact() {
+  if (GetFragmentedSize() == 0) {
+    return;
+  }
+  // 按slot顺序把tuple重新排到页尾，和依次插入时的布局一样
+  char buf[PAGE_SIZE];
+  uint32_t free_space_pointer = PAGE_SIZE;
+  for (uint32_t i = 0; i < GetTupleCount(); i++) {
+    uint32_t tuple_size = UnsetDeletedFlag(GetTupleSize(i));
+    if (tuple_size == 0) {
+      continue;
+    }
+    free_space_pointer -= tuple_size;
+    memcpy(buf + free_space_pointer, GetData() + GetTupleOffsetAtSlot(i), tuple_size);
+    SetTupleOffsetAtSlot(i, free_space_pointer);
+  }
+  memcpy(GetData() + free_space_pointer, buf + free_space_pointer, PAGE_SIZE - free_space_pointer);
+  SetFreeSpacePointer(free_space_pointer);
+  SetFragmentedSize(0);
+}
+
+void TablePage::RemoveFreeSlot(uint32_t slot_num) {
+  // 只有恢复和回滚会指定slot，链表一般很短，顺着找即可
+  if (GetFreeSlot() == slot_num) {
+    SetFreeSlot(GetTupleOffsetAtSlot(slot_num));
+    return;
+  }
+  for (uint32_t i = GetFreeSlot(); i != INVALID_SLOT; i = GetTupleOffsetAtSlot(i)) {
+    if (GetTupleOffsetAtSlot(i) == slot_num) {
+      SetTupleOffsetAtSlot(i, GetTupleOffsetAtSlot(slot_num));
+      return;
+    }
+  }
+  ASSERT(false, "Slot is not in the free slot chain.");
+}
+
+bool TablePage::ReserveSpace(uint32_t size) {
+  if (GetContiguousFreeSpace() >= size) {
+    return true;
+  }
+  if (GetFreeSpaceRemaining() < size) {
+    return false;
+  }
+  Compact();
+  return true;
+}
+
+void TablePage::AppendTupleLog(LogRecord *log_record, Transaction *txn, LogManager *log_manager) {
+  lsn_t lsn = log_manager->AppendLogRecord(log_record);
+  txn->SetPrevLSN(lsn);
+  SetLSN(lsn);
+}
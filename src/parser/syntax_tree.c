@@ -169,6 +169,14 @@ const char *GetSyntaxNodeTypeStr(SyntaxNodeType type) {
       return "kNodeTrxCommit";
     case kNodeTrxRollback:
       return "kNodeTrxRollback";
+    case kNodeAnalyze:
+      return "kNodeAnalyze";
+    case kNodeLoadData:
+      return "kNodeLoadData";
+    case kNodeSet:
+      return "kNodeSet";
+    case kNodeLimit:
+      return "kNodeLimit";
     case kNodeIndexType:
       return "kNodeIndexType";
     default:
@@ -81,8 +81,6 @@ uint32_t Column::GetSerializedSize() const {
 
 uint32_t Column::DeserializeFrom(char *buf, Column *&column, MemHeap *heap) {
   // replace with your code here
-  // test if empty
-  ASSERT(column != nullptr, "Pointer to column is not null in column deserialize.");
   uint32_t ofs = 0;
   /* deserialize field from buf */
   // read magic num
@@ -94,7 +92,7 @@ uint32_t Column::DeserializeFrom(char *buf, Column *&column, MemHeap *heap) {
   buf += 4;
   ofs += 4;
   // read name one char by one char
-  char *name = new char[len];
+  char *name = new char[len + 1];
   ofs += len;
   for (uint32_t i = 0; i < len; i++) {
     name[i] = MACH_READ_FROM(char, buf);
@@ -102,6 +100,7 @@ uint32_t Column::DeserializeFrom(char *buf, Column *&column, MemHeap *heap) {
   }
   name[len] = 0;
   std::string column_name(name);
+  delete[] name;
   // read type
   TypeId type = MACH_READ_FROM(TypeId, buf);
   buf += sizeof(TypeId);
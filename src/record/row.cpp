@@ -2,6 +2,19 @@
 #include <iostream>
 using namespace std;
 
+Field *Row::CopyField(const Field &field) {
+  void *buf = heap_->Allocate(sizeof(Field));
+  if (field.GetTypeId() != TypeId::kTypeChar || field.IsNull()) {
+    return new (buf) Field(field);
+  }
+  // char的数据也复制到heap上，不用Field自己new
+  uint32_t len = field.GetLength();
+  auto chars = static_cast<char *>(heap_->Allocate(len + 1));
+  memcpy(chars, field.GetChars(), len);
+  chars[len] = '\0';
+  return new (buf) Field(TypeId::kTypeChar, chars, len, false);
+}
+
 uint32_t Row::SerializeTo(char *buf, Schema *schema) const {
   // replace with your code here
   // 若整个row空 则啥也不写进去
@@ -52,7 +65,6 @@ uint32_t Row::DeserializeFrom(char *buf, Schema *schema) {
   // read fields num
   uint32_t ofs = 0;
   uint32_t field_num = MACH_READ_UINT32(buf);
-  MemHeap *heap = new SimpleMemHeap();
   buf += 4;
   ofs += 4;
   // read null bitmap
@@ -74,26 +86,14 @@ uint32_t Row::DeserializeFrom(char *buf, Schema *schema) {
     map_num++;
   }
   // deserialize
+  fields_.reserve(fields_.size() + field_num);
   for (uint32_t i = 0; i < field_num; i++) {
     TypeId type = schema->GetColumn(i)->GetType();
-    uint32_t t;
-    Field *f;
-    if (type == TypeId::kTypeInt) {
-      f = new Field(TypeId::kTypeInt, 0);
-    } else if (type == TypeId::kTypeChar) {
-      f = new Field(TypeId::kTypeChar, const_cast<char *>(""), strlen(const_cast<char *>("")), false);
-    } else if (type == TypeId::kTypeFloat) {
-      f = new Field(TypeId::kTypeFloat, 0.0f);
-    }
-    if (map[i] == 0) {
-      t = f->DeserializeFrom(buf, type, &f, true, heap);
-      ofs += t;
-      buf += t;
-    } else {
-      t = f->DeserializeFrom(buf, type, &f, false, heap);
-      ofs += t;
-      buf += t;
-    }
+    // field直接分配在行自己的heap上
+    Field *f = nullptr;
+    uint32_t t = Field::DeserializeFrom(buf, type, &f, map[i] == 0, heap_);
+    ofs += t;
+    buf += t;
     fields_.push_back(f);
   }
   return ofs;
@@ -0,0 +1,52 @@
+#include "record/row_view.h"
+
+void RowView::Reset(const char *data, Schema *schema, RowId rid) {
+  data_ = data;
+  schema_ = schema;
+  rid_ = rid;
+  uint32_t field_num = MACH_READ_UINT32(data);
+  // resize不会缩小容量，换行时不会重新分配
+  offsets_.resize(field_num);
+  const char *bitmap = data + sizeof(uint32_t);
+  uint32_t ofs = sizeof(uint32_t) + (field_num + 7) / 8;
+  for (uint32_t i = 0; i < field_num; i++) {
+    if (((bitmap[i / 8] >> (7 - i % 8)) & 0x01) == 0) {
+      offsets_[i] = NULL_OFFSET;
+      continue;
+    }
+    offsets_[i] = ofs;
+    TypeId type = schema->GetColumn(i)->GetType();
+    if (type == TypeId::kTypeChar) {
+      ofs += sizeof(uint32_t) + MACH_READ_UINT32(data + ofs);
+    } else {
+      ofs += Type::GetTypeSize(type);
+    }
+  }
+  size_ = ofs;
+}
+
+Field RowView::GetField(uint32_t idx) const {
+  TypeId type = schema_->GetColumn(idx)->GetType();
+  if (IsNull(idx)) {
+    return Field(type);
+  }
+  const char *buf = data_ + offsets_[idx];
+  switch (type) {
+    case TypeId::kTypeInt:
+      return Field(type, MACH_READ_INT32(buf));
+    case TypeId::kTypeFloat:
+      return Field(type, MACH_READ_FROM(float, buf));
+    case TypeId::kTypeChar:
+      return Field(type, const_cast<char *>(buf + sizeof(uint32_t)), MACH_READ_UINT32(buf), false);
+    default:
+      ASSERT(false, "Unsupported type.");
+      return Field(type);
+  }
+}
+
+void RowView::Materialize(Row *row) const {
+  ASSERT(row->GetFieldCount() == 0, "Row is not empty.");
+  row->SetRowId(rid_);
+  uint32_t __attribute__((unused)) read_bytes = row->DeserializeFrom(const_cast<char *>(data_), schema_);
+  ASSERT(read_bytes == size_, "Unexpected behavior in tuple deserialize.");
+}
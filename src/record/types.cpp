@@ -246,7 +246,11 @@ uint32_t TypeChar::DeserializeFrom(char *storage, Field **field, bool is_null, M
     return 0;
   }
   uint32_t len = MACH_READ_UINT32(storage);
-  *field = ALLOC_P(heap, Field)(TypeId::kTypeChar, storage + sizeof(uint32_t), len, true);
+  // 数据也分配在heap上，和field一起释放
+  auto chars = static_cast<char *>(heap->Allocate(len + 1));
+  memcpy(chars, storage + sizeof(uint32_t), len);
+  chars[len] = '\0';
+  *field = ALLOC_P(heap, Field)(TypeId::kTypeChar, chars, len, false);
   return len + sizeof(uint32_t);
 }
 
@@ -0,0 +1,70 @@
+#include "recovery/checkpoint_manager.h"
+
+#include <chrono>
+
+CheckpointManager::CheckpointManager(TransactionManager *txn_manager, LogManager *log_manager,
+                                     BufferPoolManager *buffer_pool_manager, DiskManager *disk_manager,
+                                     bool enable_checkpointer)
+    : txn_manager_(txn_manager),
+      log_manager_(log_manager),
+      buffer_pool_manager_(buffer_pool_manager),
+      disk_manager_(disk_manager) {
+  if (enable_checkpointer) {
+    checkpointer_thread_ = std::thread(&CheckpointManager::RunCheckpointer, this);
+  }
+}
+
+CheckpointManager::~CheckpointManager() {
+  {
+    std::scoped_lock<std::mutex> lock(stop_latch_);
+    stop_ = true;
+  }
+  stop_cv_.notify_all();
+  if (checkpointer_thread_.joinable()) {
+    checkpointer_thread_.join();
+  }
+}
+
+void CheckpointManager::Checkpoint() {
+  std::scoped_lock<std::mutex> lock(latch_);
+  last_checkpoint_bytes_ = log_manager_->GetAppendedBytes();
+  // begin_lsn之后的日志不受dirty page table约束，recovery会全部分析
+  lsn_t begin_lsn = log_manager_->GetNextLSN();
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  buffer_pool_manager_->GetDirtyPageTable(dirty_pages);
+  lsn_t oldest_txn_lsn = txn_manager_->GetOldestBeginLSN();
+  // 不在dirty page table中的page已经写回过，要先让它们真正落盘
+  disk_manager_->SyncData();
+  LogRecord record(begin_lsn, dirty_pages);
+  log_manager_->Flush(log_manager_->AppendLogRecord(&record));
+
+  lsn_t discard_lsn = begin_lsn;
+  for (auto &entry : dirty_pages) {
+    discard_lsn = std::min(discard_lsn, entry.second);
+  }
+  if (oldest_txn_lsn != INVALID_LSN) {
+    discard_lsn = std::min(discard_lsn, oldest_txn_lsn);
+  }
+  log_manager_->DiscardBefore(discard_lsn);
+}
+
+bool CheckpointManager::CheckpointIfNeeded() {
+  if (log_manager_->GetAppendedBytes() - last_checkpoint_bytes_ < CHECKPOINT_LOG_SIZE) {
+    return false;
+  }
+  Checkpoint();
+  return true;
+}
+
+void CheckpointManager::RunCheckpointer() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(stop_latch_);
+      stop_cv_.wait_for(lock, std::chrono::milliseconds(CHECKPOINT_INTERVAL_MS), [this] { return stop_; });
+      if (stop_) {
+        return;
+      }
+    }
+    CheckpointIfNeeded();
+  }
+}
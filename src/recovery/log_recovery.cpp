@@ -0,0 +1,194 @@
+#include "recovery/log_recovery.h"
+
+#include "page/table_page.h"
+
+void LogRecovery::Redo() {
+  ReadLog();
+  Analyze();
+  for (const auto &record : log_records_) {
+    if (record.GetType() != LogRecordType::kNewPage && record.GetType() != LogRecordType::kPageDelta) {
+      continue;
+    }
+    if (record.GetType() == LogRecordType::kNewPage && record.GetLSN() >= checkpoint_begin_lsn_) {
+      // 分配表只在checkpoint等SyncData时落盘，之后新建的页要在分配表里补上
+      disk_manager_->AllocatePageAt(record.GetPageId());
+    }
+    if (record.GetLSN() < checkpoint_begin_lsn_) {
+      // checkpoint时已经写回的修改不需要重放
+      auto it = dirty_pages_.find(record.GetPageId());
+      if (it == dirty_pages_.end() || record.GetLSN() < it->second) {
+        continue;
+      }
+    }
+    record.ApplyTo(GetPage(record.GetPageId()));
+    redo_count_++;
+  }
+  for (auto &it : pages_) {
+    disk_manager_->WritePage(it.first, it.second.get());
+  }
+  // page落盘之后才能丢弃日志
+  disk_manager_->SyncData();
+  pages_.clear();
+  if (losers_.empty()) {
+    disk_manager_->TruncateLog();
+    log_records_.clear();
+    return;
+  }
+  // undo还需要loser的日志，只去掉末尾不完整的记录
+  disk_manager_->TruncateLog(log_size_);
+  std::vector<LogRecord> loser_records;
+  for (auto &record : log_records_) {
+    if (losers_.count(record.GetTxnId()) != 0) {
+      loser_records.emplace_back(std::move(record));
+    }
+  }
+  log_records_.swap(loser_records);
+}
+
+void LogRecovery::Undo(CatalogManager *catalog_manager, BufferPoolManager *buffer_pool_manager,
+                       LogManager *log_manager) {
+  for (auto it = log_records_.rbegin(); it != log_records_.rend(); ++it) {
+    UndoRecord(*it, catalog_manager, buffer_pool_manager);
+  }
+  for (auto txn_id : losers_) {
+    LogRecord record(txn_id, INVALID_LSN, LogRecordType::kAbort);
+    log_manager->AppendLogRecord(&record);
+  }
+  log_manager->FlushAll();
+  log_records_.clear();
+  losers_.clear();
+}
+
+void LogRecovery::ReadLog() {
+  log_records_.clear();
+  std::string log;
+  auto buf = std::make_unique<char[]>(LOG_BUFFER_SIZE);
+  uint32_t read_bytes;
+  while ((read_bytes = disk_manager_->ReadLog(buf.get(), LOG_BUFFER_SIZE, log.size())) > 0) {
+    log.append(buf.get(), read_bytes);
+  }
+  uint32_t offset = 0;
+  LogRecord record;
+  while (LogRecord::DeserializeFrom(log.data() + offset, log.size() - offset, &record)) {
+    offset += record.GetSize();
+    log_records_.emplace_back(std::move(record));
+  }
+  log_size_ = offset;
+  log_record_count_ = log_records_.size();
+}
+
+void LogRecovery::Analyze() {
+  // 从最后一个checkpoint的dirty page table开始
+  for (auto it = log_records_.rbegin(); it != log_records_.rend(); ++it) {
+    if (it->GetType() == LogRecordType::kCheckpoint) {
+      checkpoint_begin_lsn_ = it->GetCheckpointBeginLSN();
+      for (auto &entry : it->GetDirtyPageTable()) {
+        dirty_pages_.emplace(entry.first, entry.second);
+      }
+      break;
+    }
+  }
+  std::unordered_set<txn_id_t> finished;
+  for (const auto &record : log_records_) {
+    next_lsn_ = record.GetLSN() + 1;
+    switch (record.GetType()) {
+      case LogRecordType::kNewPage:
+      case LogRecordType::kPageDelta:
+        if (record.GetLSN() >= checkpoint_begin_lsn_) {
+          dirty_pages_.emplace(record.GetPageId(), record.GetLSN());
+        }
+        break;
+      case LogRecordType::kCommit:
+      case LogRecordType::kAbort:
+        finished.insert(record.GetTxnId());
+        break;
+      default:
+        break;
+    }
+    if (record.GetTxnId() != INVALID_TXN_ID) {
+      next_txn_id_ = std::max(next_txn_id_, record.GetTxnId() + 1);
+      losers_.insert(record.GetTxnId());
+    }
+  }
+  for (auto txn_id : finished) {
+    losers_.erase(txn_id);
+  }
+}
+
+char *LogRecovery::GetPage(page_id_t page_id) {
+  auto it = pages_.find(page_id);
+  if (it != pages_.end()) {
+    return it->second.get();
+  }
+  auto page = std::make_unique<char[]>(PAGE_SIZE);
+  disk_manager_->ReadPage(page_id, page.get());
+  return pages_.emplace(page_id, std::move(page)).first->second.get();
+}
+
+void LogRecovery::UndoRecord(const LogRecord &log_record, CatalogManager *catalog_manager,
+                             BufferPoolManager *buffer_pool_manager) {
+  if (log_record.GetType() == LogRecordType::kBegin) {
+    return;
+  }
+  RowId rid = log_record.GetRowId();
+  std::string tuple = log_record.GetTuple();
+  switch (log_record.GetType()) {
+    case LogRecordType::kInsert:
+    case LogRecordType::kMarkDelete:
+    case LogRecordType::kApplyDelete:
+    case LogRecordType::kRollbackDelete:
+    case LogRecordType::kUpdate: {
+      auto page = reinterpret_cast<TablePage *>(buffer_pool_manager->FetchPage(rid.GetPageId()));
+      if (page == nullptr) {
+        return;
+      }
+      page->WLatch();
+      if (log_record.GetType() == LogRecordType::kInsert) {
+        if (page->HasTuple(rid, tuple.data(), tuple.size())) {
+          page->ApplyDelete(rid, nullptr, nullptr);
+        }
+      } else if (log_record.GetType() == LogRecordType::kMarkDelete) {
+        if (page->HasTuple(rid, tuple.data(), tuple.size())) {
+          page->RollbackDelete(rid, nullptr, nullptr);
+        }
+      } else if (log_record.GetType() == LogRecordType::kRollbackDelete) {
+        if (page->HasTuple(rid, tuple.data(), tuple.size())) {
+          page->MarkDelete(rid, nullptr, nullptr, nullptr);
+        }
+      } else if (log_record.GetType() == LogRecordType::kApplyDelete) {
+        page->RestoreTuple(rid, tuple.data(), tuple.size());
+      } else {
+        // 先删掉新的tuple，再把旧的tuple放回同一个slot
+        std::string new_tuple = log_record.GetNewTuple();
+        if (page->HasTuple(rid, new_tuple.data(), new_tuple.size())) {
+          page->ApplyDelete(rid, nullptr, nullptr);
+        }
+        page->RestoreTuple(rid, tuple.data(), tuple.size());
+      }
+      page->WUnlatch();
+      buffer_pool_manager->UnpinPage(rid.GetPageId(), true);
+      break;
+    }
+    case LogRecordType::kIndexInsert:
+    case LogRecordType::kIndexDelete: {
+      IndexInfo *index_info = nullptr;
+      if (catalog_manager->GetIndex(log_record.GetIndexId(), index_info) != DB_SUCCESS) {
+        return;
+      }
+      Row key(rid);
+      key.DeserializeFrom(tuple.data(), index_info->GetIndexKeySchema());
+      std::vector<RowId> result;
+      bool found = index_info->GetIndex()->ScanKey(key, result, nullptr, "=") == DB_SUCCESS;
+      if (log_record.GetType() == LogRecordType::kIndexInsert) {
+        if (found && result[0].Get() == rid.Get()) {
+          index_info->GetIndex()->RemoveEntry(key, rid, nullptr);
+        }
+      } else if (!found) {
+        index_info->GetIndex()->InsertEntry(key, rid, nullptr);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
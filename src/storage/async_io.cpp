@@ -0,0 +1,272 @@
+#include "storage/async_io.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "glog/logging.h"
+
+std::unique_ptr<AsyncIO> AsyncIO::Create(int fd, uint32_t queue_depth) {
+  auto io_uring = IoUringIO::Create(fd, queue_depth);
+  if (io_uring != nullptr) {
+    return io_uring;
+  }
+  return std::make_unique<ThreadPoolIO>(fd, queue_depth);
+}
+
+void AsyncIO::SubmitRead(char *buf, size_t len, off_t offset, Callback done) {
+  Reserve();
+  Submit(new Request{false, buf, len, offset, std::move(done)});
+}
+
+void AsyncIO::SubmitWrite(const char *buf, size_t len, off_t offset, Callback done) {
+  Reserve();
+  Submit(new Request{true, const_cast<char *>(buf), len, offset, std::move(done)});
+}
+
+void AsyncIO::Wait() {
+  Flush();
+  std::unique_lock<std::mutex> lock(latch_);
+  completed_.wait(lock, [this] { return in_flight_ == 0; });
+}
+
+void AsyncIO::Reserve() {
+  std::unique_lock<std::mutex> lock(latch_);
+  if (in_flight_ == queue_depth_) {
+    // 满了的时候可能还有请求没交给内核，先提交，否则永远等不到完成
+    lock.unlock();
+    Flush();
+    lock.lock();
+    completed_.wait(lock, [this] { return in_flight_ < queue_depth_; });
+  }
+  in_flight_++;
+}
+
+void AsyncIO::Complete(Request *request, ssize_t result) {
+  if (result >= 0 && static_cast<size_t>(result) < request->len_) {
+    // 只读/写了一部分（读到末尾时result是0），剩下的同步做完
+    result = Perform(request, result);
+  }
+  request->done_(result >= 0);
+  delete request;
+  std::scoped_lock<std::mutex> lock(latch_);
+  in_flight_--;
+  completed_.notify_all();
+}
+
+ssize_t AsyncIO::Perform(Request *request, size_t done) {
+  while (done < request->len_) {
+    ssize_t ret = request->write_
+                      ? pwrite(fd_, request->buf_ + done, request->len_ - done, request->offset_ + done)
+                      : pread(fd_, request->buf_ + done, request->len_ - done, request->offset_ + done);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0) {
+      int err = errno;
+      LOG(ERROR) << "I/O error while " << (request->write_ ? "writing" : "reading");
+      return -err;
+    }
+    if (ret == 0) {
+      if (request->write_) {
+        return -EIO;
+      }
+      // 文件末尾
+      memset(request->buf_ + done, 0, request->len_ - done);
+      break;
+    }
+    done += ret;
+  }
+  return request->len_;
+}
+
+static int SysIoUringSetup(unsigned entries, io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int SysIoUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+std::unique_ptr<IoUringIO> IoUringIO::Create(int fd, uint32_t queue_depth) {
+  std::unique_ptr<IoUringIO> io(new IoUringIO(fd, queue_depth));
+  if (!io->Setup()) {
+    return nullptr;
+  }
+  io->reaper_ = std::thread(&IoUringIO::Reap, io.get());
+  return io;
+}
+
+bool IoUringIO::Setup() {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = SysIoUringSetup(queue_depth_, &params);
+  if (ring_fd_ < 0) {
+    return false;
+  }
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                  IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    return false;
+  }
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                    IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      cq_ring_ = nullptr;
+      return false;
+    }
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                    IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = reinterpret_cast<io_uring_sqe *>(sqes);
+  char *sq = reinterpret_cast<char *>(sq_ring_);
+  char *cq = reinterpret_cast<char *>(cq_ring_);
+  sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  return true;
+}
+
+IoUringIO::~IoUringIO() {
+  if (reaper_.joinable()) {
+    Wait();
+    // 用一个nop叫醒完成线程让它退出
+    Push(nullptr);
+    Flush();
+    reaper_.join();
+  }
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != nullptr) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+}
+
+void IoUringIO::Submit(Request *request) { Push(request); }
+
+void IoUringIO::Push(Request *request) {
+  std::scoped_lock<std::mutex> lock(sq_latch_);
+  // 同时在进行的请求不超过queue_depth_，不会超过submission queue的大小
+  unsigned tail = *sq_tail_;
+  unsigned index = tail & *sq_mask_;
+  io_uring_sqe *sqe = sqes_ + index;
+  memset(sqe, 0, sizeof(*sqe));
+  if (request == nullptr) {
+    sqe->opcode = IORING_OP_NOP;
+  } else {
+    sqe->opcode = request->write_ ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(request->buf_);
+    sqe->len = static_cast<uint32_t>(request->len_);
+    sqe->off = static_cast<uint64_t>(request->offset_);
+  }
+  sqe->user_data = reinterpret_cast<uint64_t>(request);
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  pending_++;
+}
+
+void IoUringIO::Flush() {
+  std::scoped_lock<std::mutex> lock(sq_latch_);
+  while (pending_ > 0) {
+    int ret = SysIoUringEnter(ring_fd_, pending_, 0, 0);
+    if (ret < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+      continue;
+    }
+    if (ret < 0) {
+      LOG(ERROR) << "io_uring_enter failed: " << strerror(errno);
+      return;
+    }
+    pending_ -= ret;
+  }
+}
+
+void IoUringIO::Reap() {
+  while (true) {
+    // 只有这个线程会移动cq的head
+    unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      SysIoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+      continue;
+    }
+    io_uring_cqe *cqe = cqes_ + (head & *cq_mask_);
+    auto request = reinterpret_cast<Request *>(cqe->user_data);
+    ssize_t result = cqe->res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    if (request == nullptr) {
+      return;
+    }
+    Complete(request, result);
+  }
+}
+
+ThreadPoolIO::ThreadPoolIO(int fd, uint32_t queue_depth, uint32_t thread_count) : AsyncIO(fd, queue_depth) {
+  for (uint32_t i = 0; i < thread_count; i++) {
+    workers_.emplace_back(&ThreadPoolIO::Work, this);
+  }
+}
+
+ThreadPoolIO::~ThreadPoolIO() {
+  Wait();
+  {
+    std::scoped_lock<std::mutex> lock(queue_latch_);
+    stop_ = true;
+  }
+  queue_cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPoolIO::Submit(Request *request) {
+  {
+    std::scoped_lock<std::mutex> lock(queue_latch_);
+    queue_.push_back(request);
+  }
+  queue_cv_.notify_one();
+}
+
+void ThreadPoolIO::Work() {
+  while (true) {
+    Request *request;
+    {
+      std::unique_lock<std::mutex> lock(queue_latch_);
+      queue_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      request = queue_.front();
+      queue_.pop_front();
+    }
+    Complete(request, Perform(request));
+  }
+}
@@ -1,4 +1,11 @@
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <filesystem>
+#include <memory>
 #include <stdexcept>
 
 #include <iostream>
@@ -8,32 +15,123 @@
 
 //#define ENABLE_BPM_DEBUG
 
-DiskManager::DiskManager(const std::string &db_file) : file_name_(db_file) {
-  std::scoped_lock<std::recursive_mutex> lock(db_io_latch_);
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-    if (!db_io_.is_open()) {
-      throw std::exception();
-    }
+DiskManager::DiskManager(const std::string &db_file) : file_name_(db_file), log_name_(GetLogFileName(db_file)) {
+  db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT, 0644);
+  if (db_fd_ < 0) {
+    throw std::exception();
   }
   ReadPhysicalPage(META_PAGE_ID, meta_data_);
+  struct stat file_stat;
+  if (fstat(db_fd_, &file_stat) == 0) {
+    file_pages_ = static_cast<page_id_t>((file_stat.st_size + PAGE_SIZE - 1) / PAGE_SIZE);
+  }
+  async_io_ = AsyncIO::Create(db_fd_);
+  log_fd_ = open(log_name_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (log_fd_ < 0) {
+    throw std::exception();
+  }
+  log_size_ = lseek(log_fd_, 0, SEEK_END);
 }
 
 void DiskManager::Close() {
-  std::scoped_lock<std::recursive_mutex> lock(db_io_latch_);
+  std::scoped_lock<std::mutex> lock(meta_latch_);
   if (!closed) {
-    db_io_.close();
+    async_io_.reset();
+    WriteAllocationPages();
+    close(db_fd_);
+    close(log_fd_);
     closed = true;
   }
 }
 
+void DiskManager::WriteLog(const char *log_data, uint32_t size) {
+  // 只有log flush线程会写日志，不需要加锁
+  uint32_t written = 0;
+  while (written < size) {
+    ssize_t ret = pwrite(log_fd_, log_data + written, size - written, log_size_ + written);
+    if (ret < 0) {
+      LOG(ERROR) << "I/O error while writing log";
+      return;
+    }
+    written += ret;
+  }
+  log_size_ += size;
+  if (fdatasync(log_fd_) != 0) {
+    LOG(ERROR) << "I/O error while syncing log";
+  }
+}
+
+uint32_t DiskManager::ReadLog(char *log_data, uint32_t size, uint32_t offset) {
+  ssize_t ret = pread(log_fd_, log_data, size, offset);
+  return ret < 0 ? 0 : static_cast<uint32_t>(ret);
+}
+
+void DiskManager::TruncateLog(uint32_t size) {
+  if (ftruncate(log_fd_, size) != 0 || fdatasync(log_fd_) != 0) {
+    LOG(ERROR) << "I/O error while truncating log";
+  }
+  log_size_ = size;
+}
+
+void DiskManager::DiscardLogPrefix(uint32_t offset) {
+  ASSERT(offset <= log_size_, "Discard beyond the end of log.");
+  if (offset == 0) {
+    return;
+  }
+  // 先把保留的部分写到临时文件并落盘，再rename替换原来的日志，任何时刻崩溃都能看到一份完整的日志
+  std::string tmp_name = log_name_ + ".tmp";
+  int tmp_fd = open(tmp_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (tmp_fd < 0) {
+    LOG(ERROR) << "I/O error while creating " << tmp_name;
+    return;
+  }
+  uint32_t size = log_size_ - offset;
+  std::unique_ptr<char[]> buf(new char[PAGE_SIZE * 16]);
+  for (uint32_t copied = 0; copied < size;) {
+    uint32_t len = std::min<uint32_t>(PAGE_SIZE * 16, size - copied);
+    ssize_t ret = pread(log_fd_, buf.get(), len, offset + copied);
+    if (ret <= 0 || pwrite(tmp_fd, buf.get(), ret, copied) != ret) {
+      LOG(ERROR) << "I/O error while copying log";
+      close(tmp_fd);
+      return;
+    }
+    copied += ret;
+  }
+  if (fdatasync(tmp_fd) != 0 || rename(tmp_name.c_str(), log_name_.c_str()) != 0) {
+    LOG(ERROR) << "I/O error while replacing log";
+    close(tmp_fd);
+    return;
+  }
+  // rename本身也要落盘
+  std::string dir = std::filesystem::path(log_name_).parent_path().string();
+  int dir_fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+  if (dir_fd >= 0) {
+    fsync(dir_fd);
+    close(dir_fd);
+  }
+  close(log_fd_);
+  log_fd_ = tmp_fd;
+  log_size_ = size;
+}
+
+void DiskManager::SyncData() {
+  {
+    std::scoped_lock<std::mutex> lock(meta_latch_);
+    WriteAllocationPages();
+  }
+  if (fdatasync(db_fd_) != 0) {
+    LOG(ERROR) << "I/O error while syncing db file";
+  }
+}
+
+std::string DiskManager::GetLogFileName(const std::string &db_file) {
+  size_t n = db_file.size();
+  if (n >= 3 && db_file.compare(n - 3, 3, ".db") == 0) {
+    return db_file.substr(0, n - 3) + ".log";
+  }
+  return db_file + ".log";
+}
+
 void DiskManager::ReadPage(page_id_t logical_page_id, char *page_data) {
   ASSERT(logical_page_id >= 0, "Invalid page id.");
   ReadPhysicalPage(MapPageId(logical_page_id), page_data);
@@ -44,117 +142,216 @@ void DiskManager::WritePage(page_id_t logical_page_id, const char *page_data) {
   WritePhysicalPage(MapPageId(logical_page_id), page_data);
 }
 
-page_id_t DiskManager::AllocatePage() {
-  //  ASSERT(false, "Not implemented yet.");
-  //  return INVALID_PAGE_ID;
-  uint32_t meta_data_uint[PAGE_SIZE/4];
-  memcpy(meta_data_uint, meta_data_, 4096);
-
-  size_t page_id;
-  // 寻找第一个没有满额的extent
-  uint32_t extent_id = 0;
-  while (  *(meta_data_uint+2+extent_id) == BITMAP_SIZE) {
-    extent_id++;
-  };
-  // 读取对应extent的bitmap_page，寻找第一个free的page
-  char bitmap[PAGE_SIZE];
-  page_id_t bitmap_physical_id = extent_id * (BITMAP_SIZE + 1) + 1;
-  ReadPhysicalPage(bitmap_physical_id, bitmap);
-
-  BitmapPage<PAGE_SIZE> *bitmap_page = reinterpret_cast<BitmapPage<PAGE_SIZE> *>(bitmap);
-  uint32_t next_free_page = bitmap_page->GetNextFreePage();
-  page_id = extent_id * BITMAP_SIZE + next_free_page;
-
-  bitmap_page->AllocatePage(next_free_page);
-  // 修改meta_data
-  if (extent_id >= *(meta_data_uint+1)) ++ *(meta_data_uint+1);
-  ++ *(meta_data_uint+2+extent_id);
-  ++ *(meta_data_uint);
+void DiskManager::WritePages(const std::vector<std::pair<page_id_t, const char *>> &pages) {
+  std::vector<std::pair<page_id_t, const char *>> physical_pages;
+  physical_pages.reserve(pages.size());
+  for (auto &page : pages) {
+    ASSERT(page.first >= 0, "Invalid page id.");
+    physical_pages.emplace_back(MapPageId(page.first), page.second);
+  }
+  std::sort(physical_pages.begin(), physical_pages.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+  // 物理页号连续的一段用一次pwritev写，bitmap页会把逻辑上连续的页隔开
+  std::vector<iovec> iov;
+  size_t i = 0;
+  while (i < physical_pages.size()) {
+    size_t j = i + 1;
+    while (j < physical_pages.size() && j - i < static_cast<size_t>(IOV_MAX) &&
+           physical_pages[j].first == physical_pages[j - 1].first + 1) {
+      j++;
+    }
+    iov.clear();
+    for (size_t k = i; k < j; k++) {
+      iov.push_back({const_cast<char *>(physical_pages[k].second), PAGE_SIZE});
+    }
+    WritePhysicalPages(physical_pages[i].first, iov);
+    i = j;
+  }
+}
 
-  memcpy(meta_data_,meta_data_uint, 4096);
-  WritePhysicalPage(META_PAGE_ID, meta_data_);
-  WritePhysicalPage(bitmap_physical_id, bitmap);
-  return page_id;
+void DiskManager::ReadPageAsync(page_id_t logical_page_id, char *page_data, const AsyncIO::Callback &done) {
+  ASSERT(logical_page_id >= 0, "Invalid page id.");
+  off_t offset = static_cast<off_t>(MapPageId(logical_page_id)) * PAGE_SIZE;
+  async_io_->SubmitRead(page_data, PAGE_SIZE, offset, done);
 }
 
-void DiskManager::DeAllocatePage(page_id_t logical_page_id) {
-  //  ASSERT(false, "Not implemented yet.");
-  char bitmap[PAGE_SIZE];
-  size_t pages_per_extent = 1 + BITMAP_SIZE;
-  page_id_t bitmap_physical_id = 1 + MapPageId(logical_page_id) / pages_per_extent;
-  ReadPhysicalPage(bitmap_physical_id, bitmap);
-  BitmapPage<PAGE_SIZE> *bitmap_page = reinterpret_cast<BitmapPage<PAGE_SIZE> *>(bitmap);
+void DiskManager::WritePageAsync(page_id_t logical_page_id, const char *page_data, const AsyncIO::Callback &done) {
+  ASSERT(logical_page_id >= 0, "Invalid page id.");
+  off_t offset = static_cast<off_t>(MapPageId(logical_page_id)) * PAGE_SIZE;
+  async_io_->SubmitWrite(page_data, PAGE_SIZE, offset, done);
+}
 
-  bitmap_page->DeAllocatePage(logical_page_id % BITMAP_SIZE);
+page_id_t DiskManager::AllocatePage() {
+  std::scoped_lock<std::mutex> lock(meta_latch_);
+  // meta page: | allocated pages | extents | used pages of extent 0 | used pages of extent 1 | ...
+  uint32_t *meta_data_uint = reinterpret_cast<uint32_t *>(meta_data_);
+  // 寻找第一个没有满额的extent，它前面的extent都是满的
+  while (next_free_extent_ < DiskFileMetaPage::MAX_EXTENT_NUMS &&
+         meta_data_uint[2 + next_free_extent_] == BITMAP_SIZE) {
+    next_free_extent_++;
+  }
+  ASSERT(next_free_extent_ < DiskFileMetaPage::MAX_EXTENT_NUMS, "Database file is full.");
+  uint32_t extent_id = next_free_extent_;
+  // 在缓存的bitmap_page中分配第一个free的page
+  uint32_t next_free_page;
+  GetBitmap(extent_id)->AllocatePage(next_free_page);
+  bitmap_dirty_[extent_id] = true;
+  page_id_t page_id = extent_id * BITMAP_SIZE + next_free_page;
+  // 修改meta_data
+  if (extent_id >= meta_data_uint[1]) ++meta_data_uint[1];
+  ++meta_data_uint[2 + extent_id];
+  ++meta_data_uint[0];
+  meta_dirty_ = true;
+  Preallocate(MapPageId(page_id));
+  return page_id;
+}
 
-  uint32_t meta_data_uint[PAGE_SIZE/4];
-//   修改meta_data
+bool DiskManager::AllocatePageAt(page_id_t logical_page_id) {
+  std::scoped_lock<std::mutex> lock(meta_latch_);
+  uint32_t *meta_data_uint = reinterpret_cast<uint32_t *>(meta_data_);
   uint32_t extent_id = logical_page_id / BITMAP_SIZE;
-  if (-- *(meta_data_uint + 2 + extent_id) == 0) -- *( meta_data_uint + 1 );
-  -- *(meta_data_uint);
+  if (!GetBitmap(extent_id)->AllocatePageAt(logical_page_id % BITMAP_SIZE)) {
+    return false;
+  }
+  bitmap_dirty_[extent_id] = true;
+  if (extent_id >= meta_data_uint[1]) ++meta_data_uint[1];
+  ++meta_data_uint[2 + extent_id];
+  ++meta_data_uint[0];
+  meta_dirty_ = true;
+  Preallocate(MapPageId(logical_page_id));
+  return true;
+}
 
-  memcpy(meta_data_,meta_data_uint, 4096);
-  WritePhysicalPage(META_PAGE_ID, meta_data_);
-  WritePhysicalPage(bitmap_physical_id, bitmap);
+void DiskManager::DeAllocatePage(page_id_t logical_page_id) {
+  std::scoped_lock<std::mutex> lock(meta_latch_);
+  uint32_t extent_id = logical_page_id / BITMAP_SIZE;
+  // 已经是空闲的页不再修改计数
+  if (!GetBitmap(extent_id)->DeAllocatePage(logical_page_id % BITMAP_SIZE)) {
+    return;
+  }
+  bitmap_dirty_[extent_id] = true;
+  //   修改meta_data
+  uint32_t *meta_data_uint = reinterpret_cast<uint32_t *>(meta_data_);
+  if (--meta_data_uint[2 + extent_id] == 0) --meta_data_uint[1];
+  --meta_data_uint[0];
+  meta_dirty_ = true;
+  next_free_extent_ = std::min(next_free_extent_, extent_id);
 }
 
 bool DiskManager::IsPageFree(page_id_t logical_page_id) {
   // 判断对应的bitmap中那一bit是0还是1
-  // 读取对应的bitmap
-  char bitmap[PAGE_SIZE];
-  size_t pages_per_extent = 1 + BITMAP_SIZE;
-  page_id_t bitmap_physical_id = 1 + MapPageId(logical_page_id) / pages_per_extent;
-  ReadPhysicalPage(bitmap_physical_id, bitmap);
+  std::scoped_lock<std::mutex> lock(meta_latch_);
+  return GetBitmap(logical_page_id / BITMAP_SIZE)->IsPageFree(logical_page_id % BITMAP_SIZE);
+}
 
-  BitmapPage<PAGE_SIZE> *bitmap_page = reinterpret_cast<BitmapPage<PAGE_SIZE> *>(bitmap);
-  // 判断
-  if (bitmap_page->IsPageFree(logical_page_id % BITMAP_SIZE)) return true;
-  return false;
+BitmapPage<PAGE_SIZE> *DiskManager::GetBitmap(uint32_t extent_id) {
+  if (extent_id >= bitmaps_.size()) {
+    bitmaps_.resize(extent_id + 1);
+    bitmap_dirty_.resize(extent_id + 1, false);
+  }
+  if (bitmaps_[extent_id] == nullptr) {
+    bitmaps_[extent_id].reset(new char[PAGE_SIZE]);
+    ReadPhysicalPage(extent_id * (BITMAP_SIZE + 1) + 1, bitmaps_[extent_id].get());
+  }
+  return reinterpret_cast<BitmapPage<PAGE_SIZE> *>(bitmaps_[extent_id].get());
 }
 
-page_id_t DiskManager::MapPageId(page_id_t logical_page_id) {
-  return logical_page_id + 1 + 1 + logical_page_id / BITMAP_SIZE;
+void DiskManager::WriteAllocationPages() {
+  if (meta_dirty_) {
+    WritePhysicalPage(META_PAGE_ID, meta_data_);
+    meta_dirty_ = false;
+  }
+  for (uint32_t extent_id = 0; extent_id < bitmaps_.size(); extent_id++) {
+    if (bitmap_dirty_[extent_id]) {
+      WritePhysicalPage(extent_id * (BITMAP_SIZE + 1) + 1, bitmaps_[extent_id].get());
+      bitmap_dirty_[extent_id] = false;
+    }
+  }
 }
 
-int DiskManager::GetFileSize(const std::string &file_name) {
-  struct stat stat_buf;
-  int rc = stat(file_name.c_str(), &stat_buf);
-  return rc == 0 ? stat_buf.st_size : -1;
+void DiskManager::Preallocate(page_id_t physical_page_id) {
+  if (physical_page_id < file_pages_) {
+    return;
+  }
+  // 一次多扩展一些，文件的元数据不用每分配一页就改一次；不支持fallocate的文件系统上写页时自然会扩展文件
+  page_id_t new_file_pages = physical_page_id + 1 + DISK_PREALLOCATE_PAGES;
+  off_t offset = static_cast<off_t>(file_pages_) * PAGE_SIZE;
+  off_t length = static_cast<off_t>(new_file_pages - file_pages_) * PAGE_SIZE;
+  if (fallocate(db_fd_, 0, offset, length) != 0 && errno != EOPNOTSUPP) {
+    LOG(WARNING) << "fallocate failed: " << strerror(errno);
+  }
+  file_pages_ = new_file_pages;
+}
+
+page_id_t DiskManager::MapPageId(page_id_t logical_page_id) {
+  return logical_page_id + 1 + 1 + logical_page_id / BITMAP_SIZE;
 }
 
 void DiskManager::ReadPhysicalPage(page_id_t physical_page_id, char *page_data) {
-  int offset = physical_page_id * PAGE_SIZE;
-  // check if read beyond file length
-  if (offset >= GetFileSize(file_name_)) {
+  off_t offset = static_cast<off_t>(physical_page_id) * PAGE_SIZE;
+  // pread读到文件末尾会返回0，不需要先stat文件大小
+  size_t read_count = 0;
+  while (read_count < PAGE_SIZE) {
+    ssize_t ret = pread(db_fd_, page_data + read_count, PAGE_SIZE - read_count, offset + read_count);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      if (ret < 0) {
+        LOG(ERROR) << "I/O error while reading";
+      }
+      break;
+    }
+    read_count += ret;
+  }
+  if (read_count < PAGE_SIZE) {
 #ifdef ENABLE_BPM_DEBUG
     LOG(INFO) << "Read less than a page" << std::endl;
 #endif
-    memset(page_data, 0, PAGE_SIZE);
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-#ifdef ENABLE_BPM_DEBUG
-      LOG(INFO) << "Read less than a page" << std::endl;
-#endif
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+    memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+  }
+}
+
+void DiskManager::WritePhysicalPages(page_id_t physical_page_id, std::vector<iovec> &iov) {
+  off_t offset = static_cast<off_t>(physical_page_id) * PAGE_SIZE;
+  iovec *vec = iov.data();
+  int count = static_cast<int>(iov.size());
+  while (count > 0) {
+    ssize_t ret = pwritev(db_fd_, vec, count, offset);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      LOG(ERROR) << "I/O error while writing";
+      return;
+    }
+    // 只写了一部分，跳过已经写完的缓冲区接着写
+    offset += ret;
+    while (count > 0 && static_cast<size_t>(ret) >= vec->iov_len) {
+      ret -= vec->iov_len;
+      vec++;
+      count--;
+    }
+    if (count > 0) {
+      vec->iov_base = static_cast<char *>(vec->iov_base) + ret;
+      vec->iov_len -= ret;
     }
   }
 }
 
 void DiskManager::WritePhysicalPage(page_id_t physical_page_id, const char *page_data) {
-  size_t offset = static_cast<size_t>(physical_page_id) * PAGE_SIZE;
-  // set write cursor to offset
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG(ERROR) << "I/O error while writing";
-    return;
+  off_t offset = static_cast<off_t>(physical_page_id) * PAGE_SIZE;
+  size_t written = 0;
+  while (written < PAGE_SIZE) {
+    ssize_t ret = pwrite(db_fd_, page_data + written, PAGE_SIZE - written, offset + written);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    // check for I/O error
+    if (ret <= 0) {
+      LOG(ERROR) << "I/O error while writing";
+      return;
+    }
+    written += ret;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
 }
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "storage/free_space_map.h"
+
+FreeSpaceMap::FreeSpaceMap(BufferPoolManager *buffer_pool_manager)
+    : buffer_pool_manager_(buffer_pool_manager), pages_by_bucket_(BUCKET_COUNT) {
+  page_id_t page_id;
+  auto page = reinterpret_cast<FreeSpaceMapPage *>(buffer_pool_manager_->NewPage(page_id)->GetData());
+  page->Init();
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  fsm_pages_.push_back(page_id);
+}
+
+FreeSpaceMap::FreeSpaceMap(BufferPoolManager *buffer_pool_manager, page_id_t first_page_id)
+    : buffer_pool_manager_(buffer_pool_manager), pages_by_bucket_(BUCKET_COUNT) {
+  page_id_t page_id = first_page_id;
+  while (page_id != INVALID_PAGE_ID) {
+    auto page = reinterpret_cast<FreeSpaceMapPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+    fsm_pages_.push_back(page_id);
+    if (!page->IsValid()) {
+      // 没有写回过磁盘，之后的页也不可信，TableHeap会沿着页链表把缺的页补上
+      page->Init();
+      buffer_pool_manager_->UnpinPage(page_id, true);
+      break;
+    }
+    for (uint32_t i = 0; i < page->GetCount(); i++) {
+      uint32_t index = table_pages_.size();
+      table_pages_.push_back(page->GetPageId(i));
+      buckets_.push_back(page->GetBucket(i));
+      positions_[page->GetPageId(i)] = index;
+      pages_by_bucket_[page->GetBucket(i)].insert(index);
+    }
+    page_id_t next_page_id = page->GetNextPageId();
+    if (!page->IsFull() && next_page_id != INVALID_PAGE_ID) {
+      // 只有最后一页可以不满，否则下标和页对应不上，把后面的页截掉
+      page->SetNextPageId(INVALID_PAGE_ID);
+      buffer_pool_manager_->UnpinPage(page_id, true);
+      break;
+    }
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
+uint32_t FreeSpaceMap::GetPageCount() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return table_pages_.size();
+}
+
+page_id_t FreeSpaceMap::GetLastPageId() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return table_pages_.empty() ? INVALID_PAGE_ID : table_pages_.back();
+}
+
+bool FreeSpaceMap::Contains(page_id_t table_page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  return positions_.count(table_page_id) > 0;
+}
+
+void FreeSpaceMap::GetNextPages(page_id_t table_page_id, uint32_t count, std::vector<page_id_t> *page_ids) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = positions_.find(table_page_id);
+  if (it == positions_.end()) {
+    return;
+  }
+  uint32_t end = std::min<uint32_t>(table_pages_.size(), it->second + 1 + count);
+  for (uint32_t i = it->second + 1; i < end; i++) {
+    page_ids->push_back(table_pages_[i]);
+  }
+}
+
+page_id_t FreeSpaceMap::FindPage(uint32_t size) {
+  std::lock_guard<std::mutex> guard(latch_);
+  // 桶号是向下取整的，所以要从向上取整的桶开始找
+  for (uint32_t bucket = (size + BUCKET_SIZE - 1) / BUCKET_SIZE; bucket < BUCKET_COUNT; bucket++) {
+    if (!pages_by_bucket_[bucket].empty()) {
+      return table_pages_[*pages_by_bucket_[bucket].begin()];
+    }
+  }
+  return INVALID_PAGE_ID;
+}
+
+void FreeSpaceMap::Update(page_id_t table_page_id, uint32_t free_space) {
+  std::lock_guard<std::mutex> guard(latch_);
+  uint8_t bucket = ToBucket(free_space);
+  auto it = positions_.find(table_page_id);
+  if (it == positions_.end()) {
+    Append(table_page_id, bucket);
+    return;
+  }
+  uint32_t index = it->second;
+  if (buckets_[index] == bucket) {
+    return;
+  }
+  pages_by_bucket_[buckets_[index]].erase(index);
+  pages_by_bucket_[bucket].insert(index);
+  buckets_[index] = bucket;
+  WriteBucket(index);
+}
+
+void FreeSpaceMap::Destroy() {
+  std::lock_guard<std::mutex> guard(latch_);
+  for (auto page_id : fsm_pages_) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+  fsm_pages_.clear();
+  table_pages_.clear();
+  buckets_.clear();
+  positions_.clear();
+  for (auto &pages : pages_by_bucket_) {
+    pages.clear();
+  }
+}
+
+void FreeSpaceMap::WriteBucket(uint32_t index) {
+  page_id_t page_id = fsm_pages_[index / FreeSpaceMapPage::MAX_ENTRY_COUNT];
+  auto page = reinterpret_cast<FreeSpaceMapPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+  page->SetBucket(index % FreeSpaceMapPage::MAX_ENTRY_COUNT, buckets_[index]);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+void FreeSpaceMap::Append(page_id_t table_page_id, uint8_t bucket) {
+  uint32_t index = table_pages_.size();
+  table_pages_.push_back(table_page_id);
+  buckets_.push_back(bucket);
+  positions_[table_page_id] = index;
+  pages_by_bucket_[bucket].insert(index);
+  page_id_t page_id = fsm_pages_.back();
+  auto page = reinterpret_cast<FreeSpaceMapPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+  if (page->IsFull()) {
+    page_id_t new_page_id;
+    auto new_page = reinterpret_cast<FreeSpaceMapPage *>(buffer_pool_manager_->NewPage(new_page_id)->GetData());
+    new_page->Init();
+    page->SetNextPageId(new_page_id);
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    fsm_pages_.push_back(new_page_id);
+    page_id = new_page_id;
+    page = new_page;
+  }
+  page->Append(table_page_id, bucket);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
@@ -2,46 +2,177 @@
 
 bool TableHeap::InsertTuple(Row &row, Transaction *txn) {
   // if tuple is too big, return false
-  // PAGE_SIZE-32 means the remaining space after init page
-  if (row.GetSerializedSize(schema_) > PAGE_SIZE - 32) {
+  uint32_t size = row.GetSerializedSize(schema_);
+  if (size > TablePage::SIZE_MAX_ROW) {
     return false;
   }
-  // Find a page that can contain this tuple.
-  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(GetFirstPageId()));
+  // 除了tuple本身还要一个slot
+  uint32_t space_needed = size + TablePage::SIZE_TUPLE;
   while (true) {
+    // 在空闲空间表中找一个放得下的page，找不到就在最后new一个page
+    page_id_t page_id = free_space_map_.FindPage(space_needed);
+    if (page_id == INVALID_PAGE_ID) {
+      page_id = FindOrAppendPage(space_needed);
+      if (page_id == INVALID_PAGE_ID) {
+        return false;
+      }
+    }
+    RowId wait_rid = INVALID_ROWID;
+    auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
     // If the page could not be found, then abort the transaction.
     if (page == nullptr) {
       return false;
     }
-    // Otherwise, insert tuple.
-//    page->WLatch();
+    page->WLatch();
+    bool inserted = page->InsertTuple(row, schema_, txn, lock_manager_, log_manager_, &wait_rid);
+    uint32_t free_space = page->GetFreeSpaceRemaining();
+    page->WUnlatch();
     // 若insert完成,则返回true
-    if (page->InsertTuple(row, schema_, txn, lock_manager_, log_manager_)) {
-//      page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
+    if (inserted) {
+      free_space_map_.Update(page_id, free_space);
+      buffer_pool_manager_->UnpinPage(page_id, true);
+      AppendTableWrite(row.GetRowId(), WType::kInsert, Row(row.GetRowId()), txn);
       return true;
     }
-    // 否则继续找下一个page是否可以insert
-//    page->WUnlatch();
-    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
-    page_id_t next = page->GetNextPageId();
-    // 若当前page不是最后一个page则继续循环,是最后一个就new一个page
-    if (next != INVALID_PAGE_ID) {
-      page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(next));
-    } else {
-      // new一个page并完成插入
-      auto new_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->NewPage(next));
-      page->SetNextPageId(next);
-      new_page->Init(next, page->GetPageId(), log_manager_, txn);
-//      new_page->WLatch();
-      new_page->InsertTuple(row, schema_, txn, lock_manager_, log_manager_);
-//      new_page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(next, true);  // 存疑
-      return true;
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    // 没能锁住新的slot，事务已经被回滚
+    if (txn != nullptr && txn->GetState() == TxnState::kAborted) {
+      return false;
+    }
+    if (wait_rid.GetPageId() != INVALID_PAGE_ID) {
+      // 复用的slot还被别的事务锁着，已经放掉latch，等到锁之后重试。重试时slot可能已被别人占用，多拿的锁提交时一起释放
+      if (!lock_manager_->LockExclusive(txn, wait_rid)) {
+        return false;
+      }
+      continue;
     }
+    // 空闲空间表里记的过时了，按page上实际的空闲空间更新后重新找，更新后不会再找到这个page
+    free_space_map_.Update(page_id, free_space);
+  }
+}
+
+page_id_t TableHeap::FindOrAppendPage(uint32_t space_needed) {
+  std::lock_guard<std::mutex> guard(append_latch_);
+  // 等append_latch_的时候别的insert可能已经接了一个新page，它放得下就不用再new了
+  page_id_t page_id = free_space_map_.FindPage(space_needed);
+  if (page_id != INVALID_PAGE_ID) {
+    return page_id;
+  }
+  // 空闲空间表中最后一个page就是页链表的最后一个page
+  page_id_t last_page_id = free_space_map_.GetLastPageId();
+  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(last_page_id));
+  if (page == nullptr) {
+    return INVALID_PAGE_ID;
+  }
+  // 链接新page时最后一个page必须仍被pin住，并以dirty的方式unpin
+  page_id_t next;
+  auto new_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->NewPage(next));
+  if (new_page == nullptr) {
+    buffer_pool_manager_->UnpinPage(last_page_id, false);
+    return INVALID_PAGE_ID;
   }
+  new_page->Init(next, last_page_id, log_manager_, nullptr);
+  page->WLatch();
+  page->SetNextPageId(next);
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(last_page_id, true);
+  free_space_map_.Update(next, new_page->GetFreeSpaceRemaining());
+  buffer_pool_manager_->UnpinPage(next, true);
+  return next;
 }
+
+RowId TableHeap::AppendTuples(const std::function<bool(std::vector<Field> *)> &next,
+                              const std::function<void(const Row &)> &inserted) {
+  std::lock_guard<std::mutex> guard(append_latch_);
+  page_id_t page_id = free_space_map_.GetLastPageId();
+  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (page == nullptr) {
+    return INVALID_ROWID;
+  }
+  // 最后一页已经有数据时从新页开始，这样新插入的行正好是first_rid之后的所有行
+  RowId first_rid = INVALID_ROWID;
+  bool usable = !page->GetFirstTupleRid(&first_rid);
+  first_rid = INVALID_ROWID;
+  // 扫描可能同时在读这些page，每行都在page的写latch下写入
+  auto insert_into = [this](TablePage *page, Row &row) {
+    page->WLatch();
+    bool inserted = page->InsertTuple(row, schema_, nullptr, lock_manager_, log_manager_);
+    page->WUnlatch();
+    return inserted;
+  };
+  std::vector<Field> fields;
+  while (next(&fields)) {
+    Row row(fields);
+    fields.clear();
+    if (row.GetSerializedSize(schema_) > TablePage::SIZE_MAX_ROW) {
+      continue;
+    }
+    if (!usable || !insert_into(page, row)) {
+      // 当前页写满了，接一个新页继续写，写满的页不会再被碰到，这时再更新空闲空间表
+      page_id_t new_page_id;
+      auto new_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->NewPage(new_page_id));
+      if (new_page == nullptr) {
+        break;
+      }
+      new_page->Init(new_page_id, page_id, log_manager_, nullptr);
+      page->WLatch();
+      page->SetNextPageId(new_page_id);
+      page->WUnlatch();
+      free_space_map_.Update(page_id, page->GetFreeSpaceRemaining());
+      buffer_pool_manager_->UnpinPage(page_id, true);
+      page = new_page;
+      page_id = new_page_id;
+      usable = true;
+      if (!insert_into(page, row)) {
+        continue;
+      }
+    }
+    if (first_rid == INVALID_ROWID) {
+      first_rid = row.GetRowId();
+    }
+    inserted(row);
+  }
+  free_space_map_.Update(page_id, page->GetFreeSpaceRemaining());
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  return first_rid;
+}
+
+uint32_t TableHeap::ReadAhead(page_id_t page_id, uint32_t count, page_id_t *last_page_id) {
+  // 空闲空间表里的页就是按页链表的顺序排的，不用把页读进来再找下一页
+  std::vector<page_id_t> page_ids;
+  free_space_map_.GetNextPages(page_id, count, &page_ids);
+  if (page_ids.empty()) {
+    return 0;
+  }
+  buffer_pool_manager_->PrefetchPages(page_ids, true);
+  *last_page_id = page_ids.back();
+  return page_ids.size();
+}
+
+void TableHeap::SyncFreeSpaceMap() {
+  page_id_t page_id = free_space_map_.GetLastPageId();
+  if (page_id == INVALID_PAGE_ID) {
+    page_id = first_page_id_;
+  }
+  while (page_id != INVALID_PAGE_ID) {
+    auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr) {
+      break;
+    }
+    if (!free_space_map_.Contains(page_id)) {
+      free_space_map_.Update(page_id, page->GetFreeSpaceRemaining());
+    }
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
 bool TableHeap::MarkDelete(const RowId &rid, Transaction *txn) {
+  // 等待行锁时不能持有page的latch，所以先加锁再latch page
+  if (txn != nullptr && lock_manager_ != nullptr && !lock_manager_->LockExclusive(txn, rid)) {
+    return false;
+  }
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -51,35 +182,61 @@ bool TableHeap::MarkDelete(const RowId &rid, Transaction *txn) {
 
   // Otherwise, mark the tuple as deleted.
   page->WLatch();
-  page->MarkDelete(rid, txn, lock_manager_, log_manager_);
+  bool deleted = page->MarkDelete(rid, txn, lock_manager_, log_manager_);
   page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
-  return true;
+  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), deleted);
+  if (deleted) {
+    AppendTableWrite(rid, WType::kDelete, Row(rid), txn);
+  }
+  return deleted;
 }
 
 bool TableHeap::UpdateTuple(const Row &row, const RowId &rid, Transaction *txn) {
+  return UpdateTupleInPlace(row, rid, txn) == 0;
+}
+
+bool TableHeap::UpdateOrMoveTuple(Row &row, const RowId &rid, Transaction *txn) {
+  int type = UpdateTupleInPlace(row, rid, txn);
+  if (type == 0) {
+    row.SetRowId(rid);
+    return true;
+  }
+  if (type != 3) {
+    return false;
+  }
+  // 原来的page放不下，删掉旧的再插入到别的page，两步都记在txn的write set里，回滚时各自撤销
+  return MarkDelete(rid, txn) && InsertTuple(row, txn);
+}
+
+int TableHeap::UpdateTupleInPlace(const Row &row, const RowId &rid, Transaction *txn) {
+  if (txn != nullptr && lock_manager_ != nullptr && !lock_manager_->LockExclusive(txn, rid)) {
+    return 1;
+  }
   // rid is old row, get its page and update
-  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
-  if (page == nullptr) return false;
   Row old(rid);
   // get old row by get_tuple
   if (!GetTuple(&old, txn)) {
-    return false;
+    return 1;
   }
+  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  if (page == nullptr) return 1;
   // update old row
+  Row page_old(rid);
   page->WLatch();
-  int type = page->UpdateTuple(row, &old, schema_, txn, lock_manager_, log_manager_);
+  int type = page->UpdateTuple(row, &page_old, schema_, txn, lock_manager_, log_manager_);
+  uint32_t free_space = page->GetFreeSpaceRemaining();
   page->WUnlatch();
-  // if type==0, success, return true
-  // if type==1 or type==2, fail, return false
+  // if type==0, success
+  // if type==1 or type==2, fail
   // if type==3, space is not enough, we need delete and insert
   if (type == 0) {
+    free_space_map_.Update(rid.GetPageId(), free_space);
     buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
-    return true;
+    AppendTableWrite(rid, WType::kUpdate, old, txn);
   } else {
     buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
-    return false;
   }
+  return type;
 }
 
 void TableHeap::ApplyDelete(const RowId &rid, Transaction *txn) {
@@ -91,7 +248,10 @@ void TableHeap::ApplyDelete(const RowId &rid, Transaction *txn) {
   // delete
   page->WLatch();
   page->ApplyDelete(rid, txn, log_manager_);
+  uint32_t free_space = page->GetFreeSpaceRemaining();
   page->WUnlatch();
+  // 腾出来的空间之后的insert可以用
+  free_space_map_.Update(rid.GetPageId(), free_space);
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
 }
 
@@ -108,26 +268,37 @@ void TableHeap::RollbackDelete(const RowId &rid, Transaction *txn) {
 
 void TableHeap::FreeHeap() {
   page_id_t now_page_id = first_page_id_;
-  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(now_page_id));
-  page->RLatch();
-  page_id_t new_page_id = page->GetNextPageId();
-  page->RUnlatch();
   while (now_page_id != INVALID_PAGE_ID) {
-    buffer_pool_manager_->DeletePage(now_page_id);
-    now_page_id = new_page_id;
-    page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(now_page_id));
+    auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(now_page_id));
+    if (page == nullptr) {
+      break;
+    }
     page->RLatch();
-    new_page_id = page->GetNextPageId();
+    page_id_t next_page_id = page->GetNextPageId();
     page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(now_page_id, false);
+    buffer_pool_manager_->DeletePage(now_page_id);
+    now_page_id = next_page_id;
   }
-  delete buffer_pool_manager_;
-  delete &first_page_id_;
-  delete schema_;
-  delete log_manager_;
-  delete lock_manager_;
+  free_space_map_.Destroy();
+}
+
+bool TableHeap::TryLockRow(const RowId &rid, Transaction *txn, bool emit) {
+  if (txn == nullptr || lock_manager_ == nullptr) {
+    return true;
+  }
+  // 不返回的行不加锁，只要不是别的事务没提交的修改就行，不用为扫过的每一行都建一个锁
+  return emit ? lock_manager_->TryLockShared(txn, rid) : !lock_manager_->IsExclusiveLockedByOther(txn, rid);
+}
+
+bool TableHeap::LockRow(const RowId &rid, Transaction *txn) {
+  return txn == nullptr || lock_manager_ == nullptr || lock_manager_->LockShared(txn, rid);
 }
 
 bool TableHeap::GetTuple(Row *row, Transaction *txn) {
+  if (txn != nullptr && lock_manager_ != nullptr && !lock_manager_->LockShared(txn, row->GetRowId())) {
+    return false;
+  }
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(row->GetRowId().GetPageId()));
   if (page == nullptr) return false;
   page->RLatch();
@@ -141,6 +312,12 @@ bool TableHeap::GetTuple(Row *row, Transaction *txn) {
   return true;
 }
 
+void TableHeap::AppendTableWrite(const RowId &rid, WType wtype, const Row &old_row, Transaction *txn) {
+  if (txn != nullptr) {
+    txn->GetTableWriteSet().emplace_back(rid, wtype, old_row, this);
+  }
+}
+
 TableIterator TableHeap::Begin(Transaction *txn) {
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
   RowId rid;
@@ -2,7 +2,7 @@
 #include "common/macros.h"
 #include "storage/table_heap.h"
 
-TableIterator::TableIterator(TableHeap *t, RowId rid) : table_heap_(t) {
+TableIterator::TableIterator(TableHeap *t, RowId rid) : table_heap_(t), read_ahead_(t) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
     row_ = new Row(rid);
     table_heap_->GetTuple(row_, nullptr);
@@ -11,12 +11,22 @@ TableIterator::TableIterator(TableHeap *t, RowId rid) : table_heap_(t) {
   }
 }
 
-TableIterator::TableIterator(const TableIterator &other) {
+TableIterator::TableIterator(const TableIterator &other) : read_ahead_(other.table_heap_) {
   table_heap_ = other.table_heap_;
-  row_ = other.row_;
+  row_ = new Row(*other.row_);
 }
 
-TableIterator::~TableIterator() {}
+TableIterator &TableIterator::operator=(const TableIterator &other) {
+  if (this != &other) {
+    delete row_;
+    table_heap_ = other.table_heap_;
+    row_ = new Row(*other.row_);
+    read_ahead_ = ScanReadAhead(table_heap_);
+  }
+  return *this;
+}
+
+TableIterator::~TableIterator() { delete row_; }
 
 bool TableIterator::operator==(const TableIterator &itr) const {
   if(itr.row_->GetRowId()==INVALID_ROWID&&row_->GetRowId()==INVALID_ROWID){
@@ -63,16 +73,16 @@ TableIterator &TableIterator::operator++() {
     return *this;
   }
   // 先找本页之后的row
-  auto page = reinterpret_cast<TablePage *>(table_heap_->buffer_pool_manager_->FetchPage(row_->GetRowId().GetPageId()));
+  // 扫描中的访问不会让预读的冷页变热，行直接从已经latch住的页里读
+  auto page =
+      reinterpret_cast<TablePage *>(table_heap_->buffer_pool_manager_->FetchPage(row_->GetRowId().GetPageId(), true));
   RowId new_id;
   page->RLatch();
   // 如果能找到则直接读
   if (page->GetNextTupleRid(row_->GetRowId(), &new_id)) {
     delete row_;
     row_ = new Row(new_id);
-    if (*this != table_heap_->End()) {
-      table_heap_->GetTuple(row_, nullptr);
-    }
+    page->GetTuple(row_, table_heap_->schema_, nullptr, nullptr);
     page->RUnlatch();
     table_heap_->buffer_pool_manager_->UnpinPage(row_->GetRowId().GetPageId(), false);
   } else {
@@ -80,10 +90,11 @@ TableIterator &TableIterator::operator++() {
     page_id_t next_page_id = page->GetNextPageId();
     while (next_page_id != INVALID_PAGE_ID) {
       // 还没到最后一页
-      auto new_page = reinterpret_cast<TablePage *>(table_heap_->buffer_pool_manager_->FetchPage(next_page_id));
+      auto new_page = reinterpret_cast<TablePage *>(table_heap_->buffer_pool_manager_->FetchPage(next_page_id, true));
       page->RUnlatch();
       table_heap_->buffer_pool_manager_->UnpinPage(row_->GetRowId().GetPageId(), false);
       page = new_page;
+      read_ahead_.OnPage(next_page_id);
       page->RLatch();
       if (page->GetFirstTupleRid(&new_id)) {
         // 如果找到可用的tuple则跳出循环并读这个tuple
@@ -95,7 +106,7 @@ TableIterator &TableIterator::operator++() {
     }
     // 如果next_page_id不是非法的则可以读取tuple,否则需要返回nullptr构成的iter
     if (next_page_id != INVALID_PAGE_ID) {
-      table_heap_->GetTuple(row_, nullptr);
+      page->GetTuple(row_, table_heap_->schema_, nullptr, nullptr);
     } else {
       delete row_;
       row_ = new Row(INVALID_ROWID);
@@ -105,6 +116,20 @@ TableIterator &TableIterator::operator++() {
   }
   return *this;
 }
+void ScanReadAhead::OnPage(page_id_t page_id) {
+  uint32_t window = table_heap_->GetReadAheadPages();
+  pages_scanned_++;
+  if (read_ahead_left_ > 0) {
+    read_ahead_left_--;
+  }
+  if (window == 0 || pages_scanned_ < READ_AHEAD_TRIGGER || read_ahead_left_ > window / 2) {
+    return;
+  }
+  // 接着上一个窗口的末尾往后读，把窗口补满
+  page_id_t from = read_ahead_left_ > 0 ? read_ahead_end_ : page_id;
+  read_ahead_left_ += table_heap_->ReadAhead(from, window - read_ahead_left_, &read_ahead_end_);
+}
+
 TableIterator TableIterator::operator++(int) {
   TableIterator p(table_heap_, row_->GetRowId());
   ++(*this);
@@ -0,0 +1,349 @@
+#include "transaction/lock_manager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <unordered_set>
+
+/**
+ * 只有处于加锁阶段的事务可以加锁，在释放锁之后再加锁违反两阶段锁协议，事务被回滚
+ */
+static bool CheckGrowing(Transaction *txn) {
+  if (txn->GetState() == TxnState::kShrinking) {
+    txn->SetState(TxnState::kAborted);
+  }
+  return txn->GetState() == TxnState::kGrowing;
+}
+
+LockManager::LockManager(bool enable_cycle_detection) {
+  if (enable_cycle_detection) {
+    cycle_detection_thread_ = std::thread(&LockManager::RunCycleDetection, this);
+  }
+}
+
+LockManager::~LockManager() {
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    stop_ = true;
+  }
+  stop_cv_.notify_all();
+  if (cycle_detection_thread_.joinable()) {
+    cycle_detection_thread_.join();
+  }
+}
+
+bool LockManager::LockShared(Transaction *txn, const RowId &rid) {
+  // lock set只会被事务自己的线程修改，不需要latch
+  if (txn->IsSharedLocked(rid) || txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  std::unique_lock<std::mutex> lock(latch_);
+  if (!CheckGrowing(txn)) {
+    return false;
+  }
+  auto &queue = lock_table_[rid];
+  auto request = queue.request_queue_.emplace(queue.request_queue_.end(), txn->GetTransactionId(), LockMode::kShared);
+  if (!WaitForGrant(txn, rid, queue, request, lock)) {
+    return false;
+  }
+  txn->GetSharedLockSet().emplace(rid);
+  return true;
+}
+
+bool LockManager::LockExclusive(Transaction *txn, const RowId &rid) {
+  if (txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  if (txn->IsSharedLocked(rid)) {
+    return LockUpgrade(txn, rid);
+  }
+  std::unique_lock<std::mutex> lock(latch_);
+  if (!CheckGrowing(txn)) {
+    return false;
+  }
+  auto &queue = lock_table_[rid];
+  auto request =
+      queue.request_queue_.emplace(queue.request_queue_.end(), txn->GetTransactionId(), LockMode::kExclusive);
+  if (!WaitForGrant(txn, rid, queue, request, lock)) {
+    return false;
+  }
+  txn->GetExclusiveLockSet().emplace(rid);
+  return true;
+}
+
+bool LockManager::TryLockExclusive(Transaction *txn, const RowId &rid) {
+  if (txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  // 持有共享锁时要走升级，可能需要等待
+  if (txn->IsSharedLocked(rid)) {
+    return false;
+  }
+  std::scoped_lock<std::mutex> lock(latch_);
+  if (!CheckGrowing(txn)) {
+    return false;
+  }
+  // 只有没有任何其他请求时才能马上授予，否则不入队直接返回
+  auto it = lock_table_.find(rid);
+  if (it != lock_table_.end() && !it->second.request_queue_.empty()) {
+    return false;
+  }
+  auto &queue = lock_table_[rid];
+  queue.request_queue_.emplace_back(txn->GetTransactionId(), LockMode::kExclusive);
+  queue.request_queue_.back().granted_ = true;
+  txn->GetExclusiveLockSet().emplace(rid);
+  return true;
+}
+
+bool LockManager::TryLockShared(Transaction *txn, const RowId &rid) {
+  if (txn->IsSharedLocked(rid) || txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  std::scoped_lock<std::mutex> lock(latch_);
+  if (!CheckGrowing(txn)) {
+    return false;
+  }
+  // 和IsGrantable一样：前面不能有排它锁，也不能有事务在等待升级
+  auto it = lock_table_.find(rid);
+  if (it != lock_table_.end() &&
+      (it->second.upgrading_ != INVALID_TXN_ID ||
+       std::any_of(it->second.request_queue_.begin(), it->second.request_queue_.end(),
+                   [](const LockRequest &r) { return r.lock_mode_ == LockMode::kExclusive; }))) {
+    return false;
+  }
+  auto &queue = lock_table_[rid];
+  queue.request_queue_.emplace_back(txn->GetTransactionId(), LockMode::kShared);
+  queue.request_queue_.back().granted_ = true;
+  txn->GetSharedLockSet().emplace(rid);
+  return true;
+}
+
+bool LockManager::IsExclusiveLockedByOther(Transaction *txn, const RowId &rid) {
+  if (txn->IsExclusiveLocked(rid)) {
+    return false;
+  }
+  std::scoped_lock<std::mutex> lock(latch_);
+  auto it = lock_table_.find(rid);
+  return it != lock_table_.end() &&
+         std::any_of(it->second.request_queue_.begin(), it->second.request_queue_.end(),
+                     [](const LockRequest &r) { return r.granted_ && r.lock_mode_ == LockMode::kExclusive; });
+}
+
+bool LockManager::LockUpgrade(Transaction *txn, const RowId &rid) {
+  if (txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  if (!txn->IsSharedLocked(rid)) {
+    return LockExclusive(txn, rid);
+  }
+  std::unique_lock<std::mutex> lock(latch_);
+  if (!CheckGrowing(txn)) {
+    return false;
+  }
+  auto &queue = lock_table_[rid];
+  txn_id_t txn_id = txn->GetTransactionId();
+  if (queue.upgrading_ != INVALID_TXN_ID) {
+    // 两个事务都持有共享锁并等待升级，必然死锁
+    txn->SetState(TxnState::kAborted);
+    return false;
+  }
+  auto request = std::find_if(queue.request_queue_.begin(), queue.request_queue_.end(),
+                              [txn_id](const LockRequest &r) { return r.txn_id_ == txn_id; });
+  ASSERT(request != queue.request_queue_.end() && request->granted_, "Shared lock not found.");
+  // 已授予的请求总在队列最前面，其他持有者都释放之后，自己就是队首
+  auto is_only_holder = [&queue, txn_id]() {
+    return std::none_of(queue.request_queue_.begin(), queue.request_queue_.end(),
+                        [txn_id](const LockRequest &r) { return r.granted_ && r.txn_id_ != txn_id; });
+  };
+  if (!is_only_holder()) {
+    queue.upgrading_ = txn_id;
+    waiting_.emplace(txn_id, std::make_pair(txn, rid));
+    queue.cv_.wait(lock, [&]() { return txn->GetState() == TxnState::kAborted || is_only_holder(); });
+    waiting_.erase(txn_id);
+    queue.upgrading_ = INVALID_TXN_ID;
+    if (txn->GetState() == TxnState::kAborted) {
+      // 共享锁仍然持有，回滚时释放
+      queue.cv_.notify_all();
+      return false;
+    }
+  }
+  request->lock_mode_ = LockMode::kExclusive;
+  txn->GetSharedLockSet().erase(rid);
+  txn->GetExclusiveLockSet().emplace(rid);
+  return true;
+}
+
+bool LockManager::Unlock(Transaction *txn, const RowId &rid) {
+  std::scoped_lock<std::mutex> lock(latch_);
+  txn->GetSharedLockSet().erase(rid);
+  txn->GetExclusiveLockSet().erase(rid);
+  auto it = lock_table_.find(rid);
+  if (it == lock_table_.end()) {
+    return false;
+  }
+  auto &queue = it->second;
+  txn_id_t txn_id = txn->GetTransactionId();
+  auto request = std::find_if(queue.request_queue_.begin(), queue.request_queue_.end(),
+                              [txn_id](const LockRequest &r) { return r.txn_id_ == txn_id; });
+  if (request == queue.request_queue_.end()) {
+    return false;
+  }
+  queue.request_queue_.erase(request);
+  if (txn->GetState() == TxnState::kGrowing) {
+    txn->SetState(TxnState::kShrinking);
+  }
+  if (queue.request_queue_.empty()) {
+    lock_table_.erase(it);
+  } else {
+    queue.cv_.notify_all();
+  }
+  return true;
+}
+
+void LockManager::UnlockAll(Transaction *txn) {
+  std::vector<RowId> rids(txn->GetSharedLockSet().begin(), txn->GetSharedLockSet().end());
+  rids.insert(rids.end(), txn->GetExclusiveLockSet().begin(), txn->GetExclusiveLockSet().end());
+  for (auto &rid : rids) {
+    Unlock(txn, rid);
+  }
+}
+
+bool LockManager::WaitForGrant(Transaction *txn, const RowId &rid, LockRequestQueue &queue,
+                               std::list<LockRequest>::iterator request, std::unique_lock<std::mutex> &lock) {
+  txn_id_t txn_id = txn->GetTransactionId();
+  if (!IsGrantable(queue, request)) {
+    waiting_.emplace(txn_id, std::make_pair(txn, rid));
+    queue.cv_.wait(lock, [&]() { return txn->GetState() == TxnState::kAborted || IsGrantable(queue, request); });
+    waiting_.erase(txn_id);
+  }
+  if (txn->GetState() == TxnState::kAborted) {
+    queue.request_queue_.erase(request);
+    if (queue.request_queue_.empty()) {
+      lock_table_.erase(rid);
+    } else {
+      queue.cv_.notify_all();
+    }
+    return false;
+  }
+  request->granted_ = true;
+  return true;
+}
+
+bool LockManager::IsGrantable(const LockRequestQueue &queue, std::list<LockRequest>::const_iterator request) {
+  // 按到达顺序授予：排它锁必须在队首，共享锁前面只能有共享锁
+  for (auto it = queue.request_queue_.begin(); it != request; ++it) {
+    if (request->lock_mode_ == LockMode::kExclusive || it->lock_mode_ == LockMode::kExclusive) {
+      return false;
+    }
+  }
+  // 有事务在等待升级时，不再授予新的共享锁，否则升级可能永远等不到
+  return request->lock_mode_ == LockMode::kExclusive || queue.upgrading_ == INVALID_TXN_ID;
+}
+
+std::unordered_map<txn_id_t, std::vector<txn_id_t>> LockManager::BuildWaitsForGraph() {
+  std::unordered_map<txn_id_t, std::vector<txn_id_t>> graph;
+  for (auto &entry : lock_table_) {
+    auto &queue = entry.second;
+    for (auto &waiter : queue.request_queue_) {
+      if (waiter.granted_ && waiter.txn_id_ != queue.upgrading_) {
+        continue;
+      }
+      // 已经被选为牺牲者的事务马上会放弃等待
+      auto it = waiting_.find(waiter.txn_id_);
+      if (it == waiting_.end() || it->second.first->GetState() == TxnState::kAborted) {
+        continue;
+      }
+      for (auto &holder : queue.request_queue_) {
+        if (holder.granted_ && holder.txn_id_ != waiter.txn_id_) {
+          graph[waiter.txn_id_].push_back(holder.txn_id_);
+        }
+      }
+    }
+  }
+  for (auto &entry : graph) {
+    std::sort(entry.second.begin(), entry.second.end());
+    entry.second.erase(std::unique(entry.second.begin(), entry.second.end()), entry.second.end());
+  }
+  return graph;
+}
+
+txn_id_t LockManager::FindCycle(const std::unordered_map<txn_id_t, std::vector<txn_id_t>> &graph) {
+  std::vector<txn_id_t> nodes;
+  for (auto &entry : graph) {
+    nodes.push_back(entry.first);
+  }
+  std::sort(nodes.begin(), nodes.end());
+  std::unordered_set<txn_id_t> visited;
+  std::unordered_set<txn_id_t> on_path;
+  std::vector<txn_id_t> path;
+  std::function<txn_id_t(txn_id_t)> dfs = [&](txn_id_t u) -> txn_id_t {
+    visited.insert(u);
+    on_path.insert(u);
+    path.push_back(u);
+    auto it = graph.find(u);
+    if (it != graph.end()) {
+      for (auto v : it->second) {
+        if (on_path.count(v) != 0) {
+          return *std::max_element(std::find(path.begin(), path.end(), v), path.end());
+        }
+        if (visited.count(v) == 0) {
+          txn_id_t victim = dfs(v);
+          if (victim != INVALID_TXN_ID) {
+            return victim;
+          }
+        }
+      }
+    }
+    on_path.erase(u);
+    path.pop_back();
+    return INVALID_TXN_ID;
+  };
+  for (auto node : nodes) {
+    if (visited.count(node) == 0) {
+      txn_id_t victim = dfs(node);
+      if (victim != INVALID_TXN_ID) {
+        return victim;
+      }
+    }
+  }
+  return INVALID_TXN_ID;
+}
+
+std::vector<std::pair<txn_id_t, txn_id_t>> LockManager::GetEdgeList() {
+  std::scoped_lock<std::mutex> lock(latch_);
+  std::vector<std::pair<txn_id_t, txn_id_t>> edges;
+  for (auto &entry : BuildWaitsForGraph()) {
+    for (auto holder : entry.second) {
+      edges.emplace_back(entry.first, holder);
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  return edges;
+}
+
+uint32_t LockManager::DetectDeadlocks() {
+  std::scoped_lock<std::mutex> lock(latch_);
+  uint32_t aborted = 0;
+  txn_id_t victim;
+  while ((victim = FindCycle(BuildWaitsForGraph())) != INVALID_TXN_ID) {
+    // 环中的事务都在等待，牺牲者被唤醒后自己撤回请求
+    auto &waiting = waiting_.at(victim);
+    waiting.first->SetState(TxnState::kAborted);
+    lock_table_[waiting.second].cv_.notify_all();
+    aborted++;
+  }
+  return aborted;
+}
+
+void LockManager::RunCycleDetection() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(latch_);
+      stop_cv_.wait_for(lock, std::chrono::milliseconds(DEADLOCK_DETECTION_INTERVAL_MS), [this] { return stop_; });
+      if (stop_) {
+        return;
+      }
+    }
+    DetectDeadlocks();
+  }
+}
@@ -0,0 +1,116 @@
+#include "transaction/log_manager.h"
+
+#include <chrono>
+
+LogManager::LogManager(DiskManager *disk_manager, lsn_t next_lsn)
+    : disk_manager_(disk_manager), next_lsn_(next_lsn), persistent_lsn_(next_lsn - 1) {
+  // 已经在日志文件中的记录lsn都小于next_lsn
+  batches_.emplace_back(INVALID_LSN, 0);
+  if (disk_manager_->GetLogSize() > 0) {
+    batches_.emplace_back(next_lsn, disk_manager_->GetLogSize());
+  }
+  log_buffer_ = new char[LOG_BUFFER_SIZE];
+  flush_buffer_ = new char[LOG_BUFFER_SIZE];
+  flush_thread_ = std::thread(&LogManager::FlushThread, this);
+}
+
+LogManager::~LogManager() {
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    stop_ = true;
+  }
+  flush_cv_.notify_one();
+  flush_thread_.join();
+  delete[] log_buffer_;
+  delete[] flush_buffer_;
+}
+
+lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
+  uint32_t size = log_record->GetSize();
+  ASSERT(size <= LOG_BUFFER_SIZE, "Log record is larger than the log buffer.");
+  std::unique_lock<std::mutex> lock(latch_);
+  // 缓冲区满了，唤醒flush线程交换缓冲区
+  while (log_buffer_offset_ + size > LOG_BUFFER_SIZE) {
+    flush_request_lsn_ = std::max(flush_request_lsn_, last_buffered_lsn_);
+    flush_cv_.notify_one();
+    append_cv_.wait(lock);
+  }
+  log_record->SetLSN(next_lsn_++);
+  log_record->SerializeTo(log_buffer_ + log_buffer_offset_);
+  if (log_buffer_offset_ == 0) {
+    first_buffered_lsn_ = log_record->GetLSN();
+  }
+  log_buffer_offset_ += size;
+  appended_bytes_ += size;
+  last_buffered_lsn_ = log_record->GetLSN();
+  return log_record->GetLSN();
+}
+
+void LogManager::Flush(lsn_t lsn) {
+  if (lsn == INVALID_LSN || persistent_lsn_ >= lsn) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(latch_);
+  flush_request_lsn_ = std::max(flush_request_lsn_, lsn);
+  flush_cv_.notify_one();
+  persist_cv_.wait(lock, [&] { return persistent_lsn_ >= lsn; });
+}
+
+void LogManager::FlushAll() {
+  lsn_t lsn;
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    lsn = next_lsn_ - 1;
+  }
+  Flush(lsn);
+}
+
+void LogManager::FlushThread() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    // 超时、缓冲区满、有事务在等待提交或者关闭时醒来
+    flush_cv_.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_TIMEOUT_MS),
+                       [&] { return stop_ || flush_request_lsn_ > persistent_lsn_; });
+    if (log_buffer_offset_ == 0) {
+      if (stop_) {
+        break;
+      }
+      continue;
+    }
+    std::swap(log_buffer_, flush_buffer_);
+    uint32_t size = log_buffer_offset_;
+    lsn_t lsn = last_buffered_lsn_;
+    log_buffer_offset_ = 0;
+    if (batches_.back().first != first_buffered_lsn_) {
+      batches_.emplace_back(first_buffered_lsn_, disk_manager_->GetLogSize());
+    }
+    flushing_ = true;
+    append_cv_.notify_all();
+    // 写盘时不持有latch，其他线程可以继续往另一块缓冲区追加日志
+    lock.unlock();
+    disk_manager_->WriteLog(flush_buffer_, size);
+    lock.lock();
+    flushing_ = false;
+    persistent_lsn_ = lsn;
+    persist_cv_.notify_all();
+  }
+}
+
+void LogManager::DiscardBefore(lsn_t lsn) {
+  std::unique_lock<std::mutex> lock(latch_);
+  // 持有latch时flush线程不会开始新的写盘，等正在进行的写盘结束即可
+  persist_cv_.wait(lock, [&] { return !flushing_; });
+  size_t keep = 0;
+  while (keep + 1 < batches_.size() && batches_[keep + 1].first <= lsn) {
+    keep++;
+  }
+  uint32_t offset = batches_[keep].second;
+  if (offset == 0) {
+    return;
+  }
+  disk_manager_->DiscardLogPrefix(offset);
+  batches_.erase(batches_.begin(), batches_.begin() + keep);
+  for (auto &batch : batches_) {
+    batch.second -= offset;
+  }
+}
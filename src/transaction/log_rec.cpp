@@ -0,0 +1,154 @@
+#include "transaction/log_rec.h"
+
+#include "common/macros.h"
+
+LogRecord::LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType type, const RowId &rid, const char *tuple,
+                     uint32_t tuple_size)
+    : txn_id_(txn_id), prev_lsn_(prev_lsn), type_(type) {
+  int64_t rid_value = rid.Get();
+  payload_.append(reinterpret_cast<const char *>(&rid_value), sizeof(int64_t));
+  payload_.append(reinterpret_cast<const char *>(&tuple_size), sizeof(uint32_t));
+  payload_.append(tuple, tuple_size);
+}
+
+LogRecord::LogRecord(txn_id_t txn_id, lsn_t prev_lsn, const RowId &rid, const char *old_tuple,
+                     uint32_t old_tuple_size, const char *new_tuple, uint32_t new_tuple_size)
+    : LogRecord(txn_id, prev_lsn, LogRecordType::kUpdate, rid, old_tuple, old_tuple_size) {
+  payload_.append(reinterpret_cast<const char *>(&new_tuple_size), sizeof(uint32_t));
+  payload_.append(new_tuple, new_tuple_size);
+}
+
+LogRecord::LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType type, index_id_t index_id, const RowId &rid,
+                     const char *key, uint32_t key_size)
+    : txn_id_(txn_id), prev_lsn_(prev_lsn), type_(type) {
+  ASSERT(type == LogRecordType::kIndexInsert || type == LogRecordType::kIndexDelete, "Not an index record.");
+  int64_t rid_value = rid.Get();
+  payload_.append(reinterpret_cast<const char *>(&index_id), sizeof(index_id_t));
+  payload_.append(reinterpret_cast<const char *>(&rid_value), sizeof(int64_t));
+  payload_.append(reinterpret_cast<const char *>(&key_size), sizeof(uint32_t));
+  payload_.append(key, key_size);
+}
+
+LogRecord::LogRecord(lsn_t begin_lsn, const std::vector<std::pair<page_id_t, lsn_t>> &dirty_pages)
+    : type_(LogRecordType::kCheckpoint) {
+  uint32_t count = dirty_pages.size();
+  payload_.append(reinterpret_cast<const char *>(&begin_lsn), sizeof(lsn_t));
+  payload_.append(reinterpret_cast<const char *>(&count), sizeof(uint32_t));
+  for (auto &entry : dirty_pages) {
+    payload_.append(reinterpret_cast<const char *>(&entry.first), sizeof(page_id_t));
+    payload_.append(reinterpret_cast<const char *>(&entry.second), sizeof(lsn_t));
+  }
+}
+
+LogRecord::LogRecord(LogRecordType type, page_id_t page_id) : type_(type) {
+  ASSERT(type == LogRecordType::kNewPage || type == LogRecordType::kPageDelta, "Not a page record.");
+  payload_.append(reinterpret_cast<const char *>(&page_id), sizeof(page_id_t));
+}
+
+void LogRecord::AppendDeltaRun(uint16_t offset, const char *data, uint16_t length) {
+  ASSERT(type_ == LogRecordType::kPageDelta, "Not a page delta record.");
+  payload_.append(reinterpret_cast<const char *>(&offset), sizeof(uint16_t));
+  payload_.append(reinterpret_cast<const char *>(&length), sizeof(uint16_t));
+  payload_.append(data, length);
+}
+
+RowId LogRecord::GetRowId() const {
+  return RowId(MACH_READ_FROM(int64_t, payload_.data() + GetRowIdOffset()));
+}
+
+std::string LogRecord::GetTuple() const {
+  uint32_t ofs = GetRowIdOffset() + sizeof(int64_t);
+  uint32_t size = MACH_READ_UINT32(payload_.data() + ofs);
+  return payload_.substr(ofs + sizeof(uint32_t), size);
+}
+
+index_id_t LogRecord::GetIndexId() const {
+  ASSERT(type_ == LogRecordType::kIndexInsert || type_ == LogRecordType::kIndexDelete, "Not an index record.");
+  return MACH_READ_FROM(index_id_t, payload_.data());
+}
+
+lsn_t LogRecord::GetCheckpointBeginLSN() const {
+  ASSERT(type_ == LogRecordType::kCheckpoint, "Not a checkpoint record.");
+  return MACH_READ_FROM(lsn_t, payload_.data());
+}
+
+std::vector<std::pair<page_id_t, lsn_t>> LogRecord::GetDirtyPageTable() const {
+  ASSERT(type_ == LogRecordType::kCheckpoint, "Not a checkpoint record.");
+  uint32_t count = MACH_READ_UINT32(payload_.data() + sizeof(lsn_t));
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  const char *buf = payload_.data() + sizeof(lsn_t) + sizeof(uint32_t);
+  for (uint32_t i = 0; i < count; i++) {
+    dirty_pages.emplace_back(MACH_READ_FROM(page_id_t, buf), MACH_READ_FROM(lsn_t, buf + sizeof(page_id_t)));
+    buf += sizeof(page_id_t) + sizeof(lsn_t);
+  }
+  return dirty_pages;
+}
+
+std::string LogRecord::GetNewTuple() const {
+  ASSERT(type_ == LogRecordType::kUpdate, "Not an update record.");
+  uint32_t ofs = sizeof(int64_t);
+  ofs += sizeof(uint32_t) + MACH_READ_UINT32(payload_.data() + ofs);
+  uint32_t size = MACH_READ_UINT32(payload_.data() + ofs);
+  return payload_.substr(ofs + sizeof(uint32_t), size);
+}
+
+page_id_t LogRecord::GetPageId() const {
+  return MACH_READ_FROM(page_id_t, payload_.data());
+}
+
+void LogRecord::ApplyTo(char *page_data) const {
+  if (type_ == LogRecordType::kNewPage) {
+    memset(page_data, 0, PAGE_SIZE);
+    return;
+  }
+  ASSERT(type_ == LogRecordType::kPageDelta, "Not a page record.");
+  uint32_t ofs = sizeof(page_id_t);
+  while (ofs < payload_.size()) {
+    uint16_t offset = MACH_READ_FROM(uint16_t, payload_.data() + ofs);
+    uint16_t length = MACH_READ_FROM(uint16_t, payload_.data() + ofs + sizeof(uint16_t));
+    ofs += 2 * sizeof(uint16_t);
+    memcpy(page_data + offset, payload_.data() + ofs, length);
+    ofs += length;
+  }
+}
+
+uint32_t LogRecord::SerializeTo(char *buf) const {
+  uint32_t size = GetSize();
+  MACH_WRITE_UINT32(buf, size);
+  MACH_WRITE_INT32(buf + 8, lsn_);
+  MACH_WRITE_INT32(buf + 12, txn_id_);
+  MACH_WRITE_INT32(buf + 16, prev_lsn_);
+  MACH_WRITE_INT32(buf + 20, static_cast<int32_t>(type_));
+  memcpy(buf + HEADER_SIZE, payload_.data(), payload_.size());
+  MACH_WRITE_UINT32(buf + 4, Checksum(buf + 8, size - 8));
+  return size;
+}
+
+bool LogRecord::DeserializeFrom(const char *buf, uint32_t size, LogRecord *record) {
+  if (size < HEADER_SIZE) {
+    return false;
+  }
+  uint32_t record_size = MACH_READ_UINT32(buf);
+  if (record_size < HEADER_SIZE || record_size > size) {
+    return false;
+  }
+  if (MACH_READ_UINT32(buf + 4) != Checksum(buf + 8, record_size - 8)) {
+    return false;
+  }
+  record->lsn_ = MACH_READ_INT32(buf + 8);
+  record->txn_id_ = MACH_READ_INT32(buf + 12);
+  record->prev_lsn_ = MACH_READ_INT32(buf + 16);
+  record->type_ = static_cast<LogRecordType>(MACH_READ_INT32(buf + 20));
+  record->payload_.assign(buf + HEADER_SIZE, record_size - HEADER_SIZE);
+  return true;
+}
+
+uint32_t LogRecord::Checksum(const char *buf, uint32_t size) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (uint32_t i = 0; i < size; i++) {
+    hash ^= static_cast<uint8_t>(buf[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
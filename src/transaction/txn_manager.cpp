@@ -0,0 +1,105 @@
+#include "transaction/txn_manager.h"
+
+#include "index/index.h"
+#include "storage/table_heap.h"
+
+TransactionManager::~TransactionManager() {
+  for (auto &it : txn_map_) {
+    delete it.second;
+  }
+}
+
+Transaction *TransactionManager::Begin() {
+  auto txn = new Transaction(next_txn_id_++);
+  // begin日志和加入txn_map_要在同一个latch下完成，checkpoint才不会漏掉已经开始的事务
+  std::scoped_lock<std::mutex> lock(latch_);
+  if (log_manager_ != nullptr) {
+    LogRecord record(txn->GetTransactionId(), INVALID_LSN, LogRecordType::kBegin);
+    txn->SetBeginLSN(log_manager_->AppendLogRecord(&record));
+    txn->SetPrevLSN(txn->GetBeginLSN());
+  }
+  txn_map_[txn->GetTransactionId()] = txn;
+  return txn;
+}
+
+void TransactionManager::Commit(Transaction *txn) {
+  txn->SetState(TxnState::kCommitted);
+  // 标记删除的tuple在提交时才真正删除，在此之前其他事务仍可以回滚它
+  for (auto &record : txn->GetTableWriteSet()) {
+    if (record.wtype_ == WType::kDelete) {
+      record.table_heap_->ApplyDelete(record.rid_, txn);
+    }
+  }
+  txn->GetTableWriteSet().clear();
+  txn->GetIndexWriteSet().clear();
+  if (log_manager_ != nullptr) {
+    LogRecord record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::kCommit);
+    lsn_t lsn = log_manager_->AppendLogRecord(&record);
+    log_manager_->Flush(lsn);
+  }
+  // 日志落盘之后才释放锁，其他事务不会看到可能丢失的修改
+  if (lock_manager_ != nullptr) {
+    lock_manager_->UnlockAll(txn);
+  }
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    txn_map_.erase(txn->GetTransactionId());
+  }
+  delete txn;
+}
+
+void TransactionManager::Abort(Transaction *txn) {
+  txn->SetState(TxnState::kAborted);
+  // 撤销操作本身也会写入write set，先把原来的write set取出来
+  std::deque<IndexWriteRecord> index_write_set;
+  std::deque<TableWriteRecord> table_write_set;
+  index_write_set.swap(txn->GetIndexWriteSet());
+  table_write_set.swap(txn->GetTableWriteSet());
+  for (auto it = index_write_set.rbegin(); it != index_write_set.rend(); ++it) {
+    if (it->wtype_ == WType::kInsert) {
+      it->index_->RemoveEntry(it->key_, it->rid_, txn);
+    } else {
+      it->index_->InsertEntry(it->key_, it->rid_, txn);
+    }
+  }
+  for (auto it = table_write_set.rbegin(); it != table_write_set.rend(); ++it) {
+    switch (it->wtype_) {
+      case WType::kInsert:
+        it->table_heap_->ApplyDelete(it->rid_, txn);
+        break;
+      case WType::kDelete:
+        it->table_heap_->RollbackDelete(it->rid_, txn);
+        break;
+      case WType::kUpdate:
+        it->table_heap_->UpdateTuple(it->old_row_, it->rid_, txn);
+        break;
+    }
+  }
+  txn->GetIndexWriteSet().clear();
+  txn->GetTableWriteSet().clear();
+  // 撤销的修改都有日志，abort日志不需要等待落盘：崩溃后recovery会再撤销一遍
+  if (log_manager_ != nullptr) {
+    LogRecord record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::kAbort);
+    log_manager_->AppendLogRecord(&record);
+  }
+  if (lock_manager_ != nullptr) {
+    lock_manager_->UnlockAll(txn);
+  }
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    txn_map_.erase(txn->GetTransactionId());
+  }
+  delete txn;
+}
+
+lsn_t TransactionManager::GetOldestBeginLSN() {
+  std::scoped_lock<std::mutex> lock(latch_);
+  lsn_t oldest = INVALID_LSN;
+  for (auto &it : txn_map_) {
+    lsn_t begin_lsn = it.second->GetBeginLSN();
+    if (oldest == INVALID_LSN || (begin_lsn != INVALID_LSN && begin_lsn < oldest)) {
+      oldest = begin_lsn;
+    }
+  }
+  return oldest;
+}
@@ -1,6 +1,11 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <random>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
@@ -71,4 +76,506 @@ TEST(BufferPoolManagerTest, BinaryDataTest) {
 
   delete bpm;
   delete disk_manager;
-}
\ No newline at end of file
+}
+
+TEST(BufferPoolManagerTest, ConcurrentFetchUnpinBenchmark) {
+  const std::string db_name = "bpm_concurrent_test.db";
+  const size_t buffer_pool_size = DEFAULT_BUFFER_POOL_SIZE;
+  const int num_pages = buffer_pool_size / 2;
+  const int ops_per_thread = 50000;
+
+  remove(db_name.c_str());
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  // 所有页都常驻在buffer pool中，只测page table和latch的开销
+  for (int i = 0; i < num_pages; i++) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    memcpy(page->GetData(), &page_id, sizeof(page_id));
+    bpm->UnpinPage(page_id, true);
+  }
+
+  for (int num_threads : {1, 2, 4, 8}) {
+    std::vector<std::thread> threads;
+    std::vector<int> errors(num_threads, 0);
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&, t]() {
+        std::default_random_engine rng(t);
+        std::uniform_int_distribution<page_id_t> dist(0, num_pages - 1);
+        for (int i = 0; i < ops_per_thread; i++) {
+          page_id_t page_id = dist(rng);
+          auto *page = bpm->FetchPage(page_id);
+          if (page == nullptr || memcmp(page->GetData(), &page_id, sizeof(page_id)) != 0) {
+            errors[t]++;
+            continue;
+          }
+          bpm->UnpinPage(page_id, false);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (int t = 0; t < num_threads; t++) {
+      EXPECT_EQ(0, errors[t]);
+    }
+    std::cout << "fetch/unpin with " << num_threads << " threads: "
+              << static_cast<int64_t>(num_threads * ops_per_thread / seconds) << " ops/sec" << std::endl;
+  }
+  EXPECT_TRUE(bpm->CheckAllUnpinned());
+
+  disk_manager->Close();
+  remove(db_name.c_str());
+
+  delete bpm;
+  delete disk_manager;
+}
+
+/**
+ * 一个shard的帧都被pin住时，映射到它的页向别的shard借帧，整个pool都被pin住才失败
+ */
+TEST(BufferPoolManagerTest, ShardBorrowTest) {
+  const std::string db_name = "bpm_borrow_test.db";
+  const size_t num_shards = 4;
+  const size_t buffer_pool_size = num_shards * BUFFER_POOL_SHARD_FRAMES;
+  remove(db_name.c_str());
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  // 只有映射到shard 0的页一直pin着，它要的帧是自己那份的两倍
+  std::vector<page_id_t> pinned;
+  page_id_t page_id;
+  while (pinned.size() < buffer_pool_size / 2) {
+    auto *page = bpm->NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    if (page_id % num_shards != 0) {
+      ASSERT_TRUE(bpm->UnpinPage(page_id, false));
+      continue;
+    }
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    pinned.push_back(page_id);
+  }
+  for (auto id : pinned) {
+    ASSERT_TRUE(bpm->UnpinPage(id, true));
+  }
+  delete bpm;
+
+  // 换一个空的pool重新读，shard 0的页读进来时也要借帧
+  bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  for (auto id : pinned) {
+    auto *page = bpm->FetchPage(id);
+    ASSERT_NE(nullptr, page);
+    ASSERT_EQ("page " + std::to_string(id), std::string(page->GetData()));
+  }
+  // 剩下的帧也都pin住之后就没有帧可借了
+  for (size_t i = pinned.size(); i < buffer_pool_size; i++) {
+    ASSERT_NE(nullptr, bpm->NewPage(page_id));
+    pinned.push_back(page_id);
+  }
+  ASSERT_EQ(nullptr, bpm->NewPage(page_id));
+  ASSERT_EQ(nullptr, bpm->FetchPage(pinned.size() * num_shards));
+  for (auto id : pinned) {
+    ASSERT_TRUE(bpm->UnpinPage(id, false));
+  }
+  ASSERT_TRUE(bpm->CheckAllUnpinned());
+
+  disk_manager->Close();
+  remove(db_name.c_str());
+
+  delete bpm;
+  delete disk_manager;
+}
+
+/**
+ * 预读的页读完后和同步读的一样，没读完时FetchPage会等它
+ */
+TEST(BufferPoolManagerTest, PrefetchTest) {
+  const std::string db_name = "bpm_prefetch_test.db";
+  const size_t buffer_pool_size = 64;
+  const page_id_t page_nums = 256;
+  remove(db_name.c_str());
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  for (page_id_t i = 0; i < page_nums; i++) {
+    page_id_t page_id;
+    auto page = bpm->NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    ASSERT_EQ(i, page_id);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  // 最后的几页还在buffer pool里，前面的都被换出去了
+  std::vector<page_id_t> page_ids;
+  for (page_id_t i = 0; i < static_cast<page_id_t>(buffer_pool_size / 2); i++) {
+    page_ids.push_back(i);
+  }
+  ASSERT_EQ(page_ids.size(), bpm->PrefetchPages(page_ids));
+  ASSERT_EQ(0u, bpm->PrefetchPages(page_ids));
+  for (auto page_id : page_ids) {
+    auto page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    ASSERT_EQ("page " + std::to_string(page_id), std::string(page->GetData()));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  // 预读进来的页没被用到也可以被换出
+  for (page_id_t i = page_nums - static_cast<page_id_t>(buffer_pool_size); i < page_nums; i++) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    ASSERT_EQ("page " + std::to_string(i), std::string(page->GetData()));
+    ASSERT_TRUE(bpm->UnpinPage(i, false));
+  }
+  bpm->PrefetchPages(page_ids);
+  EXPECT_TRUE(bpm->CheckAllUnpinned());
+  delete bpm;
+  delete disk_manager;
+  remove(db_name.c_str());
+  remove("bpm_prefetch_test.log");
+}
+
+/**
+ * 预读的冷页只被扫描访问时最先被换出，扫描之外再被访问一次就按普通页对待
+ */
+TEST(BufferPoolManagerTest, ColdPagePromotionTest) {
+  const std::string db_name = "bpm_cold_test.db";
+  const size_t buffer_pool_size = 8;
+  remove(db_name.c_str());
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  for (page_id_t i = 0; i < 16; i++) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(page_id));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  // 0和1被预读进来，扫描各访问一次，1之后又被点查访问了一次
+  ASSERT_EQ(2u, bpm->PrefetchPages({0, 1}, true));
+  for (page_id_t page_id : {0, 1}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id, true));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  ASSERT_NE(nullptr, bpm->FetchPage(1));
+  ASSERT_TRUE(bpm->UnpinPage(1, false));
+  // 再读进两页：第一页换出冷页0，第二页换出最久没用的普通页，1是刚用过的，留在buffer pool里
+  for (page_id_t page_id : {2, 3}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  uint64_t hits = bpm->GetHitCount();
+  ASSERT_NE(nullptr, bpm->FetchPage(1));
+  ASSERT_TRUE(bpm->UnpinPage(1, false));
+  ASSERT_EQ(hits + 1, bpm->GetHitCount());
+  ASSERT_NE(nullptr, bpm->FetchPage(0));
+  ASSERT_TRUE(bpm->UnpinPage(0, false));
+  ASSERT_EQ(hits + 1, bpm->GetHitCount());
+  delete bpm;
+  delete disk_manager;
+  remove(db_name.c_str());
+  remove("bpm_cold_test.log");
+}
+
+/**
+ * 回放点查和全表扫描交替的访问序列，比较各替换策略的命中率。点查访问索引的根、一个叶子（越靠前越热）和一个随机的表页，
+ * 扫描阶段每次点查之间顺序读几页表，扫描的页只用一次，不应该把索引页挤出去
+ */
+TEST(BufferPoolManagerTest, ReplacerReplayBenchmark) {
+  const std::string db_name = "bpm_replay_test.db";
+  const size_t buffer_pool_size = 256;
+  const page_id_t index_pages = 193;
+  const page_id_t table_pages = 4096;
+  const int lookups = 20000;
+  const int phase_length = 2000;
+  const int scan_pages_per_lookup = 4;
+
+  remove(db_name.c_str());
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  for (page_id_t i = 0; i < index_pages + table_pages; i++) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    memcpy(page->GetData(), &page_id, sizeof(page_id));
+    bpm->UnpinPage(page_id, true);
+  }
+  delete bpm;
+
+  const std::vector<std::pair<std::string, ReplacerType>> policies = {
+      {"LRU", ReplacerType::kLRU}, {"Clock", ReplacerType::kClock},
+      {"LRU-K", ReplacerType::kLRUK}, {"2Q", ReplacerType::k2Q}};
+  for (auto &policy : policies) {
+    bpm = new BufferPoolManager(buffer_pool_size, disk_manager, nullptr, policy.second);
+    std::default_random_engine rng(0);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    uint64_t index_fetches = 0;
+    uint64_t index_hits = 0;
+    int errors = 0;
+    auto fetch = [&](page_id_t page_id) {
+      uint64_t hits = bpm->GetHitCount();
+      auto *page = bpm->FetchPage(page_id);
+      if (page == nullptr || memcmp(page->GetData(), &page_id, sizeof(page_id)) != 0) {
+        errors++;
+        return false;
+      }
+      bpm->UnpinPage(page_id, false);
+      return bpm->GetHitCount() > hits;
+    };
+    page_id_t scan_cursor = 0;
+    for (int i = 0; i < lookups; i++) {
+      double r = uniform(rng);
+      page_id_t leaf = 1 + static_cast<page_id_t>(r * r * (index_pages - 1));
+      for (page_id_t page_id : {0, leaf}) {
+        index_fetches++;
+        index_hits += fetch(page_id) ? 1 : 0;
+      }
+      fetch(index_pages + static_cast<page_id_t>(uniform(rng) * table_pages));
+      if ((i / phase_length) % 2 == 1) {
+        for (int j = 0; j < scan_pages_per_lookup; j++) {
+          fetch(index_pages + scan_cursor);
+          scan_cursor = (scan_cursor + 1) % table_pages;
+        }
+      }
+    }
+    EXPECT_EQ(0, errors);
+    EXPECT_TRUE(bpm->CheckAllUnpinned());
+    uint64_t hits = bpm->GetHitCount();
+    uint64_t total = hits + bpm->GetMissCount();
+    printf("%-6s hit ratio %5.1f%% (index pages %5.1f%%)\n", policy.first.c_str(), 100.0 * hits / total,
+           100.0 * index_hits / index_fetches);
+    delete bpm;
+  }
+
+  disk_manager->Close();
+  remove(db_name.c_str());
+  delete disk_manager;
+}
+
+/**
+ * cleaner按页号顺序把一半可换出的帧写干净，之后换出这些页时前台不用写盘
+ */
+TEST(BufferPoolManagerTest, PageCleanerTest) {
+  const std::string db_name = "bpm_cleaner_test.db";
+  const size_t buffer_pool_size = 64;
+  remove(db_name.c_str());
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  auto new_page = [&]() {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+  };
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    new_page();
+  }
+  ASSERT_EQ(buffer_pool_size / 2, bpm->CleanPages());
+  ASSERT_EQ(0u, bpm->CleanPages());
+  ASSERT_EQ(buffer_pool_size / 2, bpm->GetBackgroundWriteCount());
+  // 最早unpin的正好是被写干净的页号小的那一半
+  for (size_t i = 0; i < buffer_pool_size / 2; i++) {
+    new_page();
+  }
+  ASSERT_EQ(0u, bpm->GetForegroundWriteCount());
+  new_page();
+  ASSERT_EQ(1u, bpm->GetForegroundWriteCount());
+  delete bpm;
+
+  // 后台线程和前台并发地写，内容都不会丢
+  const page_id_t page_nums = 2048;
+  bpm = new BufferPoolManager(buffer_pool_size, disk_manager, nullptr, ReplacerType::kLRU, true);
+  const page_id_t allocated = buffer_pool_size * 3 / 2 + 1;
+  for (page_id_t i = 0; i < page_nums; i++) {
+    Page *page;
+    if (i < allocated) {
+      page = bpm->FetchPage(i);
+      ASSERT_NE(nullptr, page);
+    } else {
+      page_id_t page_id;
+      page = bpm->NewPage(page_id);
+      ASSERT_NE(nullptr, page);
+      ASSERT_EQ(i, page_id);
+    }
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", -i);
+    ASSERT_TRUE(bpm->UnpinPage(i, true));
+  }
+  for (page_id_t i = 0; i < page_nums; i++) {
+    auto *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    ASSERT_EQ("page " + std::to_string(-i), std::string(page->GetData()));
+    ASSERT_TRUE(bpm->UnpinPage(i, false));
+  }
+  printf("foreground writes %lu, background writes %lu\n", bpm->GetForegroundWriteCount(),
+         bpm->GetBackgroundWriteCount());
+  delete bpm;
+  delete disk_manager;
+  remove(db_name.c_str());
+  remove("bpm_cleaner_test.log");
+}
+
+/**
+ * 在线扩大、缩小buffer pool：缩小时被pin住的帧要等unpin，等不到就保持原来的大小；换出的脏页都写回了
+ */
+TEST(BufferPoolManagerTest, ResizeTest) {
+  const std::string db_name = "bpm_resize_test.db";
+  remove(db_name.c_str());
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(10, disk_manager, nullptr, ReplacerType::k2Q, true);
+  const page_id_t page_nums = 2000;
+  page_id_t page_id;
+  for (page_id_t i = 0; i < 10; i++) {
+    ASSERT_NE(nullptr, bpm->NewPage(page_id));
+  }
+  ASSERT_EQ(nullptr, bpm->NewPage(page_id));
+  // 跨过好几个块
+  ASSERT_TRUE(bpm->Resize(page_nums));
+  ASSERT_EQ(page_nums, bpm->GetPoolSize());
+  for (page_id_t i = 10; i < page_nums; i++) {
+    ASSERT_NE(nullptr, bpm->NewPage(page_id));
+    ASSERT_EQ(i, page_id);
+  }
+  ASSERT_EQ(nullptr, bpm->NewPage(page_id));
+  // 所有页都被pin住，缩不下去
+  ASSERT_FALSE(bpm->Resize(20, 50));
+  ASSERT_EQ(page_nums, bpm->GetPoolSize());
+  for (page_id_t i = 0; i < page_nums; i++) {
+    auto *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    ASSERT_TRUE(bpm->UnpinPage(i, true));
+    ASSERT_TRUE(bpm->UnpinPage(i, true));
+  }
+  // 一页还被pin着，unpin之后才能缩小
+  ASSERT_NE(nullptr, bpm->FetchPage(page_nums - 1));
+  std::thread unpin([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    bpm->UnpinPage(page_nums - 1, false);
+  });
+  ASSERT_TRUE(bpm->Resize(20));
+  unpin.join();
+  ASSERT_EQ(20u, bpm->GetPoolSize());
+  for (page_id_t i = 0; i < page_nums; i++) {
+    auto *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    ASSERT_EQ("page " + std::to_string(i), std::string(page->GetData()));
+    ASSERT_TRUE(bpm->UnpinPage(i, false));
+  }
+  std::vector<Page *> pinned;
+  for (page_id_t i = 0; i < 20; i++) {
+    pinned.push_back(bpm->FetchPage(i));
+    ASSERT_NE(nullptr, pinned.back());
+  }
+  ASSERT_EQ(nullptr, bpm->FetchPage(20));
+  for (page_id_t i = 0; i < 20; i++) {
+    ASSERT_TRUE(bpm->UnpinPage(i, false));
+  }
+
+  // 一边读写一边来回调整大小
+  std::atomic<bool> stop{false};
+  std::thread resizer([&] {
+    for (size_t size = 64; !stop; size = size == 64 ? 1024 : 64) {
+      bpm->Resize(size);
+    }
+  });
+  std::mt19937 rng(0);
+  for (int i = 0; i < 20000; i++) {
+    page_id_t target = rng() % page_nums;
+    Page *page;
+    while ((page = bpm->FetchPage(target)) == nullptr) {
+    }
+    ASSERT_EQ("page " + std::to_string(target), std::string(page->GetData()));
+    ASSERT_TRUE(bpm->UnpinPage(target, i % 2 == 0));
+  }
+  stop = true;
+  resizer.join();
+  ASSERT_TRUE(bpm->CheckAllUnpinned());
+  delete bpm;
+  delete disk_manager;
+  remove(db_name.c_str());
+  remove("bpm_resize_test.log");
+}
+
+/**
+ * 一次只扩大一帧的话，新块里的帧号都是BUFFER_POOL_CHUNK_FRAMES的倍数；这些帧也要分到各个shard，每一帧unpin之后都能被换出
+ */
+TEST(BufferPoolManagerTest, ResizeGrowByOneTest) {
+  const std::string db_name = "bpm_grow_test.db";
+  remove(db_name.c_str());
+  auto *disk_manager = new DiskManager(db_name);
+  size_t pool_size = MAX_BUFFER_POOL_SHARDS * BUFFER_POOL_SHARD_FRAMES;
+  auto *bpm = new BufferPoolManager(pool_size, disk_manager, nullptr, ReplacerType::kClock);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(bpm->Resize(++pool_size));
+  }
+  ASSERT_EQ(pool_size, bpm->GetPoolSize());
+  page_id_t page_id;
+  for (int round = 0; round < 2; round++) {
+    std::vector<page_id_t> pinned;
+    for (size_t i = 0; i < pool_size; i++) {
+      ASSERT_NE(nullptr, bpm->NewPage(page_id));
+      pinned.push_back(page_id);
+    }
+    ASSERT_EQ(nullptr, bpm->NewPage(page_id));
+    for (auto id : pinned) {
+      ASSERT_TRUE(bpm->UnpinPage(id, false));
+    }
+  }
+  ASSERT_TRUE(bpm->CheckAllUnpinned());
+  delete bpm;
+  delete disk_manager;
+  remove(db_name.c_str());
+}
+
+/**
+ * 关闭时写回整个脏的buffer pool：一页一页按随机顺序写，和排序后合并成pwritev写比较
+ */
+TEST(BufferPoolManagerTest, FlushAllPagesBenchmark) {
+  const std::string db_name = "bpm_flush_test.db";
+  const size_t buffer_pool_size = 8192;
+  remove(db_name.c_str());
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(page_id));
+    page_ids.push_back(page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+  auto dirty_all = [&](int round) {
+    for (auto page_id : page_ids) {
+      auto *page = bpm->FetchPage(page_id);
+      ASSERT_NE(nullptr, page);
+      snprintf(page->GetData(), PAGE_SIZE, "page %d round %d", page_id, round);
+      bpm->UnpinPage(page_id, true);
+    }
+  };
+  std::shuffle(page_ids.begin(), page_ids.end(), std::default_random_engine(0));
+
+  dirty_all(1);
+  auto start = std::chrono::steady_clock::now();
+  for (auto page_id : page_ids) {
+    bpm->FlushPage(page_id);
+  }
+  disk_manager->SyncData();
+  double page_by_page = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  dirty_all(2);
+  start = std::chrono::steady_clock::now();
+  bpm->FlushAllPages();
+  double sorted = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("flush %zu dirty pages: page by page %.3fs, sorted and coalesced %.3fs\n", buffer_pool_size, page_by_page,
+         sorted);
+  delete bpm;
+
+  bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  for (auto page_id : page_ids) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    ASSERT_EQ("page " + std::to_string(page_id) + " round 2", std::string(page->GetData()));
+    bpm->UnpinPage(page_id, false);
+  }
+  delete bpm;
+  delete disk_manager;
+  remove(db_name.c_str());
+  remove("bpm_flush_test.log");
+}
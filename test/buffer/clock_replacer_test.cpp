@@ -0,0 +1,19 @@
+#include "buffer/clock_replacer.h"
+#include "gtest/gtest.h"
+
+TEST(ClockReplacerTest, GrowTest) {
+  // 放进来的帧比容量多时扩容，每一帧都还能被替换
+  ClockReplacer clock_replacer(2);
+  for (frame_id_t i = 0; i < 5; i++) {
+    clock_replacer.Unpin(i);
+  }
+  EXPECT_EQ(5, clock_replacer.Size());
+  std::vector<bool> victims(5, false);
+  int value;
+  for (int i = 0; i < 5; i++) {
+    ASSERT_TRUE(clock_replacer.Victim(&value));
+    victims[value] = true;
+  }
+  EXPECT_FALSE(clock_replacer.Victim(&value));
+  EXPECT_EQ(std::vector<bool>(5, true), victims);
+}
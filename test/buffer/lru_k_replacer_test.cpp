@@ -0,0 +1,99 @@
+#include "buffer/lru_k_replacer.h"
+#include "gtest/gtest.h"
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer lru_k_replacer(8, 2);
+
+  // Scenario: unpin six elements, every unpin of a frame not in the replacer is an access.
+  for (frame_id_t i = 1; i <= 6; i++) {
+    lru_k_replacer.Unpin(i);
+  }
+  // 1和2被再次访问，有了两次访问的历史
+  lru_k_replacer.Pin(1);
+  lru_k_replacer.Unpin(1);
+  lru_k_replacer.Pin(2);
+  lru_k_replacer.Unpin(2);
+  // 紧挨着的重复访问是相关访问，7仍然只算访问过一次
+  lru_k_replacer.Unpin(7);
+  lru_k_replacer.Pin(7);
+  lru_k_replacer.Unpin(7);
+  EXPECT_EQ(7, lru_k_replacer.Size());
+
+  // 冷页最先被换出，然后是访问不到k次的，最后才是访问过k次的
+  lru_k_replacer.UnpinCold(8);
+  int value;
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(8, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+
+  // Scenario: pin elements in the replacer.
+  lru_k_replacer.Pin(5);
+  EXPECT_EQ(4, lru_k_replacer.Size());
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(7, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  // 5在被pin时有了第二次访问，但它的倒数第二次访问比2晚
+  lru_k_replacer.Unpin(5);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(5, value);
+  EXPECT_FALSE(lru_k_replacer.Victim(&value));
+}
+
+TEST(LRUKReplacerTest, SetPageTest) {
+  LRUKReplacer lru_k_replacer(7, 2);
+  lru_k_replacer.Unpin(1);
+  lru_k_replacer.Unpin(2);
+  lru_k_replacer.Unpin(3);
+  lru_k_replacer.Pin(1);
+  lru_k_replacer.Unpin(1);
+  lru_k_replacer.Pin(2);
+  lru_k_replacer.Unpin(2);
+  // 帧2换了一页，之前的历史不再算数
+  lru_k_replacer.SetPage(2, 100);
+  lru_k_replacer.Unpin(2);
+  int value;
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+}
+
+/**
+ * 相关访问按时钟判断：共用时钟的replacer互相计入访问，各自的时钟互不影响
+ */
+TEST(LRUKReplacerTest, ClockTest) {
+  auto touch = [](LRUKReplacer *replacer, LRUKReplacer *other) {
+    replacer->Unpin(1);
+    for (frame_id_t i = 0; i < 10; i++) {
+      other->Unpin(i);
+      other->Pin(i);
+    }
+    replacer->Pin(1);
+    replacer->Unpin(1);
+    replacer->Unpin(2);
+  };
+  int value;
+  // 两次访问之间别的buffer pool的访问不算，1只访问过一次，比2更早
+  LRUKReplacer replacer(4, 2);
+  LRUKReplacer other(16, 2);
+  touch(&replacer, &other);
+  ASSERT_TRUE(replacer.Victim(&value));
+  EXPECT_EQ(1, value);
+  // 同一个buffer pool的其他shard的访问会把两次访问隔开，1有了两次访问
+  std::atomic<uint64_t> clock{0};
+  LRUKReplacer shard0(4, 2, &clock);
+  LRUKReplacer shard1(16, 2, &clock);
+  touch(&shard0, &shard1);
+  ASSERT_TRUE(shard0.Victim(&value));
+  EXPECT_EQ(2, value);
+}
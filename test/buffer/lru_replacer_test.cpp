@@ -55,4 +55,26 @@ TEST(LRUReplacerTest, SampleTest) {
   EXPECT_EQ(1, value);
   lru_replacer.Victim(&value);
   EXPECT_EQ(4, value);
-}
\ No newline at end of file
+}
+TEST(LRUReplacerTest, UnpinColdTest) {
+  LRUReplacer lru_replacer(7);
+  lru_replacer.Unpin(1);
+  lru_replacer.Unpin(2);
+  // 冷的页先于所有热的页被替换，冷页之间最后放进来的先替换
+  lru_replacer.UnpinCold(3);
+  lru_replacer.UnpinCold(4);
+  lru_replacer.Unpin(5);
+  EXPECT_EQ(5, lru_replacer.Size());
+  int value;
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  // 再被正常使用后就不冷了
+  lru_replacer.UnpinCold(6);
+  lru_replacer.Unpin(6);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+}
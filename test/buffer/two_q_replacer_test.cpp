@@ -0,0 +1,70 @@
+#include "buffer/two_q_replacer.h"
+#include "gtest/gtest.h"
+
+TEST(TwoQReplacerTest, SampleTest) {
+  // Kin = 2, Kout = 4
+  TwoQReplacer two_q_replacer(8);
+
+  // Scenario: four pages read for the first time go to A1in.
+  for (frame_id_t i = 1; i <= 4; i++) {
+    two_q_replacer.SetPage(i, i * 10);
+    two_q_replacer.Unpin(i);
+  }
+  EXPECT_EQ(4, two_q_replacer.Size());
+  int value;
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+
+  // 刚被换出的页还在A1out里，再读进来时进入Am
+  two_q_replacer.SetPage(1, 10);
+  two_q_replacer.Unpin(1);
+  two_q_replacer.SetPage(2, 20);
+  two_q_replacer.Unpin(2);
+  // A1in里的页重复访问不会提升
+  two_q_replacer.Pin(3);
+  two_q_replacer.Unpin(3);
+  two_q_replacer.SetPage(5, 50);
+  two_q_replacer.Unpin(5);
+  two_q_replacer.SetPage(6, 60);
+  two_q_replacer.Unpin(6);
+  two_q_replacer.Pin(1);
+  two_q_replacer.Unpin(1);
+  // 冷页排在A1in的最前面
+  two_q_replacer.SetPage(7, 70);
+  two_q_replacer.UnpinCold(7);
+  EXPECT_EQ(7, two_q_replacer.Size());
+
+  // A1in超过Kin时从A1in换出，否则从Am按LRU换出
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(7, value);
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(5, value);
+
+  // Scenario: pin elements in the replacer.
+  two_q_replacer.Pin(6);
+  EXPECT_EQ(0, two_q_replacer.Size());
+  EXPECT_FALSE(two_q_replacer.Victim(&value));
+  two_q_replacer.Unpin(6);
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+
+  // A1out最多记Kout个页：依次换出了70、30、40、50、60，70已经被挤掉了
+  two_q_replacer.SetPage(1, 70);
+  two_q_replacer.Unpin(1);
+  two_q_replacer.SetPage(2, 40);
+  two_q_replacer.Unpin(2);
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  two_q_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+}
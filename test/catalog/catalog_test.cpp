@@ -20,6 +20,7 @@ TEST(CatalogTest, CatalogMetaTest) {
     meta->GetIndexMetaPages()->emplace(i, RandomUtils::RandomInt(0, 1 << 16));
   }
   meta->GetIndexMetaPages()->emplace(index_nums, INVALID_PAGE_ID);
+  meta->GetStatisticsPages()->emplace(3, RandomUtils::RandomInt(0, 1 << 16));
   // serialize
   meta->SerializeTo(buf);
   // deserialize
@@ -27,6 +28,7 @@ TEST(CatalogTest, CatalogMetaTest) {
   ASSERT_NE(nullptr, other);
   ASSERT_EQ(table_nums + 1, other->GetTableMetaPages()->size());
   ASSERT_EQ(index_nums + 1, other->GetIndexMetaPages()->size());
+  ASSERT_EQ(*meta->GetStatisticsPages(), *other->GetStatisticsPages());
   ASSERT_EQ(INVALID_PAGE_ID, other->GetTableMetaPages()->at(table_nums));
   ASSERT_EQ(INVALID_PAGE_ID, other->GetIndexMetaPages()->at(index_nums));
   for (auto i = 0; i < table_nums; i++) {
@@ -135,4 +137,127 @@ TEST(CatalogTest, CatalogIndexTest) {
     ASSERT_EQ(rid.Get(), ret_02[i].Get());
   }
   delete db_02;
+}
+
+/**
+ * 缓冲池大小、页大小和格式版本记在catalog meta里，版本或页大小不对的db文件打不开
+ */
+TEST(CatalogTest, CatalogFormatTest) {
+  auto db_01 = new DBStorageEngine(db_file_name, true);
+  ASSERT_EQ(0, db_01->catalog_mgr_->GetBufferPoolSize());
+  ASSERT_EQ(DB_SUCCESS, db_01->catalog_mgr_->SetBufferPoolSize(64));
+  delete db_01;
+  auto db_02 = new DBStorageEngine(db_file_name, false);
+  ASSERT_EQ(64, db_02->catalog_mgr_->GetBufferPoolSize());
+  ASSERT_EQ(64, db_02->bpm_->GetPoolSize());
+  delete db_02;
+  // 改写catalog meta里的一个uint32，db文件不能再打开
+  auto rewrite = [](uint32_t offset, uint32_t value) {
+    DiskManager disk_mgr(db_file_name);
+    char buf[PAGE_SIZE];
+    disk_mgr.ReadPage(CATALOG_META_PAGE_ID, buf);
+    uint32_t old_value = MACH_READ_UINT32(buf + offset);
+    MACH_WRITE_UINT32(buf + offset, value);
+    disk_mgr.WritePage(CATALOG_META_PAGE_ID, buf);
+    disk_mgr.Close();
+    return old_value;
+  };
+  uint32_t version = rewrite(4, CatalogMeta::FORMAT_VERSION + 1);
+  ASSERT_EQ(CatalogMeta::FORMAT_VERSION, version);
+  ASSERT_THROW(DBStorageEngine(db_file_name, false), std::runtime_error);
+  // 版本1的db文件还能打开，只是没有统计信息
+  rewrite(4, CatalogMeta::MIN_FORMAT_VERSION);
+  delete new DBStorageEngine(db_file_name, false);
+  ASSERT_EQ(CatalogMeta::FORMAT_VERSION, rewrite(4, version));
+  uint32_t page_size = rewrite(8, PAGE_SIZE * 2);
+  ASSERT_EQ(PAGE_SIZE, page_size);
+  ASSERT_THROW(DBStorageEngine(db_file_name, false), std::runtime_error);
+  rewrite(8, page_size);
+  // 记录版本之前的旧格式
+  uint32_t magic_num = rewrite(0, 89849);
+  ASSERT_THROW(DBStorageEngine(db_file_name, false), std::runtime_error);
+  rewrite(0, magic_num);
+  delete new DBStorageEngine(db_file_name, false);
+}
+
+/**
+ * ANALYZE的结果存在db文件里，重新打开数据库后还在；列很多时统计信息要占好几页
+ */
+TEST(CatalogTest, CatalogStatisticsTest) {
+  SimpleMemHeap heap;
+  const int column_nums = 40;
+  const int row_nums = 2000;
+  auto db_01 = new DBStorageEngine(db_file_name, true);
+  auto &catalog_01 = db_01->catalog_mgr_;
+  std::vector<Column *> columns;
+  for (int i = 0; i < column_nums; i++) {
+    columns.push_back(ALLOC_COLUMN(heap)("c" + std::to_string(i), TypeId::kTypeInt, i, true, false));
+  }
+  auto schema = std::make_shared<Schema>(columns);
+  TableInfo *table_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, catalog_01->CreateTable("table-1", schema.get(), nullptr, table_info));
+  ASSERT_EQ(DB_SUCCESS, catalog_01->CreateTable("table-2", schema.get(), nullptr, table_info));
+  for (int i = 0; i < row_nums; i++) {
+    std::vector<Field> fields;
+    for (int j = 0; j < column_nums; j++) {
+      // 第j列每j+2行有一个null，有j+1种值，前一半的行都是0
+      if (i % (j + 2) == 0) {
+        fields.emplace_back(TypeId::kTypeInt);
+      } else {
+        fields.emplace_back(TypeId::kTypeInt, i < row_nums / 2 ? 0 : i % (j + 1));
+      }
+    }
+    Row row(fields);
+    ASSERT_TRUE(table_info->GetTableHeap()->InsertTuple(row, nullptr));
+  }
+  const TableStatistics *statistics = nullptr;
+  ASSERT_EQ(DB_SUCCESS, catalog_01->GetTableStatistics("table-2", statistics));
+  ASSERT_EQ(nullptr, statistics);
+  ASSERT_EQ(DB_SUCCESS, catalog_01->AnalyzeTable("table-1"));
+  ASSERT_EQ(DB_SUCCESS, catalog_01->AnalyzeTable("table-2"));
+  // 再ANALYZE一次，旧的页被回收
+  ASSERT_EQ(DB_SUCCESS, catalog_01->AnalyzeTable("table-2"));
+  ASSERT_EQ(DB_SUCCESS, catalog_01->GetTableStatistics("table-2", statistics));
+  ASSERT_GT(statistics->GetSerializedSize(), PAGE_SIZE);
+  ASSERT_EQ(row_nums, statistics->GetRowCount());
+  std::vector<const char *> literals{"0", "1", "7", "100", nullptr};
+  std::vector<std::string> ops{"=", "<>", "<", "<=", ">", ">=", "is", "not"};
+  std::vector<double> selectivities;
+  for (int j = 0; j < column_nums; j++) {
+    for (auto &op : ops) {
+      for (auto literal : literals) {
+        selectivities.push_back(statistics->EstimateSelectivity(j, op, literal));
+      }
+    }
+  }
+  uint32_t page_count = statistics->GetPageCount();
+  std::vector<uint64_t> distinct_counts;
+  std::vector<uint64_t> null_counts;
+  for (int j = 0; j < column_nums; j++) {
+    distinct_counts.push_back(statistics->GetDistinctCount(j));
+    null_counts.push_back(statistics->GetNullCount(j));
+  }
+  ASSERT_EQ(DB_SUCCESS, catalog_01->DropTable("table-1"));
+  delete db_01;
+
+  auto db_02 = new DBStorageEngine(db_file_name, false);
+  auto &catalog_02 = db_02->catalog_mgr_;
+  ASSERT_EQ(DB_TABLE_NOT_EXIST, catalog_02->GetTableStatistics("table-1", statistics));
+  ASSERT_EQ(DB_SUCCESS, catalog_02->GetTableStatistics("table-2", statistics));
+  ASSERT_NE(nullptr, statistics);
+  ASSERT_EQ(row_nums, statistics->GetRowCount());
+  ASSERT_EQ(page_count, statistics->GetPageCount());
+  for (int j = 0; j < column_nums; j++) {
+    ASSERT_EQ(distinct_counts[j], statistics->GetDistinctCount(j));
+    ASSERT_EQ(null_counts[j], statistics->GetNullCount(j));
+  }
+  size_t k = 0;
+  for (int j = 0; j < column_nums; j++) {
+    for (auto &op : ops) {
+      for (auto literal : literals) {
+        ASSERT_EQ(selectivities[k++], statistics->EstimateSelectivity(j, op, literal));
+      }
+    }
+  }
+  delete db_02;
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "executor/csv_reader.h"
+#include "gtest/gtest.h"
+
+static const std::string csv_file_name = "csv_reader_test.csv";
+
+/**
+ * 引号、转义的引号、引号里的逗号和换行、CRLF和空行，缓冲区很小时记录跨越多次fread也一样
+ */
+TEST(CsvReaderTest, ParseTest) {
+  FILE *file = fopen(csv_file_name.c_str(), "wb");
+  ASSERT_NE(nullptr, file);
+  fputs("1,abc,2.5\r\n"
+        "\n"
+        "2,\"a,\"\"b\"\"\nc\",\r\n"
+        "3,\"\",\n"
+        "4,x",
+        file);
+  fclose(file);
+  for (size_t buffer_size : {3, 7, 1024}) {
+    CsvReader reader(csv_file_name, buffer_size);
+    ASSERT_TRUE(reader.IsOpen());
+    std::vector<std::string> fields;
+    std::vector<bool> quoted;
+    ASSERT_TRUE(reader.NextRecord(&fields, &quoted));
+    ASSERT_EQ((std::vector<std::string>{"1", "abc", "2.5"}), fields);
+    ASSERT_EQ((std::vector<bool>{false, false, false}), quoted);
+    ASSERT_EQ(1u, reader.GetLineNumber());
+    ASSERT_TRUE(reader.NextRecord(&fields, &quoted));
+    ASSERT_EQ((std::vector<std::string>{"2", "a,\"b\"\nc", ""}), fields);
+    ASSERT_EQ((std::vector<bool>{false, true, false}), quoted);
+    ASSERT_EQ(3u, reader.GetLineNumber());
+    ASSERT_TRUE(reader.NextRecord(&fields, &quoted));
+    ASSERT_EQ((std::vector<std::string>{"3", "", ""}), fields);
+    ASSERT_EQ((std::vector<bool>{false, true, false}), quoted);
+    ASSERT_EQ(5u, reader.GetLineNumber());
+    ASSERT_TRUE(reader.NextRecord(&fields, &quoted));
+    ASSERT_EQ((std::vector<std::string>{"4", "x"}), fields);
+    ASSERT_EQ(6u, reader.GetLineNumber());
+    ASSERT_FALSE(reader.NextRecord(&fields, &quoted));
+  }
+  remove(csv_file_name.c_str());
+}
+
+TEST(CsvReaderTest, MissingFileTest) {
+  CsvReader reader("csv_reader_test_missing.csv");
+  ASSERT_FALSE(reader.IsOpen());
+  std::vector<std::string> fields;
+  std::vector<bool> quoted;
+  ASSERT_FALSE(reader.NextRecord(&fields, &quoted));
+}
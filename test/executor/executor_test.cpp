@@ -0,0 +1,285 @@
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/instance.h"
+#include "executor/executors/delete_executor.h"
+#include "executor/executors/filter_executor.h"
+#include "executor/executors/index_scan_executor.h"
+#include "executor/executors/limit_executor.h"
+#include "executor/executors/projection_executor.h"
+#include "executor/executors/seq_scan_executor.h"
+#include "executor/executors/update_executor.h"
+#include "gtest/gtest.h"
+#include "storage/table_heap.h"
+
+static const std::string db_file_name = "executor_test.db";
+static const std::string log_file_name = "executor_test.log";
+static const int row_nums = 1000;
+
+/**
+ * catalog直接引用建表时传入的schema，所以schema要和engine活得一样久
+ */
+static SimpleMemHeap schema_heap;
+
+class ExecutorTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    engine_ = new DBStorageEngine(db_file_name, true);
+    SimpleMemHeap &heap = schema_heap;
+    std::vector<Column *> columns = {
+        ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, true),
+        ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 16, 1, true, false),
+        ALLOC_COLUMN(heap)("account", TypeId::kTypeFloat, 2, true, false)
+    };
+    auto schema = ALLOC(heap, Schema)(columns);
+    ASSERT_EQ(DB_SUCCESS, engine_->catalog_mgr_->CreateTable("account", schema, nullptr, table_info_));
+    ASSERT_EQ(DB_SUCCESS, engine_->catalog_mgr_->CreateIndex("account", "account_id", {"id"}, nullptr, index_info_));
+    for (int i = 0; i < row_nums; i++) {
+      std::string name = "user" + std::to_string(i);
+      std::vector<Field> fields{Field(TypeId::kTypeInt, i),
+                                Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true),
+                                Field(TypeId::kTypeFloat, static_cast<float>(i))};
+      Row row(fields);
+      ASSERT_TRUE(table_info_->GetTableHeap()->InsertTuple(row, nullptr));
+      ASSERT_EQ(DB_SUCCESS, index_info_->GetIndex()->InsertEntry(Key(i), row.GetRowId(), nullptr));
+    }
+  }
+
+  void TearDown() override {
+    delete engine_;
+    remove(db_file_name.c_str());
+    remove(log_file_name.c_str());
+  }
+
+  static Row Key(int id) {
+    std::vector<Field> fields{Field(TypeId::kTypeInt, id)};
+    return Row(fields);
+  }
+
+  static int IdOf(const Row &row) { return row.GetField(0)->GetInt(); }
+
+  std::unique_ptr<AbstractExecutor> ScanById(std::function<bool(int)> pred) {
+    return std::make_unique<FilterExecutor>(std::make_unique<SeqScanExecutor>(table_info_),
+                                            [pred](const Row &row) { return pred(IdOf(row)); });
+  }
+
+  /**
+   * Run the executor to the end and return all its rows, each batch must not be larger than EXECUTOR_BATCH_SIZE
+   */
+  static std::vector<Row> Drain(AbstractExecutor *executor) {
+    std::vector<Row> result;
+    result.reserve(row_nums);
+    std::vector<Row> batch;
+    executor->Init();
+    while (executor->Next(&batch)) {
+      EXPECT_FALSE(batch.empty());
+      EXPECT_LE(batch.size(), EXECUTOR_BATCH_SIZE);
+      for (auto &row : batch) {
+        result.emplace_back(row);
+      }
+    }
+    EXPECT_TRUE(batch.empty());
+    return result;
+  }
+
+  size_t CountIndex(int id, const std::string &condition) {
+    std::vector<RowId> rids;
+    index_info_->GetIndex()->ScanKey(Key(id), rids, nullptr, condition);
+    return rids.size();
+  }
+
+  DBStorageEngine *engine_{nullptr};
+  TableInfo *table_info_{nullptr};
+  IndexInfo *index_info_{nullptr};
+};
+
+TEST_F(ExecutorTest, SeqScanFilterProjectionLimitTest) {
+  SeqScanExecutor seq_scan(table_info_);
+  auto all = Drain(&seq_scan);
+  ASSERT_EQ(row_nums, all.size());
+  for (int i = 0; i < row_nums; i++) {
+    ASSERT_EQ(i, IdOf(all[i]));
+  }
+  // select account, id from account where id % 3 = 0
+  ProjectionExecutor projection(ScanById([](int id) { return id % 3 == 0; }), {2, 0});
+  auto projected = Drain(&projection);
+  ASSERT_EQ((row_nums + 2) / 3, projected.size());
+  for (size_t i = 0; i < projected.size(); i++) {
+    ASSERT_EQ(2, projected[i].GetFieldCount());
+    ASSERT_EQ(static_cast<float>(i * 3), projected[i].GetField(0)->GetFloat());
+    ASSERT_EQ(static_cast<int>(i * 3), projected[i].GetField(1)->GetInt());
+  }
+  // limit截断在一批的中间，也可以大于行数
+  LimitExecutor limit(ScanById([](int id) { return id % 2 == 0; }), 300);
+  auto limited = Drain(&limit);
+  ASSERT_EQ(300, limited.size());
+  ASSERT_EQ(598, IdOf(limited.back()));
+  LimitExecutor no_limit(std::make_unique<SeqScanExecutor>(table_info_), row_nums * 2);
+  ASSERT_EQ(row_nums, Drain(&no_limit).size());
+  LimitExecutor empty(ScanById([](int) { return false; }), 10);
+  ASSERT_EQ(0, Drain(&empty).size());
+}
+
+TEST_F(ExecutorTest, SeqScanFetchFailTest) {
+  // 所有帧都被pin住，表的页读不进来，扫描报错停止
+  std::vector<page_id_t> pinned;
+  page_id_t page_id;
+  while (engine_->bpm_->NewPage(page_id) != nullptr) {
+    pinned.push_back(page_id);
+  }
+  SeqScanExecutor seq_scan(table_info_);
+  ASSERT_EQ(0, Drain(&seq_scan).size());
+  ASSERT_EQ(DB_FAILED, seq_scan.GetStatus());
+  for (auto id : pinned) {
+    ASSERT_TRUE(engine_->bpm_->UnpinPage(id, false));
+    ASSERT_TRUE(engine_->bpm_->DeletePage(id));
+  }
+  ASSERT_EQ(row_nums, Drain(&seq_scan).size());
+  ASSERT_EQ(DB_SUCCESS, seq_scan.GetStatus());
+}
+
+TEST_F(ExecutorTest, IndexScanTest) {
+  auto scan = [this](int id, const std::string &condition) {
+    std::vector<Field> key{Field(TypeId::kTypeInt, id)};
+    IndexScanExecutor executor(table_info_, index_info_, key, condition);
+    auto rows = Drain(&executor);
+    for (auto &row : rows) {
+      EXPECT_EQ(3, row.GetFieldCount());
+      EXPECT_EQ(static_cast<float>(IdOf(row)), row.GetField(2)->GetFloat());
+    }
+    return rows;
+  };
+  auto equal = scan(42, "=");
+  ASSERT_EQ(1, equal.size());
+  ASSERT_EQ(42, IdOf(equal[0]));
+  ASSERT_EQ(0, scan(row_nums, "=").size());
+  ASSERT_EQ(10, scan(10, "<").size());
+  ASSERT_EQ(11, scan(10, "<=").size());
+  ASSERT_EQ(10, scan(row_nums - 11, ">").size());
+  ASSERT_EQ(row_nums - 500, scan(500, ">=").size());
+}
+
+TEST_F(ExecutorTest, DeleteTest) {
+  std::vector<IndexInfo *> indexes{index_info_};
+  Transaction *txn = engine_->txn_mgr_->Begin();
+  DeleteExecutor executor(ScanById([](int id) { return id < 100; }), table_info_, indexes, txn);
+  ASSERT_EQ(100, Drain(&executor).size());
+  ASSERT_EQ(DB_SUCCESS, executor.GetStatus());
+  engine_->txn_mgr_->Commit(txn);
+
+  SeqScanExecutor seq_scan(table_info_);
+  auto rows = Drain(&seq_scan);
+  ASSERT_EQ(row_nums - 100, rows.size());
+  ASSERT_EQ(100, IdOf(rows[0]));
+  ASSERT_EQ(0, CountIndex(50, "="));
+  ASSERT_EQ(0, CountIndex(100, "<"));
+  ASSERT_EQ(1, CountIndex(100, "="));
+}
+
+TEST_F(ExecutorTest, UpdateTest) {
+  std::vector<IndexInfo *> indexes{index_info_};
+  // 只改account，索引不变
+  Transaction *txn = engine_->txn_mgr_->Begin();
+  std::vector<Field> values;
+  values.emplace_back(TypeId::kTypeFloat, 0.5f);
+  UpdateExecutor update_account(ScanById([](int id) { return id == 5; }), table_info_, indexes, {2}, values, txn);
+  ASSERT_EQ(1, Drain(&update_account).size());
+  ASSERT_EQ(DB_SUCCESS, update_account.GetStatus());
+  engine_->txn_mgr_->Commit(txn);
+  std::vector<Field> key5{Field(TypeId::kTypeInt, 5)};
+  IndexScanExecutor scan5(table_info_, index_info_, key5, "=");
+  auto rows = Drain(&scan5);
+  ASSERT_EQ(1, rows.size());
+  ASSERT_EQ(0.5f, rows[0].GetField(2)->GetFloat());
+
+  // 改索引列，旧key被删除，新key指向同一行
+  txn = engine_->txn_mgr_->Begin();
+  values.clear();
+  values.emplace_back(TypeId::kTypeInt, row_nums + 6);
+  UpdateExecutor update_id(ScanById([](int id) { return id == 6; }), table_info_, indexes, {0}, values, txn);
+  ASSERT_EQ(1, Drain(&update_id).size());
+  ASSERT_EQ(DB_SUCCESS, update_id.GetStatus());
+  engine_->txn_mgr_->Commit(txn);
+  ASSERT_EQ(0, CountIndex(6, "="));
+  ASSERT_EQ(1, CountIndex(row_nums + 6, "="));
+  ASSERT_EQ(row_nums, Drain(std::make_unique<SeqScanExecutor>(table_info_).get()).size());
+
+  // 新key和其他行重复，update失败
+  txn = engine_->txn_mgr_->Begin();
+  values.clear();
+  values.emplace_back(TypeId::kTypeInt, 8);
+  UpdateExecutor duplicate(ScanById([](int id) { return id == 7; }), table_info_, indexes, {0}, values, txn);
+  ASSERT_EQ(0, Drain(&duplicate).size());
+  ASSERT_EQ(DB_FAILED, duplicate.GetStatus());
+  engine_->txn_mgr_->Abort(txn);
+  ASSERT_EQ(1, CountIndex(7, "="));
+  ASSERT_EQ(1, CountIndex(8, "="));
+}
+
+TEST_F(ExecutorTest, ScanUncommittedUpdateTest) {
+  // 另一个事务改了id为5的行还没提交，事务里的扫描要等它结束，不会读到没提交的值
+  auto update = [this](float account) {
+    Transaction *writer = engine_->txn_mgr_->Begin();
+    std::string name = "user5";
+    std::vector<Field> fields{Field(TypeId::kTypeInt, 5),
+                              Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true),
+                              Field(TypeId::kTypeFloat, account)};
+    std::vector<RowId> rids;
+    EXPECT_EQ(DB_SUCCESS, index_info_->GetIndex()->ScanKey(Key(5), rids, nullptr, "="));
+    EXPECT_TRUE(table_info_->GetTableHeap()->UpdateTuple(Row(fields), rids[0], writer));
+    return writer;
+  };
+  auto account_of_5 = [](const std::vector<Row> &rows) {
+    for (auto &row : rows) {
+      if (IdOf(row) == 5) {
+        return row.GetField(2)->GetFloat();
+      }
+    }
+    return -1.0f;
+  };
+  // 读的事务在另一个线程里，写的事务提交之前它不能结束
+  auto read_while_writing = [this](std::function<std::unique_ptr<AbstractExecutor>(Transaction *)> make_scan,
+                                    Transaction *writer, bool commit) {
+    std::atomic<bool> done{false};
+    std::vector<Row> rows;
+    std::thread reader([&]() {
+      Transaction *txn = engine_->txn_mgr_->Begin();
+      auto scan = make_scan(txn);
+      rows = Drain(scan.get());
+      EXPECT_EQ(DB_SUCCESS, scan->GetStatus());
+      engine_->txn_mgr_->Commit(txn);
+      done = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_FALSE(done);
+    if (commit) {
+      engine_->txn_mgr_->Commit(writer);
+    } else {
+      engine_->txn_mgr_->Abort(writer);
+    }
+    reader.join();
+    return rows;
+  };
+
+  auto seq_scan = [this](Transaction *txn) { return std::make_unique<SeqScanExecutor>(table_info_, Predicate(), txn); };
+  auto rows = read_while_writing(seq_scan, update(0.5f), true);
+  ASSERT_EQ(row_nums, rows.size());
+  ASSERT_EQ(0.5f, account_of_5(rows));
+
+  rows = read_while_writing(seq_scan, update(0.25f), false);
+  ASSERT_EQ(row_nums, rows.size());
+  ASSERT_EQ(0.5f, account_of_5(rows));
+
+  auto index_scan = [this](Transaction *txn) {
+    std::vector<Field> key{Field(TypeId::kTypeInt, 10)};
+    return std::make_unique<IndexScanExecutor>(table_info_, index_info_, key, "<", txn);
+  };
+  rows = read_while_writing(index_scan, update(0.75f), true);
+  ASSERT_EQ(10, rows.size());
+  ASSERT_EQ(0.75f, account_of_5(rows));
+}
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/instance.h"
+#include "executor/executors/filter_executor.h"
+#include "executor/executors/index_scan_executor.h"
+#include "executor/executors/seq_scan_executor.h"
+#include "executor/optimizer.h"
+#include "executor/predicate.h"
+#include "gtest/gtest.h"
+#include "storage/table_heap.h"
+
+static const std::string db_file_name = "optimizer_test.db";
+static const std::string log_file_name = "optimizer_test.log";
+static const int row_nums = 1000;
+
+/**
+ * catalog直接引用建表时传入的schema，所以schema要和engine活得一样久
+ */
+static SimpleMemHeap schema_heap;
+
+/**
+ * id和code都有唯一索引，code是id的一个排列；grade没有索引，90%的行都是7
+ */
+class OptimizerTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    engine_ = new DBStorageEngine(db_file_name, true);
+    SimpleMemHeap &heap = schema_heap;
+    std::vector<Column *> columns = {
+        ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, true),
+        ALLOC_COLUMN(heap)("code", TypeId::kTypeInt, 1, false, true),
+        ALLOC_COLUMN(heap)("grade", TypeId::kTypeInt, 2, true, false)
+    };
+    auto schema = ALLOC(heap, Schema)(columns);
+    auto catalog = engine_->catalog_mgr_;
+    ASSERT_EQ(DB_SUCCESS, catalog->CreateTable("t", schema, nullptr, table_info_));
+    IndexInfo *id_index = nullptr;
+    IndexInfo *code_index = nullptr;
+    ASSERT_EQ(DB_SUCCESS, catalog->CreateIndex("t", "t_id", {"id"}, nullptr, id_index));
+    ASSERT_EQ(DB_SUCCESS, catalog->CreateIndex("t", "t_code", {"code"}, nullptr, code_index));
+    indexes_ = {id_index, code_index};
+    for (int i = 0; i < row_nums; i++) {
+      int code = i * 37 % row_nums;
+      std::vector<Field> fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeInt, code),
+                                i % 10 == 0 ? Field(TypeId::kTypeInt, i) : Field(TypeId::kTypeInt, 7)};
+      Row row(fields);
+      ASSERT_TRUE(table_info_->GetTableHeap()->InsertTuple(row, nullptr));
+      ASSERT_EQ(DB_SUCCESS, id_index->GetIndex()->InsertEntry(Key(i), row.GetRowId(), nullptr));
+      ASSERT_EQ(DB_SUCCESS, code_index->GetIndex()->InsertEntry(Key(code), row.GetRowId(), nullptr));
+    }
+  }
+
+  void TearDown() override {
+    delete engine_;
+    remove(db_file_name.c_str());
+    remove(log_file_name.c_str());
+  }
+
+  static Row Key(int value) {
+    std::vector<Field> fields{Field(TypeId::kTypeInt, value)};
+    return Row(fields);
+  }
+
+  const TableStatistics *Analyze() {
+    const TableStatistics *statistics = nullptr;
+    EXPECT_EQ(DB_SUCCESS, engine_->catalog_mgr_->AnalyzeTable("t"));
+    EXPECT_EQ(DB_SUCCESS, engine_->catalog_mgr_->GetTableStatistics("t", statistics));
+    return statistics;
+  }
+
+  /**
+   * Names of the indexes used by path, "and" within a clause and "or" between clauses
+   */
+  static std::string Describe(const AccessPath &path) {
+    std::string result;
+    for (size_t i = 0; i < path.lookups_.size(); i++) {
+      for (size_t j = 0; j < path.lookups_[i].size(); j++) {
+        result += (i == 0 && j == 0 ? "" : j == 0 ? " or " : " and ") + path.lookups_[i][j].index_->GetIndexName();
+      }
+    }
+    return result;
+  }
+
+  /**
+   * Sorted ids of the rows returned by executor
+   */
+  static std::vector<int> Ids(AbstractExecutor *executor) {
+    std::vector<int> ids;
+    std::vector<Row> batch;
+    executor->Init();
+    while (executor->Next(&batch)) {
+      for (auto &row : batch) {
+        ids.push_back(row.GetField(0)->GetInt());
+      }
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+  }
+
+  /**
+   * Run conditions through the access path and through a seq scan, both must return the same rows
+   */
+  void CheckPath(const std::vector<std::vector<ScanCondition>> &conditions, AccessPath path) {
+    Predicate predicate;
+    auto schema = table_info_->GetSchema();
+    for (auto &clause : conditions) {
+      predicate.AddClause();
+      for (auto &condition : clause) {
+        auto type = schema->GetColumn(condition.column_index_)->GetType();
+        ASSERT_TRUE(predicate.AddComparison(condition.column_index_, type, condition.op_, condition.literal_));
+      }
+    }
+    FilterExecutor expected(std::make_unique<SeqScanExecutor>(table_info_), predicate);
+    FilterExecutor actual(std::make_unique<IndexScanExecutor>(table_info_, std::move(path.lookups_)), predicate);
+    ASSERT_EQ(Ids(&expected), Ids(&actual));
+  }
+
+  DBStorageEngine *engine_{nullptr};
+  TableInfo *table_info_{nullptr};
+  std::vector<IndexInfo *> indexes_;
+};
+
+TEST_F(OptimizerTest, StatisticsTest) {
+  const TableStatistics *statistics = nullptr;
+  ASSERT_EQ(DB_SUCCESS, engine_->catalog_mgr_->GetTableStatistics("t", statistics));
+  ASSERT_EQ(nullptr, statistics);
+  ASSERT_EQ(DB_TABLE_NOT_EXIST, engine_->catalog_mgr_->AnalyzeTable("not_exist"));
+  statistics = Analyze();
+  ASSERT_NE(nullptr, statistics);
+  ASSERT_EQ(static_cast<uint64_t>(row_nums), statistics->GetRowCount());
+  ASSERT_EQ(static_cast<uint64_t>(row_nums), statistics->GetDistinctCount(0));
+  ASSERT_EQ(101u, statistics->GetDistinctCount(2));
+  ASSERT_EQ(0u, statistics->GetNullCount(2));
+  // 均匀分布的列，范围条件按直方图插值
+  EXPECT_NEAR(0.25, statistics->EstimateSelectivity(0, "<", "250"), 0.02);
+  EXPECT_NEAR(0.75, statistics->EstimateSelectivity(0, ">=", "250"), 0.02);
+  EXPECT_NEAR(0.001, statistics->EstimateSelectivity(0, "=", "250"), 0.001);
+  EXPECT_DOUBLE_EQ(0, statistics->EstimateSelectivity(0, "=", "5000"));
+  EXPECT_DOUBLE_EQ(1, statistics->EstimateSelectivity(0, "<", "5000"));
+  // 倾斜的列：高频值占满了多个桶，低频值按1/distinct估计
+  EXPECT_NEAR(0.9, statistics->EstimateSelectivity(2, "=", "7"), 0.1);
+  EXPECT_NEAR(0.1, statistics->EstimateSelectivity(2, "<>", "7"), 0.1);
+  EXPECT_LT(statistics->EstimateSelectivity(2, "=", "500"), 0.02);
+  EXPECT_DOUBLE_EQ(0, statistics->EstimateSelectivity(2, "is", nullptr));
+  EXPECT_DOUBLE_EQ(1, statistics->EstimateSelectivity(2, "not", nullptr));
+  ASSERT_EQ(DB_SUCCESS, engine_->catalog_mgr_->DropTable("t"));
+  ASSERT_EQ(DB_TABLE_NOT_EXIST, engine_->catalog_mgr_->GetTableStatistics("t", statistics));
+}
+
+TEST_F(OptimizerTest, DefaultSelectivityTest) {
+  // 没有ANALYZE时等值用索引，范围条件假设选中1/3的行，全表扫描更便宜
+  Optimizer optimizer(table_info_, indexes_, nullptr);
+  std::vector<std::vector<ScanCondition>> equal{{{0, "=", "5"}}};
+  auto path = optimizer.ChooseAccessPath(equal);
+  ASSERT_EQ("t_id", Describe(path));
+  CheckPath(equal, std::move(path));
+  std::vector<std::vector<ScanCondition>> range{{{0, "<", "5"}}};
+  ASSERT_EQ("", Describe(optimizer.ChooseAccessPath(range)));
+  std::vector<std::vector<ScanCondition>> no_index{{{2, "=", "7"}}};
+  ASSERT_EQ("", Describe(optimizer.ChooseAccessPath(no_index)));
+  ASSERT_EQ("", Describe(optimizer.ChooseAccessPath({})));
+}
+
+TEST_F(OptimizerTest, StaleStatisticsTest) {
+  Optimizer optimizer(table_info_, indexes_, Analyze());
+  ASSERT_DOUBLE_EQ(row_nums, optimizer.ChooseAccessPath({}).rows_);
+  // ANALYZE之后表变成了3倍大，行数按页数估计，页不一定是满的，所以只是近似
+  for (int i = row_nums; i < 3 * row_nums; i++) {
+    std::vector<Field> fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeInt, i), Field(TypeId::kTypeInt, 7)};
+    Row row(fields);
+    ASSERT_TRUE(table_info_->GetTableHeap()->InsertTuple(row, nullptr));
+  }
+  EXPECT_NEAR(3 * row_nums, optimizer.ChooseAccessPath({}).rows_, 0.2 * 3 * row_nums);
+}
+
+TEST_F(OptimizerTest, AccessPathTest) {
+  Optimizer optimizer(table_info_, indexes_, Analyze());
+  // 选中大部分行时全表扫描
+  std::vector<std::vector<ScanCondition>> wide{{{0, ">", "5"}}};
+  ASSERT_EQ("", Describe(optimizer.ChooseAccessPath(wide)));
+  // 选中很少的行时用索引，范围条件也可以
+  std::vector<std::vector<ScanCondition>> narrow{{{0, "<", "5"}, {2, "=", "7"}}};
+  auto path = optimizer.ChooseAccessPath(narrow);
+  ASSERT_EQ("t_id", Describe(path));
+  CheckPath(narrow, std::move(path));
+  // 同一列上的多个条件用最有选择性的那个
+  std::vector<std::vector<ScanCondition>> same_column{{{0, ">", "5"}, {0, "=", "10"}}};
+  path = optimizer.ChooseAccessPath(same_column);
+  ASSERT_EQ("t_id", Describe(path));
+  ASSERT_EQ("=", path.lookups_[0][0].op_);
+  CheckPath(same_column, std::move(path));
+  // 等值已经最多一行，不需要再和另一个索引求交集
+  std::vector<std::vector<ScanCondition>> point{{{0, "<", "200"}, {1, "=", "20"}}};
+  path = optimizer.ChooseAccessPath(point);
+  ASSERT_EQ("t_code", Describe(path));
+  CheckPath(point, std::move(path));
+}
+
+TEST_F(OptimizerTest, IntersectionTest) {
+  Optimizer optimizer(table_info_, indexes_, Analyze());
+  // 两个条件各选中20%的行，交集只剩4%，回表的代价远小于多一次索引查找
+  std::vector<std::vector<ScanCondition>> conditions{{{0, "<", "200"}, {1, "<", "200"}, {2, "=", "7"}}};
+  auto path = optimizer.ChooseAccessPath(conditions);
+  ASSERT_EQ(1u, path.lookups_.size());
+  ASSERT_EQ(2u, path.lookups_[0].size());
+  EXPECT_NEAR(40, path.rows_, 10);
+  CheckPath(conditions, std::move(path));
+  // 交集为空
+  std::vector<std::vector<ScanCondition>> empty{{{0, "<", "100"}, {1, ">=", "900"}}};
+  path = optimizer.ChooseAccessPath(empty);
+  ASSERT_EQ(2u, path.lookups_[0].size());
+  CheckPath(empty, std::move(path));
+}
+
+TEST_F(OptimizerTest, UnionTest) {
+  Optimizer optimizer(table_info_, indexes_, Analyze());
+  std::vector<std::vector<ScanCondition>> conditions{{{0, "<", "20"}}, {{1, "<", "20"}}, {{0, "=", "3"}}};
+  auto path = optimizer.ChooseAccessPath(conditions);
+  ASSERT_EQ("t_id or t_code or t_id", Describe(path));
+  CheckPath(conditions, std::move(path));
+  // 有一个分支不能用索引，只能全表扫描
+  std::vector<std::vector<ScanCondition>> no_index{{{0, "<", "20"}}, {{2, "=", "500"}}};
+  ASSERT_EQ("", Describe(optimizer.ChooseAccessPath(no_index)));
+  // 分支都选中很多行时全表扫描
+  std::vector<std::vector<ScanCondition>> wide{{{0, "<", "600"}}, {{1, "<", "600"}}};
+  ASSERT_EQ("", Describe(optimizer.ChooseAccessPath(wide)));
+}
+
+TEST_F(OptimizerTest, BoundedRangeTest) {
+  // 同一列上同时有上下界时只查一次索引
+  std::vector<std::vector<ScanCondition>> conditions{{{0, ">", "100"}, {0, ">=", "90"}, {0, "<=", "150"}}};
+  for (auto statistics : {static_cast<const TableStatistics *>(nullptr), Analyze()}) {
+    Optimizer optimizer(table_info_, indexes_, statistics);
+    auto path = optimizer.ChooseAccessPath(conditions);
+    ASSERT_EQ("t_id", Describe(path));
+    auto &lookup = path.lookups_[0][0];
+    ASSERT_EQ(">", lookup.op_);
+    ASSERT_EQ("<=", lookup.upper_op_);
+    ASSERT_EQ(100, lookup.key_[0].GetInt());
+    ASSERT_EQ(150, lookup.upper_key_[0].GetInt());
+    if (statistics != nullptr) {
+      EXPECT_NEAR(50, path.rows_, 10);
+    }
+    CheckPath(conditions, std::move(path));
+  }
+  Optimizer optimizer(table_info_, indexes_, Analyze());
+  // 上下界相交为空
+  std::vector<std::vector<ScanCondition>> empty{{{0, ">", "500"}, {0, "<", "400"}}};
+  auto path = optimizer.ChooseAccessPath(empty);
+  ASSERT_EQ("t_id", Describe(path));
+  CheckPath(empty, std::move(path));
+  // 范围很宽时全表扫描
+  std::vector<std::vector<ScanCondition>> wide{{{0, ">", "10"}, {0, "<", "990"}}};
+  ASSERT_EQ("", Describe(optimizer.ChooseAccessPath(wide)));
+  // 范围和等值在同一列时用等值
+  std::vector<std::vector<ScanCondition>> equal{{{0, ">", "10"}, {0, "<", "990"}, {0, "=", "20"}}};
+  path = optimizer.ChooseAccessPath(equal);
+  ASSERT_EQ("=", path.lookups_[0][0].op_);
+  CheckPath(equal, std::move(path));
+}
@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "common/instance.h"
+#include "executor/executors/filter_executor.h"
+#include "executor/executors/seq_scan_executor.h"
+#include "executor/predicate.h"
+#include "gtest/gtest.h"
+#include "page/table_page.h"
+#include "storage/table_heap.h"
+
+static const std::string db_file_name = "predicate_test.db";
+static const std::string log_file_name = "predicate_test.log";
+
+/**
+ * 统计堆分配的次数，用来检查扫描时不满足条件的行没有分配内存
+ */
+static std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size) {
+  allocations++;
+  void *ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+TEST(PredicateTest, EvaluateTest) {
+  std::vector<Field> fields{Field(TypeId::kTypeInt, 10),
+                            Field(TypeId::kTypeChar, const_cast<char *>("minisql"), 7, true),
+                            Field(TypeId::kTypeFloat, 2.5f),
+                            Field(TypeId::kTypeInt)};
+  Row row(fields);
+  // 同一行序列化之后用RowView原地判断，结果要和Row一致
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {
+      ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false),
+      ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 16, 1, true, false),
+      ALLOC_COLUMN(heap)("account", TypeId::kTypeFloat, 2, true, false),
+      ALLOC_COLUMN(heap)("age", TypeId::kTypeInt, 3, true, false)
+  };
+  Schema schema(columns);
+  char buf[PAGE_SIZE];
+  row.SerializeTo(buf, &schema);
+  RowView view;
+  view.Reset(buf, &schema, INVALID_ROWID);
+  auto check = [&row, &view](uint32_t column_index, TypeId type, const std::string &op, const char *literal) {
+    Predicate predicate;
+    predicate.AddClause();
+    EXPECT_TRUE(predicate.AddComparison(column_index, type, op, literal));
+    bool satisfied = predicate.Evaluate(row);
+    EXPECT_EQ(satisfied, predicate.Evaluate(view));
+    return satisfied;
+  };
+  EXPECT_TRUE(check(0, TypeId::kTypeInt, "=", "10"));
+  EXPECT_FALSE(check(0, TypeId::kTypeInt, "<>", "10"));
+  EXPECT_TRUE(check(0, TypeId::kTypeInt, "<", "11"));
+  EXPECT_FALSE(check(0, TypeId::kTypeInt, "<", "10"));
+  EXPECT_TRUE(check(0, TypeId::kTypeInt, "<=", "10"));
+  EXPECT_TRUE(check(0, TypeId::kTypeInt, ">", "-3"));
+  EXPECT_FALSE(check(0, TypeId::kTypeInt, ">=", "11"));
+  EXPECT_TRUE(check(1, TypeId::kTypeChar, "=", "minisql"));
+  EXPECT_FALSE(check(1, TypeId::kTypeChar, "=", "minisq"));
+  EXPECT_TRUE(check(1, TypeId::kTypeChar, ">", "minisq"));
+  EXPECT_TRUE(check(1, TypeId::kTypeChar, "<", "minisqm"));
+  EXPECT_TRUE(check(1, TypeId::kTypeChar, "<", "minisql2"));
+  EXPECT_TRUE(check(1, TypeId::kTypeChar, "<>", "mysql"));
+  EXPECT_TRUE(check(2, TypeId::kTypeFloat, ">=", "2.5"));
+  EXPECT_FALSE(check(2, TypeId::kTypeFloat, ">", "2.5"));
+  EXPECT_TRUE(check(2, TypeId::kTypeFloat, "<", "3"));
+  // null
+  EXPECT_TRUE(check(3, TypeId::kTypeInt, "is", nullptr));
+  EXPECT_FALSE(check(3, TypeId::kTypeInt, "not", nullptr));
+  EXPECT_FALSE(check(0, TypeId::kTypeInt, "is", nullptr));
+  EXPECT_FALSE(check(3, TypeId::kTypeInt, "=", "0"));
+  EXPECT_FALSE(check(3, TypeId::kTypeInt, "<>", "0"));
+  EXPECT_FALSE(check(0, TypeId::kTypeInt, "=", nullptr));
+  Predicate bad;
+  bad.AddClause();
+  EXPECT_FALSE(bad.AddComparison(0, TypeId::kTypeInt, "like", "1"));
+
+  // (id > 5 and name = "mysql") or account < 3
+  Predicate predicate;
+  predicate.AddClause();
+  predicate.AddComparison(0, TypeId::kTypeInt, ">", "5");
+  predicate.AddComparison(1, TypeId::kTypeChar, "=", "mysql");
+  EXPECT_FALSE(predicate.Evaluate(row));
+  predicate.AddClause();
+  predicate.AddComparison(2, TypeId::kTypeFloat, "<", "3");
+  EXPECT_TRUE(predicate.Evaluate(row));
+  EXPECT_TRUE(predicate.Evaluate(view));
+}
+
+/**
+ * catalog直接引用建表时传入的schema，所以schema要和engine活得一样久
+ */
+static SimpleMemHeap schema_heap;
+
+TEST(PredicateTest, RangeScanBenchmark) {
+  remove(db_file_name.c_str());
+  remove(log_file_name.c_str());
+  auto engine = new DBStorageEngine(db_file_name, true);
+  SimpleMemHeap &heap = schema_heap;
+  std::vector<Column *> columns = {
+      ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false),
+      ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 16, 1, true, false),
+      ALLOC_COLUMN(heap)("account", TypeId::kTypeFloat, 2, true, false)
+  };
+  auto schema = ALLOC(heap, Schema)(columns);
+  TableInfo *table_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, engine->catalog_mgr_->CreateTable("account", schema, nullptr, table_info));
+  const int n = 1000000;
+  // TableHeap::InsertTuple每次都从第一页开始找空闲空间，插入1M行太慢，这里直接在最后一页后面追加
+  auto bpm = engine->bpm_;
+  page_id_t last_page_id = table_info->GetTableHeap()->GetFirstPageId();
+  auto last_page = reinterpret_cast<TablePage *>(bpm->FetchPage(last_page_id));
+  for (int i = 0; i < n; i++) {
+    std::string name = "user" + std::to_string(i);
+    std::vector<Field> fields{Field(TypeId::kTypeInt, i),
+                              Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true),
+                              Field(TypeId::kTypeFloat, static_cast<float>(i % 1000))};
+    Row row(fields);
+    if (!last_page->InsertTuple(row, schema, nullptr, nullptr, nullptr)) {
+      page_id_t next_page_id;
+      auto next_page = reinterpret_cast<TablePage *>(bpm->NewPage(next_page_id));
+      ASSERT_NE(nullptr, next_page);
+      next_page->Init(next_page_id, last_page_id, nullptr, nullptr);
+      last_page->SetNextPageId(next_page_id);
+      bpm->UnpinPage(last_page_id, true);
+      last_page_id = next_page_id;
+      last_page = next_page;
+      ASSERT_TRUE(last_page->InsertTuple(row, schema, nullptr, nullptr, nullptr));
+    }
+  }
+  bpm->UnpinPage(last_page_id, true);
+  // where id >= 250000 and id < 750000 and account < 500.5
+  // 原来的做法：逐行解析常量、构造临时Field再比较
+  auto interpreted = [](const Row &row) {
+    Field low(TypeId::kTypeInt, std::stoi("250000"));
+    Field high(TypeId::kTypeInt, std::stoi("750000"));
+    Field account(TypeId::kTypeFloat, (float)atof("500.5"));
+    return row.GetField(0)->CompareGreaterThanEquals(low) != CmpBool::kFalse &&
+           row.GetField(0)->CompareLessThan(high) != CmpBool::kFalse &&
+           row.GetField(2)->CompareLessThan(account) != CmpBool::kFalse;
+  };
+  Predicate compiled;
+  compiled.AddClause();
+  compiled.AddComparison(0, TypeId::kTypeInt, ">=", "250000");
+  compiled.AddComparison(0, TypeId::kTypeInt, "<", "750000");
+  compiled.AddComparison(2, TypeId::kTypeFloat, "<", "500.5");
+  // 扫描本身的开销远大于谓词，所以两种谓词在同一次扫描的每一批上分别计时
+  using Clock = std::chrono::steady_clock;
+  std::chrono::duration<double> scan_time{0}, interpreted_time{0}, compiled_time{0};
+  size_t scanned = 0, interpreted_matched = 0, compiled_matched = 0;
+  SeqScanExecutor seq_scan(table_info);
+  std::vector<Row> batch;
+  auto start = Clock::now();
+  seq_scan.Init();
+  while (seq_scan.Next(&batch)) {
+    auto t0 = Clock::now();
+    for (auto &row : batch) {
+      interpreted_matched += interpreted(row);
+    }
+    auto t1 = Clock::now();
+    for (auto &row : batch) {
+      compiled_matched += compiled.Evaluate(row);
+    }
+    auto t2 = Clock::now();
+    interpreted_time += t1 - t0;
+    compiled_time += t2 - t1;
+    scanned += batch.size();
+  }
+  scan_time = Clock::now() - start - interpreted_time - compiled_time;
+  ASSERT_EQ(static_cast<size_t>(n), scanned);
+  ASSERT_EQ(250500u, compiled_matched);
+  ASSERT_EQ(interpreted_matched, compiled_matched);
+  // 通过FilterExecutor走一遍完整的流水线：每一行都先反序列化成Row再判断
+  FilterExecutor filter(std::make_unique<SeqScanExecutor>(table_info), compiled);
+  size_t filtered = 0;
+  size_t filter_allocations = allocations;
+  start = Clock::now();
+  filter.Init();
+  while (filter.Next(&batch)) {
+    filtered += batch.size();
+  }
+  std::chrono::duration<double> filter_time = Clock::now() - start;
+  filter_allocations = allocations - filter_allocations;
+  ASSERT_EQ(compiled_matched, filtered);
+  // 谓词下推到SeqScanExecutor：在页上原地判断，只有满足条件的行才反序列化
+  SeqScanExecutor pushed_down(table_info, compiled);
+  size_t pushed_down_matched = 0;
+  size_t pushed_down_allocations = allocations;
+  start = Clock::now();
+  pushed_down.Init();
+  while (pushed_down.Next(&batch)) {
+    pushed_down_matched += batch.size();
+  }
+  std::chrono::duration<double> pushed_down_time = Clock::now() - start;
+  pushed_down_allocations = allocations - pushed_down_allocations;
+  ASSERT_EQ(compiled_matched, pushed_down_matched);
+  ASSERT_LT(pushed_down_allocations, filter_allocations);
+  std::cout << "Range scan over " << n << " rows, " << compiled_matched << " matched: scan " << scan_time.count()
+            << "s, interpreted predicate " << interpreted_time.count() * 1e9 / n << "ns/row, compiled predicate "
+            << compiled_time.count() * 1e9 / n << "ns/row" << std::endl;
+  std::cout << "Filter over scan " << filter_time.count() << "s, " << filter_allocations * 1.0 / n
+            << " allocations/row; predicate pushed into scan " << pushed_down_time.count() << "s, "
+            << pushed_down_allocations * 1.0 / n << " allocations/row" << std::endl;
+  delete engine;
+  remove(db_file_name.c_str());
+  remove(log_file_name.c_str());
+}
+
+TEST(PredicateTest, InPlaceScanTest) {
+  remove(db_file_name.c_str());
+  remove(log_file_name.c_str());
+  auto engine = new DBStorageEngine(db_file_name, true);
+  SimpleMemHeap &heap = schema_heap;
+  std::vector<Column *> columns = {
+      ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false),
+      ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 16, 1, true, false),
+      ALLOC_COLUMN(heap)("account", TypeId::kTypeFloat, 2, true, false)
+  };
+  auto schema = ALLOC(heap, Schema)(columns);
+  TableInfo *table_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, engine->catalog_mgr_->CreateTable("scan", schema, nullptr, table_info));
+  const int n = 20000;
+  std::vector<RowId> rids;
+  for (int i = 0; i < n; i++) {
+    std::string name = "user" + std::to_string(i);
+    // 每7行一个null的name
+    std::vector<Field> fields{Field(TypeId::kTypeInt, i),
+                              i % 7 == 0 ? Field(TypeId::kTypeChar)
+                                         : Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true),
+                              Field(TypeId::kTypeFloat, static_cast<float>(i % 100))};
+    Row row(fields);
+    ASSERT_TRUE(table_info->GetTableHeap()->InsertTuple(row, nullptr));
+    rids.push_back(row.GetRowId());
+  }
+  // 删掉一部分行，扫描要跳过它们
+  auto deleted = [](int i) { return i % 10 == 5; };
+  for (int i = 0; i < n; i++) {
+    if (deleted(i)) {
+      table_info->GetTableHeap()->ApplyDelete(rids[i], nullptr);
+    }
+  }
+  auto scan = [table_info](Predicate predicate, std::vector<int> *ids) {
+    SeqScanExecutor seq_scan(table_info, std::move(predicate));
+    std::vector<Row> batch;
+    batch.reserve(EXECUTOR_BATCH_SIZE);
+    size_t before = allocations;
+    seq_scan.Init();
+    while (seq_scan.Next(&batch)) {
+      EXPECT_LE(batch.size(), EXECUTOR_BATCH_SIZE);
+      // 插入时会填前面页的空隙，存储顺序不一定是插入顺序
+      for (auto &row : batch) {
+        ids->push_back(row.GetField(0)->GetInt());
+      }
+    }
+    return allocations - before;
+  };
+  // 空谓词产生所有行
+  std::vector<int> ids;
+  ids.reserve(n);
+  scan(Predicate(), &ids);
+  std::vector<int> expected;
+  for (int i = 0; i < n; i++) {
+    if (!deleted(i)) {
+      expected.push_back(i);
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+  ASSERT_EQ(expected, ids);
+  // name <> "user42" or account >= 99，null的name不满足第一个条件
+  Predicate predicate;
+  predicate.AddClause();
+  predicate.AddComparison(1, TypeId::kTypeChar, "<>", "user42");
+  predicate.AddClause();
+  predicate.AddComparison(2, TypeId::kTypeFloat, ">=", "99");
+  ids.clear();
+  scan(predicate, &ids);
+  std::sort(ids.begin(), ids.end());
+  expected.clear();
+  for (int i = 0; i < n; i++) {
+    if (!deleted(i) && ((i % 7 != 0 && i != 42) || i % 100 == 99)) {
+      expected.push_back(i);
+    }
+  }
+  ASSERT_EQ(expected, ids);
+  // 没有一行满足条件时行上不分配内存，剩下的只有每页pin/unpin时replacer的节点和预读，和行数无关
+  Predicate none;
+  none.AddClause();
+  none.AddComparison(0, TypeId::kTypeInt, "<", "0");
+  ids.clear();
+  size_t none_allocations = scan(none, &ids);
+  ASSERT_TRUE(ids.empty());
+  ASSERT_LE(none_allocations, 4 * table_info->GetTableHeap()->GetPageCount());
+  std::cout << "Scanned " << n << " rows in " << table_info->GetTableHeap()->GetPageCount() << " pages with "
+            << none_allocations << " allocations" << std::endl;
+  delete engine;
+  remove(db_file_name.c_str());
+  remove(log_file_name.c_str());
+}
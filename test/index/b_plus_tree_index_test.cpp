@@ -1,9 +1,11 @@
+#include <chrono>
 #include <string>
 
 #include "common/instance.h"
 #include "gtest/gtest.h"
 #include "index/b_plus_tree_index.h"
 #include "index/generic_key.h"
+#include "utils/utils.h"
 
 static const std::string db_name = "bp_tree_index_test.db";
 
@@ -78,4 +80,307 @@ TEST(BPlusTreeTests, BPlusTreeIndexSimpleTest) {
     ASSERT_EQ(i, (*iter).second.GetSlotNum());
     i++;
   }
-}
\ No newline at end of file
+}
+TEST(BPlusTreeTests, GenericKeyOrderTest) {
+  using INDEX_KEY_TYPE = GenericKey<32>;
+  using INDEX_COMPARATOR_TYPE = GenericComparator<32>;
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {
+          ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false),
+          ALLOC_COLUMN(heap)("account", TypeId::kTypeFloat, 1, true, false),
+          ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 8, 2, true, false)
+  };
+  const TableSchema table_schema(columns);
+  INDEX_COMPARATOR_TYPE comparator(const_cast<TableSchema *>(&table_schema));
+  auto sign = [](int x) { return (x > 0) - (x < 0); };
+  // 每一列单独比较时，编码后的顺序必须与Field的比较结果一致
+  for (int round = 0; round < 2000; round++) {
+    std::vector<Field> fields[2];
+    char names[2][9];
+    for (int i = 0; i < 2; i++) {
+      int len = RandomUtils::RandomInt(0, 8);
+      for (int j = 0; j < len; j++) {
+        names[i][j] = static_cast<char>('a' + RandomUtils::RandomInt(0, 3));
+      }
+      names[i][len] = '\0';
+      fields[i].emplace_back(TypeId::kTypeInt, RandomUtils::RandomInt(-5, 5) * 100000);
+      fields[i].emplace_back(TypeId::kTypeFloat, RandomUtils::RandomInt(-3, 3) * 1.5f);
+      fields[i].emplace_back(TypeId::kTypeChar, names[i], len, true);
+    }
+    int expected = 0;
+    for (int col = 0; col < 3 && expected == 0; col++) {
+      if (fields[0][col].CompareLessThan(fields[1][col]) == CmpBool::kTrue) {
+        expected = -1;
+      } else if (fields[0][col].CompareGreaterThan(fields[1][col]) == CmpBool::kTrue) {
+        expected = 1;
+      }
+    }
+    Row r0(fields[0]), r1(fields[1]);
+    INDEX_KEY_TYPE k0, k1;
+    k0.SerializeFromKey(r0, const_cast<TableSchema *>(&table_schema));
+    k1.SerializeFromKey(r1, const_cast<TableSchema *>(&table_schema));
+    ASSERT_EQ(expected, sign(comparator(k0, k1)));
+    // 反序列化后应还原出相同的字段
+    Row decoded(INVALID_ROWID);
+    k0.DeserializeToKey(decoded, const_cast<TableSchema *>(&table_schema));
+    ASSERT_EQ(3u, decoded.GetFieldCount());
+    for (int col = 0; col < 3; col++) {
+      ASSERT_EQ(CmpBool::kTrue, decoded.GetField(col)->CompareEquals(fields[0][col]));
+    }
+  }
+  // null排在所有非null值之前
+  std::vector<Field> null_fields{Field(TypeId::kTypeInt), Field(TypeId::kTypeFloat), Field(TypeId::kTypeChar)};
+  std::vector<Field> min_fields{Field(TypeId::kTypeInt, INT32_MIN), Field(TypeId::kTypeFloat, -1e30f),
+                                Field(TypeId::kTypeChar, const_cast<char *>(""), 0, false)};
+  Row null_row(null_fields), min_row(min_fields);
+  INDEX_KEY_TYPE null_key, min_key;
+  null_key.SerializeFromKey(null_row, const_cast<TableSchema *>(&table_schema));
+  min_key.SerializeFromKey(min_row, const_cast<TableSchema *>(&table_schema));
+  ASSERT_LT(comparator(null_key, min_key), 0);
+}
+
+TEST(BPlusTreeTests, GenericKeyLookupBenchmark) {
+  using INDEX_KEY_TYPE = GenericKey<32>;
+  using INDEX_COMPARATOR_TYPE = GenericComparator<32>;
+  using BP_TREE_INDEX = BPlusTreeIndex<INDEX_KEY_TYPE, RowId, INDEX_COMPARATOR_TYPE>;
+  DBStorageEngine engine(db_name);
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {
+          ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false),
+          ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 8, 1, true, false)
+  };
+  std::vector<uint32_t> index_key_map{0, 1};
+  const TableSchema table_schema(columns);
+  auto *index_schema = Schema::ShallowCopySchema(&table_schema, index_key_map, &heap);
+  auto *index = ALLOC(heap, BP_TREE_INDEX)(0, index_schema, engine.bpm_);
+  const int n = 10000;
+  std::vector<int> keys;
+  for (int i = 0; i < n; i++) {
+    keys.push_back(i);
+  }
+  ShuffleArray(keys);
+  for (int i = 0; i < n; i++) {
+    std::vector<Field> fields{
+            Field(TypeId::kTypeInt, keys[i]),
+            Field(TypeId::kTypeChar, const_cast<char *>("minisql"), 7, true)
+    };
+    Row row(fields);
+    ASSERT_EQ(DB_SUCCESS, index->InsertEntry(row, RowId(keys[i], 0), nullptr));
+  }
+  std::vector<RowId> ret;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++) {
+    std::vector<Field> fields{
+            Field(TypeId::kTypeInt, keys[i]),
+            Field(TypeId::kTypeChar, const_cast<char *>("minisql"), 7, true)
+    };
+    Row row(fields);
+    ret.clear();
+    ASSERT_EQ(DB_SUCCESS, index->ScanKey(row, ret, nullptr, "="));
+    ASSERT_EQ(1u, ret.size());
+    ASSERT_EQ(keys[i], ret[0].GetPageId());
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "GenericKey point lookups: " << n << " in " << seconds << "s, "
+            << static_cast<int64_t>(n / seconds) << " lookups/sec" << std::endl;
+}
+
+TEST(BPlusTreeTests, BPlusTreeIndexRangeScanTest) {
+  using INDEX_KEY_TYPE = GenericKey<8>;
+  using INDEX_COMPARATOR_TYPE = GenericComparator<8>;
+  using BP_TREE_INDEX = BPlusTreeIndex<INDEX_KEY_TYPE, RowId, INDEX_COMPARATOR_TYPE>;
+  DBStorageEngine engine(db_name);
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {
+          ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false)
+  };
+  std::vector<uint32_t> index_key_map{0};
+  const TableSchema table_schema(columns);
+  auto *index_schema = Schema::ShallowCopySchema(&table_schema, index_key_map, &heap);
+  auto *index = ALLOC(heap, BP_TREE_INDEX)(0, index_schema, engine.bpm_);
+  auto key = [](int id) {
+    std::vector<Field> fields{Field(TypeId::kTypeInt, id)};
+    return Row(fields);
+  };
+  // 偶数key，跨越很多片叶子
+  const int n = 5000;
+  std::vector<int> keys;
+  for (int i = 0; i < n; i++) {
+    keys.push_back(i * 2);
+  }
+  ShuffleArray(keys);
+  for (int k : keys) {
+    ASSERT_EQ(DB_SUCCESS, index->InsertEntry(key(k), RowId(k, 0), nullptr));
+  }
+  ASSERT_TRUE(engine.bpm_->CheckAllUnpinned());
+  // 和暴力过滤的结果比较，结果按key有序
+  auto check = [&](const int *lower, bool lower_inclusive, const int *upper, bool upper_inclusive) {
+    std::vector<int> expected;
+    for (int k = 0; k < n * 2; k += 2) {
+      if ((lower == nullptr || k > *lower || (lower_inclusive && k == *lower)) &&
+          (upper == nullptr || k < *upper || (upper_inclusive && k == *upper))) {
+        expected.push_back(k);
+      }
+    }
+    Row lower_key = key(lower != nullptr ? *lower : 0);
+    Row upper_key = key(upper != nullptr ? *upper : 0);
+    std::vector<RowId> result;
+    ASSERT_EQ(DB_SUCCESS, index->ScanRange(lower != nullptr ? &lower_key : nullptr, lower_inclusive,
+                                           upper != nullptr ? &upper_key : nullptr, upper_inclusive, result, nullptr));
+    std::vector<int> actual;
+    for (auto &rid : result) {
+      actual.push_back(rid.GetPageId());
+    }
+    ASSERT_EQ(expected, actual);
+  };
+  const int bounds[] = {-5, 0, 1, 2, 777, 778, 4000, 9997, 9998, 20000};
+  for (auto &lower : bounds) {
+    for (auto &upper : bounds) {
+      for (int inclusive = 0; inclusive < 4; inclusive++) {
+        check(&lower, inclusive & 1, &upper, inclusive & 2);
+      }
+    }
+    check(&lower, true, nullptr, false);
+    check(&lower, false, nullptr, false);
+    check(nullptr, false, &lower, true);
+    check(nullptr, false, &lower, false);
+  }
+  check(nullptr, false, nullptr, false);
+  // ScanKey的范围条件也走ScanRange
+  std::vector<RowId> result;
+  ASSERT_EQ(DB_SUCCESS, index->ScanKey(key(100), result, nullptr, "<"));
+  ASSERT_EQ(50u, result.size());
+  result.clear();
+  ASSERT_EQ(DB_SUCCESS, index->ScanKey(key(100), result, nullptr, ">"));
+  ASSERT_EQ(static_cast<size_t>(n - 51), result.size());
+  ASSERT_TRUE(engine.bpm_->CheckAllUnpinned());
+}
+
+TEST(BPlusTreeTests, BPlusTreeIndexBulkLoadTest) {
+  using INDEX_KEY_TYPE = GenericKey<8>;
+  using INDEX_COMPARATOR_TYPE = GenericComparator<8>;
+  using BP_TREE_INDEX = BPlusTreeIndex<INDEX_KEY_TYPE, RowId, INDEX_COMPARATOR_TYPE>;
+  DBStorageEngine engine(db_name);
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {
+          ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false)
+  };
+  std::vector<uint32_t> index_key_map{0};
+  const TableSchema table_schema(columns);
+  auto *index_schema = Schema::ShallowCopySchema(&table_schema, index_key_map, &heap);
+  // 乱序的key，每个key出现两次，先出现的那个row id应该被保留
+  const int n = 20000;
+  std::vector<int> keys;
+  for (int i = 0; i < 2 * n; i++) {
+    keys.push_back(i % n);
+  }
+  ShuffleArray(keys);
+  std::vector<int> first_seen(n, -1);
+  for (int i = 0; i < 2 * n; i++) {
+    if (first_seen[keys[i]] < 0) {
+      first_seen[keys[i]] = i;
+    }
+  }
+  // 第一个索引全在内存里排序，第二个每段只有1000个条目，需要外部归并
+  for (size_t sort_memory : {INDEX_SORT_MEMORY, 1000 * (sizeof(INDEX_KEY_TYPE) + sizeof(RowId))}) {
+    auto *index = ALLOC(heap, BP_TREE_INDEX)(sort_memory == INDEX_SORT_MEMORY ? 0 : 1, index_schema, engine.bpm_);
+    index->SetSortMemory(sort_memory);
+    int i = 0;
+    std::vector<RowId> duplicates;
+    ASSERT_EQ(DB_SUCCESS, index->BulkLoad([&](std::vector<Field> *key, RowId *row_id) {
+      if (i == 2 * n) {
+        return false;
+      }
+      key->emplace_back(TypeId::kTypeInt, keys[i]);
+      *row_id = RowId(keys[i], i);
+      i++;
+      return true;
+    }, INDEX_FILL_FACTOR, &duplicates));
+    ASSERT_TRUE(engine.bpm_->CheckAllUnpinned());
+    ASSERT_EQ(static_cast<size_t>(n), duplicates.size());
+    for (auto &rid : duplicates) {
+      ASSERT_NE(first_seen[rid.GetPageId()], static_cast<int>(rid.GetSlotNum()));
+    }
+    std::vector<RowId> result;
+    ASSERT_EQ(DB_SUCCESS, index->ScanRange(nullptr, false, nullptr, false, result, nullptr));
+    ASSERT_EQ(static_cast<size_t>(n), result.size());
+    for (int k = 0; k < n; k++) {
+      ASSERT_EQ(RowId(k, first_seen[k]), result[k]);
+    }
+    // 再加入一半已有、一半新的key，已有的key被丢掉
+    duplicates.clear();
+    i = n / 2;
+    ASSERT_EQ(DB_SUCCESS, index->BulkLoad([&](std::vector<Field> *key, RowId *row_id) {
+      if (i == n + n / 2) {
+        return false;
+      }
+      key->emplace_back(TypeId::kTypeInt, i);
+      *row_id = RowId(i, 0);
+      i++;
+      return true;
+    }, INDEX_FILL_FACTOR, &duplicates));
+    ASSERT_TRUE(engine.bpm_->CheckAllUnpinned());
+    ASSERT_EQ(static_cast<size_t>(n / 2), duplicates.size());
+    result.clear();
+    ASSERT_EQ(DB_SUCCESS, index->ScanRange(nullptr, false, nullptr, false, result, nullptr));
+    ASSERT_EQ(static_cast<size_t>(n + n / 2), result.size());
+    for (int k = 0; k < n + n / 2; k++) {
+      ASSERT_EQ(RowId(k, k < n ? first_seen[k] : 0), result[k]);
+    }
+  }
+}
+
+TEST(BPlusTreeTests, BulkLoadBenchmark) {
+  using INDEX_KEY_TYPE = GenericKey<8>;
+  using INDEX_COMPARATOR_TYPE = GenericComparator<8>;
+  using BP_TREE_INDEX = BPlusTreeIndex<INDEX_KEY_TYPE, RowId, INDEX_COMPARATOR_TYPE>;
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {
+          ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false)
+  };
+  std::vector<uint32_t> index_key_map{0};
+  const TableSchema table_schema(columns);
+  auto *index_schema = Schema::ShallowCopySchema(&table_schema, index_key_map, &heap);
+  const int n = 200000;
+  std::vector<int> keys;
+  for (int i = 0; i < n; i++) {
+    keys.push_back(i);
+  }
+  ShuffleArray(keys);
+  // 分别逐条插入和bulk load同样的乱序key，比较耗时和建好之后用了多少页（新库里下一个分配的页号）
+  double seconds[2];
+  page_id_t pages[2];
+  for (int bulk = 0; bulk < 2; bulk++) {
+    DBStorageEngine engine(db_name);
+    auto *index = ALLOC(heap, BP_TREE_INDEX)(0, index_schema, engine.bpm_);
+    auto start = std::chrono::steady_clock::now();
+    if (bulk) {
+      int i = 0;
+      ASSERT_EQ(DB_SUCCESS, index->BulkLoad([&](std::vector<Field> *key, RowId *row_id) {
+        if (i == n) {
+          return false;
+        }
+        key->emplace_back(TypeId::kTypeInt, keys[i]);
+        *row_id = RowId(keys[i], 0);
+        i++;
+        return true;
+      }, INDEX_FILL_FACTOR, nullptr));
+    } else {
+      for (int k : keys) {
+        std::vector<Field> fields{Field(TypeId::kTypeInt, k)};
+        Row key(fields);
+        ASSERT_EQ(DB_SUCCESS, index->InsertEntry(key, RowId(k, 0), nullptr));
+      }
+    }
+    seconds[bulk] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    engine.bpm_->NewPage(pages[bulk]);
+    engine.bpm_->UnpinPage(pages[bulk], false);
+    std::vector<RowId> result;
+    ASSERT_EQ(DB_SUCCESS, index->ScanRange(nullptr, false, nullptr, false, result, nullptr));
+    ASSERT_EQ(static_cast<size_t>(n), result.size());
+  }
+  std::cout << "Index build of " << n << " keys: insert " << seconds[0] << "s / " << pages[0] << " pages, bulk load "
+            << seconds[1] << "s / " << pages[1] << " pages" << std::endl;
+  ASSERT_LT(seconds[1], seconds[0]);
+  ASSERT_LT(pages[1], pages[0]);
+}
@@ -1,3 +1,9 @@
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <random>
+#include <thread>
+
 #include "index/b_plus_tree.h"
 #include "common/instance.h"
 #include "gtest/gtest.h"
@@ -63,4 +69,177 @@ TEST(BPlusTreeTests, SampleTest) {
     ASSERT_TRUE(tree.GetValue(delete_seq[i], ans));
     ASSERT_EQ(kv_map[delete_seq[i]], ans[ans.size() - 1]);
   }
-}
\ No newline at end of file
+}
+
+TEST(BPlusTreeTests, ConcurrentTest) {
+  DBStorageEngine engine("bp_tree_concurrent_test.db");
+  BasicComparator<int> comparator;
+  // 节点很小，分裂、合并和借节点都会频繁发生
+  BPlusTree<int, int, BasicComparator<int>> tree(0, engine.bpm_, comparator, 6, 6);
+  const int thread_nums = 4;
+  const int n = 2000;  // keys of each thread
+  // 线程t负责 key % thread_nums == t 的key，最后树里的内容是确定的
+  auto key_of = [&](int t, int i) { return i * thread_nums + t; };
+  std::atomic<int> errors{0};
+  auto run = [&](const std::function<void(int)> &work) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_nums; t++) {
+      threads.emplace_back(work, t);
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  };
+
+  // 并发插入，插入的同时查找自己已经插入的key
+  run([&](int t) {
+    std::mt19937 random(t);
+    std::vector<int> seq;
+    for (int i = 0; i < n; i++) {
+      seq.push_back(i);
+    }
+    std::shuffle(seq.begin(), seq.end(), random);
+    for (int j = 0; j < n; j++) {
+      int key = key_of(t, seq[j]);
+      if (!tree.Insert(key, key * 10)) {
+        errors++;
+      }
+      std::vector<int> result;
+      int inserted = key_of(t, seq[random() % (j + 1)]);
+      if (!tree.GetValue(inserted, result) || result[0] != inserted * 10) {
+        errors++;
+      }
+    }
+  });
+  ASSERT_EQ(0, errors);
+  ASSERT_TRUE(tree.Check());
+
+  // 并发删除一半，同时插入新key、重复插入旧key，并查找不会被删除的key和别的线程的key
+  run([&](int t) {
+    std::mt19937 random(t + thread_nums);
+    std::vector<int> seq;
+    for (int i = 1; i < n; i += 2) {
+      seq.push_back(i);
+    }
+    std::shuffle(seq.begin(), seq.end(), random);
+    for (int i : seq) {
+      tree.Remove(key_of(t, i));
+      if (!tree.Insert(key_of(t, n + i), i)) {
+        errors++;
+      }
+      if (tree.Insert(key_of(t, i - 1), 0)) {
+        errors++;
+      }
+      std::vector<int> result;
+      int stable = key_of(t, 2 * (random() % (n / 2)));
+      if (!tree.GetValue(stable, result) || result[0] != stable * 10) {
+        errors++;
+      }
+      tree.GetValue(random() % (n * thread_nums), result);
+    }
+  });
+  ASSERT_EQ(0, errors);
+
+  for (int t = 0; t < thread_nums; t++) {
+    for (int i = 0; i < n; i++) {
+      std::vector<int> result;
+      int key = key_of(t, i);
+      if (i % 2 == 0) {
+        ASSERT_TRUE(tree.GetValue(key, result));
+        ASSERT_EQ(key * 10, result[0]);
+      } else {
+        ASSERT_FALSE(tree.GetValue(key, result));
+        ASSERT_TRUE(tree.GetValue(key_of(t, n + i), result));
+        ASSERT_EQ(i, result[0]);
+      }
+    }
+  }
+  ASSERT_TRUE(tree.Check());
+
+  // 并发删掉所有key，树最后应该是空的
+  run([&](int t) {
+    for (int i = 0; i < 2 * n; i++) {
+      tree.Remove(key_of(t, i));
+    }
+  });
+  ASSERT_TRUE(tree.IsEmpty());
+  ASSERT_TRUE(tree.Check());
+}
+
+TEST(BPlusTreeTests, BulkLoadTest) {
+  DBStorageEngine engine("bp_tree_bulk_load_test.db");
+  BasicComparator<int> comparator;
+  // 各种条目数和填充率下建出来的树都要合法：能查到所有key，之后还能正常插入和删除
+  index_id_t index_id = 0;
+  for (int n : {0, 1, 4, 5, 17, 100, 1000}) {
+    for (double fill_factor : {0.5, 0.75, 1.0}) {
+      BPlusTree<int, int, BasicComparator<int>> tree(index_id++, engine.bpm_, comparator, 4, 5);
+      int i = 0;
+      ASSERT_TRUE(tree.BulkLoad(n, [&](int *key, int *value) {
+        *key = i * 2;
+        *value = i * 20;
+        i++;
+      }, fill_factor));
+      ASSERT_EQ(n, i);
+      ASSERT_EQ(n == 0, tree.IsEmpty());
+      ASSERT_TRUE(tree.Check());
+      std::vector<int> result;
+      tree.ScanRange(nullptr, false, nullptr, false, result);
+      ASSERT_EQ(static_cast<size_t>(n), result.size());
+      for (int k = 0; k < n; k++) {
+        ASSERT_EQ(k * 20, result[k]);
+      }
+      // 非空的树不能再bulk load
+      ASSERT_EQ(n == 0, tree.BulkLoad(0, [](int *, int *) {}, fill_factor));
+      for (int k = 0; k < n; k++) {
+        ASSERT_TRUE(tree.Insert(k * 2 + 1, k));
+        ASSERT_FALSE(tree.Insert(k * 2, k));
+      }
+      for (int k = 0; k < 2 * n; k++) {
+        tree.Remove(k);
+        result.clear();
+        ASSERT_FALSE(tree.GetValue(k, result));
+        if (k + 1 < 2 * n) {
+          ASSERT_TRUE(tree.GetValue(k + 1, result));
+        }
+      }
+      ASSERT_TRUE(tree.IsEmpty());
+      ASSERT_TRUE(tree.Check());
+    }
+  }
+}
+
+TEST(BPlusTreeTests, ScanRangeFetchFailTest) {
+  DBStorageEngine engine("bp_tree_scan_fail_test.db", true, MIN_BUFFER_POOL_SIZE);
+  BasicComparator<int> comparator;
+  BPlusTree<int, int, BasicComparator<int>> tree(0, engine.bpm_, comparator, 4, 64);
+  const int n = 20;
+  for (int i = 0; i < n; i++) {
+    ASSERT_TRUE(tree.Insert(i, i * 10));
+  }
+  // 第一片叶子和根一直被pin着，其余的帧全被新页占住，走到第二片叶子时拿不到帧
+  Page *leaf = tree.FindLeafPage(0, true);
+  ASSERT_NE(nullptr, leaf);
+  page_id_t root_page_id = reinterpret_cast<BPlusTreePage *>(leaf->GetData())->GetParentPageId();
+  ASSERT_NE(nullptr, engine.bpm_->FetchPage(root_page_id));
+  std::vector<page_id_t> pinned;
+  page_id_t page_id;
+  while (engine.bpm_->NewPage(page_id) != nullptr) {
+    pinned.push_back(page_id);
+  }
+  std::vector<int> result;
+  ASSERT_FALSE(tree.ScanRange(nullptr, false, nullptr, false, result));
+  ASSERT_FALSE(result.empty());
+  ASSERT_LT(result.size(), static_cast<size_t>(n));
+  for (auto id : pinned) {
+    ASSERT_TRUE(engine.bpm_->UnpinPage(id, false));
+    ASSERT_TRUE(engine.bpm_->DeletePage(id));
+  }
+  ASSERT_TRUE(engine.bpm_->UnpinPage(root_page_id, false));
+  ASSERT_TRUE(engine.bpm_->UnpinPage(leaf->GetPageId(), false));
+  // 失败时叶子的pin和latch都已经放掉，之后的扫描正常
+  ASSERT_TRUE(tree.Check());
+  result.clear();
+  ASSERT_TRUE(tree.ScanRange(nullptr, false, nullptr, false, result));
+  ASSERT_EQ(static_cast<size_t>(n), result.size());
+}
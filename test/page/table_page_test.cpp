@@ -0,0 +1,146 @@
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "common/instance.h"
+#include "gtest/gtest.h"
+#include "page/table_page.h"
+#include "record/schema.h"
+
+class TablePageTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    std::vector<Column *> columns = {ALLOC_COLUMN(heap_)("id", TypeId::kTypeInt, 0, false, false),
+                                     ALLOC_COLUMN(heap_)("name", TypeId::kTypeChar, 100, 1, true, false)};
+    schema_ = std::make_shared<Schema>(columns);
+    page_.Init(0, INVALID_PAGE_ID, nullptr, nullptr);
+  }
+
+  // 名字定长，所有tuple一样大
+  static std::string Name(int id) {
+    std::string digits = std::to_string(id);
+    return "row_" + std::string(6 - digits.size(), '0') + digits;
+  }
+
+  bool Insert(int id, const std::string &name, RowId *rid) {
+    std::vector<Field> fields = {Field(TypeId::kTypeInt, id),
+                                 Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), false)};
+    Row row(fields);
+    if (!page_.InsertTuple(row, schema_.get(), nullptr, nullptr, nullptr)) {
+      return false;
+    }
+    *rid = row.GetRowId();
+    return true;
+  }
+
+  void Delete(const RowId &rid) {
+    ASSERT_TRUE(page_.MarkDelete(rid, nullptr, nullptr, nullptr));
+    page_.ApplyDelete(rid, nullptr, nullptr);
+  }
+
+  void CheckRows(const std::map<uint32_t, int> &expected) {
+    uint32_t count = 0;
+    RowId rid;
+    for (bool found = page_.GetFirstTupleRid(&rid); found; found = page_.GetNextTupleRid(rid, &rid)) {
+      ASSERT_EQ(1, expected.count(rid.GetSlotNum()));
+      Row row(rid);
+      ASSERT_TRUE(page_.GetTuple(&row, schema_.get(), nullptr, nullptr));
+      int id = expected.at(rid.GetSlotNum());
+      ASSERT_EQ(CmpBool::kTrue, row.GetField(0)->CompareEquals(Field(TypeId::kTypeInt, id)));
+      std::string name = Name(id);
+      ASSERT_EQ(CmpBool::kTrue, row.GetField(1)->CompareEquals(
+                                    Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), false)));
+      count++;
+    }
+    ASSERT_EQ(expected.size(), count);
+  }
+
+  SimpleMemHeap heap_;
+  std::shared_ptr<Schema> schema_;
+  TablePage page_;
+};
+
+TEST_F(TablePageTest, SlotReuseTest) {
+  std::map<uint32_t, int> rows;
+  RowId rid;
+  int id = 0;
+  while (Insert(id, Name(id), &rid)) {
+    ASSERT_EQ(static_cast<uint32_t>(id), rid.GetSlotNum());
+    rows[rid.GetSlotNum()] = id++;
+  }
+  uint32_t slot_count = rows.size();
+  ASSERT_GT(slot_count, 100);
+  // 被删掉的slot按后进先出的顺序重新使用
+  std::vector<uint32_t> deleted = {7, 3, 42, 0, 99};
+  for (auto slot : deleted) {
+    Delete(RowId(0, slot));
+    rows.erase(slot);
+  }
+  CheckRows(rows);
+  for (auto it = deleted.rbegin(); it != deleted.rend(); ++it) {
+    ASSERT_TRUE(Insert(id, Name(id), &rid));
+    ASSERT_EQ(*it, rid.GetSlotNum());
+    rows[rid.GetSlotNum()] = id++;
+  }
+  ASSERT_FALSE(Insert(id, Name(id), &rid));
+  ASSERT_EQ(slot_count, rows.size());
+  CheckRows(rows);
+}
+
+TEST_F(TablePageTest, CompactionTest) {
+  std::map<uint32_t, int> rows;
+  RowId rid;
+  int id = 0;
+  while (Insert(id, Name(id), &rid)) {
+    rows[rid.GetSlotNum()] = id++;
+  }
+  uint32_t full_count = rows.size();
+  // 反复删掉一半再插满，空洞不合并的话页会越来越空。奇数轮由插入时按需整理
+  for (int round = 0; round < 20; round++) {
+    for (uint32_t slot = round % 2; slot < full_count; slot += 2) {
+      if (rows.count(slot) != 0) {
+        Delete(RowId(0, slot));
+        rows.erase(slot);
+      }
+    }
+    if (round % 2 == 0) {
+      uint32_t free_space = page_.GetFreeSpaceRemaining();
+      page_.Compact();
+      ASSERT_EQ(free_space, page_.GetFreeSpaceRemaining());
+      CheckRows(rows);
+    }
+    while (Insert(id, Name(id), &rid)) {
+      ASSERT_LT(rid.GetSlotNum(), full_count + 1);
+      rows[rid.GetSlotNum()] = id++;
+    }
+    ASSERT_EQ(full_count, rows.size());
+    CheckRows(rows);
+  }
+}
+
+TEST_F(TablePageTest, RestoreTupleTest) {
+  std::map<uint32_t, int> rows;
+  RowId rid;
+  int id = 0;
+  while (Insert(id, Name(id), &rid)) {
+    rows[rid.GetSlotNum()] = id++;
+  }
+  // 删掉几个tuple之后按相反的顺序放回原来的slot，中间的空洞需要整理才能放下
+  std::vector<std::pair<uint32_t, std::string>> deleted;
+  for (uint32_t slot : {5, 20, 1, 33}) {
+    Row row(RowId(0, slot));
+    ASSERT_TRUE(page_.GetTuple(&row, schema_.get(), nullptr, nullptr));
+    std::string tuple(row.GetSerializedSize(schema_.get()), '\0');
+    row.SerializeTo(&tuple[0], schema_.get());
+    deleted.emplace_back(slot, tuple);
+    Delete(RowId(0, slot));
+  }
+  ASSERT_FALSE(page_.RestoreTuple(RowId(0, 0), deleted[0].second.data(), deleted[0].second.size()));
+  for (auto it = deleted.rbegin(); it != deleted.rend(); ++it) {
+    RowId slot_rid(0, it->first);
+    ASSERT_TRUE(page_.RestoreTuple(slot_rid, it->second.data(), it->second.size()));
+    ASSERT_TRUE(page_.HasTuple(slot_rid, it->second.data(), it->second.size()));
+  }
+  CheckRows(rows);
+  ASSERT_FALSE(Insert(id, Name(id), &rid));
+}
@@ -5,6 +5,7 @@
 #include "page/table_page.h"
 #include "record/field.h"
 #include "record/row.h"
+#include "record/row_view.h"
 #include "record/schema.h"
 
 char *chars[] = {
@@ -142,4 +143,66 @@ TEST(TupleTest, RowTest) {
     ASSERT_EQ(schema->GetColumn(i)->IsNullable(), sch->GetColumn(i)->IsNullable());
     ASSERT_EQ(schema->GetColumn(i)->GetTableInd(), sch->GetColumn(i)->GetTableInd());
   }
-}
\ No newline at end of file
+}
+
+TEST(TupleTest, RowViewTest) {
+  SimpleMemHeap heap;
+  TablePage table_page;
+  // 10列，null bitmap占两个字节
+  std::vector<Column *> columns;
+  std::vector<Field> fields;
+  for (uint32_t i = 0; i < 10; i++) {
+    std::string name = "c" + std::to_string(i);
+    bool is_null = i == 2 || i == 7 || i == 9;
+    if (i % 3 == 0) {
+      columns.push_back(ALLOC_COLUMN(heap)(name, TypeId::kTypeInt, i, true, false));
+      fields.emplace_back(TypeId::kTypeInt, static_cast<int32_t>(i * 100) - 500);
+    } else if (i % 3 == 1) {
+      columns.push_back(ALLOC_COLUMN(heap)(name, TypeId::kTypeChar, 16, i, true, false));
+      fields.emplace_back(TypeId::kTypeChar, chars[i % 4], strlen(chars[i % 4]), false);
+    } else {
+      columns.push_back(ALLOC_COLUMN(heap)(name, TypeId::kTypeFloat, i, true, false));
+      fields.emplace_back(TypeId::kTypeFloat, i * 1.5f);
+    }
+    if (is_null) {
+      fields.pop_back();
+      fields.emplace_back(columns[i]->GetType());
+    }
+  }
+  auto schema = std::make_shared<Schema>(columns);
+  Row row(fields);
+  table_page.Init(0, INVALID_PAGE_ID, nullptr, nullptr);
+  ASSERT_TRUE(table_page.InsertTuple(row, schema.get(), nullptr, nullptr, nullptr));
+  RowView view;
+  ASSERT_TRUE(table_page.GetTupleView(row.GetRowId().GetSlotNum(), schema.get(), &view));
+  ASSERT_EQ(row.GetRowId(), view.GetRowId());
+  ASSERT_EQ(10u, view.GetFieldCount());
+  ASSERT_EQ(row.GetSerializedSize(schema.get()), view.GetSerializedSize());
+  for (uint32_t i = 0; i < 10; i++) {
+    ASSERT_EQ(fields[i].IsNull(), view.IsNull(i));
+    Field field = view.GetField(i);
+    if (fields[i].IsNull()) {
+      ASSERT_TRUE(field.IsNull());
+    } else {
+      ASSERT_EQ(CmpBool::kTrue, field.CompareEquals(fields[i]));
+    }
+  }
+  // char field直接指向页内的数据
+  const char *page_begin = table_page.GetData();
+  ASSERT_GE(view.GetField(1).GetChars(), page_begin);
+  ASSERT_LT(view.GetField(1).GetChars(), page_begin + PAGE_SIZE);
+  Row materialized(INVALID_ROWID);
+  view.Materialize(&materialized);
+  ASSERT_EQ(row.GetRowId(), materialized.GetRowId());
+  ASSERT_EQ(10u, materialized.GetFieldCount());
+  for (uint32_t i = 0; i < 10; i++) {
+    ASSERT_EQ(fields[i].IsNull(), materialized.GetField(i)->IsNull());
+    if (!fields[i].IsNull()) {
+      ASSERT_EQ(CmpBool::kTrue, materialized.GetField(i)->CompareEquals(fields[i]));
+    }
+  }
+  // 删除的tuple没有view
+  ASSERT_TRUE(table_page.MarkDelete(row.GetRowId(), nullptr, nullptr, nullptr));
+  ASSERT_FALSE(table_page.GetTupleView(row.GetRowId().GetSlotNum(), schema.get(), &view));
+  ASSERT_FALSE(table_page.GetTupleView(1, schema.get(), &view));
+}
@@ -0,0 +1,322 @@
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "common/instance.h"
+#include "gtest/gtest.h"
+#include "record/field.h"
+#include "record/schema.h"
+#include "storage/table_heap.h"
+
+static const std::string db_file_name = "recovery_test.db";
+static const std::string log_file_name = "recovery_test.log";
+static const std::string crash_db_file_name = "recovery_crash_test.db";
+static const std::string crash_log_file_name = "recovery_crash_test.log";
+
+/**
+ * 不关闭engine，直接复制db文件和日志，相当于在这一刻崩溃
+ */
+static void CopyAsCrashed() {
+  std::filesystem::copy_file(db_file_name, crash_db_file_name, std::filesystem::copy_options::overwrite_existing);
+  std::filesystem::copy_file(log_file_name, crash_log_file_name, std::filesystem::copy_options::overwrite_existing);
+}
+
+static void RemoveFiles() {
+  remove(db_file_name.c_str());
+  remove(log_file_name.c_str());
+  remove(crash_db_file_name.c_str());
+  remove(crash_log_file_name.c_str());
+}
+
+/**
+ * catalog直接引用建表时传入的schema，所以schema要和engine活得一样久
+ */
+static SimpleMemHeap schema_heap;
+
+static void CreateAccountTable(DBStorageEngine *engine) {
+  SimpleMemHeap &heap = schema_heap;
+  std::vector<Column *> columns = {
+      ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, true),
+      ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 16, 1, true, false),
+      ALLOC_COLUMN(heap)("account", TypeId::kTypeFloat, 2, true, false)
+  };
+  auto schema = ALLOC(heap, Schema)(columns);
+  TableInfo *table_info = nullptr;
+  IndexInfo *index_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, engine->catalog_mgr_->CreateTable("account", schema, nullptr, table_info));
+  ASSERT_EQ(DB_SUCCESS, engine->catalog_mgr_->CreateIndex("account", "account_id", {"id"}, nullptr, index_info));
+}
+
+/**
+ * 和executor一样，先写table heap再写索引
+ */
+static RowId InsertAccount(DBStorageEngine *engine, int id, float account, Transaction *txn) {
+  TableInfo *table_info = nullptr;
+  IndexInfo *index_info = nullptr;
+  engine->catalog_mgr_->GetTable("account", table_info);
+  engine->catalog_mgr_->GetIndex("account", "account_id", index_info);
+  std::string name = "user" + std::to_string(id);
+  std::vector<Field> fields{Field(TypeId::kTypeInt, id),
+                            Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true),
+                            Field(TypeId::kTypeFloat, account)};
+  Row row(fields);
+  EXPECT_TRUE(table_info->GetTableHeap()->InsertTuple(row, txn));
+  std::vector<Field> key_fields{Field(TypeId::kTypeInt, id)};
+  Row key(key_fields);
+  EXPECT_EQ(DB_SUCCESS, index_info->GetIndex()->InsertEntry(key, row.GetRowId(), txn));
+  return row.GetRowId();
+}
+
+static void UpdateAccount(DBStorageEngine *engine, const RowId &rid, float account, Transaction *txn) {
+  TableInfo *table_info = nullptr;
+  engine->catalog_mgr_->GetTable("account", table_info);
+  Row row(rid);
+  ASSERT_TRUE(table_info->GetTableHeap()->GetTuple(&row, txn));
+  std::vector<Field> fields;
+  fields.emplace_back(*row.GetField(0));
+  fields.emplace_back(*row.GetField(1));
+  fields.emplace_back(TypeId::kTypeFloat, account);
+  Row new_row(fields);
+  ASSERT_TRUE(table_info->GetTableHeap()->UpdateTuple(new_row, rid, txn));
+}
+
+static void DeleteAccount(DBStorageEngine *engine, int id, const RowId &rid, Transaction *txn) {
+  TableInfo *table_info = nullptr;
+  IndexInfo *index_info = nullptr;
+  engine->catalog_mgr_->GetTable("account", table_info);
+  engine->catalog_mgr_->GetIndex("account", "account_id", index_info);
+  table_info->GetTableHeap()->ApplyDelete(rid, txn);
+  std::vector<Field> key_fields{Field(TypeId::kTypeInt, id)};
+  Row key(key_fields);
+  index_info->GetIndex()->RemoveEntry(key, rid, txn);
+}
+
+/**
+ * Scan the table, check that the index agrees with the table, and return id -> account
+ */
+static std::unordered_map<int, float> ScanAccounts(DBStorageEngine *engine) {
+  TableInfo *table_info = nullptr;
+  IndexInfo *index_info = nullptr;
+  std::unordered_map<int, float> accounts;
+  EXPECT_EQ(DB_SUCCESS, engine->catalog_mgr_->GetTable("account", table_info));
+  EXPECT_EQ(DB_SUCCESS, engine->catalog_mgr_->GetIndex("account", "account_id", index_info));
+  TableHeap *table_heap = table_info->GetTableHeap();
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); ++iter) {
+    int id = iter->GetField(0)->GetInt();
+    EXPECT_EQ(0u, accounts.count(id)) << "duplicate row " << id;
+    accounts[id] = iter->GetField(2)->GetFloat();
+    std::vector<Field> key_fields{Field(TypeId::kTypeInt, id)};
+    Row key(key_fields);
+    std::vector<RowId> result;
+    EXPECT_EQ(DB_SUCCESS, index_info->GetIndex()->ScanKey(key, result, nullptr, "=")) << "row " << id;
+    if (!result.empty()) {
+      EXPECT_EQ(iter->GetRowId().Get(), result[0].Get()) << "row " << id;
+    }
+  }
+  return accounts;
+}
+
+static bool IndexContains(DBStorageEngine *engine, int id) {
+  IndexInfo *index_info = nullptr;
+  engine->catalog_mgr_->GetIndex("account", "account_id", index_info);
+  std::vector<Field> key_fields{Field(TypeId::kTypeInt, id)};
+  Row key(key_fields);
+  std::vector<RowId> result;
+  return index_info->GetIndex()->ScanKey(key, result, nullptr, "=") == DB_SUCCESS;
+}
+
+TEST(RecoveryTest, UndoLoserTest) {
+  RemoveFiles();
+  auto engine = new DBStorageEngine(db_file_name, true);
+  CreateAccountTable(engine);
+  std::vector<RowId> rids;
+  Transaction *txn = engine->txn_mgr_->Begin();
+  for (int i = 0; i < 100; i++) {
+    rids.push_back(InsertAccount(engine, i, i, txn));
+  }
+  engine->txn_mgr_->Commit(txn);
+
+  // 没有提交的事务：插入、更新和删除
+  Transaction *loser = engine->txn_mgr_->Begin();
+  for (int i = 100; i < 150; i++) {
+    InsertAccount(engine, i, i, loser);
+  }
+  for (int i = 0; i < 10; i++) {
+    UpdateAccount(engine, rids[i], -1, loser);
+  }
+  for (int i = 10; i < 20; i++) {
+    DeleteAccount(engine, i, rids[i], loser);
+  }
+  // loser的修改已经写进了db文件（steal），恢复时必须撤销
+  engine->bpm_->FlushAllPages();
+  engine->log_mgr_->FlushAll();
+  CopyAsCrashed();
+  delete engine;
+
+  auto recovered = new DBStorageEngine(crash_db_file_name, false);
+  auto accounts = ScanAccounts(recovered);
+  ASSERT_EQ(100u, accounts.size());
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(1u, accounts.count(i)) << "row " << i;
+    ASSERT_FLOAT_EQ(static_cast<float>(i), accounts[i]);
+  }
+  for (int i = 100; i < 150; i++) {
+    ASSERT_FALSE(IndexContains(recovered, i)) << "row " << i;
+  }
+  // 恢复后可以继续使用
+  txn = recovered->txn_mgr_->Begin();
+  InsertAccount(recovered, 100, 100, txn);
+  recovered->txn_mgr_->Commit(txn);
+  delete recovered;
+
+  recovered = new DBStorageEngine(crash_db_file_name, false);
+  ASSERT_EQ(101u, ScanAccounts(recovered).size());
+  delete recovered;
+  RemoveFiles();
+}
+
+TEST(RecoveryTest, CheckpointTest) {
+  RemoveFiles();
+  auto engine = new DBStorageEngine(db_file_name, true, 64);
+  CreateAccountTable(engine);
+  std::vector<RowId> rids;
+  for (int i = 0; i < 2000; i++) {
+    Transaction *txn = engine->txn_mgr_->Begin();
+    rids.push_back(InsertAccount(engine, i, i, txn));
+    engine->txn_mgr_->Commit(txn);
+  }
+  uint32_t log_size = engine->disk_mgr_->GetLogSize();
+  // 把大部分page写回之后，checkpoint可以丢掉前面的日志
+  engine->bpm_->FlushAllPages();
+  engine->checkpoint_mgr_->Checkpoint();
+  ASSERT_LT(engine->disk_mgr_->GetLogSize(), log_size / 10);
+
+  // checkpoint之后的修改，有一个事务没有提交
+  Transaction *txn = engine->txn_mgr_->Begin();
+  for (int i = 0; i < 100; i++) {
+    UpdateAccount(engine, rids[i], -i, txn);
+  }
+  engine->txn_mgr_->Commit(txn);
+  Transaction *loser = engine->txn_mgr_->Begin();
+  for (int i = 2000; i < 2100; i++) {
+    InsertAccount(engine, i, i, loser);
+  }
+  engine->checkpoint_mgr_->Checkpoint();
+  for (int i = 100; i < 200; i++) {
+    UpdateAccount(engine, rids[i], -1, loser);
+  }
+  engine->log_mgr_->FlushAll();
+  CopyAsCrashed();
+  delete engine;
+
+  auto recovered = new DBStorageEngine(crash_db_file_name, false, 64);
+  auto accounts = ScanAccounts(recovered);
+  ASSERT_EQ(2000u, accounts.size());
+  for (int i = 0; i < 2000; i++) {
+    ASSERT_FLOAT_EQ(i < 100 ? static_cast<float>(-i) : static_cast<float>(i), accounts[i]) << "row " << i;
+  }
+  delete recovered;
+  RemoveFiles();
+}
+
+/**
+ * 子进程不停地执行事务，父进程在随机的时刻用SIGKILL杀死它，然后检查恢复后的数据库：
+ * 1. 已经提交的事务全部存在，没有提交的事务完全不存在（原子性和持久性）
+ * 2. 索引和table heap一致
+ * 事务t插入id为[5t, 5t+5)的5行，并把事务t-1插入的第一行的account改为t
+ */
+TEST(RecoveryTest, CrashInjectionTest) {
+  RemoveFiles();
+  auto engine = new DBStorageEngine(db_file_name, true);
+  CreateAccountTable(engine);
+  delete engine;
+
+  const int rows_per_txn = 5;
+  const int crash_nums = 10;
+  auto seed = std::random_device()();
+  std::mt19937 random(seed);
+  std::cout << "random seed: " << seed << std::endl;
+  int committed_txns = 0;  // 恢复后已经提交的事务数
+  std::unordered_set<int> first_txns;  // 每个子进程执行的第一个事务，它不会更新上一个事务的行
+  for (int round = 0; round < crash_nums; round++) {
+    first_txns.insert(committed_txns);
+    int pipe_fd[2];
+    ASSERT_EQ(0, pipe(pipe_fd));
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+      close(pipe_fd[0]);
+      // buffer pool很小，page会在事务提交前被换出
+      auto child = new DBStorageEngine(db_file_name, false, 32);
+      std::unordered_map<int, RowId> first_rids;
+      for (int t = committed_txns; t < committed_txns + 100000; t++) {
+        Transaction *txn = child->txn_mgr_->Begin();
+        for (int i = 0; i < rows_per_txn; i++) {
+          RowId rid = InsertAccount(child, t * rows_per_txn + i, -1, txn);
+          if (i == 0) {
+            first_rids[t] = rid;
+          }
+        }
+        if (first_rids.count(t - 1) != 0) {
+          UpdateAccount(child, first_rids[t - 1], t, txn);
+        }
+        child->txn_mgr_->Commit(txn);
+        if (write(pipe_fd[1], &t, sizeof(t)) != sizeof(t)) {
+          _exit(1);
+        }
+        if (t % 20 == 0) {
+          child->checkpoint_mgr_->Checkpoint();
+        }
+      }
+      _exit(0);
+    }
+    close(pipe_fd[1]);
+    // 等子进程提交若干个事务之后，在随机的时刻杀死它
+    int wait_txns = std::uniform_int_distribution<int>(1, 60)(random);
+    int last_reported = committed_txns - 1;
+    int t;
+    for (int i = 0; i < wait_txns && read(pipe_fd[0], &t, sizeof(t)) == sizeof(t); i++) {
+      last_reported = t;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(std::uniform_int_distribution<int>(0, 3000)(random)));
+    kill(pid, SIGKILL);
+    int status;
+    waitpid(pid, &status, 0);
+    while (read(pipe_fd[0], &t, sizeof(t)) == sizeof(t)) {
+      last_reported = t;
+    }
+    close(pipe_fd[0]);
+
+    auto recovered = new DBStorageEngine(db_file_name, false);
+    auto accounts = ScanAccounts(recovered);
+    ASSERT_EQ(0u, accounts.size() % rows_per_txn) << "partial transaction after crash " << round;
+    int txns = accounts.size() / rows_per_txn;
+    // 报告过的事务一定已经提交；最后一个事务可能提交了，但还没来得及报告
+    ASSERT_GE(txns, last_reported + 1) << "lost committed transaction after crash " << round;
+    ASSERT_LE(txns, last_reported + 2) << "crash " << round;
+    for (int id = 0; id < txns * rows_per_txn; id++) {
+      ASSERT_EQ(1u, accounts.count(id)) << "row " << id << " after crash " << round;
+      // 跨越崩溃的第一行没有被下一个事务更新
+      bool updated = id % rows_per_txn == 0 && id / rows_per_txn + 1 < txns &&
+                     first_txns.count(id / rows_per_txn + 1) == 0;
+      if (updated) {
+        ASSERT_FLOAT_EQ(static_cast<float>(id / rows_per_txn + 1), accounts[id]) << "row " << id;
+      } else if (id >= committed_txns * rows_per_txn) {
+        ASSERT_FLOAT_EQ(-1.0f, accounts[id]) << "row " << id;
+      }
+    }
+    ASSERT_FALSE(IndexContains(recovered, txns * rows_per_txn));
+    committed_txns = txns;
+    delete recovered;
+  }
+  std::cout << committed_txns << " transactions committed across " << crash_nums << " crashes" << std::endl;
+  RemoveFiles();
+}
@@ -0,0 +1,79 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "storage/async_io.h"
+
+static const std::string file_name = "async_io_test.db";
+
+/**
+ * 写一批页再读回来，队列深度比请求数小，Submit要等前面的请求完成；读到文件末尾之后的部分是0
+ */
+static void ReadWriteTest(AsyncIO *io) {
+  const int page_nums = 256;
+  std::vector<char> data(static_cast<size_t>(page_nums) * PAGE_SIZE);
+  for (int i = 0; i < page_nums; i++) {
+    memset(data.data() + static_cast<size_t>(i) * PAGE_SIZE, 'a' + i % 26, PAGE_SIZE);
+  }
+  std::atomic<int> done{0};
+  std::atomic<int> failed{0};
+  auto callback = [&](bool ok) {
+    done++;
+    if (!ok) {
+      failed++;
+    }
+  };
+  for (int i = 0; i < page_nums; i++) {
+    io->SubmitWrite(data.data() + static_cast<size_t>(i) * PAGE_SIZE, PAGE_SIZE, static_cast<off_t>(i) * PAGE_SIZE,
+                    callback);
+  }
+  io->Wait();
+  ASSERT_EQ(page_nums, done);
+  ASSERT_EQ(0, failed);
+  // 逆序读回来，最后一页在文件之外
+  std::vector<char> buf(static_cast<size_t>(page_nums + 1) * PAGE_SIZE, 'x');
+  for (int i = page_nums; i >= 0; i--) {
+    io->SubmitRead(buf.data() + static_cast<size_t>(i) * PAGE_SIZE, PAGE_SIZE, static_cast<off_t>(i) * PAGE_SIZE,
+                   callback);
+  }
+  io->Wait();
+  ASSERT_EQ(2 * page_nums + 1, done);
+  ASSERT_EQ(0, failed);
+  ASSERT_EQ(0, memcmp(data.data(), buf.data(), data.size()));
+  std::vector<char> zeros(PAGE_SIZE, 0);
+  ASSERT_EQ(0, memcmp(zeros.data(), buf.data() + data.size(), PAGE_SIZE));
+}
+
+TEST(AsyncIOTest, ThreadPoolTest) {
+  int fd = open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  ASSERT_GE(fd, 0);
+  {
+    ThreadPoolIO io(fd, 8);
+    ReadWriteTest(&io);
+  }
+  close(fd);
+  remove(file_name.c_str());
+}
+
+TEST(AsyncIOTest, IoUringTest) {
+  int fd = open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  ASSERT_GE(fd, 0);
+  auto io = IoUringIO::Create(fd, 8);
+  if (io == nullptr) {
+    std::cout << "io_uring is not available, skipped" << std::endl;
+  } else {
+    ReadWriteTest(io.get());
+    io.reset();
+  }
+  auto default_io = AsyncIO::Create(fd);
+  std::cout << "default backend: " << default_io->GetName() << std::endl;
+  default_io.reset();
+  close(fd);
+  remove(file_name.c_str());
+}
@@ -1,4 +1,9 @@
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
 #include <unordered_set>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "storage/disk_manager.h"
@@ -55,4 +60,91 @@ TEST(DiskManagerTest, FreePageAllocationTest) {
   EXPECT_EQ(DiskManager::BITMAP_SIZE - 2, meta_page->GetExtentUsedPage(0));
   EXPECT_EQ(DiskManager::BITMAP_SIZE - 3, meta_page->GetExtentUsedPage(1));
   remove(db_name.c_str());
-}
\ No newline at end of file
+}
+
+/**
+ * 分配表缓存在内存里，Close之后重新打开，分配情况不变；AllocatePageAt只分配空闲的页
+ */
+TEST(DiskManagerTest, AllocationPersistenceTest) {
+  std::string db_name = "disk_allocation_test.db";
+  remove(db_name.c_str());
+  DiskManager *disk_mgr = new DiskManager(db_name);
+  const page_id_t page_nums = DiskManager::BITMAP_SIZE + 100;
+  auto start = std::chrono::steady_clock::now();
+  for (page_id_t i = 0; i < page_nums; i++) {
+    ASSERT_EQ(i, disk_mgr->AllocatePage());
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << page_nums << " allocations: " << seconds << " s" << std::endl;
+  disk_mgr->DeAllocatePage(10);
+  disk_mgr->DeAllocatePage(DiskManager::BITMAP_SIZE + 5);
+  ASSERT_FALSE(disk_mgr->AllocatePageAt(20));
+  ASSERT_TRUE(disk_mgr->AllocatePageAt(page_nums + 7));
+  disk_mgr->Close();
+  delete disk_mgr;
+
+  disk_mgr = new DiskManager(db_name);
+  DiskFileMetaPage *meta_page = reinterpret_cast<DiskFileMetaPage *>(disk_mgr->GetMetaData());
+  EXPECT_EQ(page_nums - 1, meta_page->GetAllocatedPages());
+  EXPECT_EQ(2, meta_page->GetExtentNums());
+  EXPECT_EQ(DiskManager::BITMAP_SIZE - 1, meta_page->GetExtentUsedPage(0));
+  EXPECT_EQ(100, meta_page->GetExtentUsedPage(1));
+  EXPECT_TRUE(disk_mgr->IsPageFree(10));
+  EXPECT_FALSE(disk_mgr->IsPageFree(page_nums + 7));
+  // 空闲的页从小到大分配
+  EXPECT_EQ(10, disk_mgr->AllocatePage());
+  EXPECT_EQ(DiskManager::BITMAP_SIZE + 5, disk_mgr->AllocatePage());
+  EXPECT_EQ(page_nums, disk_mgr->AllocatePage());
+  disk_mgr->Close();
+  delete disk_mgr;
+  remove(db_name.c_str());
+  remove("disk_allocation_test.log");
+}
+/**
+ * 1、4、16个线程同时随机读页的IOPS。页读写用pread/pwrite不加锁，多个线程的读可以同时进行；
+ * 文件在page cache里时，测到的是系统调用和锁的开销
+ */
+TEST(DiskManagerTest, RandomReadBenchmark) {
+  std::string db_name = "disk_benchmark_test.db";
+  remove(db_name.c_str());
+  DiskManager *disk_mgr = new DiskManager(db_name);
+  const page_id_t page_nums = 8192;
+  char data[PAGE_SIZE];
+  memset(data, 0, PAGE_SIZE);
+  for (page_id_t i = 0; i < page_nums; i++) {
+    page_id_t page_id = disk_mgr->AllocatePage();
+    memcpy(data, &page_id, sizeof(page_id));
+    disk_mgr->WritePage(page_id, data);
+  }
+  disk_mgr->SyncData();
+  const int read_nums = 1 << 16;
+  for (int thread_nums : {1, 4, 16}) {
+    std::atomic<int> errors{0};
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < thread_nums; t++) {
+      threads.emplace_back([&, t] {
+        std::mt19937 rng(t);
+        char buf[PAGE_SIZE];
+        for (int i = 0; i < read_nums / thread_nums; i++) {
+          page_id_t page_id = rng() % page_nums;
+          disk_mgr->ReadPage(page_id, buf);
+          if (*reinterpret_cast<page_id_t *>(buf) != page_id) {
+            errors++;
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ASSERT_EQ(0, errors);
+    std::cout << thread_nums << " threads: " << static_cast<int>(read_nums / seconds) << " random reads/s"
+              << std::endl;
+  }
+  disk_mgr->Close();
+  delete disk_mgr;
+  remove(db_name.c_str());
+  remove("disk_benchmark_test.log");
+}
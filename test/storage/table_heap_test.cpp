@@ -1,3 +1,9 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 #include <unordered_map>
 
@@ -67,3 +73,376 @@ TEST(TableHeapTest, TableHeapSampleTest) {
   ASSERT_EQ(row_nums, count);
   remove(db_file_name.c_str());
 }
+
+/**
+ * 删除腾出来的空间通过空闲空间表被之后的insert复用，不会再追加新page
+ */
+TEST(TableHeapTest, FreeSpaceReuseTest) {
+  DBStorageEngine engine(db_file_name);
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {
+      ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false),
+      ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 64, 1, true, false)
+  };
+  auto schema = std::make_shared<Schema>(columns);
+  TableHeap *table_heap = TableHeap::Create(engine.bpm_, schema.get(), nullptr, nullptr, nullptr, &heap);
+  auto make_row = [](int id) {
+    std::string name = "name" + std::to_string(id) + std::string(40, 'x');
+    Fields fields{Field(TypeId::kTypeInt, id),
+                  Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true)};
+    return Row(fields);
+  };
+  const int row_nums = 5000;
+  std::vector<RowId> rids;
+  for (int i = 0; i < row_nums; i++) {
+    Row row = make_row(i);
+    ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+    rids.push_back(row.GetRowId());
+  }
+  uint32_t page_count = table_heap->GetPageCount();
+  ASSERT_GT(page_count, 10u);
+  // 删掉一半，再插入同样多的row
+  for (int i = 0; i < row_nums; i += 2) {
+    ASSERT_TRUE(table_heap->MarkDelete(rids[i], nullptr));
+    table_heap->ApplyDelete(rids[i], nullptr);
+  }
+  for (int i = 0; i < row_nums; i += 2) {
+    Row row = make_row(row_nums + i);
+    ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+  }
+  ASSERT_EQ(page_count, table_heap->GetPageCount());
+  int count = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); ++iter) {
+    int id = iter->GetField(0)->GetInt();
+    ASSERT_TRUE(id % 2 == 1 || id >= row_nums);
+    count++;
+  }
+  ASSERT_EQ(row_nums, count);
+  // 放不下的update把row移到别的page
+  std::string name(60, 'y');
+  Fields fields{Field(TypeId::kTypeInt, 1),
+                Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true)};
+  for (int i = 1; i < row_nums; i += 2) {
+    Row row(fields);
+    ASSERT_TRUE(table_heap->UpdateOrMoveTuple(row, rids[i], nullptr));
+    Row read(row.GetRowId());
+    ASSERT_TRUE(table_heap->GetTuple(&read, nullptr));
+    ASSERT_EQ(CmpBool::kTrue, read.GetField(1)->CompareEquals(fields[1]));
+  }
+  remove(db_file_name.c_str());
+}
+
+/**
+ * 空闲空间表随表一起持久化，重新打开后不用遍历页链表
+ */
+TEST(TableHeapTest, FreeSpaceMapPersistTest) {
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {
+      ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false),
+      ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 400, 1, true, false)
+  };
+  auto schema = std::make_shared<Schema>(columns);
+  // 每页只放得下几个row，让空闲空间表跨越多个page（页数和空闲空间表每页的表页数都随页大小增长）
+  const int row_nums = 10000 * (PAGE_SIZE / 4096) * (PAGE_SIZE / 4096);
+  std::string name(380, 'x');
+  page_id_t first_page_id, free_space_map_page_id;
+  uint32_t page_count;
+  std::vector<RowId> rids;
+  {
+    DBStorageEngine engine(db_file_name);
+    TableHeap *table_heap = TableHeap::Create(engine.bpm_, schema.get(), nullptr, nullptr, nullptr, &heap);
+    for (int i = 0; i < row_nums; i++) {
+      Fields fields{Field(TypeId::kTypeInt, i),
+                    Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true)};
+      Row row(fields);
+      ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+      rids.push_back(row.GetRowId());
+    }
+    // 清空第一页
+    for (auto &rid : rids) {
+      if (rid.GetPageId() == table_heap->GetFirstPageId()) {
+        ASSERT_TRUE(table_heap->MarkDelete(rid, nullptr));
+        table_heap->ApplyDelete(rid, nullptr);
+      }
+    }
+    first_page_id = table_heap->GetFirstPageId();
+    free_space_map_page_id = table_heap->GetFreeSpaceMapPageId();
+    page_count = table_heap->GetPageCount();
+    ASSERT_GT(page_count, FreeSpaceMapPage::MAX_ENTRY_COUNT);
+  }
+  DBStorageEngine engine(db_file_name, false);
+  TableHeap *table_heap = TableHeap::Create(engine.bpm_, first_page_id, free_space_map_page_id, schema.get(),
+                                            nullptr, nullptr, &heap);
+  ASSERT_EQ(page_count, table_heap->GetPageCount());
+  Fields fields{Field(TypeId::kTypeInt, -1),
+                Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true)};
+  Row row(fields);
+  ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+  ASSERT_EQ(first_page_id, row.GetRowId().GetPageId());
+  ASSERT_EQ(page_count, table_heap->GetPageCount());
+  remove(db_file_name.c_str());
+}
+
+/**
+ * 批量追加的行从新的page开始，从第一个新行往后遍历正好是追加的行
+ */
+TEST(TableHeapTest, AppendTuplesTest) {
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {
+      ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false),
+      ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 400, 1, true, false)
+  };
+  auto schema = std::make_shared<Schema>(columns);
+  DBStorageEngine engine(db_file_name);
+  TableHeap *table_heap = TableHeap::Create(engine.bpm_, schema.get(), nullptr, nullptr, nullptr, &heap);
+  std::string name(100, 'x');
+  auto make_fields = [&](int id, Fields *fields) {
+    fields->emplace_back(TypeId::kTypeInt, id);
+    fields->emplace_back(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true);
+  };
+  // 表是空的时候第一页直接用
+  bool done = false;
+  RowId first_rid = table_heap->AppendTuples(
+      [&](Fields *next_fields) {
+        if (done) {
+          return false;
+        }
+        make_fields(-1, next_fields);
+        done = true;
+        return true;
+      },
+      [](const Row &) {});
+  ASSERT_EQ(table_heap->GetFirstPageId(), first_rid.GetPageId());
+  uint32_t page_count = table_heap->GetPageCount();
+  ASSERT_EQ(1u, page_count);
+
+  const int row_nums = 1000;
+  int next_id = 0;
+  std::vector<RowId> rids;
+  first_rid = table_heap->AppendTuples(
+      [&](Fields *next_fields) {
+        if (next_id == row_nums) {
+          return false;
+        }
+        make_fields(next_id++, next_fields);
+        return true;
+      },
+      [&](const Row &row) { rids.push_back(row.GetRowId()); });
+  ASSERT_EQ(static_cast<size_t>(row_nums), rids.size());
+  ASSERT_EQ(rids[0], first_rid);
+  ASSERT_NE(table_heap->GetFirstPageId(), first_rid.GetPageId());
+  // 每页都写满了才换下一页
+  uint32_t rows_per_page = 0;
+  for (auto &rid : rids) {
+    if (rid.GetPageId() == first_rid.GetPageId()) {
+      rows_per_page++;
+    }
+  }
+  ASSERT_EQ((row_nums + rows_per_page - 1) / rows_per_page + page_count, table_heap->GetPageCount());
+  int id = 0;
+  for (TableIterator iter(table_heap, first_rid); iter != table_heap->End(); ++iter) {
+    ASSERT_EQ(rids[id], iter->GetRowId());
+    ASSERT_EQ(id, iter->GetField(0)->GetInt());
+    id++;
+  }
+  ASSERT_EQ(row_nums, id);
+  remove(db_file_name.c_str());
+}
+
+/**
+ * 一页放不下的row直接插入失败，不会在页链表后面留下空页
+ */
+TEST(TableHeapTest, MaxRowSizeTest) {
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {
+      ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false),
+      ALLOC_COLUMN(heap)("first_name", TypeId::kTypeChar, VARCHAR_MAX_LEN, 1, true, false),
+      ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, VARCHAR_MAX_LEN, 2, true, false)
+  };
+  auto schema = std::make_shared<Schema>(columns);
+  DBStorageEngine engine(db_file_name);
+  TableHeap *table_heap = TableHeap::Create(engine.bpm_, schema.get(), nullptr, nullptr, nullptr, &heap);
+  // 一个char字段放不满一页，用两个；先量出除了name之外row占多少字节
+  std::string first_name(VARCHAR_MAX_LEN - 1, 'x');
+  std::string name;
+  Fields fields{Field(TypeId::kTypeInt, 0),
+                Field(TypeId::kTypeChar, const_cast<char *>(first_name.c_str()), first_name.size(), true),
+                Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), 0, true)};
+  uint32_t overhead = Row(fields).GetSerializedSize(schema.get());
+  name.assign(TablePage::SIZE_MAX_ROW + 1 - overhead, 'x');
+  Fields too_big_fields{Field(TypeId::kTypeInt, 0),
+                        Field(TypeId::kTypeChar, const_cast<char *>(first_name.c_str()), first_name.size(), true),
+                        Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true)};
+  Row too_big(too_big_fields);
+  ASSERT_EQ(TablePage::SIZE_MAX_ROW + 1, too_big.GetSerializedSize(schema.get()));
+  for (int i = 0; i < 3; i++) {
+    ASSERT_FALSE(table_heap->InsertTuple(too_big, nullptr));
+  }
+  ASSERT_EQ(1u, table_heap->GetPageCount());
+  name.pop_back();
+  Fields max_fields{Field(TypeId::kTypeInt, 0),
+                    Field(TypeId::kTypeChar, const_cast<char *>(first_name.c_str()), first_name.size(), true),
+                    Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true)};
+  Row max_row(max_fields);
+  ASSERT_EQ(TablePage::SIZE_MAX_ROW, max_row.GetSerializedSize(schema.get()));
+  ASSERT_TRUE(table_heap->InsertTuple(max_row, nullptr));
+  ASSERT_EQ(1u, table_heap->GetPageCount());
+  remove(db_file_name.c_str());
+}
+
+/**
+ * 多个线程同时insert，另一个线程同时扫描。扫到的行不能是写了一半的，最后每一行都在自己的rid上
+ */
+TEST(TableHeapTest, ConcurrentInsertTest) {
+  DBStorageEngine engine(db_file_name);
+  SimpleMemHeap heap;
+  const int thread_nums = 4;
+  const int row_nums = 2000;
+  std::vector<Column *> columns = {
+      ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false),
+      ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 32, 1, true, false)
+  };
+  auto schema = std::make_shared<Schema>(columns);
+  TableHeap *table_heap = TableHeap::Create(engine.bpm_, schema.get(), nullptr, nullptr, nullptr, &heap);
+  auto name_of = [](int id) { return std::string(id % 32 + 1, static_cast<char>('a' + id % 26)); };
+  std::vector<std::vector<RowId>> rids(thread_nums);
+  std::atomic<bool> done{false};
+  std::atomic<int> bad_rows{0};
+  std::thread scanner([&]() {
+    while (!done) {
+      for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); ++iter) {
+        int id = iter->GetField(0)->GetInt();
+        if (std::string(iter->GetField(1)->GetData(), iter->GetField(1)->GetLength()) != name_of(id)) {
+          bad_rows++;
+        }
+      }
+    }
+  });
+  std::vector<std::thread> inserters;
+  for (int t = 0; t < thread_nums; t++) {
+    inserters.emplace_back([&, t]() {
+      for (int i = 0; i < row_nums; i++) {
+        int id = t * row_nums + i;
+        std::string name = name_of(id);
+        Fields fields{Field(TypeId::kTypeInt, id),
+                      Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true)};
+        Row row(fields);
+        EXPECT_TRUE(table_heap->InsertTuple(row, nullptr));
+        rids[t].push_back(row.GetRowId());
+      }
+    });
+  }
+  for (auto &inserter : inserters) {
+    inserter.join();
+  }
+  done = true;
+  scanner.join();
+  ASSERT_EQ(0, bad_rows);
+
+  std::unordered_set<int64_t> seen;
+  for (int t = 0; t < thread_nums; t++) {
+    for (int i = 0; i < row_nums; i++) {
+      ASSERT_TRUE(seen.insert(rids[t][i].Get()).second);
+      Row row(rids[t][i]);
+      ASSERT_TRUE(table_heap->GetTuple(&row, nullptr));
+      ASSERT_EQ(t * row_nums + i, row.GetField(0)->GetInt());
+    }
+  }
+  int count = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); ++iter) {
+    count++;
+  }
+  ASSERT_EQ(thread_nums * row_nums, count);
+  remove(db_file_name.c_str());
+}
+
+/**
+ * 每个insert的耗时不随表的大小增长
+ */
+TEST(TableHeapTest, InsertBenchmark) {
+  DBStorageEngine engine(db_file_name);
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {
+      ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false),
+      ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 16, 1, true, false),
+      ALLOC_COLUMN(heap)("account", TypeId::kTypeFloat, 2, true, false)
+  };
+  auto schema = std::make_shared<Schema>(columns);
+  TableHeap *table_heap = TableHeap::Create(engine.bpm_, schema.get(), nullptr, nullptr, nullptr, &heap);
+  // 10M行要跑很久，默认插入1M行，分成10段统计每段的平均耗时
+  const int row_nums = 1000000;
+  const int rounds = 10;
+  std::vector<double> latencies;
+  for (int round = 0; round < rounds; round++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = round * (row_nums / rounds); i < (round + 1) * (row_nums / rounds); i++) {
+      std::string name = "user" + std::to_string(i);
+      Fields fields{Field(TypeId::kTypeInt, i),
+                    Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true),
+                    Field(TypeId::kTypeFloat, static_cast<float>(i % 1000))};
+      Row row(fields);
+      ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    latencies.push_back(seconds * 1e9 / (row_nums / rounds));
+    std::cout << "Insert rows " << round * (row_nums / rounds) << " ~ " << (round + 1) * (row_nums / rounds) << ": "
+              << latencies.back() << "ns/row, " << table_heap->GetPageCount() << " pages" << std::endl;
+  }
+  // 找page是O(1)的，最后一段不应该比第一段慢很多
+  ASSERT_LT(latencies.back(), latencies.front() * 3);
+  remove(db_file_name.c_str());
+}
+
+/**
+ * buffer pool和操作系统的缓存都是冷的时候，扫描一张10倍于buffer pool的表，比较关掉和打开预读的吞吐量
+ */
+TEST(TableHeapTest, ColdScanBenchmark) {
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {
+      ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false),
+      ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 400, 1, true, false)
+  };
+  auto schema = std::make_shared<Schema>(columns);
+  const uint32_t buffer_pool_size = 256;
+  const uint32_t page_nums = buffer_pool_size * 10;
+  std::string name(380, 'x');
+  page_id_t first_page_id, free_space_map_page_id;
+  int row_nums = 0;
+  {
+    DBStorageEngine engine(db_file_name, true, buffer_pool_size);
+    TableHeap *table_heap = TableHeap::Create(engine.bpm_, schema.get(), nullptr, nullptr, nullptr, &heap);
+    while (table_heap->GetPageCount() < page_nums) {
+      Fields fields{Field(TypeId::kTypeInt, row_nums),
+                    Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true)};
+      Row row(fields);
+      ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+      row_nums++;
+    }
+    first_page_id = table_heap->GetFirstPageId();
+    free_space_map_page_id = table_heap->GetFreeSpaceMapPageId();
+  }
+  for (uint32_t read_ahead_pages : {0u, READ_AHEAD_PAGES}) {
+    // 把db文件从操作系统的缓存里清掉
+    int fd = open(db_file_name.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    DBStorageEngine engine(db_file_name, false, buffer_pool_size);
+    TableHeap *table_heap = TableHeap::Create(engine.bpm_, first_page_id, free_space_map_page_id, schema.get(),
+                                              nullptr, nullptr, &heap);
+    table_heap->SetReadAheadPages(read_ahead_pages);
+    auto start = std::chrono::steady_clock::now();
+    int count = 0;
+    for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); ++iter) {
+      ASSERT_EQ(count, iter->GetField(0)->GetInt());
+      count++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ASSERT_EQ(row_nums, count);
+    std::cout << "Cold scan of " << page_nums << " pages, read-ahead " << read_ahead_pages << ": "
+              << static_cast<int>(page_nums / seconds) << " pages/s, "
+              << page_nums * PAGE_SIZE / seconds / 1024 / 1024 << " MB/s" << std::endl;
+  }
+  remove(db_file_name.c_str());
+}
@@ -0,0 +1,309 @@
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "common/instance.h"
+#include "gtest/gtest.h"
+#include "record/field.h"
+#include "record/schema.h"
+#include "storage/table_heap.h"
+#include "transaction/lock_manager.h"
+#include "transaction/txn_manager.h"
+
+static const std::string db_file_name = "lock_manager_test.db";
+static const std::string log_file_name = "lock_manager_test.log";
+
+static void RemoveFiles() {
+  remove(db_file_name.c_str());
+  remove(log_file_name.c_str());
+}
+
+TEST(LockManagerTest, SharedExclusiveTest) {
+  LockManager lock_manager(false);
+  Transaction txn0(0), txn1(1), txn2(2);
+  RowId rid(1, 0);
+  ASSERT_TRUE(lock_manager.LockShared(&txn0, rid));
+  ASSERT_TRUE(lock_manager.LockShared(&txn1, rid));
+  ASSERT_TRUE(txn0.IsSharedLocked(rid));
+  std::atomic<bool> granted{false};
+  std::thread writer([&]() {
+    ASSERT_TRUE(lock_manager.LockExclusive(&txn2, rid));
+    granted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(granted);
+  ASSERT_EQ((std::vector<std::pair<txn_id_t, txn_id_t>>{{2, 0}, {2, 1}}), lock_manager.GetEdgeList());
+  ASSERT_TRUE(lock_manager.Unlock(&txn0, rid));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(granted);
+  ASSERT_TRUE(lock_manager.Unlock(&txn1, rid));
+  writer.join();
+  ASSERT_TRUE(granted);
+  ASSERT_TRUE(txn2.IsExclusiveLocked(rid));
+  // 2PL：释放过锁的事务不能再加锁
+  ASSERT_EQ(TxnState::kShrinking, txn0.GetState());
+  ASSERT_FALSE(lock_manager.LockShared(&txn0, RowId(1, 1)));
+  ASSERT_EQ(TxnState::kAborted, txn0.GetState());
+  lock_manager.UnlockAll(&txn2);
+  ASSERT_TRUE(txn2.GetExclusiveLockSet().empty());
+}
+
+TEST(LockManagerTest, UpgradeTest) {
+  LockManager lock_manager(false);
+  Transaction txn0(0), txn1(1), txn2(2);
+  RowId rid(1, 0);
+  ASSERT_TRUE(lock_manager.LockShared(&txn0, rid));
+  ASSERT_TRUE(lock_manager.LockShared(&txn1, rid));
+  std::atomic<bool> upgraded{false};
+  std::thread upgrader([&]() {
+    ASSERT_TRUE(lock_manager.LockUpgrade(&txn0, rid));
+    upgraded = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(upgraded);
+  // 等待升级时不再授予新的共享锁
+  std::atomic<bool> reader_granted{false};
+  std::thread reader([&]() {
+    ASSERT_TRUE(lock_manager.LockShared(&txn2, rid));
+    reader_granted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(reader_granted);
+  // 第二个升级请求必然死锁，立即回滚
+  ASSERT_FALSE(lock_manager.LockExclusive(&txn1, rid));
+  ASSERT_EQ(TxnState::kAborted, txn1.GetState());
+  lock_manager.UnlockAll(&txn1);
+  upgrader.join();
+  ASSERT_TRUE(upgraded);
+  ASSERT_TRUE(txn0.IsExclusiveLocked(rid));
+  ASSERT_FALSE(txn0.IsSharedLocked(rid));
+  ASSERT_FALSE(reader_granted);
+  lock_manager.UnlockAll(&txn0);
+  reader.join();
+  ASSERT_TRUE(reader_granted);
+  lock_manager.UnlockAll(&txn2);
+}
+
+TEST(LockManagerTest, DeadlockTest) {
+  LockManager lock_manager;
+  Transaction txn0(0), txn1(1);
+  RowId rid0(1, 0), rid1(1, 1);
+  ASSERT_TRUE(lock_manager.LockExclusive(&txn0, rid0));
+  ASSERT_TRUE(lock_manager.LockExclusive(&txn1, rid1));
+  std::thread t0([&]() {
+    // txn0更老，不会被选为牺牲者
+    ASSERT_TRUE(lock_manager.LockShared(&txn0, rid1));
+    lock_manager.UnlockAll(&txn0);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_FALSE(lock_manager.LockExclusive(&txn1, rid0));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  ASSERT_EQ(TxnState::kAborted, txn1.GetState());
+  ASSERT_LT(elapsed, std::chrono::milliseconds(10 * DEADLOCK_DETECTION_INTERVAL_MS));
+  lock_manager.UnlockAll(&txn1);
+  t0.join();
+  ASSERT_TRUE(lock_manager.GetEdgeList().empty());
+}
+
+TEST(LockManagerTest, RollbackTest) {
+  RemoveFiles();
+  auto engine = new DBStorageEngine(db_file_name, true);
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, true),
+                                   ALLOC_COLUMN(heap)("value", TypeId::kTypeInt, 1, false, false)};
+  auto schema = ALLOC(heap, Schema)(columns);
+  TableInfo *table_info = nullptr;
+  IndexInfo *index_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, engine->catalog_mgr_->CreateTable("t", schema, nullptr, table_info));
+  ASSERT_EQ(DB_SUCCESS, engine->catalog_mgr_->CreateIndex("t", "t_id", {"id"}, nullptr, index_info));
+  TableHeap *table_heap = table_info->GetTableHeap();
+  auto insert = [&](int id, Transaction *txn) {
+    std::vector<Field> fields{Field(TypeId::kTypeInt, id), Field(TypeId::kTypeInt, id)};
+    Row row(fields);
+    EXPECT_TRUE(table_heap->InsertTuple(row, txn));
+    std::vector<Field> key_fields{Field(TypeId::kTypeInt, id)};
+    EXPECT_EQ(DB_SUCCESS, index_info->GetIndex()->InsertEntry(Row(key_fields), row.GetRowId(), txn));
+    return row.GetRowId();
+  };
+  auto index_contains = [&](int id) {
+    std::vector<Field> key_fields{Field(TypeId::kTypeInt, id)};
+    std::vector<RowId> result;
+    return index_info->GetIndex()->ScanKey(Row(key_fields), result, nullptr, "=") == DB_SUCCESS;
+  };
+  std::vector<RowId> rids;
+  Transaction *txn = engine->txn_mgr_->Begin();
+  for (int i = 0; i < 10; i++) {
+    rids.push_back(insert(i, txn));
+  }
+  engine->txn_mgr_->Commit(txn);
+
+  txn = engine->txn_mgr_->Begin();
+  for (int i = 10; i < 20; i++) {
+    insert(i, txn);
+  }
+  for (int i = 0; i < 5; i++) {
+    std::vector<Field> fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeInt, -1)};
+    ASSERT_TRUE(table_heap->UpdateTuple(Row(fields), rids[i], txn));
+  }
+  for (int i = 5; i < 10; i++) {
+    ASSERT_TRUE(table_heap->MarkDelete(rids[i], txn));
+    std::vector<Field> key_fields{Field(TypeId::kTypeInt, i)};
+    index_info->GetIndex()->RemoveEntry(Row(key_fields), rids[i], txn);
+  }
+  ASSERT_FALSE(index_contains(7));
+  ASSERT_TRUE(txn->IsExclusiveLocked(rids[0]));
+  engine->txn_mgr_->Abort(txn);
+
+  int rows = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); ++iter) {
+    int id = iter->GetField(0)->GetInt();
+    ASSERT_EQ(id, iter->GetField(1)->GetInt());
+    ASSERT_TRUE(index_contains(id));
+    rows++;
+  }
+  ASSERT_EQ(10, rows);
+  for (int i = 10; i < 20; i++) {
+    ASSERT_FALSE(index_contains(i));
+  }
+
+  // 提交时才真正删除，之后其他事务可以锁住并读取这些行
+  txn = engine->txn_mgr_->Begin();
+  ASSERT_TRUE(table_heap->MarkDelete(rids[0], txn));
+  engine->txn_mgr_->Commit(txn);
+  txn = engine->txn_mgr_->Begin();
+  Row row(rids[0]);
+  ASSERT_FALSE(table_heap->GetTuple(&row, txn));
+  Row row1(rids[1]);
+  ASSERT_TRUE(table_heap->GetTuple(&row1, txn));
+  engine->txn_mgr_->Commit(txn);
+  delete engine;
+  RemoveFiles();
+}
+
+/**
+ * insert要用的slot被别的事务锁着时，放掉page latch等锁，期间其他事务仍能读这个page
+ */
+TEST(LockManagerTest, InsertWaitsForSlotLockTest) {
+  RemoveFiles();
+  auto engine = new DBStorageEngine(db_file_name, true);
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false)};
+  auto schema = ALLOC(heap, Schema)(columns);
+  TableInfo *table_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, engine->catalog_mgr_->CreateTable("t", schema, nullptr, table_info));
+  TableHeap *table_heap = table_info->GetTableHeap();
+  Transaction *txn = engine->txn_mgr_->Begin();
+  std::vector<Field> fields{Field(TypeId::kTypeInt, 0)};
+  Row row(fields);
+  ASSERT_TRUE(table_heap->InsertTuple(row, txn));
+  engine->txn_mgr_->Commit(txn);
+  // 锁住下一个insert会用到的slot
+  RowId next_rid(row.GetRowId().GetPageId(), row.GetRowId().GetSlotNum() + 1);
+  Transaction *holder = engine->txn_mgr_->Begin();
+  ASSERT_TRUE(engine->lock_mgr_->LockExclusive(holder, next_rid));
+  std::atomic<bool> inserted{false};
+  RowId inserted_rid;
+  std::thread inserter([&]() {
+    Transaction *txn = engine->txn_mgr_->Begin();
+    std::vector<Field> fields{Field(TypeId::kTypeInt, 1)};
+    Row row(fields);
+    EXPECT_TRUE(table_heap->InsertTuple(row, txn));
+    inserted_rid = row.GetRowId();
+    inserted = true;
+    engine->txn_mgr_->Commit(txn);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(inserted);
+  Row read_row(row.GetRowId());
+  ASSERT_TRUE(table_heap->GetTuple(&read_row, holder));
+  ASSERT_EQ(0, read_row.GetField(0)->GetInt());
+  engine->txn_mgr_->Commit(holder);
+  inserter.join();
+  ASSERT_TRUE(inserted);
+  Row row1(inserted_rid);
+  ASSERT_TRUE(table_heap->GetTuple(&row1, nullptr));
+  ASSERT_EQ(1, row1.GetField(0)->GetInt());
+  delete engine;
+  RemoveFiles();
+}
+
+/**
+ * N个线程在少量热点行上做read-modify-write：先用共享锁读，再升级为排它锁写回。
+ * 升级冲突和死锁的事务回滚后重试，最后检查所有提交的增量都在。
+ */
+TEST(LockManagerTest, ContentionBenchmark) {
+  RemoveFiles();
+  auto engine = new DBStorageEngine(db_file_name, true);
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, true),
+                                   ALLOC_COLUMN(heap)("counter", TypeId::kTypeInt, 1, false, false)};
+  auto schema = ALLOC(heap, Schema)(columns);
+  TableInfo *table_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, engine->catalog_mgr_->CreateTable("hot", schema, nullptr, table_info));
+  TableHeap *table_heap = table_info->GetTableHeap();
+  const int hot_rows = 256;
+  const int rows_per_txn = 2;
+  const int txn_nums = 2000;
+  std::vector<RowId> rids;
+  Transaction *txn = engine->txn_mgr_->Begin();
+  for (int i = 0; i < hot_rows; i++) {
+    std::vector<Field> fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeInt, 0)};
+    Row row(fields);
+    ASSERT_TRUE(table_heap->InsertTuple(row, txn));
+    rids.push_back(row.GetRowId());
+  }
+  engine->txn_mgr_->Commit(txn);
+
+  int committed_total = 0;
+  for (int thread_nums : {1, 2, 4, 8}) {
+    std::atomic<int> aborted{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_nums; t++) {
+      threads.emplace_back([&, t]() {
+        std::mt19937 random(t);
+        std::uniform_int_distribution<int> dist(0, hot_rows - 1);
+        for (int i = 0; i < txn_nums / thread_nums;) {
+          Transaction *txn = engine->txn_mgr_->Begin();
+          bool ok = true;
+          for (int j = 0; j < rows_per_txn && ok; j++) {
+            RowId rid = rids[dist(random)];
+            Row row(rid);
+            ok = table_heap->GetTuple(&row, txn);
+            if (ok) {
+              std::vector<Field> fields;
+              fields.emplace_back(*row.GetField(0));
+              fields.emplace_back(TypeId::kTypeInt, row.GetField(1)->GetInt() + 1);
+              ok = table_heap->UpdateTuple(Row(fields), rid, txn);
+            }
+          }
+          if (ok) {
+            engine->txn_mgr_->Commit(txn);
+            i++;
+          } else {
+            engine->txn_mgr_->Abort(txn);
+            aborted++;
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    committed_total += txn_nums / thread_nums * thread_nums;
+    std::cout << thread_nums << " threads: " << static_cast<int>(txn_nums / seconds) << " txns/sec, " << aborted
+              << " aborted" << std::endl;
+  }
+
+  int sum = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); ++iter) {
+    sum += iter->GetField(1)->GetInt();
+  }
+  ASSERT_EQ(committed_total * rows_per_txn, sum);
+  delete engine;
+  RemoveFiles();
+}
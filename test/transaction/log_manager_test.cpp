@@ -0,0 +1,164 @@
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "common/instance.h"
+#include "gtest/gtest.h"
+#include "record/field.h"
+#include "record/schema.h"
+#include "recovery/log_recovery.h"
+#include "storage/table_heap.h"
+#include "transaction/log_manager.h"
+#include "transaction/txn_manager.h"
+#include "utils/utils.h"
+
+static const std::string db_file_name = "log_manager_test.db";
+static const std::string log_file_name = "log_manager_test.log";
+static const std::string crash_db_file_name = "log_manager_crash_test.db";
+static const std::string crash_log_file_name = "log_manager_crash_test.log";
+using Fields = std::vector<Field>;
+
+TEST(LogManagerTest, LogRecordSerializeTest) {
+  char old_tuple[] = "old tuple";
+  char new_tuple[] = "new tuple, longer";
+  LogRecord update(3, 7, RowId(5, 2), old_tuple, sizeof(old_tuple), new_tuple, sizeof(new_tuple));
+  update.SetLSN(8);
+  char page[PAGE_SIZE]{};
+  char data[] = "0123456789";
+  LogRecord delta(LogRecordType::kPageDelta, 9);
+  delta.AppendDeltaRun(100, data, 10);
+  delta.AppendDeltaRun(PAGE_SIZE - 4, data, 4);
+  delta.SetLSN(9);
+
+  char buf[PAGE_SIZE];
+  uint32_t size = update.SerializeTo(buf);
+  size += delta.SerializeTo(buf + size);
+  ASSERT_EQ(update.GetSize() + delta.GetSize(), size);
+
+  LogRecord record;
+  ASSERT_TRUE(LogRecord::DeserializeFrom(buf, size, &record));
+  ASSERT_EQ(LogRecordType::kUpdate, record.GetType());
+  ASSERT_EQ(8, record.GetLSN());
+  ASSERT_EQ(3, record.GetTxnId());
+  ASSERT_EQ(7, record.GetPrevLSN());
+  ASSERT_EQ(RowId(5, 2).Get(), record.GetRowId().Get());
+  ASSERT_EQ(std::string(old_tuple, sizeof(old_tuple)), record.GetTuple());
+  ASSERT_EQ(std::string(new_tuple, sizeof(new_tuple)), record.GetNewTuple());
+
+  uint32_t offset = record.GetSize();
+  ASSERT_TRUE(LogRecord::DeserializeFrom(buf + offset, size - offset, &record));
+  ASSERT_EQ(LogRecordType::kPageDelta, record.GetType());
+  ASSERT_EQ(9, record.GetPageId());
+  record.ApplyTo(page);
+  ASSERT_EQ(0, memcmp(page + 100, data, 10));
+  ASSERT_EQ(0, memcmp(page + PAGE_SIZE - 4, data, 4));
+  // torn write at the tail of the log
+  ASSERT_FALSE(LogRecord::DeserializeFrom(buf + offset, size - offset - 1, &record));
+  buf[offset + LogRecord::HEADER_SIZE] ^= 1;
+  ASSERT_FALSE(LogRecord::DeserializeFrom(buf + offset, size - offset, &record));
+}
+
+TEST(LogManagerTest, GroupCommitTest) {
+  remove(db_file_name.c_str());
+  remove(log_file_name.c_str());
+  auto disk_manager = new DiskManager(db_file_name);
+  auto log_manager = new LogManager(disk_manager);
+  auto txn_manager = new TransactionManager(log_manager);
+  const int thread_nums = 8;
+  const int txn_nums = 200;
+  char tuple[64]{};
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_nums; t++) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < txn_nums; i++) {
+        Transaction *txn = txn_manager->Begin();
+        LogRecord record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::kInsert, RowId(1, i), tuple,
+                         sizeof(tuple));
+        txn->SetPrevLSN(log_manager->AppendLogRecord(&record));
+        txn_manager->Commit(txn);
+        // commit returns only after the commit record is durable
+        ASSERT_GE(log_manager->GetPersistentLSN(), record.GetLSN());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << thread_nums * txn_nums << " commits with " << thread_nums << " threads: "
+            << static_cast<int>(thread_nums * txn_nums / duration) << " commits/sec" << std::endl;
+  ASSERT_EQ(log_manager->GetNextLSN() - 1, log_manager->GetPersistentLSN());
+  delete txn_manager;
+  delete log_manager;
+
+  // every record is in the log, in lsn order
+  LogRecovery recovery(disk_manager);
+  recovery.Redo();
+  ASSERT_EQ(0u, recovery.GetLoserCount());
+  ASSERT_EQ(static_cast<size_t>(thread_nums * txn_nums * 3), recovery.GetLogRecordCount());
+  delete disk_manager;
+  remove(db_file_name.c_str());
+  remove(log_file_name.c_str());
+}
+
+TEST(LogManagerTest, RedoAfterCrashTest) {
+  auto engine = new DBStorageEngine(db_file_name, true);
+  SimpleMemHeap heap;
+  std::vector<Column *> columns = {
+      ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, false),
+      ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 64, 1, true, false),
+      ALLOC_COLUMN(heap)("account", TypeId::kTypeFloat, 2, true, false)
+  };
+  auto schema = std::make_shared<Schema>(columns);
+  TableInfo *table_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, engine->catalog_mgr_->CreateTable("table-1", schema.get(), nullptr, table_info));
+  const int row_nums = 2000;
+  std::unordered_map<int64_t, Fields> row_values;
+  Transaction *txn = engine->txn_mgr_->Begin();
+  for (int i = 0; i < row_nums; i++) {
+    int32_t len = RandomUtils::RandomInt(0, 64);
+    char *characters = new char[len];
+    RandomUtils::RandomString(characters, len);
+    Fields fields{
+        Field(TypeId::kTypeInt, i),
+        Field(TypeId::kTypeChar, const_cast<char *>(characters), len, true),
+        Field(TypeId::kTypeFloat, RandomUtils::RandomFloat(-999.f, 999.f))
+    };
+    Row row(fields);
+    ASSERT_TRUE(table_info->GetTableHeap()->InsertTuple(row, txn));
+    row_values.emplace(row.GetRowId().Get(), fields);
+    delete[] characters;
+  }
+  engine->txn_mgr_->Commit(txn);
+  // 不关闭engine，直接复制文件模拟崩溃：db文件中的page还没有写回，只有日志是持久的
+  std::filesystem::copy_file(db_file_name, crash_db_file_name, std::filesystem::copy_options::overwrite_existing);
+  std::filesystem::copy_file(log_file_name, crash_log_file_name, std::filesystem::copy_options::overwrite_existing);
+  ASSERT_GT(std::filesystem::file_size(crash_log_file_name), 0u);
+  delete engine;
+
+  auto recovered = new DBStorageEngine(crash_db_file_name, false);
+  ASSERT_EQ(0u, std::filesystem::file_size(crash_log_file_name));
+  ASSERT_EQ(DB_SUCCESS, recovered->catalog_mgr_->GetTable("table-1", table_info));
+  TableHeap *table_heap = table_info->GetTableHeap();
+  for (auto &row_kv : row_values) {
+    Row row(RowId(row_kv.first));
+    ASSERT_TRUE(table_heap->GetTuple(&row, nullptr));
+    ASSERT_EQ(schema->GetColumnCount(), row.GetFields().size());
+    for (size_t j = 0; j < schema->GetColumnCount(); j++) {
+      ASSERT_EQ(CmpBool::kTrue, row.GetField(j)->CompareEquals(row_kv.second.at(j)));
+    }
+  }
+  int count = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); ++iter) {
+    count++;
+  }
+  ASSERT_EQ(row_nums, count);
+  delete recovered;
+  remove(db_file_name.c_str());
+  remove(log_file_name.c_str());
+  remove(crash_db_file_name.c_str());
+  remove(crash_log_file_name.c_str());
+}
@@ -0,0 +1,128 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/instance.h"
+#include "executor/executors/seq_scan_executor.h"
+#include "gtest/gtest.h"
+#include "storage/table_heap.h"
+#include "utils/mem_heap.h"
+
+static const std::string db_file_name = "mem_heap_test.db";
+static const std::string log_file_name = "mem_heap_test.log";
+
+/**
+ * 统计malloc的次数，operator new和SimpleMemHeap最终都走malloc
+ */
+static std::atomic<size_t> allocations{0};
+
+extern "C" void *__libc_malloc(size_t size);
+
+extern "C" void *malloc(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+TEST(MemHeapTest, ArenaTest) {
+  ArenaMemHeap heap(1024);
+  // 分配是对齐的，并且互不重叠
+  std::vector<char *> bufs;
+  for (size_t size = 1; size <= 200; size++) {
+    auto buf = static_cast<char *>(heap.Allocate(size));
+    ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(buf) % alignof(std::max_align_t));
+    memset(buf, static_cast<int>(size), size);
+    bufs.push_back(buf);
+  }
+  // 大块单独分配，不影响当前块
+  auto large = static_cast<char *>(heap.Allocate(4096));
+  memset(large, 0xff, 4096);
+  for (size_t size = 1; size <= 200; size++) {
+    for (size_t i = 0; i < size; i++) {
+      ASSERT_EQ(static_cast<char>(size), bufs[size - 1][i]);
+    }
+  }
+  // Reset之后从保留下来的当前块的开头重新分配，不再malloc
+  heap.Reset();
+  size_t before = allocations;
+  void *first = heap.Allocate(8);
+  for (int i = 0; i < 10; i++) {
+    heap.Allocate(64);
+  }
+  ASSERT_EQ(before, allocations.load());
+  heap.Reset();
+  ASSERT_EQ(first, heap.Allocate(8));
+}
+
+/**
+ * catalog直接引用建表时传入的schema，所以schema要和engine活得一样久
+ */
+static SimpleMemHeap schema_heap;
+
+TEST(MemHeapTest, AllocationBenchmark) {
+  remove(db_file_name.c_str());
+  remove(log_file_name.c_str());
+  auto engine = new DBStorageEngine(db_file_name, true);
+  SimpleMemHeap &heap = schema_heap;
+  std::vector<Column *> columns = {
+      ALLOC_COLUMN(heap)("id", TypeId::kTypeInt, 0, false, true),
+      ALLOC_COLUMN(heap)("name", TypeId::kTypeChar, 16, 1, true, false),
+      ALLOC_COLUMN(heap)("account", TypeId::kTypeFloat, 2, true, false)
+  };
+  auto schema = ALLOC(heap, Schema)(columns);
+  TableInfo *table_info = nullptr;
+  IndexInfo *index_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, engine->catalog_mgr_->CreateTable("account", schema, nullptr, table_info));
+  ASSERT_EQ(DB_SUCCESS, engine->catalog_mgr_->CreateIndex("account", "account_id", {"id"}, nullptr, index_info));
+  const int n = 20000;
+  std::vector<std::string> names;
+  for (int i = 0; i < n; i++) {
+    names.push_back("user" + std::to_string(i));
+  }
+  // insert：和ExecuteInsert一样，先构造row插入表，再构造key插入索引
+  size_t before = allocations;
+  for (int i = 0; i < n; i++) {
+    std::vector<Field> fields;
+    fields.reserve(3);
+    fields.emplace_back(TypeId::kTypeInt, i);
+    fields.emplace_back(TypeId::kTypeChar, const_cast<char *>(names[i].c_str()), names[i].size(), true);
+    fields.emplace_back(TypeId::kTypeFloat, static_cast<float>(i));
+    Row row(fields);
+    ASSERT_TRUE(table_info->GetTableHeap()->InsertTuple(row, nullptr));
+    Row key(row, index_info->GetKeyMapping());
+    ASSERT_EQ(DB_SUCCESS, index_info->GetIndex()->InsertEntry(key, row.GetRowId(), nullptr));
+  }
+  size_t insert_allocations = allocations - before;
+  // select *：全表扫描，每一行都要反序列化
+  SeqScanExecutor seq_scan(table_info);
+  std::vector<Row> batch;
+  size_t scanned = 0;
+  before = allocations;
+  seq_scan.Init();
+  while (seq_scan.Next(&batch)) {
+    scanned += batch.size();
+  }
+  size_t scan_allocations = allocations - before;
+  ASSERT_EQ(static_cast<size_t>(n), scanned);
+  // select * where id = ?：索引点查，再从表里取出整行
+  before = allocations;
+  for (int i = 0; i < n; i++) {
+    std::vector<Field> key_fields;
+    key_fields.emplace_back(TypeId::kTypeInt, i);
+    Row key(key_fields);
+    std::vector<RowId> rids;
+    ASSERT_EQ(DB_SUCCESS, index_info->GetIndex()->ScanKey(key, rids, nullptr, "="));
+    ASSERT_EQ(1u, rids.size());
+    Row row(rids[0]);
+    ASSERT_TRUE(table_info->GetTableHeap()->GetTuple(&row, nullptr));
+    ASSERT_EQ(i, row.GetField(0)->GetInt());
+  }
+  size_t lookup_allocations = allocations - before;
+  std::cout << "Allocations per row: insert " << insert_allocations * 1.0 / n << ", seq scan "
+            << scan_allocations * 1.0 / n << ", index lookup " << lookup_allocations * 1.0 / n << std::endl;
+  delete engine;
+  remove(db_file_name.c_str());
+  remove(log_file_name.c_str());
+}